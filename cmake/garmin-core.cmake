@@ -0,0 +1,43 @@
+# garmin-core: the platform-independent pieces (sample conversion, capture
+# scratch space, the file source, resampling, echo cancellation, noise
+# suppression, auto gain, VAD, keyword spotting, phrase matching, Vosk result
+# parsing, trigger arbitration, pipeline stats). Linked into the plugin and the developer
+# tools; with GARMIN_CORE_STANDALONE it builds without OBS.
+
+add_library(garmin-core STATIC
+    src/audio-capture/audio-convert.c
+    src/audio-capture/capture-scratch.c
+    src/audio-capture/file-source.c
+    src/audio-capture/resampler.c
+    src/audio-capture/fft.c
+    src/audio-capture/echo-canceller.c
+    src/audio-capture/noise-suppressor.c
+    src/audio-capture/auto-gain.c
+    src/voice-recognition/vad.c
+    src/voice-recognition/keyword-spotter.c
+    src/voice-recognition/fuzzy-match.c
+    src/voice-recognition/vosk-json.c
+    src/voice-recognition/command-table.c
+    src/voice-recognition/phrase-detector.c
+    src/voice-recognition/phrase-index.c
+    src/replay-control/replay-request.c
+    src/replay-control/trigger-arbiter.c
+    src/diagnostics/pipeline-stats.c
+)
+target_include_directories(garmin-core PUBLIC ${CMAKE_CURRENT_SOURCE_DIR}/src)
+
+# Ends up inside the plugin's shared module
+set_target_properties(garmin-core PROPERTIES POSITION_INDEPENDENT_CODE ON)
+
+if(GARMIN_CORE_STANDALONE)
+    target_sources(garmin-core PRIVATE src/compat/obs-compat.c)
+    target_compile_definitions(garmin-core PUBLIC GARMIN_CORE_STANDALONE)
+    find_package(Threads REQUIRED)
+    target_link_libraries(garmin-core PUBLIC Threads::Threads)
+else()
+    target_link_libraries(garmin-core PUBLIC OBS::libobs)
+endif()
+
+if(NOT MSVC)
+    target_link_libraries(garmin-core PUBLIC m)
+endif()
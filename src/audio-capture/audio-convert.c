@@ -0,0 +1,600 @@
+#include "audio-convert.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define CONVERT_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define CONVERT_NEON
+#endif
+
+// The SIMD paths must reproduce the scalar arithmetic exactly:
+//  - float: sum channels left to right, scale by 1/channels, clamp, then
+//    truncate `v * 32767` (NaN clamps to -1, as the SSE min/max do)
+//  - integer: reduce each sample to 16 bits, sum, divide truncating to zero
+
+// ---------------------------------------------------------------------------
+// Scalar
+
+static inline short f32_to_s16(float v)
+{
+    v = v > -1.0f ? v : -1.0f;
+    v = v < 1.0f ? v : 1.0f;
+    return (short)(v * 32767.0f);
+}
+
+static inline int s24_to_s16(const unsigned char *p)
+{
+    // Top 16 bits of the 24-bit sample, sign taken from the high byte
+    return (int)(((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 16;
+}
+
+static inline short average(int sum, int channels)
+{
+    return (short)(channels == 1 ? sum : sum / channels);
+}
+
+static void downmix_f32_scalar(const void *src, short *dst, int frames, int channels)
+{
+    const float *in = src;
+    const float scale = 1.0f / (float)channels;
+
+    for (int i = 0; i < frames; i++, in += channels) {
+        float sum = in[0];
+        for (int c = 1; c < channels; c++) {
+            sum += in[c];
+        }
+        dst[i] = f32_to_s16(sum * scale);
+    }
+}
+
+static void downmix_s32_scalar(const void *src, short *dst, int frames, int channels)
+{
+    const int32_t *in = src;
+
+    for (int i = 0; i < frames; i++, in += channels) {
+        int sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += in[c] >> 16;
+        }
+        dst[i] = average(sum, channels);
+    }
+}
+
+static void downmix_s24_scalar(const void *src, short *dst, int frames, int channels)
+{
+    const unsigned char *in = src;
+
+    for (int i = 0; i < frames; i++) {
+        int sum = 0;
+        for (int c = 0; c < channels; c++, in += 3) {
+            sum += s24_to_s16(in);
+        }
+        dst[i] = average(sum, channels);
+    }
+}
+
+static void downmix_s16_scalar(const void *src, short *dst, int frames, int channels)
+{
+    const short *in = src;
+
+    if (channels == 1) {
+        memcpy(dst, in, (size_t)frames * sizeof(short));
+        return;
+    }
+
+    for (int i = 0; i < frames; i++, in += channels) {
+        int sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += in[c];
+        }
+        dst[i] = average(sum, channels);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 (baseline on x86-64)
+
+#ifdef CONVERT_X86
+
+static inline __m128i f32x4_to_s32_sse2(__m128 v, __m128 scale)
+{
+    v = _mm_mul_ps(v, scale);
+    v = _mm_max_ps(v, _mm_set1_ps(-1.0f));
+    v = _mm_min_ps(v, _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(32767.0f)));
+}
+
+// (a + b) / 2 rounded toward zero, like C integer division
+static inline __m128i half_sse2(__m128i sum)
+{
+    return _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+}
+
+// sum / channels rounded toward zero. The sums stay far below 2^24, so the
+// float quotient is never close enough to an integer to truncate wrongly.
+static inline __m128i divide_sse2(__m128i sum, __m128 channels)
+{
+    return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sum), channels));
+}
+
+static void downmix_f32_sse2(const void *src, short *dst, int frames, int channels)
+{
+    const float *in = src;
+    const __m128 scale = _mm_set1_ps(1.0f / (float)channels);
+    int i = 0;
+
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            __m128i lo = f32x4_to_s32_sse2(_mm_loadu_ps(in + i), scale);
+            __m128i hi = f32x4_to_s32_sse2(_mm_loadu_ps(in + i + 4), scale);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in + i * 2);
+            __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+            __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i v = f32x4_to_s32_sse2(_mm_add_ps(left, right), scale);
+            _mm_storel_epi64((__m128i *)(dst + i), _mm_packs_epi32(v, v));
+        }
+    } else {
+        for (; i + 4 <= frames; i += 4) {
+            const float *f = in + i * channels;
+            __m128 sum = _mm_setr_ps(f[0], f[channels], f[channels * 2], f[channels * 3]);
+            for (int c = 1; c < channels; c++) {
+                sum = _mm_add_ps(sum, _mm_setr_ps(f[c], f[channels + c],
+                                                  f[channels * 2 + c], f[channels * 3 + c]));
+            }
+            __m128i v = f32x4_to_s32_sse2(sum, scale);
+            _mm_storel_epi64((__m128i *)(dst + i), _mm_packs_epi32(v, v));
+        }
+    }
+
+    downmix_f32_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+static void downmix_s32_sse2(const void *src, short *dst, int frames, int channels)
+{
+    const int32_t *in = src;
+    int i = 0;
+
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            __m128i lo = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i)), 16);
+            __m128i hi = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i + 4)), 16);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i * 2)), 16);
+            __m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(in + i * 2 + 4)), 16);
+            __m128 af = _mm_castsi128_ps(a);
+            __m128 bf = _mm_castsi128_ps(b);
+            __m128i left = _mm_castps_si128(_mm_shuffle_ps(af, bf, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i right = _mm_castps_si128(_mm_shuffle_ps(af, bf, _MM_SHUFFLE(3, 1, 3, 1)));
+            __m128i v = half_sse2(_mm_add_epi32(left, right));
+            _mm_storel_epi64((__m128i *)(dst + i), _mm_packs_epi32(v, v));
+        }
+    } else {
+        const __m128 divisor = _mm_set1_ps((float)channels);
+        for (; i + 4 <= frames; i += 4) {
+            const int32_t *f = in + i * channels;
+            __m128i sum = _mm_setzero_si128();
+            for (int c = 0; c < channels; c++) {
+                __m128i v = _mm_setr_epi32(f[c], f[channels + c],
+                                           f[channels * 2 + c], f[channels * 3 + c]);
+                sum = _mm_add_epi32(sum, _mm_srai_epi32(v, 16));
+            }
+            __m128i v = divide_sse2(sum, divisor);
+            _mm_storel_epi64((__m128i *)(dst + i), _mm_packs_epi32(v, v));
+        }
+    }
+
+    downmix_s32_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+static void downmix_s16_sse2(const void *src, short *dst, int frames, int channels)
+{
+    const short *in = src;
+    int i = 0;
+
+    if (channels == 2) {
+        // madd against ones sums each left/right pair into 32 bits
+        const __m128i ones = _mm_set1_epi16(1);
+        for (; i + 8 <= frames; i += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(in + i * 2));
+            __m128i b = _mm_loadu_si128((const __m128i *)(in + i * 2 + 8));
+            __m128i lo = half_sse2(_mm_madd_epi16(a, ones));
+            __m128i hi = half_sse2(_mm_madd_epi16(b, ones));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+        }
+    } else if (channels > 2) {
+        const __m128 divisor = _mm_set1_ps((float)channels);
+        for (; i + 4 <= frames; i += 4) {
+            const short *f = in + i * channels;
+            __m128i sum = _mm_setzero_si128();
+            for (int c = 0; c < channels; c++) {
+                sum = _mm_add_epi32(sum, _mm_setr_epi32(f[c], f[channels + c],
+                                                        f[channels * 2 + c],
+                                                        f[channels * 3 + c]));
+            }
+            __m128i v = divide_sse2(sum, divisor);
+            _mm_storel_epi64((__m128i *)(dst + i), _mm_packs_epi32(v, v));
+        }
+    }
+
+    downmix_s16_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2
+
+TARGET_AVX2
+static void downmix_f32_avx2(const void *src, short *dst, int frames, int channels)
+{
+    const float *in = src;
+    const __m256 scale = _mm256_set1_ps(1.0f / (float)channels);
+    const __m256 lower = _mm256_set1_ps(-1.0f);
+    const __m256 upper = _mm256_set1_ps(1.0f);
+    const __m256 full_scale = _mm256_set1_ps(32767.0f);
+    const __m256i stride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                              _mm256_set1_epi32(channels));
+    int i = 0;
+
+    for (; i + 8 <= frames; i += 8) {
+        __m256 sum;
+
+        if (channels == 1) {
+            sum = _mm256_loadu_ps(in + i);
+        } else if (channels == 2) {
+            // In-lane shuffles leave frames ordered 0 1 4 5 | 2 3 6 7
+            __m256 a = _mm256_loadu_ps(in + i * 2);
+            __m256 b = _mm256_loadu_ps(in + i * 2 + 8);
+            __m256 left = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m256 right = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            sum = _mm256_add_ps(left, right);
+            sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum),
+                                                         _MM_SHUFFLE(3, 1, 2, 0)));
+        } else {
+            const float *f = in + i * channels;
+            sum = _mm256_i32gather_ps(f, stride, 4);
+            for (int c = 1; c < channels; c++) {
+                sum = _mm256_add_ps(sum, _mm256_i32gather_ps(f + c, stride, 4));
+            }
+        }
+
+        __m256 v = _mm256_mul_ps(sum, scale);
+        v = _mm256_max_ps(v, lower);
+        v = _mm256_min_ps(v, upper);
+        __m256i s = _mm256_cvttps_epi32(_mm256_mul_ps(v, full_scale));
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(s),
+                                         _mm256_extracti128_si256(s, 1));
+        _mm_storeu_si128((__m128i *)(dst + i), packed);
+    }
+
+    downmix_f32_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+TARGET_AVX2
+static void downmix_s32_avx2(const void *src, short *dst, int frames, int channels)
+{
+    const int32_t *in = src;
+    int i = 0;
+
+    if (channels > 2) {
+        downmix_s32_sse2(src, dst, frames, channels);
+        return;
+    }
+
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            __m256i v = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(in + i)), 16);
+            _mm_storeu_si128((__m128i *)(dst + i),
+                             _mm_packs_epi32(_mm256_castsi256_si128(v),
+                                             _mm256_extracti128_si256(v, 1)));
+        }
+    } else if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            __m256i a = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(in + i * 2)), 16);
+            __m256i b = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(in + i * 2 + 8)), 16);
+            // Pairwise sums, in-lane order 0 1 4 5 | 2 3 6 7
+            __m256i sum = _mm256_hadd_epi32(a, b);
+            sum = _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0));
+            sum = _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_srli_epi32(sum, 31)), 1);
+            _mm_storeu_si128((__m128i *)(dst + i),
+                             _mm_packs_epi32(_mm256_castsi256_si128(sum),
+                                             _mm256_extracti128_si256(sum, 1)));
+        }
+    }
+
+    downmix_s32_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+TARGET_AVX2
+static void downmix_s16_avx2(const void *src, short *dst, int frames, int channels)
+{
+    const short *in = src;
+    int i = 0;
+
+    if (channels > 2) {
+        downmix_s16_sse2(src, dst, frames, channels);
+        return;
+    }
+
+    if (channels == 2) {
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (; i + 8 <= frames; i += 8) {
+            __m256i sum = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(in + i * 2)),
+                                            ones);
+            sum = _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_srli_epi32(sum, 31)), 1);
+            _mm_storeu_si128((__m128i *)(dst + i),
+                             _mm_packs_epi32(_mm256_castsi256_si128(sum),
+                                             _mm256_extracti128_si256(sum, 1)));
+        }
+    }
+
+    downmix_s16_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+static bool cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                        (_xgetbv(0) & 6) == 6;
+    if (!os_saves_ymm) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & (1u << 27)) || !(c & (1u << 28))) {
+        return false;
+    }
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        return false;
+    }
+    return (b & (1u << 5)) != 0;
+#endif
+}
+
+#endif // CONVERT_X86
+
+// ---------------------------------------------------------------------------
+// NEON
+
+#ifdef CONVERT_NEON
+
+static inline int32x4_t f32x4_to_s32_neon(float32x4_t v, float32x4_t scale)
+{
+    const float32x4_t lower = vdupq_n_f32(-1.0f);
+    const float32x4_t upper = vdupq_n_f32(1.0f);
+
+    // Compare-and-select so NaN clamps to -1 like the scalar path
+    v = vmulq_f32(v, scale);
+    v = vbslq_f32(vcgtq_f32(v, lower), v, lower);
+    v = vbslq_f32(vcltq_f32(v, upper), v, upper);
+    return vcvtq_s32_f32(vmulq_f32(v, vdupq_n_f32(32767.0f)));
+}
+
+static inline int32x4_t half_neon(int32x4_t sum)
+{
+    uint32x4_t sign = vshrq_n_u32(vreinterpretq_u32_s32(sum), 31);
+    return vshrq_n_s32(vaddq_s32(sum, vreinterpretq_s32_u32(sign)), 1);
+}
+
+static void downmix_f32_neon(const void *src, short *dst, int frames, int channels)
+{
+    const float *in = src;
+    const float32x4_t scale = vdupq_n_f32(1.0f / (float)channels);
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t sum;
+
+        if (channels == 1) {
+            sum = vld1q_f32(in + i);
+        } else if (channels == 2) {
+            float32x4x2_t lr = vld2q_f32(in + i * 2);
+            sum = vaddq_f32(lr.val[0], lr.val[1]);
+        } else {
+            const float *f = in + i * channels;
+            float lanes[4] = {f[0], f[channels], f[channels * 2], f[channels * 3]};
+            sum = vld1q_f32(lanes);
+            for (int c = 1; c < channels; c++) {
+                float next[4] = {f[c], f[channels + c], f[channels * 2 + c], f[channels * 3 + c]};
+                sum = vaddq_f32(sum, vld1q_f32(next));
+            }
+        }
+
+        vst1_s16(dst + i, vmovn_s32(f32x4_to_s32_neon(sum, scale)));
+    }
+
+    downmix_f32_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+static void downmix_s32_neon(const void *src, short *dst, int frames, int channels)
+{
+    const int32_t *in = src;
+    int i = 0;
+
+    if (channels == 1) {
+        for (; i + 4 <= frames; i += 4) {
+            vst1_s16(dst + i, vshrn_n_s32(vld1q_s32(in + i), 16));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            int32x4x2_t lr = vld2q_s32(in + i * 2);
+            int32x4_t sum = vaddq_s32(vshrq_n_s32(lr.val[0], 16), vshrq_n_s32(lr.val[1], 16));
+            vst1_s16(dst + i, vmovn_s32(half_neon(sum)));
+        }
+    }
+
+    downmix_s32_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+static void downmix_s16_neon(const void *src, short *dst, int frames, int channels)
+{
+    const short *in = src;
+    int i = 0;
+
+    if (channels == 2) {
+        for (; i + 8 <= frames; i += 8) {
+            int16x8x2_t lr = vld2q_s16(in + i * 2);
+            int32x4_t lo = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+            int32x4_t hi = vaddl_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[1]));
+            vst1q_s16(dst + i, vcombine_s16(vmovn_s32(half_neon(lo)),
+                                            vmovn_s32(half_neon(hi))));
+        }
+    }
+
+    downmix_s16_scalar(in + i * channels, dst + i, frames - i, channels);
+}
+
+#endif // CONVERT_NEON
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+// Indexed by audio_sample_format; NULL entries fall back to scalar.
+// Packed 24-bit has no useful vector load and stays scalar everywhere.
+static const audio_downmix_fn KERNELS[AUDIO_ISA_COUNT][AUDIO_SAMPLE_FORMAT_COUNT] = {
+    [AUDIO_ISA_SCALAR] = {downmix_s16_scalar, downmix_s24_scalar,
+                          downmix_s32_scalar, downmix_f32_scalar},
+#ifdef CONVERT_X86
+    [AUDIO_ISA_SSE2] = {downmix_s16_sse2, NULL, downmix_s32_sse2, downmix_f32_sse2},
+    [AUDIO_ISA_AVX2] = {downmix_s16_avx2, NULL, downmix_s32_avx2, downmix_f32_avx2},
+#endif
+#ifdef CONVERT_NEON
+    [AUDIO_ISA_NEON] = {downmix_s16_neon, NULL, downmix_s32_neon, downmix_f32_neon},
+#endif
+};
+
+bool audio_convert_isa_available(enum audio_convert_isa isa)
+{
+    switch (isa) {
+    case AUDIO_ISA_SCALAR:
+        return true;
+#ifdef CONVERT_X86
+    case AUDIO_ISA_SSE2:
+        return true;
+    case AUDIO_ISA_AVX2: {
+        static int has_avx2 = -1;
+        if (has_avx2 < 0) {
+            has_avx2 = cpu_has_avx2() ? 1 : 0;
+        }
+        return has_avx2 == 1;
+    }
+#endif
+#ifdef CONVERT_NEON
+    case AUDIO_ISA_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+audio_downmix_fn audio_convert_get(enum audio_sample_format format,
+                                   enum audio_convert_isa isa)
+{
+    if ((int)format < 0 || format >= AUDIO_SAMPLE_FORMAT_COUNT ||
+        (int)isa < 0 || isa >= AUDIO_ISA_COUNT || !audio_convert_isa_available(isa)) {
+        return NULL;
+    }
+
+    audio_downmix_fn fn = KERNELS[isa][format];
+    return fn ? fn : KERNELS[AUDIO_ISA_SCALAR][format];
+}
+
+audio_downmix_fn audio_convert_select(enum audio_sample_format format,
+                                      enum audio_convert_isa *isa)
+{
+    static const enum audio_convert_isa PREFERENCE[] = {
+        AUDIO_ISA_AVX2, AUDIO_ISA_NEON, AUDIO_ISA_SSE2, AUDIO_ISA_SCALAR,
+    };
+
+    for (size_t i = 0; i < sizeof(PREFERENCE) / sizeof(PREFERENCE[0]); i++) {
+        if ((int)format >= 0 && format < AUDIO_SAMPLE_FORMAT_COUNT &&
+            audio_convert_isa_available(PREFERENCE[i]) && KERNELS[PREFERENCE[i]][format]) {
+            if (isa) {
+                *isa = PREFERENCE[i];
+            }
+            return KERNELS[PREFERENCE[i]][format];
+        }
+    }
+
+    return NULL;
+}
+
+int audio_sample_format_size(enum audio_sample_format format)
+{
+    switch (format) {
+    case AUDIO_SAMPLE_S16:
+        return 2;
+    case AUDIO_SAMPLE_S24:
+        return 3;
+    case AUDIO_SAMPLE_S32:
+    case AUDIO_SAMPLE_F32:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+const char *audio_sample_format_name(enum audio_sample_format format)
+{
+    switch (format) {
+    case AUDIO_SAMPLE_S16:
+        return "s16";
+    case AUDIO_SAMPLE_S24:
+        return "s24";
+    case AUDIO_SAMPLE_S32:
+        return "s32";
+    case AUDIO_SAMPLE_F32:
+        return "f32";
+    default:
+        return "unknown";
+    }
+}
+
+const char *audio_convert_isa_name(enum audio_convert_isa isa)
+{
+    switch (isa) {
+    case AUDIO_ISA_SCALAR:
+        return "scalar";
+    case AUDIO_ISA_SSE2:
+        return "SSE2";
+    case AUDIO_ISA_AVX2:
+        return "AVX2";
+    case AUDIO_ISA_NEON:
+        return "NEON";
+    default:
+        return "unknown";
+    }
+}
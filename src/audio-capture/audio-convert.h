@@ -0,0 +1,51 @@
+#ifndef AUDIO_CONVERT_H
+#define AUDIO_CONVERT_H
+
+#include <stdbool.h>
+
+// Fused sample-format conversion + downmix kernels shared by all audio
+// source backends. Interleaved input at any channel count becomes 16-bit
+// mono in one pass. Pick a kernel once when the stream format is known;
+// every ISA variant produces output bit-identical to the scalar one.
+
+enum audio_sample_format {
+    AUDIO_SAMPLE_S16,  // 16-bit signed
+    AUDIO_SAMPLE_S24,  // 24-bit signed, packed in 3 bytes
+    AUDIO_SAMPLE_S32,  // 32-bit signed (also 24-in-32 containers)
+    AUDIO_SAMPLE_F32,  // 32-bit float, -1.0 .. 1.0
+    AUDIO_SAMPLE_FORMAT_COUNT,
+};
+
+enum audio_convert_isa {
+    AUDIO_ISA_SCALAR,
+    AUDIO_ISA_SSE2,
+    AUDIO_ISA_AVX2,
+    AUDIO_ISA_NEON,
+    AUDIO_ISA_COUNT,
+};
+
+// src: `frames` interleaved frames of `channels` samples
+// dst: `frames` mono samples (the channel average)
+typedef void (*audio_downmix_fn)(const void *src, short *dst, int frames, int channels);
+
+// Best kernel for this CPU
+// isa: Optional, receives the instruction set that was selected
+audio_downmix_fn audio_convert_select(enum audio_sample_format format,
+                                      enum audio_convert_isa *isa);
+
+// Kernel for a specific instruction set (benchmarks and exactness checks)
+// Returns: NULL if the ISA is not available on this CPU/build
+audio_downmix_fn audio_convert_get(enum audio_sample_format format,
+                                   enum audio_convert_isa isa);
+
+// Whether this CPU and build can run an instruction set (the FFT kernels
+// dispatch on the same ISAs)
+bool audio_convert_isa_available(enum audio_convert_isa isa);
+
+// Bytes per sample of one channel
+int audio_sample_format_size(enum audio_sample_format format);
+
+const char *audio_sample_format_name(enum audio_sample_format format);
+const char *audio_convert_isa_name(enum audio_convert_isa isa);
+
+#endif // AUDIO_CONVERT_H
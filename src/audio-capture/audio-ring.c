@@ -0,0 +1,123 @@
+#include "audio-ring.h"
+
+#include <util/threading.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct audio_ring {
+    struct audio_frame *frames;
+    long mask;
+
+    // Free-running positions; only the producer writes write_pos and only
+    // the consumer writes read_pos. Wraparound is harmless because the
+    // capacity is a power of two.
+    volatile long write_pos;
+    volatile long read_pos;
+
+    volatile long overflows;
+    os_event_t *data_event;
+};
+
+audio_ring_t *audio_ring_create(int capacity_frames)
+{
+    if (capacity_frames < 2) {
+        capacity_frames = 2;
+    }
+
+    long capacity = 1;
+    while (capacity < capacity_frames) {
+        capacity <<= 1;
+    }
+
+    audio_ring_t *ring = calloc(1, sizeof(audio_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+
+    ring->frames = calloc((size_t)capacity, sizeof(struct audio_frame));
+    ring->mask = capacity - 1;
+
+    if (!ring->frames || os_event_init(&ring->data_event, OS_EVENT_TYPE_AUTO) != 0) {
+        free(ring->frames);
+        free(ring);
+        return NULL;
+    }
+
+    return ring;
+}
+
+bool audio_ring_push(audio_ring_t *ring, const struct audio_frame *frame)
+{
+    long write_pos = ring->write_pos;
+    long read_pos = os_atomic_load_long(&ring->read_pos);
+
+    if ((unsigned long)(write_pos - read_pos) > (unsigned long)ring->mask) {
+        os_atomic_inc_long(&ring->overflows);
+        return false;
+    }
+
+    memcpy(&ring->frames[write_pos & ring->mask], frame, sizeof(*frame));
+
+    // Publish the frame before the position the consumer checks
+    os_atomic_set_long(&ring->write_pos, (long)((unsigned long)write_pos + 1));
+    os_event_signal(ring->data_event);
+    return true;
+}
+
+bool audio_ring_pop(audio_ring_t *ring, struct audio_frame *frame)
+{
+    long read_pos = ring->read_pos;
+    long write_pos = os_atomic_load_long(&ring->write_pos);
+
+    if (read_pos == write_pos) {
+        return false;
+    }
+
+    memcpy(frame, &ring->frames[read_pos & ring->mask], sizeof(*frame));
+    os_atomic_set_long(&ring->read_pos, (long)((unsigned long)read_pos + 1));
+    return true;
+}
+
+bool audio_ring_wait(audio_ring_t *ring, unsigned long timeout_ms)
+{
+    if (audio_ring_count(ring) > 0) {
+        return true;
+    }
+
+    os_event_timedwait(ring->data_event, timeout_ms);
+    return audio_ring_count(ring) > 0;
+}
+
+void audio_ring_wake(audio_ring_t *ring)
+{
+    os_event_signal(ring->data_event);
+}
+
+int audio_ring_count(audio_ring_t *ring)
+{
+    long write_pos = os_atomic_load_long(&ring->write_pos);
+    long read_pos = os_atomic_load_long(&ring->read_pos);
+    return (int)(unsigned long)(write_pos - read_pos);
+}
+
+int audio_ring_capacity(audio_ring_t *ring)
+{
+    return (int)ring->mask + 1;
+}
+
+long audio_ring_get_overflows(audio_ring_t *ring)
+{
+    return os_atomic_load_long(&ring->overflows);
+}
+
+void audio_ring_destroy(audio_ring_t *ring)
+{
+    if (!ring) {
+        return;
+    }
+
+    os_event_destroy(ring->data_event);
+    free(ring->frames);
+    free(ring);
+}
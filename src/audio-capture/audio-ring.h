@@ -0,0 +1,52 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring of fixed 10ms frames.
+// The capture thread pushes, the recognition thread pops; neither blocks
+// the other, and a full ring drops (and counts) new frames instead.
+
+// 10ms at 16kHz
+#define AUDIO_FRAME_SAMPLES 160
+
+struct audio_frame {
+    uint64_t timestamp_ns;  // Capture time of samples[0]
+    short samples[AUDIO_FRAME_SAMPLES];
+};
+
+// Opaque handle to a ring instance
+typedef struct audio_ring audio_ring_t;
+
+// Create a ring holding at least capacity_frames frames (rounded up to a power of two)
+audio_ring_t *audio_ring_create(int capacity_frames);
+
+// Producer: copy a frame in and wake the consumer
+// Returns: false if the ring was full and the frame was dropped
+bool audio_ring_push(audio_ring_t *ring, const struct audio_frame *frame);
+
+// Consumer: copy the oldest frame out
+// Returns: false if the ring is empty
+bool audio_ring_pop(audio_ring_t *ring, struct audio_frame *frame);
+
+// Consumer: wait until a frame is available or the timeout expires
+// Returns: true if at least one frame is available
+bool audio_ring_wait(audio_ring_t *ring, unsigned long timeout_ms);
+
+// Wake a consumer blocked in audio_ring_wait() without pushing
+void audio_ring_wake(audio_ring_t *ring);
+
+// Frames currently queued
+int audio_ring_count(audio_ring_t *ring);
+
+// Frames the ring can hold
+int audio_ring_capacity(audio_ring_t *ring);
+
+// Frames dropped because the ring was full
+long audio_ring_get_overflows(audio_ring_t *ring);
+
+// Destroy the ring and free resources
+void audio_ring_destroy(audio_ring_t *ring);
+
+#endif // AUDIO_RING_H
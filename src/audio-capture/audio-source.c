@@ -0,0 +1,478 @@
+#include "audio-source.h"
+#include "audio-ring.h"
+#include "../diagnostics/pipeline-stats.h"
+#include "../diagnostics/trace.h"
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// ~5 seconds of audio between capture and recognition
+#define RING_CAPACITY_FRAMES 512
+
+// Largest single backend read (a fully drained 100ms WASAPI buffer is 1600)
+#define STAGING_SAMPLES 8192
+
+// How long a reader waits for audio before reporting an underrun
+#define READ_TIMEOUT_MS 100
+
+#define NS_PER_SAMPLE (1000000000ULL / AUDIO_SOURCE_SAMPLE_RATE)
+
+// Reopen backoff after a device fault. The first attempt is immediate
+// (a changed default device is there right away), then the wait doubles.
+#define RECOVER_BACKOFF_MIN_MS 100
+#define RECOVER_BACKOFF_MAX_MS 5000
+
+// Lost devices are retried until the source is stopped; other errors get
+// this many reopens before capture gives up
+#define RECOVER_MAX_ERROR_ATTEMPTS 5
+
+// A fault sooner than this after the last recovery continues its backoff
+// instead of retrying at full speed (a device that keeps dropping out)
+#define RECOVER_STABLE_NS 10000000000ULL
+
+struct audio_source {
+    const struct audio_source_ops *ops;
+    void *data;
+
+    // Private copy of the config; the backend is created on the capture thread
+    struct audio_source_config config;
+    char *device_id;
+    char *source_name;
+    char *path;
+
+    audio_ring_t *ring;
+
+    // Capture thread
+    pthread_t thread;
+    bool thread_active;
+    volatile bool running;
+    volatile bool ended;
+    volatile bool failed;
+    os_event_t *started_event;
+    os_event_t *stop_event;
+    bool start_ok;
+
+    // Offline inputs wait for the reader instead of dropping frames
+    bool wait_when_full;
+
+    // Producer side: frame being filled
+    struct audio_frame pending;
+    int pending_count;
+    short staging[STAGING_SAMPLES];
+
+    volatile long frames_captured;
+    volatile long underruns;
+
+    // Fault recovery (capture thread writes, any thread reads)
+    volatile bool recovering;
+    volatile long faults;
+    volatile long reconnects;
+    volatile long reopen_attempts;
+    volatile long last_recovery_ms;
+    volatile long max_recovery_ms;
+    uint64_t recovered_ns;
+    int backoff_ms;
+};
+
+const struct audio_source_ops *audio_source_find_ops(enum audio_source_type type)
+{
+    switch (type) {
+#ifdef _WIN32
+    case AUDIO_SOURCE_WASAPI:
+        return &wasapi_source_ops;
+#endif
+    case AUDIO_SOURCE_FILE:
+        return &file_source_ops;
+    case AUDIO_SOURCE_OBS:
+        return &obs_tap_source_ops;
+    default:
+        return NULL;
+    }
+}
+
+audio_source_t *audio_source_create(const struct audio_source_config *config)
+{
+    if (!config) {
+        return NULL;
+    }
+
+    // Fault injection wraps whatever backend the type picks
+    const struct audio_source_ops *ops = config->fault_interval_ms > 0 ?
+        &fault_source_ops : audio_source_find_ops(config->type);
+    if (!ops || !audio_source_find_ops(config->type)) {
+        blog(LOG_ERROR, "[Garmin Replay] Audio source type %d is not available on this platform",
+             (int)config->type);
+        return NULL;
+    }
+
+    audio_source_t *source = calloc(1, sizeof(audio_source_t));
+    if (!source) {
+        return NULL;
+    }
+
+    source->ops = ops;
+    source->config = *config;
+    source->device_id = config->device_id ? bstrdup(config->device_id) : NULL;
+    source->source_name = config->source_name ? bstrdup(config->source_name) : NULL;
+    source->path = config->path ? bstrdup(config->path) : NULL;
+    source->config.device_id = source->device_id;
+    source->config.source_name = source->source_name;
+    source->config.path = source->path;
+    source->wait_when_full = (config->type == AUDIO_SOURCE_FILE && !config->realtime);
+
+    source->ring = audio_ring_create(RING_CAPACITY_FRAMES);
+    if (!source->ring || os_event_init(&source->started_event, OS_EVENT_TYPE_MANUAL) != 0 ||
+        os_event_init(&source->stop_event, OS_EVENT_TYPE_MANUAL) != 0) {
+        audio_source_destroy(source);
+        return NULL;
+    }
+
+    return source;
+}
+
+static void push_frame(audio_source_t *source)
+{
+    while (source->wait_when_full && source->running &&
+           audio_ring_count(source->ring) >= audio_ring_capacity(source->ring)) {
+        os_sleep_ms(1);
+    }
+
+    if (!audio_ring_push(source->ring, &source->pending)) {
+        pipeline_stats_add(COUNTER_OVERFLOWS, 1);
+    }
+    os_atomic_inc_long(&source->frames_captured);
+    source->pending_count = 0;
+}
+
+// Slice backend output into 10ms frames with per-frame timestamps
+static void push_samples(audio_source_t *source, const short *samples, int count,
+                         uint64_t timestamp_ns)
+{
+    int offset = 0;
+
+    while (offset < count) {
+        if (source->pending_count == 0) {
+            source->pending.timestamp_ns = timestamp_ns + (uint64_t)offset * NS_PER_SAMPLE;
+        }
+
+        int space = AUDIO_FRAME_SAMPLES - source->pending_count;
+        int n = count - offset < space ? count - offset : space;
+        memcpy(source->pending.samples + source->pending_count, samples + offset,
+               n * sizeof(short));
+        source->pending_count += n;
+        offset += n;
+
+        if (source->pending_count == AUDIO_FRAME_SAMPLES) {
+            push_frame(source);
+        }
+    }
+}
+
+// Capture thread: the backend's read failed with `code`; rebuild it and keep
+// going. The ring and whatever reads it are untouched, so recognition just
+// sees a stretch without audio.
+// Returns: false to give up (no reopen, stopped, or the errors persist)
+static bool recover(audio_source_t *source, int code)
+{
+    if (!source->ops->reopen) {
+        return false;
+    }
+
+    uint64_t fault_ns = os_gettime_ns();
+    bool lost = code == AUDIO_SOURCE_LOST;
+    bool flapping = source->recovered_ns && fault_ns - source->recovered_ns < RECOVER_STABLE_NS;
+    if (!flapping) {
+        source->backoff_ms = RECOVER_BACKOFF_MIN_MS;
+    }
+
+    os_atomic_inc_long(&source->faults);
+    os_atomic_set_bool(&source->recovering, true);
+    blog(LOG_WARNING, "[Garmin Replay] %s capture %s, reconnecting", source->ops->name,
+         lost ? "lost its device" : "failed");
+
+    // The partial frame would straddle the gap
+    source->pending_count = 0;
+
+    int attempts = 0;
+    bool ok = false;
+    bool wait = flapping;
+    while (source->running) {
+        if (wait) {
+            // audio_source_stop() cuts this short
+            os_event_timedwait(source->stop_event, (unsigned long)source->backoff_ms);
+            source->backoff_ms = source->backoff_ms * 2 < RECOVER_BACKOFF_MAX_MS ?
+                source->backoff_ms * 2 : RECOVER_BACKOFF_MAX_MS;
+            if (!source->running) {
+                break;
+            }
+        }
+        wait = true;
+
+        attempts++;
+        os_atomic_inc_long(&source->reopen_attempts);
+        if (source->ops->reopen(source->data)) {
+            ok = true;
+            break;
+        }
+        if (!lost && attempts >= RECOVER_MAX_ERROR_ATTEMPTS) {
+            break;
+        }
+    }
+
+    os_atomic_set_bool(&source->recovering, false);
+    if (!ok) {
+        if (source->running) {
+            blog(LOG_ERROR, "[Garmin Replay] %s capture did not come back after %d attempts",
+                 source->ops->name, attempts);
+        }
+        return false;
+    }
+
+    source->recovered_ns = os_gettime_ns();
+    uint64_t recovery_ns = source->recovered_ns - fault_ns;
+    long recovery_ms = (long)(recovery_ns / 1000000);
+    pipeline_stats_record(STAGE_RECONNECT, recovery_ns);
+    os_atomic_inc_long(&source->reconnects);
+    os_atomic_set_long(&source->last_recovery_ms, recovery_ms);
+    if (recovery_ms > os_atomic_load_long(&source->max_recovery_ms)) {
+        os_atomic_set_long(&source->max_recovery_ms, recovery_ms);
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] %s capture back after %ld ms (%d attempt%s)",
+         source->ops->name, recovery_ms, attempts, attempts == 1 ? "" : "s");
+    return true;
+}
+
+static void *capture_thread_func(void *param)
+{
+    audio_source_t *source = param;
+
+    os_set_thread_name("garmin-capture");
+
+    // Create the backend here so thread-affine APIs (COM) live on one thread
+    source->data = source->ops->create(&source->config);
+    source->start_ok = source->data && source->ops->start(source->data);
+    os_event_signal(source->started_event);
+
+    if (!source->start_ok) {
+        if (source->data) {
+            source->ops->destroy(source->data);
+            source->data = NULL;
+        }
+        return NULL;
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] Capture thread started (%s)", source->ops->name);
+
+    while (source->running) {
+        uint64_t timestamp_ns = 0;
+        int samples = source->ops->read(source->data, source->staging, STAGING_SAMPLES,
+                                        &timestamp_ns);
+
+        if (samples == AUDIO_SOURCE_END) {
+            // Pad out the tail so the last few milliseconds are not lost
+            if (source->pending_count > 0) {
+                memset(source->pending.samples + source->pending_count, 0,
+                       (AUDIO_FRAME_SAMPLES - source->pending_count) * sizeof(short));
+                push_frame(source);
+            }
+            os_atomic_set_bool(&source->ended, true);
+            break;
+        }
+
+        if (samples < 0) {
+            if (recover(source, samples)) {
+                continue;
+            }
+            if (source->running) {
+                blog(LOG_ERROR, "[Garmin Replay] %s capture failed", source->ops->name);
+                os_atomic_set_bool(&source->failed, true);
+            }
+            break;
+        }
+
+        if (samples > 0) {
+            push_samples(source, source->staging, samples, timestamp_ns);
+
+            // From the device's capture time to the frames being queued
+            TRACE_SPAN(TRACE_THREAD_CAPTURE, "capture", timestamp_ns, os_gettime_ns(),
+                       "samples", samples);
+        }
+    }
+
+    audio_ring_wake(source->ring);
+
+    source->ops->stop(source->data);
+    source->ops->destroy(source->data);
+    source->data = NULL;
+
+    blog(LOG_INFO, "[Garmin Replay] Capture thread stopped (%s)", source->ops->name);
+    return NULL;
+}
+
+bool audio_source_start(audio_source_t *source)
+{
+    if (!source || source->thread_active) {
+        return false;
+    }
+
+    source->running = true;
+    source->ended = false;
+    source->failed = false;
+    source->pending_count = 0;
+    source->recovered_ns = 0;
+    os_event_reset(source->started_event);
+    os_event_reset(source->stop_event);
+
+    if (pthread_create(&source->thread, NULL, capture_thread_func, source) != 0) {
+        source->running = false;
+        blog(LOG_ERROR, "[Garmin Replay] Failed to create capture thread");
+        return false;
+    }
+    source->thread_active = true;
+
+    // Wait for the backend to come up so failures surface here
+    os_event_wait(source->started_event);
+    if (!source->start_ok) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to start %s audio source", source->ops->name);
+        audio_source_stop(source);
+        return false;
+    }
+
+    return true;
+}
+
+// Hand out whole queued frames, as many as fit
+static int pop_frames(audio_source_t *source, short *buffer, int max_samples,
+                      uint64_t *timestamp_ns)
+{
+    struct audio_frame frame;
+    int samples = 0;
+
+    while (samples + AUDIO_FRAME_SAMPLES <= max_samples &&
+           audio_ring_pop(source->ring, &frame)) {
+        if (samples == 0 && timestamp_ns) {
+            *timestamp_ns = frame.timestamp_ns;
+        }
+        memcpy(buffer + samples, frame.samples, sizeof(frame.samples));
+        samples += AUDIO_FRAME_SAMPLES;
+    }
+
+    return samples;
+}
+
+int audio_source_read(audio_source_t *source, short *buffer, int max_samples,
+                      uint64_t *timestamp_ns)
+{
+    if (!source || !source->thread_active || max_samples < AUDIO_FRAME_SAMPLES) {
+        return AUDIO_SOURCE_ERROR;
+    }
+
+    if (!audio_ring_wait(source->ring, READ_TIMEOUT_MS)) {
+        if (os_atomic_load_bool(&source->ended)) {
+            return AUDIO_SOURCE_END;
+        }
+        if (os_atomic_load_bool(&source->failed)) {
+            return AUDIO_SOURCE_ERROR;
+        }
+        if (!os_atomic_load_bool(&source->recovering)) {
+            os_atomic_inc_long(&source->underruns);
+        }
+        return 0;
+    }
+
+    return pop_frames(source, buffer, max_samples, timestamp_ns);
+}
+
+int audio_source_poll(audio_source_t *source, short *buffer, int max_samples,
+                      uint64_t *timestamp_ns)
+{
+    if (!source || !source->thread_active || max_samples < AUDIO_FRAME_SAMPLES) {
+        return AUDIO_SOURCE_ERROR;
+    }
+
+    int samples = pop_frames(source, buffer, max_samples, timestamp_ns);
+    if (samples == 0) {
+        if (os_atomic_load_bool(&source->ended)) {
+            return AUDIO_SOURCE_END;
+        }
+        if (os_atomic_load_bool(&source->failed)) {
+            return AUDIO_SOURCE_ERROR;
+        }
+    }
+    return samples;
+}
+
+void audio_source_stop(audio_source_t *source)
+{
+    if (!source || !source->thread_active) {
+        return;
+    }
+
+    source->running = false;
+    os_event_signal(source->stop_event);
+    pthread_join(source->thread, NULL);
+    source->thread_active = false;
+}
+
+void audio_source_get_stats(audio_source_t *source, struct audio_source_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!source) {
+        return;
+    }
+
+    stats->frames_captured = os_atomic_load_long(&source->frames_captured);
+    stats->frames_queued = audio_ring_count(source->ring);
+    stats->overflows = audio_ring_get_overflows(source->ring);
+    stats->underruns = os_atomic_load_long(&source->underruns);
+    stats->faults = os_atomic_load_long(&source->faults);
+    stats->reconnects = os_atomic_load_long(&source->reconnects);
+    stats->reopen_attempts = os_atomic_load_long(&source->reopen_attempts);
+    stats->recovering = os_atomic_load_bool(&source->recovering);
+    stats->last_recovery_ms = os_atomic_load_long(&source->last_recovery_ms);
+    stats->max_recovery_ms = os_atomic_load_long(&source->max_recovery_ms);
+}
+
+void audio_source_destroy(audio_source_t *source)
+{
+    if (!source) {
+        return;
+    }
+
+    audio_source_stop(source);
+
+    struct audio_source_stats stats;
+    audio_source_get_stats(source, &stats);
+    if (stats.frames_captured > 0) {
+        blog(LOG_INFO, "[Garmin Replay] %s source: %ld frames, %ld overflows, %ld underruns",
+             source->ops->name, stats.frames_captured, stats.overflows, stats.underruns);
+    }
+    if (stats.faults > 0) {
+        blog(LOG_INFO, "[Garmin Replay] %s source: %ld faults, %ld reconnects in %ld attempts, "
+             "recovery %ld ms last, %ld ms worst",
+             source->ops->name, stats.faults, stats.reconnects, stats.reopen_attempts,
+             stats.last_recovery_ms, stats.max_recovery_ms);
+    }
+
+    audio_ring_destroy(source->ring);
+    if (source->started_event) {
+        os_event_destroy(source->started_event);
+    }
+    if (source->stop_event) {
+        os_event_destroy(source->stop_event);
+    }
+    bfree(source->device_id);
+    bfree(source->source_name);
+    bfree(source->path);
+    free(source);
+}
+
+const char *audio_source_get_name(audio_source_t *source)
+{
+    return source ? source->ops->name : "none";
+}
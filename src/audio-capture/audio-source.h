@@ -0,0 +1,151 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// All backends deliver 16kHz, 16-bit, mono audio (what Vosk expects)
+#define AUDIO_SOURCE_SAMPLE_RATE 16000
+
+// OBS's global audio channels (Settings > Audio) for obs_channel
+#define AUDIO_SOURCE_OBS_DESKTOP_AUDIO 1
+#define AUDIO_SOURCE_OBS_MIC_AUX       3
+
+// Return codes for audio_source_read() besides a sample count
+#define AUDIO_SOURCE_ERROR -1  // Backend failed
+#define AUDIO_SOURCE_END   -2  // Stream finished (files and pipes only)
+
+// Backend reads only: the device went away or was replaced (unplugged,
+// default device changed, audio service restarted). Reopening it is
+// expected to work once the device is back; a plain AUDIO_SOURCE_ERROR
+// gets a few reopen attempts before the source gives up.
+#define AUDIO_SOURCE_LOST  -3
+
+// Opaque handle to an audio source instance
+// Each source runs its backend on a dedicated capture thread that feeds a
+// lock-free ring; audio_source_read() consumes from that ring.
+typedef struct audio_source audio_source_t;
+
+struct audio_source_stats {
+    long frames_captured;  // 10ms frames produced by the backend
+    int frames_queued;     // Frames waiting in the ring right now
+    long overflows;        // Frames dropped because the reader fell behind
+    long underruns;        // Reads that timed out with no audio available
+
+    // Device faults and recovery (backends with reopen only)
+    long faults;              // Lost devices and errors the backend reported
+    long reconnects;          // Times capture came back after a fault
+    long reopen_attempts;     // Including the ones that failed
+    bool recovering;          // No device right now, retrying
+    long last_recovery_ms;    // Fault to capturing again
+    long max_recovery_ms;
+};
+
+enum audio_source_type {
+    AUDIO_SOURCE_WASAPI,  // Live microphone (Windows only)
+    AUDIO_SOURCE_FILE,    // WAV or raw PCM file, "-" reads stdin
+    AUDIO_SOURCE_OBS,     // Audio of a source OBS already captures
+};
+
+struct audio_source_config {
+    enum audio_source_type type;
+
+    // AUDIO_SOURCE_WASAPI: device ID, or NULL/empty for default microphone
+    const char *device_id;
+
+    // AUDIO_SOURCE_OBS: source name, or NULL/empty for one of OBS's global
+    // audio channels: obs_channel, 0 = Mic/Aux
+    const char *source_name;
+    int obs_channel;
+
+    // AUDIO_SOURCE_FILE
+    const char *path;
+    bool realtime;        // Pace reads to the wall clock instead of max speed
+    int raw_sample_rate;  // Format of headerless input (0 = 16000)
+    int raw_channels;     // (0 = mono, samples are always s16le)
+
+    // Developer fault injection (fault-source.c), 0 = off: the backend loses
+    // its device after every fault_interval_ms of audio and then fails
+    // fault_reopen_failures reopen attempts before it comes back
+    int fault_interval_ms;
+    int fault_reopen_failures;
+};
+
+// Backend vtable. Every backend converts to AUDIO_SOURCE_SAMPLE_RATE mono.
+// All calls are made from the source's capture thread.
+struct audio_source_ops {
+    const char *name;
+
+    // Returns: Backend data, or NULL on failure
+    void *(*create)(const struct audio_source_config *config);
+    bool (*start)(void *data);
+
+    // timestamp_ns: Set to the os_gettime_ns() based capture time of buffer[0]
+    // Returns: Samples read, 0 if no data yet, AUDIO_SOURCE_ERROR,
+    //          AUDIO_SOURCE_LOST or AUDIO_SOURCE_END
+    int (*read)(void *data, short *buffer, int max_samples, uint64_t *timestamp_ns);
+
+    void (*stop)(void *data);
+    void (*destroy)(void *data);
+
+    // Optional: after a failed read, resolve the device again and rebuild
+    // the stream in place, started. Backends without it stop at the first
+    // error.
+    // Returns: false if the device still can't be opened
+    bool (*reopen)(void *data);
+
+    // Optional: times a read had to grow the backend's conversion scratch
+    // space since create (see capture-scratch.h), which should stay 0
+    long (*get_scratch_grows)(void *data);
+};
+
+// Create an audio source for the given config
+// Returns: Source instance, or NULL on failure
+audio_source_t *audio_source_create(const struct audio_source_config *config);
+
+// Start the capture thread and its backend
+// Returns: true once the backend is capturing, false if it failed to open
+bool audio_source_start(audio_source_t *source);
+
+// Read whole 10ms frames of 16kHz mono samples, waiting up to 100ms
+// max_samples: Must be at least one frame (160 samples)
+// Returns: Samples read, 0 on timeout, AUDIO_SOURCE_ERROR or AUDIO_SOURCE_END
+int audio_source_read(audio_source_t *source, short *buffer, int max_samples,
+                      uint64_t *timestamp_ns);
+
+// Same as audio_source_read(), without waiting
+// Returns: Samples read, 0 if no frame is queued, AUDIO_SOURCE_ERROR or AUDIO_SOURCE_END
+int audio_source_poll(audio_source_t *source, short *buffer, int max_samples,
+                      uint64_t *timestamp_ns);
+
+// Stop the capture thread; queued frames are kept
+void audio_source_stop(audio_source_t *source);
+
+// Snapshot of the capture/ring counters
+void audio_source_get_stats(audio_source_t *source, struct audio_source_stats *stats);
+
+// Destroy the source and free resources
+void audio_source_destroy(audio_source_t *source);
+
+// Backend name for logging
+const char *audio_source_get_name(audio_source_t *source);
+
+// Backend for a source type, NULL if it isn't available on this platform
+const struct audio_source_ops *audio_source_find_ops(enum audio_source_type type);
+
+#ifdef _WIN32
+extern const struct audio_source_ops wasapi_source_ops;
+#endif
+extern const struct audio_source_ops file_source_ops;
+extern const struct audio_source_ops obs_tap_source_ops;
+extern const struct audio_source_ops fault_source_ops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_SOURCE_H
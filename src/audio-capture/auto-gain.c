@@ -0,0 +1,382 @@
+#include "auto-gain.h"
+
+#include "../compat/obs-compat.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define AGC_X86
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define AGC_NEON
+#endif
+
+#define FRAME AUTO_GAIN_FRAME_SAMPLES
+
+// A frame counts as speech this far above the noise floor
+#define SPEECH_MARGIN_DB 10.0f
+
+// Nothing quieter than this counts as speech, however low the floor
+#define SPEECH_MIN_DBFS -65.0f
+
+// The floor follows quieter frames at once and rises 2 dB/s otherwise, so
+// it catches up with louder rooms but not with a sentence
+#define FLOOR_RISE_DB 0.02f
+
+// Digital silence (a muted mic, the noise suppressor's first frame) says
+// nothing about the room, and would pin the floor far below it
+#define SILENCE_DBFS -90.0f
+
+// Speech level follower: fast attack (~50 ms), slow release (~500 ms),
+// so it settles near the loud parts of words rather than their tails
+#define LEVEL_ATTACK  0.2f
+#define LEVEL_RELEASE 0.02f
+
+// Per-frame gain moves: up 15 dB/s so pauses and soft syllables don't
+// pump, down 100 dB/s so a shout is tamed within a few frames
+#define GAIN_UP_DB   0.15f
+#define GAIN_DOWN_DB 1.0f
+
+// Peaks are held this far below full scale; anything that still gets past
+// saturates and counts as clipped
+#define PEAK_LIMIT 29000.0f
+
+#define FULL_SCALE 32768.0f
+
+// out[i] = saturate(in[i] * (gain + step * i)) over `count` samples
+// Returns: Samples that saturated
+typedef int (*agc_apply_fn)(const short *in, short *out, int count, float gain, float step);
+
+struct auto_gain {
+    struct auto_gain_config config;
+    agc_apply_fn apply;
+    enum audio_convert_isa isa;
+
+    // The frame in progress, measured before the gain
+    int position;
+    float energy;
+    int peak;
+
+    float floor_db;
+    float level_db;
+    bool have_floor;
+    bool have_level;
+
+    float gain_db;     // Reached at the end of the frame in progress
+    float gain_start;  // Linear gain at its start
+    float gain_end;
+
+    struct auto_gain_stats stats;
+};
+
+static const int MASK_BITS[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+// ---------------------------------------------------------------------------
+// Scalar
+
+static int apply_scalar(const short *in, short *out, int count, float gain, float step)
+{
+    int clipped = 0;
+    for (int i = 0; i < count; i++) {
+        float v = (float)in[i] * (gain + step * (float)i);
+        if (v > 32767.0f || v < -32768.0f) {
+            clipped++;
+            v = v > 0.0f ? 32767.0f : -32768.0f;
+        }
+        out[i] = (short)lrintf(v);
+    }
+    return clipped;
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 (baseline on x86-64)
+
+#ifdef AGC_X86
+
+static int apply_sse2(const short *in, short *out, int count, float gain, float step)
+{
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 g0 = _mm_set1_ps(gain);
+    const __m128 s = _mm_set1_ps(step);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+
+    int clipped = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+        __m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        __m128 ia = _mm_add_ps(_mm_set1_ps((float)i), lanes);
+        __m128 ib = _mm_add_ps(_mm_set1_ps((float)(i + 4)), lanes);
+        a = _mm_mul_ps(a, _mm_add_ps(g0, _mm_mul_ps(s, ia)));
+        b = _mm_mul_ps(b, _mm_add_ps(g0, _mm_mul_ps(s, ib)));
+
+        clipped += MASK_BITS[_mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(a, hi), _mm_cmplt_ps(a, lo)))];
+        clipped += MASK_BITS[_mm_movemask_ps(_mm_or_ps(_mm_cmpgt_ps(b, hi), _mm_cmplt_ps(b, lo)))];
+        _mm_storeu_si128((__m128i *)(out + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    return clipped + apply_scalar(in + i, out + i, count - i, gain + step * (float)i, step);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2
+
+TARGET_AVX2
+static int apply_avx2(const short *in, short *out, int count, float gain, float step)
+{
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 g0 = _mm256_set1_ps(gain);
+    const __m256 s = _mm256_set1_ps(step);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+
+    int clipped = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x));
+        __m256 idx = _mm256_add_ps(_mm256_set1_ps((float)i), lanes);
+        v = _mm256_mul_ps(v, _mm256_add_ps(g0, _mm256_mul_ps(s, idx)));
+
+        int mask = _mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(v, hi, _CMP_GT_OQ),
+                                                   _mm256_cmp_ps(v, lo, _CMP_LT_OQ)));
+        clipped += MASK_BITS[mask & 15] + MASK_BITS[mask >> 4];
+
+        __m256i r = _mm256_cvtps_epi32(v);
+        _mm_storeu_si128((__m128i *)(out + i),
+                         _mm_packs_epi32(_mm256_castsi256_si128(r),
+                                         _mm256_extracti128_si256(r, 1)));
+    }
+    return clipped + apply_scalar(in + i, out + i, count - i, gain + step * (float)i, step);
+}
+
+#endif // AGC_X86
+
+// ---------------------------------------------------------------------------
+// NEON (baseline on arm64)
+
+#ifdef AGC_NEON
+
+static int apply_neon(const short *in, short *out, int count, float gain, float step)
+{
+    static const float LANES[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t lanes = vld1q_f32(LANES);
+    const float32x4_t g0 = vdupq_n_f32(gain);
+    const float32x4_t s = vdupq_n_f32(step);
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+
+    int clipped = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(in + i);
+        float32x4_t a = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+        float32x4_t b = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+        float32x4_t ia = vaddq_f32(vdupq_n_f32((float)i), lanes);
+        float32x4_t ib = vaddq_f32(vdupq_n_f32((float)(i + 4)), lanes);
+        a = vmulq_f32(a, vaddq_f32(g0, vmulq_f32(s, ia)));
+        b = vmulq_f32(b, vaddq_f32(g0, vmulq_f32(s, ib)));
+
+        uint32x4_t ca = vorrq_u32(vcgtq_f32(a, hi), vcltq_f32(a, lo));
+        uint32x4_t cb = vorrq_u32(vcgtq_f32(b, hi), vcltq_f32(b, lo));
+        clipped += (int)vaddvq_u32(vshrq_n_u32(ca, 31)) + (int)vaddvq_u32(vshrq_n_u32(cb, 31));
+
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+                                        vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    return clipped + apply_scalar(in + i, out + i, count - i, gain + step * (float)i, step);
+}
+
+#endif // AGC_NEON
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const agc_apply_fn KERNELS[AUDIO_ISA_COUNT] = {
+    [AUDIO_ISA_SCALAR] = apply_scalar,
+#ifdef AGC_X86
+    [AUDIO_ISA_SSE2] = apply_sse2,
+    [AUDIO_ISA_AVX2] = apply_avx2,
+#endif
+#ifdef AGC_NEON
+    [AUDIO_ISA_NEON] = apply_neon,
+#endif
+};
+
+void auto_gain_config_default(struct auto_gain_config *config)
+{
+    config->target_dbfs = AUTO_GAIN_DEFAULT_TARGET_DBFS;
+    config->max_gain_db = AUTO_GAIN_DEFAULT_MAX_DB;
+    config->min_gain_db = AUTO_GAIN_DEFAULT_MIN_DB;
+}
+
+auto_gain_t *auto_gain_create_isa(const struct auto_gain_config *config,
+                                  enum audio_convert_isa isa)
+{
+    if ((int)isa < 0 || isa >= AUDIO_ISA_COUNT || !KERNELS[isa] ||
+        !audio_convert_isa_available(isa)) {
+        return NULL;
+    }
+
+    struct auto_gain *agc = calloc(1, sizeof(struct auto_gain));
+    if (!agc) {
+        return NULL;
+    }
+
+    agc->config = *config;
+    if (agc->config.min_gain_db > 0.0f) {
+        agc->config.min_gain_db = 0.0f;
+    }
+    if (agc->config.max_gain_db < 0.0f) {
+        agc->config.max_gain_db = 0.0f;
+    }
+
+    agc->apply = KERNELS[isa];
+    agc->isa = isa;
+    auto_gain_reset(agc);
+    return agc;
+}
+
+auto_gain_t *auto_gain_create(const struct auto_gain_config *config)
+{
+    static const enum audio_convert_isa PREFERENCE[] = {
+        AUDIO_ISA_AVX2, AUDIO_ISA_NEON, AUDIO_ISA_SSE2, AUDIO_ISA_SCALAR,
+    };
+
+    for (size_t i = 0; i < sizeof(PREFERENCE) / sizeof(PREFERENCE[0]); i++) {
+        if (audio_convert_isa_available(PREFERENCE[i]) && KERNELS[PREFERENCE[i]]) {
+            return auto_gain_create_isa(config, PREFERENCE[i]);
+        }
+    }
+    return NULL;
+}
+
+static float clamp_float(float v, float lo, float hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// Measure the finished frame and pick the gain the next one ramps to
+static void end_frame(struct auto_gain *agc)
+{
+    float mean_square = agc->energy / (FRAME * FULL_SCALE * FULL_SCALE);
+    float frame_db = 10.0f * log10f(mean_square + 1e-10f);
+
+    if (frame_db <= SILENCE_DBFS) {
+        // Leave the floor alone
+    } else if (!agc->have_floor || frame_db < agc->floor_db) {
+        agc->floor_db = frame_db;
+        agc->have_floor = true;
+    } else {
+        agc->floor_db += FLOOR_RISE_DB;
+    }
+
+    bool speech = agc->have_floor && frame_db > agc->floor_db + SPEECH_MARGIN_DB &&
+                  frame_db > SPEECH_MIN_DBFS;
+    if (speech) {
+        if (!agc->have_level) {
+            agc->level_db = frame_db;
+            agc->have_level = true;
+        } else {
+            float rate = frame_db > agc->level_db ? LEVEL_ATTACK : LEVEL_RELEASE;
+            agc->level_db += rate * (frame_db - agc->level_db);
+        }
+        agc->stats.speech_frames++;
+    }
+
+    // Unity until there is speech to go by
+    float wanted = agc->have_level ? agc->config.target_dbfs - agc->level_db : 0.0f;
+    wanted = clamp_float(wanted, agc->config.min_gain_db, agc->config.max_gain_db);
+
+    float gain_db = clamp_float(wanted, agc->gain_db - GAIN_DOWN_DB, agc->gain_db + GAIN_UP_DB);
+
+    // A peak like this one must not clip at the new gain
+    if (agc->peak > 0) {
+        float limit_db = 20.0f * log10f(PEAK_LIMIT / (float)agc->peak);
+        gain_db = gain_db < limit_db ? gain_db : limit_db;
+    }
+
+    agc->gain_db = gain_db;
+    agc->gain_start = agc->gain_end;
+    agc->gain_end = powf(10.0f, gain_db / 20.0f);
+    agc->position = 0;
+    agc->energy = 0.0f;
+    agc->peak = 0;
+    agc->stats.frames++;
+}
+
+void auto_gain_process(auto_gain_t *agc, const short *in, int count, short *out)
+{
+    uint64_t start_ns = os_gettime_ns();
+
+    while (count > 0) {
+        int n = FRAME - agc->position;
+        n = count < n ? count : n;
+
+        // Measure before the gain touches it, since out may be in
+        for (int i = 0; i < n; i++) {
+            float v = (float)in[i];
+            int a = in[i] < 0 ? -in[i] : in[i];
+            agc->energy += v * v;
+            agc->peak = a > agc->peak ? a : agc->peak;
+        }
+
+        float step = (agc->gain_end - agc->gain_start) / FRAME;
+        float gain = agc->gain_start + step * (float)agc->position;
+        agc->stats.clipped_samples += (uint64_t)agc->apply(in, out, n, gain, step);
+
+        agc->position += n;
+        in += n;
+        out += n;
+        count -= n;
+        if (agc->position == FRAME) {
+            end_frame(agc);
+        }
+    }
+
+    agc->stats.process_ns += os_gettime_ns() - start_ns;
+}
+
+enum audio_convert_isa auto_gain_get_isa(const auto_gain_t *agc)
+{
+    return agc->isa;
+}
+
+void auto_gain_reset(auto_gain_t *agc)
+{
+    if (!agc) {
+        return;
+    }
+
+    agc->position = 0;
+    agc->energy = 0.0f;
+    agc->peak = 0;
+    agc->have_floor = false;
+    agc->have_level = false;
+    agc->gain_db = 0.0f;
+    agc->gain_start = 1.0f;
+    agc->gain_end = 1.0f;
+}
+
+void auto_gain_get_stats(const auto_gain_t *agc, struct auto_gain_stats *stats)
+{
+    *stats = agc->stats;
+    stats->gain_db = agc->gain_db;
+    stats->speech_dbfs = agc->have_level ? agc->level_db : -100.0f;
+}
+
+void auto_gain_destroy(auto_gain_t *agc)
+{
+    free(agc);
+}
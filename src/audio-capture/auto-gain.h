@@ -0,0 +1,64 @@
+#ifndef AUTO_GAIN_H
+#define AUTO_GAIN_H
+
+#include "audio-convert.h"
+
+#include <stdint.h>
+
+// Automatic gain control for the recognizer feed: brings speech from a
+// quiet or hot microphone to a steady level. The speech level is tracked on
+// 10 ms frames that stand clear of the noise floor, so pauses and
+// background noise don't pull the gain up. The gain rises slowly, falls
+// quickly, ramps across each frame, and is cut back before a peak would
+// clip. 16kHz mono s16, no added latency.
+
+// Opaque handle to an auto gain instance
+typedef struct auto_gain auto_gain_t;
+
+#define AUTO_GAIN_FRAME_SAMPLES 160
+
+struct auto_gain_config {
+    float target_dbfs;   // Speech level to reach (RMS over speech frames)
+    float max_gain_db;
+    float min_gain_db;
+};
+
+#define AUTO_GAIN_DEFAULT_TARGET_DBFS -20.0f
+#define AUTO_GAIN_DEFAULT_MAX_DB      30.0f
+#define AUTO_GAIN_DEFAULT_MIN_DB      -12.0f
+
+struct auto_gain_stats {
+    uint64_t frames;
+    uint64_t speech_frames;
+    uint64_t clipped_samples;  // Saturated on the way out
+    uint64_t process_ns;       // Time spent in auto_gain_process()
+    float gain_db;             // Gain applied right now
+    float speech_dbfs;         // Tracked speech level, before the gain
+};
+
+// Fill a config with the defaults above
+void auto_gain_config_default(struct auto_gain_config *config);
+
+// Returns: Auto gain with the best kernels for this CPU, or NULL
+auto_gain_t *auto_gain_create(const struct auto_gain_config *config);
+
+// Same, with the kernels of a specific instruction set (benchmarks and
+// accuracy checks)
+// Returns: NULL if the ISA is not available here
+auto_gain_t *auto_gain_create_isa(const struct auto_gain_config *config,
+                                  enum audio_convert_isa isa);
+
+// Apply the gain to `count` samples; in and out may be the same buffer
+void auto_gain_process(auto_gain_t *agc, const short *in, int count, short *out);
+
+enum audio_convert_isa auto_gain_get_isa(const auto_gain_t *agc);
+
+// Forget the levels and return to unity gain, for a new unrelated stream
+// (stats are kept)
+void auto_gain_reset(auto_gain_t *agc);
+
+void auto_gain_get_stats(const auto_gain_t *agc, struct auto_gain_stats *stats);
+
+void auto_gain_destroy(auto_gain_t *agc);
+
+#endif // AUTO_GAIN_H
@@ -0,0 +1,74 @@
+#include "capture-scratch.h"
+
+#include "../compat/obs-compat.h"
+
+#include <stdlib.h>
+
+struct capture_scratch {
+    short *mono;
+    int frames;
+    long grow_count;
+};
+
+static bool reserve(capture_scratch_t *scratch, int frames)
+{
+    if (frames <= scratch->frames) {
+        return true;
+    }
+
+    short *mono = realloc(scratch->mono, (size_t)frames * sizeof(short));
+    if (!mono) {
+        return false;
+    }
+    scratch->mono = mono;
+    scratch->frames = frames;
+    return true;
+}
+
+capture_scratch_t *capture_scratch_create(int frames)
+{
+    capture_scratch_t *scratch = calloc(1, sizeof(capture_scratch_t));
+    if (!scratch) {
+        return NULL;
+    }
+
+    if (!reserve(scratch, frames > 0 ? frames : 1)) {
+        capture_scratch_destroy(scratch);
+        return NULL;
+    }
+    return scratch;
+}
+
+short *capture_scratch_get(capture_scratch_t *scratch, int frames)
+{
+    // Endpoint buffers only grow in odd driver corner cases
+    if (frames > scratch->frames) {
+        scratch->grow_count++;
+        blog(LOG_WARNING, "[Garmin Replay] Packet of %d frames exceeds scratch space, growing",
+             frames);
+        if (!reserve(scratch, frames)) {
+            return NULL;
+        }
+    }
+    return scratch->mono;
+}
+
+int capture_scratch_get_frames(const capture_scratch_t *scratch)
+{
+    return scratch->frames;
+}
+
+long capture_scratch_get_grow_count(const capture_scratch_t *scratch)
+{
+    return scratch->grow_count;
+}
+
+void capture_scratch_destroy(capture_scratch_t *scratch)
+{
+    if (!scratch) {
+        return;
+    }
+
+    free(scratch->mono);
+    free(scratch);
+}
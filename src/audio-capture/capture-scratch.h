@@ -0,0 +1,30 @@
+#ifndef CAPTURE_SCRATCH_H
+#define CAPTURE_SCRATCH_H
+
+#include <stdbool.h>
+
+// Conversion scratch space for a capture backend. Sized once from the
+// largest packet the device says it can deliver, so steady-state reads
+// never touch the heap; a bigger packet still works, grows it and is
+// counted, since it means the up-front sizing was wrong.
+
+// Opaque handle to a scratch buffer
+typedef struct capture_scratch capture_scratch_t;
+
+// frames: Largest packet expected (the device buffer size)
+// Returns: Scratch space for `frames` mono samples, or NULL on failure
+capture_scratch_t *capture_scratch_create(int frames);
+
+// Scratch space for one packet of `frames` frames, grown if it doesn't fit
+// Returns: At least `frames` samples, or NULL if growing failed
+short *capture_scratch_get(capture_scratch_t *scratch, int frames);
+
+// Frames the scratch space holds right now
+int capture_scratch_get_frames(const capture_scratch_t *scratch);
+
+// Times capture_scratch_get had to allocate (should stay 0)
+long capture_scratch_get_grow_count(const capture_scratch_t *scratch);
+
+void capture_scratch_destroy(capture_scratch_t *scratch);
+
+#endif // CAPTURE_SCRATCH_H
@@ -1,13 +1,18 @@
 #include "device-enum.h"
 
+#ifdef _WIN32
 #include <windows.h>
 #include <mmdeviceapi.h>
 #include <functiondiscoverykeys_devpkey.h>
+#endif
 
 #include <obs-module.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+
 // GUIDs are defined in wasapi-capture.c
 
 device_list_t *device_enum_microphones(void)
@@ -101,6 +106,47 @@ cleanup:
     return list;
 }
 
+#else
+
+// Direct microphone capture is WASAPI only; other platforms list no devices
+// and listen through OBS sources
+device_list_t *device_enum_microphones(void)
+{
+    return calloc(1, sizeof(device_list_t));
+}
+
+#endif
+
+static bool add_obs_source(void *param, obs_source_t *source)
+{
+    device_list_t *list = param;
+    if (list->count >= MAX_DEVICES) {
+        return false;
+    }
+    if (!(obs_source_get_output_flags(source) & OBS_SOURCE_AUDIO)) {
+        return true;
+    }
+
+    const char *name = obs_source_get_name(source);
+    if (!name || !*name) {
+        return true;
+    }
+
+    device_info_t *info = &list->devices[list->count++];
+    snprintf(info->id, sizeof(info->id), "%s%s", DEVICE_ID_OBS_PREFIX, name);
+    snprintf(info->name, sizeof(info->name), "%s", name);
+    return true;
+}
+
+device_list_t *device_enum_obs_sources(void)
+{
+    device_list_t *list = calloc(1, sizeof(device_list_t));
+    if (list) {
+        obs_enum_sources(add_obs_source, list);
+    }
+    return list;
+}
+
 void device_list_free(device_list_t *list)
 {
     free(list);
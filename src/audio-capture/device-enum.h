@@ -11,6 +11,10 @@ extern "C" {
 #define MAX_DEVICE_NAME_LEN 256
 #define MAX_DEVICES 32
 
+// Device IDs with this prefix name an OBS audio source instead of a device
+// ("obs:" alone is OBS's Mic/Aux channel)
+#define DEVICE_ID_OBS_PREFIX "obs:"
+
 // Device information
 typedef struct device_info {
     char id[MAX_DEVICE_ID_LEN];
@@ -27,6 +31,10 @@ typedef struct device_list {
 // Returns a device list that must be freed with device_list_free()
 device_list_t *device_enum_microphones(void);
 
+// Enumerate OBS sources that have audio, with DEVICE_ID_OBS_PREFIX IDs
+// Returns a device list that must be freed with device_list_free()
+device_list_t *device_enum_obs_sources(void);
+
 // Free a device list
 void device_list_free(device_list_t *list);
 
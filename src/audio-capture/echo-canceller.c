@@ -0,0 +1,637 @@
+#include "echo-canceller.h"
+#include "fft.h"
+
+#include "../compat/obs-compat.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAMPLE_RATE 16000
+#define BLOCK ECHO_CANCELLER_BLOCK_SAMPLES
+#define FFT_SIZE (2 * BLOCK)
+#define BINS (BLOCK + 1)
+#define BLOCK_MS (BLOCK * 1000 / SAMPLE_RATE)
+
+// The filter starts this many blocks before the estimated echo onset, so an
+// offset that is off by a block or two still leaves the echo causal
+#define PRE_DELAY_BLOCKS 3
+
+// Reference audio kept by sample position, ~2 s
+#define FAR_RING_SAMPLES 32768
+
+// Per-block envelopes of both streams for the offset search, ~8 s
+#define ENV_BLOCKS 1024
+
+// Offset search: 2 s of envelope, redone every ~256 ms. Arrival jitter
+// between the streams gets this many blocks of slack either way.
+#define EST_WINDOW_BLOCKS 256
+#define EST_INTERVAL_BLOCKS 32
+#define EST_MARGIN_BLOCKS 4
+
+// A peak this correlated and this far above the average over all offsets
+// (a lone loud event correlates everywhere), found at the same offset a
+// few times in a row, is taken. A peak on the edge of the search range is
+// the slope of one outside it. Once aligned, the filter absorbs a block or two of error, so the
+// offset only moves for a clearly better peak further away.
+#define EST_MIN_CORRELATION 0.6f
+#define EST_MIN_PROMINENCE 0.3f
+#define EST_CONFIRMATIONS 3
+#define EST_MIN_MOVE_BLOCKS 2
+#define EST_MOVE_MARGIN 0.1f
+
+// Mic envelope variance per block (log energy) below which it is just
+// noise and any correlation is chance
+#define EST_MIN_MIC_VARIANCE 0.1
+
+// An alignment that hasn't cancelled this much after ~5 s of reference
+// playing was a chance match, or there is no echo to cancel
+#define NO_ECHO_BLOCKS 625
+#define NO_ECHO_ERLE_DB 3.0f
+
+// Envelope floor in squared sample units (~10 LSB RMS), so silence in
+// either stream doesn't dominate the correlation with noise
+#define ENV_FLOOR 100.0f
+
+// A block peak below this (~-54 dBFS) is no reference playing
+#define FAR_ACTIVE_PEAK 64.0f
+
+// NLMS step, normalized by the reference power in each bin over the whole
+// filter; the regularization is that power for ~10 LSB RMS of noise
+#define STEP_SIZE 0.5f
+#define REGULARIZATION (FFT_SIZE * ENV_FLOOR)
+
+// Geigel double-talk detector: the mic peak against the reference peak
+// over the filter span, scaled by the learned echo path gain. Until the
+// filter has converged it assumes the echo is no louder than the source.
+#define DOUBLE_TALK_MIN_RATIO 0.1f
+#define DOUBLE_TALK_MAX_RATIO 1.0f
+#define DOUBLE_TALK_HANGOVER_BLOCKS 10
+#define PATH_GAIN_INITIAL 0.5f
+#define PATH_GAIN_RATE 0.01f
+#define PATH_GAIN_MIN_ERLE_DB 6.0f
+
+// Output louder than input this long (~0.4 s) means the filter diverged
+#define DIVERGED_RESET_BLOCKS 50
+
+// ERLE smoothing per echo block, ~2 s
+#define ERLE_DECAY (1.0 - 1.0 / 250.0)
+
+struct echo_canceller {
+    struct echo_canceller_config config;
+    int partitions;
+    int hold_samples;
+    int max_delay_blocks;
+    int hold_blocks;
+    fft_t *fft;
+
+    // Reference audio and its per-block envelope, by absolute position
+    short *far;
+    uint64_t far_samples;
+    float far_env[ENV_BLOCKS];
+    float far_peak[ENV_BLOCKS];
+
+    // Mic audio not written out yet; queue[0] starts block mic_block
+    short *queue;
+    int queue_capacity;
+    int queued;
+    uint64_t mic_block;
+    uint64_t mic_samples;
+    float mic_env[ENV_BLOCKS];
+    uint64_t next_estimate_block;
+
+    // Alignment: mic block b is cancelled against far blocks up to
+    // b + offset + PRE_DELAY_BLOCKS
+    bool aligned;
+    int64_t offset;
+    uint64_t aligned_echo_blocks;
+    int64_t candidate;
+    int candidate_hits;
+
+    // Filter: spectra of the last `partitions` reference blocks (x_head is
+    // the newest) and the matching filter partitions
+    float *x_re, *x_im;
+    float *w_re, *w_im;
+    int x_head;
+    float x_power[BINS];   // Sum of |X|^2 over the partitions
+    float gain[BINS];
+    float y_re[BINS], y_im[BINS];
+    float e_re[BINS], e_im[BINS];
+    float time[FFT_SIZE];
+    float error[BLOCK];
+    int constrain_next;
+
+    int double_talk_hold;
+    float path_gain;
+    int diverged_blocks;
+
+    double erle_mic, erle_out;              // Smoothed energies
+    double erle_mic_total, erle_out_total;
+
+    struct echo_canceller_stats stats;
+};
+
+void echo_canceller_config_default(struct echo_canceller_config *config)
+{
+    config->tail_ms = ECHO_DEFAULT_TAIL_MS;
+    config->max_delay_ms = ECHO_DEFAULT_MAX_DELAY_MS;
+    config->max_hold_ms = ECHO_DEFAULT_MAX_HOLD_MS;
+}
+
+static int clamp_int(int v, int lo, int hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+echo_canceller_t *echo_canceller_create(const struct echo_canceller_config *config)
+{
+    struct echo_canceller *aec = calloc(1, sizeof(struct echo_canceller));
+    if (!aec) {
+        return NULL;
+    }
+
+    aec->config = *config;
+    aec->config.tail_ms = clamp_int(config->tail_ms, 32, 512);
+    aec->config.max_delay_ms = clamp_int(config->max_delay_ms, 0, 1000);
+    aec->config.max_hold_ms = clamp_int(config->max_hold_ms, 0, 1000);
+
+    aec->partitions = (aec->config.tail_ms + BLOCK_MS - 1) / BLOCK_MS + PRE_DELAY_BLOCKS;
+    aec->max_delay_blocks = (aec->config.max_delay_ms + BLOCK_MS - 1) / BLOCK_MS;
+    aec->hold_blocks = (aec->config.max_hold_ms + BLOCK_MS - 1) / BLOCK_MS;
+    aec->hold_samples = aec->hold_blocks * BLOCK;
+
+    // Never full once the blocks that waited too long have gone out
+    aec->queue_capacity = aec->hold_samples + 2 * BLOCK;
+
+    size_t spectra = (size_t)aec->partitions * BINS;
+    aec->fft = fft_create(FFT_SIZE);
+    aec->far = calloc(FAR_RING_SAMPLES, sizeof(short));
+    aec->queue = malloc((size_t)aec->queue_capacity * sizeof(short));
+    aec->x_re = calloc(spectra, sizeof(float));
+    aec->x_im = calloc(spectra, sizeof(float));
+    aec->w_re = calloc(spectra, sizeof(float));
+    aec->w_im = calloc(spectra, sizeof(float));
+    if (!aec->fft || !aec->far || !aec->queue || !aec->x_re || !aec->x_im ||
+        !aec->w_re || !aec->w_im) {
+        echo_canceller_destroy(aec);
+        return NULL;
+    }
+
+    aec->path_gain = PATH_GAIN_INITIAL;
+    aec->next_estimate_block = EST_WINDOW_BLOCKS;
+    aec->stats.delay_ms = 0;
+    return aec;
+}
+
+static float block_envelope(const short *samples)
+{
+    float energy = 0.0f;
+    for (int i = 0; i < BLOCK; i++) {
+        energy += (float)samples[i] * (float)samples[i];
+    }
+    return logf(energy / BLOCK + ENV_FLOOR);
+}
+
+static float block_peak(const short *samples)
+{
+    int peak = 0;
+    for (int i = 0; i < BLOCK; i++) {
+        int v = samples[i] < 0 ? -samples[i] : samples[i];
+        peak = v > peak ? v : peak;
+    }
+    return (float)peak;
+}
+
+// Start the filter over, e.g. once the streams line up differently
+static void reset_filter(struct echo_canceller *aec)
+{
+    size_t bytes = (size_t)aec->partitions * BINS * sizeof(float);
+    memset(aec->x_re, 0, bytes);
+    memset(aec->x_im, 0, bytes);
+    memset(aec->w_re, 0, bytes);
+    memset(aec->w_im, 0, bytes);
+    memset(aec->x_power, 0, sizeof(aec->x_power));
+    aec->x_head = 0;
+    aec->constrain_next = 0;
+    aec->double_talk_hold = 0;
+    aec->diverged_blocks = 0;
+    aec->erle_mic = 0.0;
+    aec->erle_out = 0.0;
+}
+
+// Arrival jitter moves the anchor by a block or two, so a realignment
+// reports how far the offset itself moved
+static void set_offset(struct echo_canceller *aec, int64_t offset)
+{
+    if (aec->aligned) {
+        aec->stats.delay_ms += (int)(aec->offset - offset) * BLOCK_MS;
+        aec->stats.realignments++;
+        blog(LOG_INFO, "[Garmin Replay] Echo canceller: echo now trails its reference by %d ms, "
+             "restarting", aec->stats.delay_ms);
+    } else {
+        int64_t anchor = (int64_t)(aec->far_samples / BLOCK) - (int64_t)(aec->mic_samples / BLOCK);
+        aec->stats.delay_ms = (int)(anchor - offset) * BLOCK_MS;
+        blog(LOG_INFO, "[Garmin Replay] Echo canceller: echo trails its reference by %d ms",
+             aec->stats.delay_ms);
+    }
+
+    aec->aligned = true;
+    aec->offset = offset;
+    aec->aligned_echo_blocks = 0;
+    reset_filter(aec);
+}
+
+// Normalized correlation of the mic envelope window with the far envelope
+// shifted by `offset` blocks; 0 if the reference is flat
+static double envelope_correlation(const struct echo_canceller *aec, int64_t mic_start,
+                                   int64_t mic_end, double mic_mean, double mic_var,
+                                   int64_t offset)
+{
+    double far_sum = 0.0, far_sq = 0.0, cross = 0.0;
+    for (int64_t b = mic_start; b < mic_end; b++) {
+        double f = aec->far_env[(b + offset) % ENV_BLOCKS];
+        double m = aec->mic_env[b % ENV_BLOCKS] - mic_mean;
+        far_sum += f;
+        far_sq += f * f;
+        cross += f * m;
+    }
+
+    double far_var = far_sq - far_sum * far_sum / (double)(mic_end - mic_start);
+    return far_var > 1e-6 ? cross / sqrt(far_var * mic_var) : 0.0;
+}
+
+// Correlate the mic envelope with the reference envelope at every offset
+// the streams' buffering allows. Offsets are in blocks: far block b + o
+// lines up with mic block b. Offsets that would make the mic wait longer
+// than max_hold_ms for its reference are not searched, and the window ends
+// early enough that the far blocks for the latest offsets have arrived.
+static void estimate_offset(struct echo_canceller *aec)
+{
+    int64_t mic_blocks = (int64_t)(aec->mic_samples / BLOCK);
+    int64_t far_blocks = (int64_t)(aec->far_samples / BLOCK);
+    int64_t anchor = far_blocks - mic_blocks;
+    int64_t lo = anchor - aec->max_delay_blocks - EST_MARGIN_BLOCKS;
+    int64_t hi = anchor + aec->hold_blocks - PRE_DELAY_BLOCKS - EST_MARGIN_BLOCKS;
+
+    int64_t mic_end = mic_blocks - (hi > anchor ? hi - anchor : 0);
+    int64_t mic_start = mic_end - EST_WINDOW_BLOCKS;
+    if (mic_start < 0 || mic_start + lo < 0 || mic_start + lo < far_blocks - ENV_BLOCKS) {
+        return;
+    }
+
+    double mic_mean = 0.0;
+    for (int64_t b = mic_start; b < mic_end; b++) {
+        mic_mean += aec->mic_env[b % ENV_BLOCKS];
+    }
+    mic_mean /= EST_WINDOW_BLOCKS;
+
+    double mic_var = 0.0;
+    for (int64_t b = mic_start; b < mic_end; b++) {
+        double d = aec->mic_env[b % ENV_BLOCKS] - mic_mean;
+        mic_var += d * d;
+    }
+    if (mic_var < EST_MIN_MIC_VARIANCE * EST_WINDOW_BLOCKS) {
+        return;
+    }
+
+    double best = 0.0, sum = 0.0;
+    int64_t best_offset = 0;
+    for (int64_t o = lo; o <= hi; o++) {
+        double corr = envelope_correlation(aec, mic_start, mic_end, mic_mean, mic_var, o);
+        sum += corr;
+        if (corr > best) {
+            best = corr;
+            best_offset = o;
+        }
+    }
+
+    if (best < EST_MIN_CORRELATION || best - sum / (double)(hi - lo + 1) < EST_MIN_PROMINENCE ||
+        best_offset == lo || best_offset == hi) {
+        aec->candidate_hits = 0;
+        return;
+    }
+
+    if (aec->aligned) {
+        double current = envelope_correlation(aec, mic_start, mic_end, mic_mean, mic_var,
+                                              aec->offset);
+        if (llabs(best_offset - aec->offset) < EST_MIN_MOVE_BLOCKS ||
+            best < current + EST_MOVE_MARGIN) {
+            aec->candidate_hits = 0;
+            return;
+        }
+    }
+
+    if (aec->candidate_hits > 0 && llabs(best_offset - aec->candidate) <= 1) {
+        aec->candidate_hits++;
+    } else {
+        aec->candidate = best_offset;
+        aec->candidate_hits = 1;
+    }
+
+    if (aec->candidate_hits >= EST_CONFIRMATIONS) {
+        set_offset(aec, aec->candidate);
+    }
+}
+
+void echo_canceller_far_end(echo_canceller_t *aec, const short *samples, int count)
+{
+    for (int i = 0; i < count; i++) {
+        aec->far[(aec->far_samples + (uint64_t)i) % FAR_RING_SAMPLES] = samples[i];
+    }
+
+    uint64_t first_block = aec->far_samples / BLOCK;
+    aec->far_samples += (uint64_t)count;
+
+    short block[BLOCK];
+    for (uint64_t b = first_block; b < aec->far_samples / BLOCK; b++) {
+        for (int i = 0; i < BLOCK; i++) {
+            block[i] = aec->far[(b * BLOCK + (uint64_t)i) % FAR_RING_SAMPLES];
+        }
+        aec->far_env[b % ENV_BLOCKS] = block_envelope(block);
+        aec->far_peak[b % ENV_BLOCKS] = block_peak(block);
+    }
+}
+
+// Spectrum of far blocks c - 1 and c becomes the newest partition
+static void push_far_spectrum(struct echo_canceller *aec, int64_t c)
+{
+    for (int i = 0; i < FFT_SIZE; i++) {
+        int64_t pos = (c - 1) * BLOCK + i;
+        aec->time[i] = pos >= 0 ? (float)aec->far[(uint64_t)pos % FAR_RING_SAMPLES] : 0.0f;
+    }
+
+    aec->x_head = (aec->x_head + aec->partitions - 1) % aec->partitions;
+    float *x_re = aec->x_re + (size_t)aec->x_head * BINS;
+    float *x_im = aec->x_im + (size_t)aec->x_head * BINS;
+
+    // The oldest partition drops out of the power sum as the new one enters
+    for (int k = 0; k < BINS; k++) {
+        aec->x_power[k] -= x_re[k] * x_re[k] + x_im[k] * x_im[k];
+    }
+    fft_forward(aec->fft, aec->time, x_re, x_im);
+    for (int k = 0; k < BINS; k++) {
+        aec->x_power[k] += x_re[k] * x_re[k] + x_im[k] * x_im[k];
+        if (aec->x_power[k] < 0.0f) {
+            aec->x_power[k] = 0.0f;
+        }
+    }
+}
+
+static void adapt(struct echo_canceller *aec)
+{
+    // Gradient from the error block, zero-padded in front (overlap-save)
+    memset(aec->time, 0, BLOCK * sizeof(float));
+    memcpy(aec->time + BLOCK, aec->error, BLOCK * sizeof(float));
+    fft_forward(aec->fft, aec->time, aec->e_re, aec->e_im);
+
+    for (int k = 0; k < BINS; k++) {
+        aec->gain[k] = STEP_SIZE / (aec->x_power[k] + REGULARIZATION);
+    }
+
+    for (int p = 0; p < aec->partitions; p++) {
+        size_t x = (size_t)((aec->x_head + p) % aec->partitions) * BINS;
+        size_t w = (size_t)p * BINS;
+        fft_conj_mul_acc(aec->fft, aec->x_re + x, aec->x_im + x, aec->e_re, aec->e_im,
+                         aec->gain, aec->w_re + w, aec->w_im + w);
+    }
+
+    // Keep one partition a linear (not circular) convolution per block:
+    // its impulse response must fit in the first half
+    size_t w = (size_t)aec->constrain_next * BINS;
+    fft_inverse(aec->fft, aec->w_re + w, aec->w_im + w, aec->time);
+    memset(aec->time + BLOCK, 0, BLOCK * sizeof(float));
+    fft_forward(aec->fft, aec->time, aec->w_re + w, aec->w_im + w);
+    aec->constrain_next = (aec->constrain_next + 1) % aec->partitions;
+}
+
+static short to_s16(float v)
+{
+    v = v > -32768.0f ? v : -32768.0f;
+    v = v < 32767.0f ? v : 32767.0f;
+    return (short)lrintf(v);
+}
+
+// Cancel one mic block against far blocks up to c
+static void cancel_block(struct echo_canceller *aec, const short *mic, short *out, int64_t c)
+{
+    push_far_spectrum(aec, c);
+
+    memset(aec->y_re, 0, sizeof(aec->y_re));
+    memset(aec->y_im, 0, sizeof(aec->y_im));
+    for (int p = 0; p < aec->partitions; p++) {
+        size_t x = (size_t)((aec->x_head + p) % aec->partitions) * BINS;
+        size_t w = (size_t)p * BINS;
+        fft_mul_acc(aec->fft, aec->x_re + x, aec->x_im + x, aec->w_re + w, aec->w_im + w,
+                    aec->y_re, aec->y_im);
+    }
+    fft_inverse(aec->fft, aec->y_re, aec->y_im, aec->time);
+
+    // The echo estimate is the second half
+    const float *echo = aec->time + BLOCK;
+    double mic_energy = 0.0, out_energy = 0.0;
+    float mic_peak = 0.0f, echo_peak = 0.0f;
+    for (int i = 0; i < BLOCK; i++) {
+        float d = (float)mic[i];
+        aec->error[i] = d - echo[i];
+        mic_energy += (double)d * d;
+        out_energy += (double)aec->error[i] * aec->error[i];
+        mic_peak = fabsf(d) > mic_peak ? fabsf(d) : mic_peak;
+        echo_peak = fabsf(echo[i]) > echo_peak ? fabsf(echo[i]) : echo_peak;
+    }
+
+    // Loudest reference the filter span still hears
+    float far_peak = 0.0f;
+    for (int p = 0; p < aec->partitions; p++) {
+        int64_t b = c - p;
+        if (b >= 0 && aec->far_peak[b % ENV_BLOCKS] > far_peak) {
+            far_peak = aec->far_peak[b % ENV_BLOCKS];
+        }
+    }
+    bool far_active = far_peak >= FAR_ACTIVE_PEAK;
+
+    float ratio = 2.0f * aec->path_gain;
+    ratio = ratio < DOUBLE_TALK_MIN_RATIO ? DOUBLE_TALK_MIN_RATIO :
+            ratio > DOUBLE_TALK_MAX_RATIO ? DOUBLE_TALK_MAX_RATIO : ratio;
+    if (far_active && mic_peak > ratio * far_peak) {
+        aec->double_talk_hold = DOUBLE_TALK_HANGOVER_BLOCKS;
+    } else if (aec->double_talk_hold > 0) {
+        aec->double_talk_hold--;
+    }
+    bool double_talk = aec->double_talk_hold > 0;
+
+    // Never make the mic louder; a filter that keeps doing so has diverged
+    bool worse = out_energy > mic_energy;
+    if (worse) {
+        memcpy(out, mic, BLOCK * sizeof(short));
+        out_energy = mic_energy;
+    } else {
+        for (int i = 0; i < BLOCK; i++) {
+            out[i] = to_s16(aec->error[i]);
+        }
+    }
+
+    if (!far_active) {
+        aec->diverged_blocks = 0;
+        return;
+    }
+
+    if (double_talk) {
+        aec->stats.double_talk_blocks++;
+        return;
+    }
+
+    aec->stats.echo_blocks++;
+    aec->erle_mic = aec->erle_mic * ERLE_DECAY + mic_energy;
+    aec->erle_out = aec->erle_out * ERLE_DECAY + out_energy;
+    aec->erle_mic_total += mic_energy;
+    aec->erle_out_total += out_energy;
+    float erle_db = aec->erle_out > 0.0 ? (float)(10.0 * log10(aec->erle_mic / aec->erle_out)) : 0.0f;
+    aec->stats.erle_db = erle_db;
+
+    if (++aec->aligned_echo_blocks >= NO_ECHO_BLOCKS && erle_db < NO_ECHO_ERLE_DB) {
+        blog(LOG_INFO, "[Garmin Replay] Echo canceller: no echo found at this alignment, "
+             "searching again");
+        aec->aligned = false;
+        aec->candidate_hits = 0;
+        return;
+    }
+
+    if (erle_db > PATH_GAIN_MIN_ERLE_DB) {
+        aec->path_gain += PATH_GAIN_RATE * (echo_peak / far_peak - aec->path_gain);
+    }
+
+    aec->diverged_blocks = worse ? aec->diverged_blocks + 1 : 0;
+    if (aec->diverged_blocks >= DIVERGED_RESET_BLOCKS) {
+        blog(LOG_INFO, "[Garmin Replay] Echo canceller: filter diverged, restarting");
+        reset_filter(aec);
+        return;
+    }
+
+    adapt(aec);
+}
+
+static void bypass_block(struct echo_canceller *aec, const short *mic, short *out)
+{
+    memcpy(out, mic, BLOCK * sizeof(short));
+    aec->stats.bypass_blocks++;
+}
+
+// Write out every queued block whose reference is in, or that waited too long
+static int run_blocks(struct echo_canceller *aec, short *out)
+{
+    int done = 0;
+
+    while (aec->queued - done >= BLOCK) {
+        const short *mic = aec->queue + done;
+        short *dst = out + done;
+
+        if (!aec->aligned) {
+            bypass_block(aec, mic, dst);
+        } else {
+            int64_t c = (int64_t)aec->mic_block + aec->offset + PRE_DELAY_BLOCKS;
+            uint64_t needed_end = (uint64_t)(c + 1) * BLOCK;
+            bool stale = c > 0 && aec->far_samples > (uint64_t)(c - 1) * BLOCK + FAR_RING_SAMPLES;
+
+            if (c < 0 || stale) {
+                blog(LOG_INFO, "[Garmin Replay] Echo canceller: reference is too far ahead, "
+                     "realigning");
+                aec->aligned = false;
+                bypass_block(aec, mic, dst);
+            } else if (aec->far_samples < needed_end) {
+                if (aec->queued - done - BLOCK < aec->hold_samples) {
+                    break;
+                }
+                blog(LOG_INFO, "[Garmin Replay] Echo canceller: reference is more than %d ms late, "
+                     "passing the mic through until it lines up again", aec->config.max_hold_ms);
+                aec->aligned = false;
+                bypass_block(aec, mic, dst);
+            } else {
+                cancel_block(aec, mic, dst, c);
+            }
+        }
+
+        aec->mic_block++;
+        aec->stats.blocks++;
+        done += BLOCK;
+    }
+
+    aec->queued -= done;
+    memmove(aec->queue, aec->queue + done, (size_t)aec->queued * sizeof(short));
+    return done;
+}
+
+static void queue_mic(struct echo_canceller *aec, const short *mic, int count)
+{
+    memcpy(aec->queue + aec->queued, mic, (size_t)count * sizeof(short));
+
+    // Envelope of every block this completes, while it is still queued
+    uint64_t first_block = aec->mic_samples / BLOCK;
+    aec->queued += count;
+    aec->mic_samples += (uint64_t)count;
+    for (uint64_t b = first_block; b < aec->mic_samples / BLOCK; b++) {
+        const short *block = aec->queue + (b - aec->mic_block) * BLOCK;
+        aec->mic_env[b % ENV_BLOCKS] = block_envelope(block);
+
+        if (b + 1 >= aec->next_estimate_block) {
+            estimate_offset(aec);
+            aec->next_estimate_block = b + 1 + EST_INTERVAL_BLOCKS;
+        }
+    }
+}
+
+int echo_canceller_process(echo_canceller_t *aec, const short *mic, int count, short *out)
+{
+    uint64_t start_ns = os_gettime_ns();
+    int written = 0;
+
+    do {
+        int space = aec->queue_capacity - aec->queued;
+        int n = count < space ? count : space;
+        queue_mic(aec, mic, n);
+        mic += n;
+        count -= n;
+        written += run_blocks(aec, out + written);
+    } while (count > 0);
+
+    aec->stats.process_ns += os_gettime_ns() - start_ns;
+    return written;
+}
+
+int echo_canceller_max_output(const echo_canceller_t *aec, int count)
+{
+    return aec->queue_capacity + count;
+}
+
+int echo_canceller_pending(const echo_canceller_t *aec)
+{
+    return aec->queued;
+}
+
+enum audio_convert_isa echo_canceller_get_isa(const echo_canceller_t *aec)
+{
+    return fft_get_isa(aec->fft);
+}
+
+void echo_canceller_get_stats(const echo_canceller_t *aec, struct echo_canceller_stats *stats)
+{
+    *stats = aec->stats;
+    stats->aligned = aec->aligned;
+    stats->erle_mean_db = aec->erle_out_total > 0.0 ?
+        (float)(10.0 * log10(aec->erle_mic_total / aec->erle_out_total)) : 0.0f;
+}
+
+void echo_canceller_destroy(echo_canceller_t *aec)
+{
+    if (!aec) {
+        return;
+    }
+
+    fft_destroy(aec->fft);
+    free(aec->far);
+    free(aec->queue);
+    free(aec->x_re);
+    free(aec->x_im);
+    free(aec->w_re);
+    free(aec->w_im);
+    free(aec);
+}
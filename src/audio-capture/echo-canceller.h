@@ -0,0 +1,79 @@
+#ifndef ECHO_CANCELLER_H
+#define ECHO_CANCELLER_H
+
+#include "audio-convert.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Acoustic echo canceller for speaker audio bleeding into the microphone.
+// The far end (what the speakers play, e.g. OBS's desktop audio) drives a
+// partitioned-block frequency-domain NLMS filter that models the path from
+// the speakers to the mic; its echo estimate is subtracted from the mic.
+// Works on 16kHz mono s16 in blocks of 8 ms.
+//
+// The two streams arrive through unrelated buffers, so the offset between
+// them is found by correlating their energy envelopes and the filter only
+// has to cover the room's tail past it. When the reference arrives later
+// than the mic, the mic waits for it (up to max_hold_ms). Until the offset
+// is known, and whenever the reference stops coming, the mic passes
+// through unchanged.
+
+// Opaque handle to an echo canceller instance
+typedef struct echo_canceller echo_canceller_t;
+
+#define ECHO_CANCELLER_BLOCK_SAMPLES 128
+
+struct echo_canceller_config {
+    int tail_ms;        // Echo path length the filter covers
+    int max_delay_ms;   // Longest the echo may trail its reference
+    int max_hold_ms;    // Longest the mic waits for late reference audio
+};
+
+#define ECHO_DEFAULT_TAIL_MS      128
+#define ECHO_DEFAULT_MAX_DELAY_MS 500
+#define ECHO_DEFAULT_MAX_HOLD_MS  300
+
+struct echo_canceller_stats {
+    uint64_t blocks;              // Mic blocks processed
+    uint64_t echo_blocks;         // Reference playing and no near-end talk
+    uint64_t double_talk_blocks;  // Near-end talk over the reference, adaptation paused
+    uint64_t bypass_blocks;       // Passed through: offset unknown or reference late
+    uint64_t process_ns;          // Time spent in echo_canceller_process()
+    float erle_db;                // Echo return loss enhancement over the last ~2 s of echo
+    float erle_mean_db;           // Same, over every echo block since the offset was found
+    bool aligned;                 // Offset known, cancelling
+    int delay_ms;                 // How far the echo trails its reference as delivered
+                                  // (negative: the reference arrives late)
+    uint64_t realignments;        // Times the offset moved and the filter restarted
+};
+
+// Fill a config with the defaults above
+void echo_canceller_config_default(struct echo_canceller_config *config);
+
+// Returns: Echo canceller instance, or NULL on failure
+echo_canceller_t *echo_canceller_create(const struct echo_canceller_config *config);
+
+// Queue reference audio as it arrives
+void echo_canceller_far_end(echo_canceller_t *aec, const short *samples, int count);
+
+// Queue microphone audio and write out whatever can be cancelled now
+// out: Needs echo_canceller_max_output(aec, count) samples
+// Returns: Samples written to out; the output lags the input by
+//          echo_canceller_pending() samples
+int echo_canceller_process(echo_canceller_t *aec, const short *mic, int count, short *out);
+
+// Largest output echo_canceller_process can produce for `count` input samples
+int echo_canceller_max_output(const echo_canceller_t *aec, int count);
+
+// Mic samples queued and not written out yet
+int echo_canceller_pending(const echo_canceller_t *aec);
+
+// Instruction set of the FFT and spectrum kernels
+enum audio_convert_isa echo_canceller_get_isa(const echo_canceller_t *aec);
+
+void echo_canceller_get_stats(const echo_canceller_t *aec, struct echo_canceller_stats *stats);
+
+void echo_canceller_destroy(echo_canceller_t *aec);
+
+#endif // ECHO_CANCELLER_H
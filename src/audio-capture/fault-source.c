@@ -0,0 +1,122 @@
+#include "audio-source.h"
+
+#include <obs-module.h>
+
+#include <stdlib.h>
+
+// Developer backend that wraps the configured one and breaks it on a
+// schedule, to exercise device-loss recovery without unplugging anything.
+// After every fault_interval_ms of audio a read fails, alternating between
+// AUDIO_SOURCE_LOST and AUDIO_SOURCE_ERROR, and the next
+// fault_reopen_failures reopens fail as if the device were still missing.
+//
+// The wrapped backend is only rebuilt if it can reopen itself (WASAPI).
+// A file keeps its position instead of starting over, so no audio is lost
+// and a clip should trigger exactly as it does without faults.
+
+struct fault_source {
+    const struct audio_source_ops *inner;
+    void *data;
+
+    uint64_t interval_samples;
+    uint64_t samples_since_fault;
+    int reopen_failures;
+    int failures_left;
+    long faults;
+};
+
+static void fault_source_destroy(void *data);
+
+static void *fault_source_create(const struct audio_source_config *config)
+{
+    struct fault_source *src = calloc(1, sizeof(struct fault_source));
+    if (!src) {
+        return NULL;
+    }
+
+    src->inner = audio_source_find_ops(config->type);
+    src->data = src->inner ? src->inner->create(config) : NULL;
+    if (!src->data) {
+        fault_source_destroy(src);
+        return NULL;
+    }
+
+    src->interval_samples = (uint64_t)config->fault_interval_ms * AUDIO_SOURCE_SAMPLE_RATE / 1000;
+    src->reopen_failures = config->fault_reopen_failures > 0 ? config->fault_reopen_failures : 0;
+
+    blog(LOG_WARNING, "[Garmin Replay] Injecting %s capture faults every %d ms, %d failed reopens each",
+         src->inner->name, config->fault_interval_ms, src->reopen_failures);
+    return src;
+}
+
+static bool fault_source_start(void *data)
+{
+    struct fault_source *src = data;
+    return src->inner->start(src->data);
+}
+
+static int fault_source_read(void *data, short *buffer, int max_samples,
+                             uint64_t *timestamp_ns)
+{
+    struct fault_source *src = data;
+
+    if (src->samples_since_fault >= src->interval_samples) {
+        src->samples_since_fault = 0;
+        src->failures_left = src->reopen_failures;
+        src->faults++;
+        return src->faults % 2 ? AUDIO_SOURCE_LOST : AUDIO_SOURCE_ERROR;
+    }
+
+    int samples = src->inner->read(src->data, buffer, max_samples, timestamp_ns);
+    if (samples > 0) {
+        src->samples_since_fault += (uint64_t)samples;
+    }
+    return samples;
+}
+
+static bool fault_source_reopen(void *data)
+{
+    struct fault_source *src = data;
+
+    if (src->failures_left > 0) {
+        src->failures_left--;
+        return false;
+    }
+    return src->inner->reopen ? src->inner->reopen(src->data) : true;
+}
+
+static long fault_source_get_scratch_grows(void *data)
+{
+    struct fault_source *src = data;
+    return src->inner->get_scratch_grows ? src->inner->get_scratch_grows(src->data) : 0;
+}
+
+static void fault_source_stop(void *data)
+{
+    struct fault_source *src = data;
+    src->inner->stop(src->data);
+}
+
+static void fault_source_destroy(void *data)
+{
+    struct fault_source *src = data;
+    if (!src) {
+        return;
+    }
+
+    if (src->data) {
+        src->inner->destroy(src->data);
+    }
+    free(src);
+}
+
+const struct audio_source_ops fault_source_ops = {
+    .name = "fault",
+    .create = fault_source_create,
+    .start = fault_source_start,
+    .read = fault_source_read,
+    .stop = fault_source_stop,
+    .destroy = fault_source_destroy,
+    .reopen = fault_source_reopen,
+    .get_scratch_grows = fault_source_get_scratch_grows,
+};
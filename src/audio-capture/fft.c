@@ -0,0 +1,543 @@
+#include "fft.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define FFT_X86
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define FFT_NEON
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// A real transform of size n runs as a complex one of size m = n/2 on the
+// even/odd samples, then splits the result. The complex FFT is radix-2
+// decimation in frequency on split arrays: every stage is one contiguous
+// run of butterflies per group, which vectorizes as long as the group's
+// half-size h is at least the vector width. The last two stages (h = 2, 1)
+// are too narrow for that, but their twiddles are 1 and -i, so they run
+// fused and multiply-free in scalar code.
+
+// One DIF stage with h >= 4: for each group of 2h, x[j] += x[j+h] and
+// x[j+h] = (old x[j] - x[j+h]) * w[j]
+typedef void (*fft_pass_fn)(float *re, float *im, int m, int h,
+                            const float *w_re, const float *w_im);
+
+// y += x * w over `count` bins
+typedef void (*fft_mul_acc_fn)(const float *x_re, const float *x_im,
+                               const float *w_re, const float *w_im,
+                               float *y_re, float *y_im, int count);
+
+// w += g * conj(x) * e over `count` bins
+typedef void (*fft_conj_mul_acc_fn)(const float *x_re, const float *x_im,
+                                    const float *e_re, const float *e_im, const float *g,
+                                    float *w_re, float *w_im, int count);
+
+struct fft_kernels {
+    fft_pass_fn pass;
+    fft_mul_acc_fn mul_acc;
+    fft_conj_mul_acc_fn conj_mul_acc;
+};
+
+struct fft {
+    int n;
+    int m;  // Complex size, n/2
+    enum audio_convert_isa isa;
+    const struct fft_kernels *kernels;
+
+    // Stage twiddles, h = m/2 first: e^(-2 pi i j / 2h) for j < h
+    float *twiddle_re;
+    float *twiddle_im;
+
+    // Split step twiddles, e^(-2 pi i k / n) for k <= m
+    float *split_re;
+    float *split_im;
+
+    int *bitrev;
+
+    // Complex working buffer
+    float *z_re;
+    float *z_im;
+};
+
+// ---------------------------------------------------------------------------
+// Scalar
+
+static void pass_scalar(float *re, float *im, int m, int h,
+                        const float *w_re, const float *w_im)
+{
+    for (int k = 0; k < m; k += 2 * h) {
+        float *a_re = re + k, *a_im = im + k;
+        float *b_re = a_re + h, *b_im = a_im + h;
+        for (int j = 0; j < h; j++) {
+            float d_re = a_re[j] - b_re[j];
+            float d_im = a_im[j] - b_im[j];
+            a_re[j] = a_re[j] + b_re[j];
+            a_im[j] = a_im[j] + b_im[j];
+            b_re[j] = d_re * w_re[j] - d_im * w_im[j];
+            b_im[j] = d_re * w_im[j] + d_im * w_re[j];
+        }
+    }
+}
+
+static void mul_acc_scalar(const float *x_re, const float *x_im,
+                           const float *w_re, const float *w_im,
+                           float *y_re, float *y_im, int count)
+{
+    for (int i = 0; i < count; i++) {
+        y_re[i] += x_re[i] * w_re[i] - x_im[i] * w_im[i];
+        y_im[i] += x_re[i] * w_im[i] + x_im[i] * w_re[i];
+    }
+}
+
+static void conj_mul_acc_scalar(const float *x_re, const float *x_im,
+                                const float *e_re, const float *e_im, const float *g,
+                                float *w_re, float *w_im, int count)
+{
+    for (int i = 0; i < count; i++) {
+        w_re[i] += g[i] * (x_re[i] * e_re[i] + x_im[i] * e_im[i]);
+        w_im[i] += g[i] * (x_re[i] * e_im[i] - x_im[i] * e_re[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 (baseline on x86-64)
+
+#ifdef FFT_X86
+
+static void pass_sse2(float *re, float *im, int m, int h,
+                      const float *w_re, const float *w_im)
+{
+    for (int k = 0; k < m; k += 2 * h) {
+        float *a_re = re + k, *a_im = im + k;
+        float *b_re = a_re + h, *b_im = a_im + h;
+        for (int j = 0; j < h; j += 4) {
+            __m128 ar = _mm_loadu_ps(a_re + j), ai = _mm_loadu_ps(a_im + j);
+            __m128 br = _mm_loadu_ps(b_re + j), bi = _mm_loadu_ps(b_im + j);
+            __m128 wr = _mm_loadu_ps(w_re + j), wi = _mm_loadu_ps(w_im + j);
+            __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+            _mm_storeu_ps(a_re + j, _mm_add_ps(ar, br));
+            _mm_storeu_ps(a_im + j, _mm_add_ps(ai, bi));
+            _mm_storeu_ps(b_re + j, _mm_sub_ps(_mm_mul_ps(dr, wr), _mm_mul_ps(di, wi)));
+            _mm_storeu_ps(b_im + j, _mm_add_ps(_mm_mul_ps(dr, wi), _mm_mul_ps(di, wr)));
+        }
+    }
+}
+
+static void mul_acc_sse2(const float *x_re, const float *x_im,
+                         const float *w_re, const float *w_im,
+                         float *y_re, float *y_im, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 xr = _mm_loadu_ps(x_re + i), xi = _mm_loadu_ps(x_im + i);
+        __m128 wr = _mm_loadu_ps(w_re + i), wi = _mm_loadu_ps(w_im + i);
+        __m128 pr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+        __m128 pi = _mm_add_ps(_mm_mul_ps(xr, wi), _mm_mul_ps(xi, wr));
+        _mm_storeu_ps(y_re + i, _mm_add_ps(_mm_loadu_ps(y_re + i), pr));
+        _mm_storeu_ps(y_im + i, _mm_add_ps(_mm_loadu_ps(y_im + i), pi));
+    }
+    mul_acc_scalar(x_re + i, x_im + i, w_re + i, w_im + i, y_re + i, y_im + i, count - i);
+}
+
+static void conj_mul_acc_sse2(const float *x_re, const float *x_im,
+                              const float *e_re, const float *e_im, const float *g,
+                              float *w_re, float *w_im, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 xr = _mm_loadu_ps(x_re + i), xi = _mm_loadu_ps(x_im + i);
+        __m128 er = _mm_loadu_ps(e_re + i), ei = _mm_loadu_ps(e_im + i);
+        __m128 gain = _mm_loadu_ps(g + i);
+        __m128 pr = _mm_add_ps(_mm_mul_ps(xr, er), _mm_mul_ps(xi, ei));
+        __m128 pi = _mm_sub_ps(_mm_mul_ps(xr, ei), _mm_mul_ps(xi, er));
+        _mm_storeu_ps(w_re + i, _mm_add_ps(_mm_loadu_ps(w_re + i), _mm_mul_ps(gain, pr)));
+        _mm_storeu_ps(w_im + i, _mm_add_ps(_mm_loadu_ps(w_im + i), _mm_mul_ps(gain, pi)));
+    }
+    conj_mul_acc_scalar(x_re + i, x_im + i, e_re + i, e_im + i, g + i, w_re + i, w_im + i,
+                        count - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2
+
+TARGET_AVX2
+static void pass_avx2(float *re, float *im, int m, int h,
+                      const float *w_re, const float *w_im)
+{
+    if (h < 8) {
+        pass_sse2(re, im, m, h, w_re, w_im);
+        return;
+    }
+
+    for (int k = 0; k < m; k += 2 * h) {
+        float *a_re = re + k, *a_im = im + k;
+        float *b_re = a_re + h, *b_im = a_im + h;
+        for (int j = 0; j < h; j += 8) {
+            __m256 ar = _mm256_loadu_ps(a_re + j), ai = _mm256_loadu_ps(a_im + j);
+            __m256 br = _mm256_loadu_ps(b_re + j), bi = _mm256_loadu_ps(b_im + j);
+            __m256 wr = _mm256_loadu_ps(w_re + j), wi = _mm256_loadu_ps(w_im + j);
+            __m256 dr = _mm256_sub_ps(ar, br), di = _mm256_sub_ps(ai, bi);
+            _mm256_storeu_ps(a_re + j, _mm256_add_ps(ar, br));
+            _mm256_storeu_ps(a_im + j, _mm256_add_ps(ai, bi));
+            _mm256_storeu_ps(b_re + j, _mm256_sub_ps(_mm256_mul_ps(dr, wr), _mm256_mul_ps(di, wi)));
+            _mm256_storeu_ps(b_im + j, _mm256_add_ps(_mm256_mul_ps(dr, wi), _mm256_mul_ps(di, wr)));
+        }
+    }
+}
+
+TARGET_AVX2
+static void mul_acc_avx2(const float *x_re, const float *x_im,
+                         const float *w_re, const float *w_im,
+                         float *y_re, float *y_im, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 xr = _mm256_loadu_ps(x_re + i), xi = _mm256_loadu_ps(x_im + i);
+        __m256 wr = _mm256_loadu_ps(w_re + i), wi = _mm256_loadu_ps(w_im + i);
+        __m256 pr = _mm256_sub_ps(_mm256_mul_ps(xr, wr), _mm256_mul_ps(xi, wi));
+        __m256 pi = _mm256_add_ps(_mm256_mul_ps(xr, wi), _mm256_mul_ps(xi, wr));
+        _mm256_storeu_ps(y_re + i, _mm256_add_ps(_mm256_loadu_ps(y_re + i), pr));
+        _mm256_storeu_ps(y_im + i, _mm256_add_ps(_mm256_loadu_ps(y_im + i), pi));
+    }
+    mul_acc_sse2(x_re + i, x_im + i, w_re + i, w_im + i, y_re + i, y_im + i, count - i);
+}
+
+TARGET_AVX2
+static void conj_mul_acc_avx2(const float *x_re, const float *x_im,
+                              const float *e_re, const float *e_im, const float *g,
+                              float *w_re, float *w_im, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 xr = _mm256_loadu_ps(x_re + i), xi = _mm256_loadu_ps(x_im + i);
+        __m256 er = _mm256_loadu_ps(e_re + i), ei = _mm256_loadu_ps(e_im + i);
+        __m256 gain = _mm256_loadu_ps(g + i);
+        __m256 pr = _mm256_add_ps(_mm256_mul_ps(xr, er), _mm256_mul_ps(xi, ei));
+        __m256 pi = _mm256_sub_ps(_mm256_mul_ps(xr, ei), _mm256_mul_ps(xi, er));
+        _mm256_storeu_ps(w_re + i, _mm256_add_ps(_mm256_loadu_ps(w_re + i), _mm256_mul_ps(gain, pr)));
+        _mm256_storeu_ps(w_im + i, _mm256_add_ps(_mm256_loadu_ps(w_im + i), _mm256_mul_ps(gain, pi)));
+    }
+    conj_mul_acc_sse2(x_re + i, x_im + i, e_re + i, e_im + i, g + i, w_re + i, w_im + i,
+                      count - i);
+}
+
+#endif // FFT_X86
+
+// ---------------------------------------------------------------------------
+// NEON (baseline on arm64)
+
+#ifdef FFT_NEON
+
+static void pass_neon(float *re, float *im, int m, int h,
+                      const float *w_re, const float *w_im)
+{
+    for (int k = 0; k < m; k += 2 * h) {
+        float *a_re = re + k, *a_im = im + k;
+        float *b_re = a_re + h, *b_im = a_im + h;
+        for (int j = 0; j < h; j += 4) {
+            float32x4_t ar = vld1q_f32(a_re + j), ai = vld1q_f32(a_im + j);
+            float32x4_t br = vld1q_f32(b_re + j), bi = vld1q_f32(b_im + j);
+            float32x4_t wr = vld1q_f32(w_re + j), wi = vld1q_f32(w_im + j);
+            float32x4_t dr = vsubq_f32(ar, br), di = vsubq_f32(ai, bi);
+            vst1q_f32(a_re + j, vaddq_f32(ar, br));
+            vst1q_f32(a_im + j, vaddq_f32(ai, bi));
+            vst1q_f32(b_re + j, vsubq_f32(vmulq_f32(dr, wr), vmulq_f32(di, wi)));
+            vst1q_f32(b_im + j, vaddq_f32(vmulq_f32(dr, wi), vmulq_f32(di, wr)));
+        }
+    }
+}
+
+static void mul_acc_neon(const float *x_re, const float *x_im,
+                         const float *w_re, const float *w_im,
+                         float *y_re, float *y_im, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t xr = vld1q_f32(x_re + i), xi = vld1q_f32(x_im + i);
+        float32x4_t wr = vld1q_f32(w_re + i), wi = vld1q_f32(w_im + i);
+        float32x4_t pr = vsubq_f32(vmulq_f32(xr, wr), vmulq_f32(xi, wi));
+        float32x4_t pi = vaddq_f32(vmulq_f32(xr, wi), vmulq_f32(xi, wr));
+        vst1q_f32(y_re + i, vaddq_f32(vld1q_f32(y_re + i), pr));
+        vst1q_f32(y_im + i, vaddq_f32(vld1q_f32(y_im + i), pi));
+    }
+    mul_acc_scalar(x_re + i, x_im + i, w_re + i, w_im + i, y_re + i, y_im + i, count - i);
+}
+
+static void conj_mul_acc_neon(const float *x_re, const float *x_im,
+                              const float *e_re, const float *e_im, const float *g,
+                              float *w_re, float *w_im, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t xr = vld1q_f32(x_re + i), xi = vld1q_f32(x_im + i);
+        float32x4_t er = vld1q_f32(e_re + i), ei = vld1q_f32(e_im + i);
+        float32x4_t gain = vld1q_f32(g + i);
+        float32x4_t pr = vaddq_f32(vmulq_f32(xr, er), vmulq_f32(xi, ei));
+        float32x4_t pi = vsubq_f32(vmulq_f32(xr, ei), vmulq_f32(xi, er));
+        vst1q_f32(w_re + i, vaddq_f32(vld1q_f32(w_re + i), vmulq_f32(gain, pr)));
+        vst1q_f32(w_im + i, vaddq_f32(vld1q_f32(w_im + i), vmulq_f32(gain, pi)));
+    }
+    conj_mul_acc_scalar(x_re + i, x_im + i, e_re + i, e_im + i, g + i, w_re + i, w_im + i,
+                        count - i);
+}
+
+#endif // FFT_NEON
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const struct fft_kernels KERNELS[AUDIO_ISA_COUNT] = {
+    [AUDIO_ISA_SCALAR] = {pass_scalar, mul_acc_scalar, conj_mul_acc_scalar},
+#ifdef FFT_X86
+    [AUDIO_ISA_SSE2] = {pass_sse2, mul_acc_sse2, conj_mul_acc_sse2},
+    [AUDIO_ISA_AVX2] = {pass_avx2, mul_acc_avx2, conj_mul_acc_avx2},
+#endif
+#ifdef FFT_NEON
+    [AUDIO_ISA_NEON] = {pass_neon, mul_acc_neon, conj_mul_acc_neon},
+#endif
+};
+
+fft_t *fft_create_isa(int n, enum audio_convert_isa isa)
+{
+    if (n < FFT_MIN_SIZE || n > FFT_MAX_SIZE || (n & (n - 1)) != 0 ||
+        (int)isa < 0 || isa >= AUDIO_ISA_COUNT || !audio_convert_isa_available(isa) ||
+        !KERNELS[isa].pass) {
+        return NULL;
+    }
+
+    struct fft *fft = calloc(1, sizeof(struct fft));
+    if (!fft) {
+        return NULL;
+    }
+
+    int m = n / 2;
+    fft->n = n;
+    fft->m = m;
+    fft->isa = isa;
+    fft->kernels = &KERNELS[isa];
+    fft->twiddle_re = malloc((size_t)m * sizeof(float));
+    fft->twiddle_im = malloc((size_t)m * sizeof(float));
+    fft->split_re = malloc((size_t)(m + 1) * sizeof(float));
+    fft->split_im = malloc((size_t)(m + 1) * sizeof(float));
+    fft->bitrev = malloc((size_t)m * sizeof(int));
+    fft->z_re = malloc((size_t)m * sizeof(float));
+    fft->z_im = malloc((size_t)m * sizeof(float));
+    if (!fft->twiddle_re || !fft->twiddle_im || !fft->split_re || !fft->split_im ||
+        !fft->bitrev || !fft->z_re || !fft->z_im) {
+        fft_destroy(fft);
+        return NULL;
+    }
+
+    int offset = 0;
+    for (int h = m / 2; h >= 1; h /= 2) {
+        for (int j = 0; j < h; j++) {
+            double angle = -M_PI * (double)j / (double)h;
+            fft->twiddle_re[offset + j] = (float)cos(angle);
+            fft->twiddle_im[offset + j] = (float)sin(angle);
+        }
+        offset += h;
+    }
+
+    for (int k = 0; k <= m; k++) {
+        double angle = -2.0 * M_PI * (double)k / (double)n;
+        fft->split_re[k] = (float)cos(angle);
+        fft->split_im[k] = (float)sin(angle);
+    }
+
+    int bits = 0;
+    while ((1 << bits) < m) {
+        bits++;
+    }
+    for (int i = 0; i < m; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        fft->bitrev[i] = r;
+    }
+
+    return fft;
+}
+
+fft_t *fft_create(int n)
+{
+    static const enum audio_convert_isa PREFERENCE[] = {
+        AUDIO_ISA_AVX2, AUDIO_ISA_NEON, AUDIO_ISA_SSE2, AUDIO_ISA_SCALAR,
+    };
+
+    for (size_t i = 0; i < sizeof(PREFERENCE) / sizeof(PREFERENCE[0]); i++) {
+        if (audio_convert_isa_available(PREFERENCE[i]) && KERNELS[PREFERENCE[i]].pass) {
+            return fft_create_isa(n, PREFERENCE[i]);
+        }
+    }
+    return NULL;
+}
+
+int fft_size(const fft_t *fft)
+{
+    return fft->n;
+}
+
+int fft_bins(const fft_t *fft)
+{
+    return fft->m + 1;
+}
+
+enum audio_convert_isa fft_get_isa(const fft_t *fft)
+{
+    return fft->isa;
+}
+
+// The h = 2 and h = 1 stages over each group of four
+static void last_stages(float *re, float *im, int m)
+{
+    for (int k = 0; k < m; k += 4) {
+        float *r = re + k, *i = im + k;
+
+        // h = 2: twiddles 1 and -i
+        float a0_re = r[0] + r[2], a0_im = i[0] + i[2];
+        float a2_re = r[0] - r[2], a2_im = i[0] - i[2];
+        float a1_re = r[1] + r[3], a1_im = i[1] + i[3];
+        float a3_re = i[1] - i[3], a3_im = r[3] - r[1];
+
+        // h = 1: twiddle 1
+        r[0] = a0_re + a1_re;
+        i[0] = a0_im + a1_im;
+        r[1] = a0_re - a1_re;
+        i[1] = a0_im - a1_im;
+        r[2] = a2_re + a3_re;
+        i[2] = a2_im + a3_im;
+        r[3] = a2_re - a3_re;
+        i[3] = a2_im - a3_im;
+    }
+}
+
+// In-place complex FFT of z_re/z_im, natural order in and out
+static void complex_forward(fft_t *fft)
+{
+    float *re = fft->z_re, *im = fft->z_im;
+    const float *w_re = fft->twiddle_re, *w_im = fft->twiddle_im;
+
+    for (int h = fft->m / 2; h >= 4; h /= 2) {
+        fft->kernels->pass(re, im, fft->m, h, w_re, w_im);
+        w_re += h;
+        w_im += h;
+    }
+    last_stages(re, im, fft->m);
+
+    for (int i = 0; i < fft->m; i++) {
+        int j = fft->bitrev[i];
+        if (j > i) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+}
+
+void fft_forward(fft_t *fft, const float *in, float *re, float *im)
+{
+    int m = fft->m;
+
+    // Even samples as the real part, odd ones as the imaginary part
+    for (int i = 0; i < m; i++) {
+        fft->z_re[i] = in[2 * i];
+        fft->z_im[i] = in[2 * i + 1];
+    }
+    complex_forward(fft);
+
+    // X[k] = E[k] + W^k O[k], with E and O (the spectra of the even and odd
+    // samples) recovered from Z[k] and conj(Z[m - k])
+    for (int k = 0; k <= m; k++) {
+        int a = k < m ? k : 0;
+        int b = k > 0 ? m - k : 0;
+        float a_re = fft->z_re[a], a_im = fft->z_im[a];
+        float b_re = fft->z_re[b], b_im = -fft->z_im[b];
+
+        float e_re = 0.5f * (a_re + b_re);
+        float e_im = 0.5f * (a_im + b_im);
+        float o_re = 0.5f * (a_im - b_im);
+        float o_im = -0.5f * (a_re - b_re);
+
+        float w_re = fft->split_re[k], w_im = fft->split_im[k];
+        re[k] = e_re + w_re * o_re - w_im * o_im;
+        im[k] = e_im + w_re * o_im + w_im * o_re;
+    }
+}
+
+void fft_inverse(fft_t *fft, const float *re, const float *im, float *out)
+{
+    int m = fft->m;
+
+    // Undo the split: E[k] = (X[k] + conj(X[m - k])) / 2,
+    // O[k] = (X[k] - conj(X[m - k])) / 2 * W^-k, and Z = E + iO.
+    // Z goes in conjugated, so the forward kernel computes the inverse.
+    for (int k = 0; k < m; k++) {
+        float a_re = re[k], a_im = im[k];
+        float b_re = re[m - k], b_im = -im[m - k];
+
+        float e_re = 0.5f * (a_re + b_re);
+        float e_im = 0.5f * (a_im + b_im);
+        float d_re = 0.5f * (a_re - b_re);
+        float d_im = 0.5f * (a_im - b_im);
+
+        float w_re = fft->split_re[k], w_im = -fft->split_im[k];
+        float o_re = d_re * w_re - d_im * w_im;
+        float o_im = d_re * w_im + d_im * w_re;
+
+        fft->z_re[k] = e_re - o_im;
+        fft->z_im[k] = -(e_im + o_re);
+    }
+    complex_forward(fft);
+
+    float scale = 1.0f / (float)m;
+    for (int i = 0; i < m; i++) {
+        out[2 * i] = fft->z_re[i] * scale;
+        out[2 * i + 1] = -fft->z_im[i] * scale;
+    }
+}
+
+void fft_mul_acc(const fft_t *fft, const float *x_re, const float *x_im,
+                 const float *w_re, const float *w_im, float *y_re, float *y_im)
+{
+    fft->kernels->mul_acc(x_re, x_im, w_re, w_im, y_re, y_im, fft->m + 1);
+}
+
+void fft_conj_mul_acc(const fft_t *fft, const float *x_re, const float *x_im,
+                      const float *e_re, const float *e_im, const float *gain,
+                      float *w_re, float *w_im)
+{
+    fft->kernels->conj_mul_acc(x_re, x_im, e_re, e_im, gain, w_re, w_im, fft->m + 1);
+}
+
+void fft_destroy(fft_t *fft)
+{
+    if (!fft) {
+        return;
+    }
+
+    free(fft->twiddle_re);
+    free(fft->twiddle_im);
+    free(fft->split_re);
+    free(fft->split_im);
+    free(fft->bitrev);
+    free(fft->z_re);
+    free(fft->z_im);
+    free(fft);
+}
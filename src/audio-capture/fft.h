@@ -0,0 +1,56 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include "audio-convert.h"
+
+// Real FFTs and per-bin spectrum arithmetic for block convolution (the echo
+// canceller). Spectra are split into real and imaginary arrays of n/2 + 1
+// bins so the per-bin products vectorize without shuffles. The butterflies
+// and spectrum kernels have SSE2/AVX2/NEON variants, dispatched on the same
+// ISAs as the audio-convert kernels; they agree with the scalar code to
+// within float rounding.
+
+// Opaque handle; holds twiddles and scratch, so one per thread
+typedef struct fft fft_t;
+
+// Smallest and largest supported transform sizes
+#define FFT_MIN_SIZE 16
+#define FFT_MAX_SIZE 4096
+
+// Create a real FFT of size n with the best kernels for this CPU
+// n: Power of two in FFT_MIN_SIZE .. FFT_MAX_SIZE
+// Returns: FFT instance, or NULL if n is unsupported
+fft_t *fft_create(int n);
+
+// Same, with the kernels of a specific instruction set (benchmarks and
+// accuracy checks)
+// Returns: NULL if n is unsupported or the ISA is not available here
+fft_t *fft_create_isa(int n, enum audio_convert_isa isa);
+
+int fft_size(const fft_t *fft);
+
+// Number of bins in a spectrum, n/2 + 1
+int fft_bins(const fft_t *fft);
+
+enum audio_convert_isa fft_get_isa(const fft_t *fft);
+
+// in: n real samples
+// re, im: Receive the n/2 + 1 bins (unscaled)
+void fft_forward(fft_t *fft, const float *in, float *re, float *im);
+
+// Inverse of fft_forward, scaled so that a round trip is the identity
+// out: Receives n real samples
+void fft_inverse(fft_t *fft, const float *re, const float *im, float *out);
+
+// y += x * w, bin by bin
+void fft_mul_acc(const fft_t *fft, const float *x_re, const float *x_im,
+                 const float *w_re, const float *w_im, float *y_re, float *y_im);
+
+// w += gain * conj(x) * e, bin by bin (an NLMS gradient step)
+void fft_conj_mul_acc(const fft_t *fft, const float *x_re, const float *x_im,
+                      const float *e_re, const float *e_im, const float *gain,
+                      float *w_re, float *w_im);
+
+void fft_destroy(fft_t *fft);
+
+#endif // FFT_H
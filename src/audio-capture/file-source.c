@@ -0,0 +1,312 @@
+#include "audio-source.h"
+#include "audio-convert.h"
+#include "capture-scratch.h"
+#include "resampler.h"
+#include "../diagnostics/pipeline-stats.h"
+
+#include "../compat/obs-compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Process 10ms of source audio per read, same cadence as a WASAPI packet
+#define CHUNK_DIVISOR 100
+
+#define WAVE_FORMAT_PCM_TAG        0x0001
+#define WAVE_FORMAT_FLOAT_TAG      0x0003
+#define WAVE_FORMAT_EXTENSIBLE_TAG 0xFFFE
+
+struct file_source {
+    FILE *file;
+    bool owns_file;
+    bool realtime;
+
+    // Source format
+    int sample_rate;
+    int channels;
+    int bits;
+    bool is_float;
+    int block_align;
+
+    // Bytes of sample data left, or -1 when unknown (pipes, streamed WAVs)
+    long long data_remaining;
+
+    // Fused convert + downmix kernel for the source format
+    enum audio_sample_format sample_format;
+    audio_downmix_fn downmix;
+
+    // Scratch space, sized once for one chunk
+    int chunk_frames;
+    unsigned char *raw_buffer;
+    capture_scratch_t *scratch;
+    resampler_t *resampler;
+
+    // Pacing
+    uint64_t start_time_ns;
+    uint64_t frames_read;
+};
+
+static unsigned int read_le16(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8);
+}
+
+static unsigned int read_le32(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+// Walk the RIFF chunks up to "data", filling in the format
+static bool parse_wav_header(struct file_source *src, const unsigned char *riff)
+{
+    if (memcmp(riff + 8, "WAVE", 4) != 0) {
+        blog(LOG_ERROR, "[Garmin Replay] File is RIFF but not WAVE");
+        return false;
+    }
+
+    bool have_format = false;
+    unsigned char chunk[8];
+
+    while (fread(chunk, 1, sizeof(chunk), src->file) == sizeof(chunk)) {
+        unsigned int chunk_size = read_le32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[40] = {0};
+            size_t fmt_len = chunk_size < sizeof(fmt) ? chunk_size : sizeof(fmt);
+            if (fread(fmt, 1, fmt_len, src->file) != fmt_len) {
+                return false;
+            }
+
+            // Skip the rest of an oversized fmt chunk (plus pad byte)
+            long skip = (long)(chunk_size - fmt_len) + (long)(chunk_size & 1);
+            for (long i = 0; i < skip; i++) {
+                fgetc(src->file);
+            }
+
+            unsigned int tag = read_le16(fmt);
+            src->channels = (int)read_le16(fmt + 2);
+            src->sample_rate = (int)read_le32(fmt + 4);
+            src->block_align = (int)read_le16(fmt + 12);
+            src->bits = (int)read_le16(fmt + 14);
+
+            // Extensible: the real tag is the first two bytes of SubFormat
+            if (tag == WAVE_FORMAT_EXTENSIBLE_TAG && fmt_len >= 26) {
+                tag = read_le16(fmt + 24);
+            }
+
+            src->is_float = (tag == WAVE_FORMAT_FLOAT_TAG);
+            if (tag != WAVE_FORMAT_PCM_TAG && tag != WAVE_FORMAT_FLOAT_TAG) {
+                blog(LOG_ERROR, "[Garmin Replay] Unsupported WAV format tag 0x%04X", tag);
+                return false;
+            }
+            have_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            // Streaming writers leave the size as 0 or 0xFFFFFFFF
+            if (chunk_size == 0 || chunk_size == 0xFFFFFFFFu) {
+                src->data_remaining = -1;
+            } else {
+                src->data_remaining = chunk_size;
+            }
+            return have_format;
+        } else {
+            // Skip unknown chunk (LIST, fact, ...) without seeking so pipes work
+            long skip = (long)chunk_size + (long)(chunk_size & 1);
+            for (long i = 0; i < skip; i++) {
+                if (fgetc(src->file) == EOF) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+static void file_source_destroy(void *data);
+
+static void *file_source_create(const struct audio_source_config *config)
+{
+    if (!config->path || !*config->path) {
+        return NULL;
+    }
+
+    struct file_source *src = calloc(1, sizeof(struct file_source));
+    if (!src) {
+        return NULL;
+    }
+
+    src->realtime = config->realtime;
+
+    if (strcmp(config->path, "-") == 0) {
+        src->file = stdin;
+    } else {
+        src->file = os_fopen(config->path, "rb");
+        src->owns_file = true;
+    }
+
+    if (!src->file) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to open audio file: %s", config->path);
+        goto fail;
+    }
+
+    unsigned char riff[12];
+    size_t header_len = fread(riff, 1, sizeof(riff), src->file);
+
+    if (header_len == sizeof(riff) && memcmp(riff, "RIFF", 4) == 0) {
+        if (!parse_wav_header(src, riff)) {
+            blog(LOG_ERROR, "[Garmin Replay] Invalid WAV file: %s", config->path);
+            goto fail;
+        }
+    } else {
+        // Headerless s16le. The peeked bytes are sample data: rewind files,
+        // on a pipe the first few samples are simply dropped.
+        src->sample_rate = config->raw_sample_rate > 0 ? config->raw_sample_rate : 16000;
+        src->channels = config->raw_channels > 0 ? config->raw_channels : 1;
+        src->bits = 16;
+        src->block_align = src->channels * 2;
+        src->data_remaining = -1;
+        if (src->owns_file) {
+            rewind(src->file);
+        }
+    }
+
+    if (src->is_float) {
+        src->sample_format = AUDIO_SAMPLE_F32;
+    } else if (src->bits == 24) {
+        src->sample_format = AUDIO_SAMPLE_S24;
+    } else if (src->bits == 32) {
+        src->sample_format = AUDIO_SAMPLE_S32;
+    } else {
+        src->sample_format = AUDIO_SAMPLE_S16;
+    }
+
+    if (src->channels < 1 || src->sample_rate < 8000 ||
+        (src->bits != 16 && src->bits != 24 && src->bits != 32) ||
+        (src->is_float && src->bits != 32) ||
+        src->block_align != src->channels * (src->bits / 8)) {
+        blog(LOG_ERROR, "[Garmin Replay] Unsupported file format: %d Hz, %d ch, %d bit",
+             src->sample_rate, src->channels, src->bits);
+        goto fail;
+    }
+
+    enum audio_convert_isa isa;
+    src->downmix = audio_convert_select(src->sample_format, &isa);
+
+    src->chunk_frames = src->sample_rate / CHUNK_DIVISOR;
+    src->raw_buffer = malloc((size_t)src->chunk_frames * src->block_align);
+    src->scratch = capture_scratch_create(src->chunk_frames);
+    src->resampler = resampler_create(src->sample_rate, AUDIO_SOURCE_SAMPLE_RATE);
+    if (!src->raw_buffer || !src->scratch || !src->resampler) {
+        goto fail;
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] File source: %s (%d Hz, %d ch, %s via %s, %s)",
+         config->path, src->sample_rate, src->channels,
+         audio_sample_format_name(src->sample_format), audio_convert_isa_name(isa),
+         src->realtime ? "real-time" : "max speed");
+    return src;
+
+fail:
+    file_source_destroy(src);
+    return NULL;
+}
+
+static bool file_source_start(void *data)
+{
+    struct file_source *src = data;
+    src->start_time_ns = os_gettime_ns();
+    src->frames_read = 0;
+    return true;
+}
+
+static int file_source_read(void *data, short *buffer, int max_samples,
+                            uint64_t *timestamp_ns)
+{
+    struct file_source *src = data;
+
+    size_t want = (size_t)src->chunk_frames * src->block_align;
+    if (src->data_remaining >= 0 && (long long)want > src->data_remaining) {
+        want = (size_t)src->data_remaining;
+    }
+    if (want == 0) {
+        return AUDIO_SOURCE_END;
+    }
+
+    size_t got = fread(src->raw_buffer, 1, want, src->file);
+    int frames = (int)(got / src->block_align);
+    if (frames == 0) {
+        return ferror(src->file) ? AUDIO_SOURCE_ERROR : AUDIO_SOURCE_END;
+    }
+    if (src->data_remaining >= 0) {
+        src->data_remaining -= (long long)got;
+    }
+
+    uint64_t chunk_start_ns = src->start_time_ns +
+        src->frames_read * 1000000000ULL / (uint64_t)src->sample_rate;
+    src->frames_read += (uint64_t)frames;
+
+    // Real-time mode releases each chunk once it would have been recorded
+    if (src->realtime) {
+        os_sleepto_ns(src->start_time_ns +
+                      src->frames_read * 1000000000ULL / (uint64_t)src->sample_rate);
+    }
+
+    if (timestamp_ns) {
+        *timestamp_ns = chunk_start_ns;
+    }
+
+    short *mono = capture_scratch_get(src->scratch, frames);
+    if (!mono) {
+        return AUDIO_SOURCE_ERROR;
+    }
+
+    uint64_t convert_start = os_gettime_ns();
+    src->downmix(src->raw_buffer, mono, frames, src->channels);
+
+    uint64_t resample_start = os_gettime_ns();
+    int samples = resampler_process(src->resampler, mono, frames, buffer, max_samples);
+
+    pipeline_stats_record(STAGE_CONVERT, resample_start - convert_start);
+    pipeline_stats_record(STAGE_RESAMPLE, os_gettime_ns() - resample_start);
+    pipeline_stats_add(COUNTER_PACKETS, 1);
+    return samples;
+}
+
+static void file_source_stop(void *data)
+{
+    (void)data;
+}
+
+static void file_source_destroy(void *data)
+{
+    struct file_source *src = data;
+    if (!src) {
+        return;
+    }
+
+    if (src->file && src->owns_file) {
+        fclose(src->file);
+    }
+    free(src->raw_buffer);
+    capture_scratch_destroy(src->scratch);
+    resampler_destroy(src->resampler);
+    free(src);
+}
+
+static long file_source_get_scratch_grows(void *data)
+{
+    struct file_source *src = data;
+    return capture_scratch_get_grow_count(src->scratch);
+}
+
+const struct audio_source_ops file_source_ops = {
+    .name = "file",
+    .create = file_source_create,
+    .start = file_source_start,
+    .read = file_source_read,
+    .stop = file_source_stop,
+    .destroy = file_source_destroy,
+    .get_scratch_grows = file_source_get_scratch_grows,
+};
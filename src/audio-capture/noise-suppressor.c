@@ -0,0 +1,462 @@
+#include "noise-suppressor.h"
+#include "fft.h"
+
+#include "../compat/obs-compat.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define NS_X86
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define NS_NEON
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// 10 ms hops of 20 ms sqrt-Hann windows: analysis and synthesis windows
+// multiply to a Hann window, which overlap-adds to exactly one at 50%, so a
+// gain of one everywhere gives the input back one hop late. The window is
+// zero-padded to the FFT size so the gains' smearing has room.
+#define HOP      NOISE_SUPPRESSOR_FRAME_SAMPLES
+#define WINDOW   (2 * HOP)
+#define FFT_SIZE 512
+#define BINS     (FFT_SIZE / 2 + 1)
+
+// Smoothing of the power spectrum the noise estimate tracks
+#define SMOOTH_ALPHA 0.7f
+
+// The estimate follows the smoothed spectrum down at once and creeps back
+// up ~3 dB/s, so it rises to meet louder noise within seconds but a spoken
+// phrase or two barely lifts it
+#define NOISE_RISE 1.0069f
+
+// The smoothed spectrum's minimum sits below the noise's mean power; this
+// brings the estimate back up to it
+#define NOISE_BIAS 2.5f
+
+// Decision-directed a priori SNR: mostly last frame's clean estimate, so
+// the gain only moves when the SNR does, and stray noise peaks don't turn
+// into tones
+#define DD_ALPHA 0.98f
+
+// Keeps digital silence from dividing by zero
+#define POWER_FLOOR 1.0f
+
+// Frames within this factor of the noise estimate's energy are noise, and
+// count toward the reduction reported in the stats
+#define NOISE_FRAME_RATIO 2.0f
+
+struct ns_params {
+    float smooth;  // Weight of the old smoothed power (0 on the first frame)
+    float rise;
+    float bias;
+    float floor;   // Smallest gain
+};
+
+// Update the per-bin noise estimate from spectrum (re, im) and scale the
+// spectrum by its Wiener gain, over `count` bins
+typedef void (*ns_gain_fn)(float *re, float *im, float *smooth, float *noise,
+                           float *clean, const struct ns_params *p, int count);
+
+struct noise_suppressor {
+    struct noise_suppressor_config config;
+    fft_t *fft;
+    ns_gain_fn gain;
+    struct ns_params params;
+
+    float window[WINDOW];
+
+    short history[HOP];   // The previous hop, first half of the next window
+    short queue[HOP];     // Input waiting for a whole hop
+    int queued;
+
+    float *time;          // FFT_SIZE samples, zero past WINDOW
+    float *synth;         // FFT_SIZE samples
+    float overlap[HOP];   // Second half of the last synthesized window
+
+    float re[BINS], im[BINS];
+    float smooth[BINS];   // Smoothed power spectrum
+    float noise[BINS];    // Noise power estimate (before NOISE_BIAS)
+    float clean[BINS];    // Last frame's clean power estimate, G^2 |Y|^2
+
+    // Energy of the frames at the noise floor, before and after
+    double noise_in;
+    double noise_out;
+    struct noise_suppressor_stats stats;
+};
+
+// ---------------------------------------------------------------------------
+// Scalar
+
+static void gain_scalar(float *re, float *im, float *smooth, float *noise,
+                        float *clean, const struct ns_params *p, int count)
+{
+    for (int i = 0; i < count; i++) {
+        float power = re[i] * re[i] + im[i] * im[i];
+        float s = p->smooth * smooth[i] + (1.0f - p->smooth) * power;
+        float n = s < noise[i] ? s : noise[i] * p->rise;
+        smooth[i] = s;
+        noise[i] = n;
+
+        float nb = n * p->bias + POWER_FLOOR;
+        float post = power / nb - 1.0f;
+        post = post > 0.0f ? post : 0.0f;
+        float prio = DD_ALPHA * clean[i] / nb + (1.0f - DD_ALPHA) * post;
+        float g = prio / (1.0f + prio);
+        g = g > p->floor ? g : p->floor;
+
+        clean[i] = g * g * power;
+        re[i] *= g;
+        im[i] *= g;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 (baseline on x86-64)
+
+#ifdef NS_X86
+
+static void gain_sse2(float *re, float *im, float *smooth, float *noise,
+                      float *clean, const struct ns_params *p, int count)
+{
+    const __m128 a = _mm_set1_ps(p->smooth);
+    const __m128 one_a = _mm_set1_ps(1.0f - p->smooth);
+    const __m128 rise = _mm_set1_ps(p->rise);
+    const __m128 bias = _mm_set1_ps(p->bias);
+    const __m128 floor = _mm_set1_ps(p->floor);
+    const __m128 dd = _mm_set1_ps(DD_ALPHA);
+    const __m128 one_dd = _mm_set1_ps(1.0f - DD_ALPHA);
+    const __m128 power_floor = _mm_set1_ps(POWER_FLOOR);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 r = _mm_loadu_ps(re + i), m = _mm_loadu_ps(im + i);
+        __m128 power = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m));
+        __m128 s = _mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(smooth + i)),
+                              _mm_mul_ps(one_a, power));
+        __m128 n_old = _mm_loadu_ps(noise + i);
+        __m128 below = _mm_cmplt_ps(s, n_old);
+        __m128 n = _mm_or_ps(_mm_and_ps(below, s),
+                             _mm_andnot_ps(below, _mm_mul_ps(n_old, rise)));
+        _mm_storeu_ps(smooth + i, s);
+        _mm_storeu_ps(noise + i, n);
+
+        __m128 nb = _mm_add_ps(_mm_mul_ps(n, bias), power_floor);
+        __m128 post = _mm_max_ps(_mm_sub_ps(_mm_div_ps(power, nb), one), zero);
+        __m128 prio = _mm_add_ps(_mm_mul_ps(dd, _mm_div_ps(_mm_loadu_ps(clean + i), nb)),
+                                 _mm_mul_ps(one_dd, post));
+        __m128 g = _mm_max_ps(_mm_div_ps(prio, _mm_add_ps(one, prio)), floor);
+
+        _mm_storeu_ps(clean + i, _mm_mul_ps(_mm_mul_ps(g, g), power));
+        _mm_storeu_ps(re + i, _mm_mul_ps(r, g));
+        _mm_storeu_ps(im + i, _mm_mul_ps(m, g));
+    }
+    gain_scalar(re + i, im + i, smooth + i, noise + i, clean + i, p, count - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2
+
+TARGET_AVX2
+static void gain_avx2(float *re, float *im, float *smooth, float *noise,
+                      float *clean, const struct ns_params *p, int count)
+{
+    const __m256 a = _mm256_set1_ps(p->smooth);
+    const __m256 one_a = _mm256_set1_ps(1.0f - p->smooth);
+    const __m256 rise = _mm256_set1_ps(p->rise);
+    const __m256 bias = _mm256_set1_ps(p->bias);
+    const __m256 floor = _mm256_set1_ps(p->floor);
+    const __m256 dd = _mm256_set1_ps(DD_ALPHA);
+    const __m256 one_dd = _mm256_set1_ps(1.0f - DD_ALPHA);
+    const __m256 power_floor = _mm256_set1_ps(POWER_FLOOR);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 r = _mm256_loadu_ps(re + i), m = _mm256_loadu_ps(im + i);
+        __m256 power = _mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m));
+        __m256 s = _mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(smooth + i)),
+                                 _mm256_mul_ps(one_a, power));
+        __m256 n_old = _mm256_loadu_ps(noise + i);
+        __m256 below = _mm256_cmp_ps(s, n_old, _CMP_LT_OQ);
+        __m256 n = _mm256_blendv_ps(_mm256_mul_ps(n_old, rise), s, below);
+        _mm256_storeu_ps(smooth + i, s);
+        _mm256_storeu_ps(noise + i, n);
+
+        __m256 nb = _mm256_add_ps(_mm256_mul_ps(n, bias), power_floor);
+        __m256 post = _mm256_max_ps(_mm256_sub_ps(_mm256_div_ps(power, nb), one), zero);
+        __m256 prio = _mm256_add_ps(
+            _mm256_mul_ps(dd, _mm256_div_ps(_mm256_loadu_ps(clean + i), nb)),
+            _mm256_mul_ps(one_dd, post));
+        __m256 g = _mm256_max_ps(_mm256_div_ps(prio, _mm256_add_ps(one, prio)), floor);
+
+        _mm256_storeu_ps(clean + i, _mm256_mul_ps(_mm256_mul_ps(g, g), power));
+        _mm256_storeu_ps(re + i, _mm256_mul_ps(r, g));
+        _mm256_storeu_ps(im + i, _mm256_mul_ps(m, g));
+    }
+    gain_sse2(re + i, im + i, smooth + i, noise + i, clean + i, p, count - i);
+}
+
+#endif // NS_X86
+
+// ---------------------------------------------------------------------------
+// NEON (baseline on arm64)
+
+#ifdef NS_NEON
+
+static void gain_neon(float *re, float *im, float *smooth, float *noise,
+                      float *clean, const struct ns_params *p, int count)
+{
+    const float32x4_t a = vdupq_n_f32(p->smooth);
+    const float32x4_t one_a = vdupq_n_f32(1.0f - p->smooth);
+    const float32x4_t rise = vdupq_n_f32(p->rise);
+    const float32x4_t bias = vdupq_n_f32(p->bias);
+    const float32x4_t floor = vdupq_n_f32(p->floor);
+    const float32x4_t dd = vdupq_n_f32(DD_ALPHA);
+    const float32x4_t one_dd = vdupq_n_f32(1.0f - DD_ALPHA);
+    const float32x4_t power_floor = vdupq_n_f32(POWER_FLOOR);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t r = vld1q_f32(re + i), m = vld1q_f32(im + i);
+        float32x4_t power = vaddq_f32(vmulq_f32(r, r), vmulq_f32(m, m));
+        float32x4_t s = vaddq_f32(vmulq_f32(a, vld1q_f32(smooth + i)), vmulq_f32(one_a, power));
+        float32x4_t n_old = vld1q_f32(noise + i);
+        float32x4_t n = vbslq_f32(vcltq_f32(s, n_old), s, vmulq_f32(n_old, rise));
+        vst1q_f32(smooth + i, s);
+        vst1q_f32(noise + i, n);
+
+        float32x4_t nb = vaddq_f32(vmulq_f32(n, bias), power_floor);
+        float32x4_t post = vmaxq_f32(vsubq_f32(vdivq_f32(power, nb), one), zero);
+        float32x4_t prio = vaddq_f32(vmulq_f32(dd, vdivq_f32(vld1q_f32(clean + i), nb)),
+                                     vmulq_f32(one_dd, post));
+        float32x4_t g = vmaxq_f32(vdivq_f32(prio, vaddq_f32(one, prio)), floor);
+
+        vst1q_f32(clean + i, vmulq_f32(vmulq_f32(g, g), power));
+        vst1q_f32(re + i, vmulq_f32(r, g));
+        vst1q_f32(im + i, vmulq_f32(m, g));
+    }
+    gain_scalar(re + i, im + i, smooth + i, noise + i, clean + i, p, count - i);
+}
+
+#endif // NS_NEON
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const ns_gain_fn KERNELS[AUDIO_ISA_COUNT] = {
+    [AUDIO_ISA_SCALAR] = gain_scalar,
+#ifdef NS_X86
+    [AUDIO_ISA_SSE2] = gain_sse2,
+    [AUDIO_ISA_AVX2] = gain_avx2,
+#endif
+#ifdef NS_NEON
+    [AUDIO_ISA_NEON] = gain_neon,
+#endif
+};
+
+void noise_suppressor_config_default(struct noise_suppressor_config *config)
+{
+    config->max_suppression_db = NOISE_SUPPRESSOR_DEFAULT_DB;
+}
+
+noise_suppressor_t *noise_suppressor_create_isa(const struct noise_suppressor_config *config,
+                                                enum audio_convert_isa isa)
+{
+    if ((int)isa < 0 || isa >= AUDIO_ISA_COUNT || !KERNELS[isa]) {
+        return NULL;
+    }
+
+    struct noise_suppressor *ns = calloc(1, sizeof(struct noise_suppressor));
+    if (!ns) {
+        return NULL;
+    }
+
+    ns->config = *config;
+    if (ns->config.max_suppression_db < 0.0f) {
+        ns->config.max_suppression_db = 0.0f;
+    }
+
+    ns->fft = fft_create_isa(FFT_SIZE, isa);
+    ns->time = calloc(FFT_SIZE, sizeof(float));
+    ns->synth = calloc(FFT_SIZE, sizeof(float));
+    if (!ns->fft || !ns->time || !ns->synth) {
+        noise_suppressor_destroy(ns);
+        return NULL;
+    }
+    ns->gain = KERNELS[isa];
+
+    for (int i = 0; i < WINDOW; i++) {
+        ns->window[i] = (float)sqrt(0.5 - 0.5 * cos(2.0 * M_PI * i / WINDOW));
+    }
+
+    ns->params.rise = NOISE_RISE;
+    ns->params.bias = NOISE_BIAS;
+    ns->params.floor = powf(10.0f, -ns->config.max_suppression_db / 20.0f);
+    noise_suppressor_reset(ns);
+    return ns;
+}
+
+noise_suppressor_t *noise_suppressor_create(const struct noise_suppressor_config *config)
+{
+    static const enum audio_convert_isa PREFERENCE[] = {
+        AUDIO_ISA_AVX2, AUDIO_ISA_NEON, AUDIO_ISA_SSE2, AUDIO_ISA_SCALAR,
+    };
+
+    for (size_t i = 0; i < sizeof(PREFERENCE) / sizeof(PREFERENCE[0]); i++) {
+        if (audio_convert_isa_available(PREFERENCE[i]) && KERNELS[PREFERENCE[i]]) {
+            return noise_suppressor_create_isa(config, PREFERENCE[i]);
+        }
+    }
+    return NULL;
+}
+
+static short to_s16(float v)
+{
+    v = v > -32768.0f ? v : -32768.0f;
+    v = v < 32767.0f ? v : 32767.0f;
+    return (short)lrintf(v);
+}
+
+// Denoise the window ending with the queued hop and write out the hop
+// before it
+static void process_frame(struct noise_suppressor *ns, short *out)
+{
+    for (int i = 0; i < HOP; i++) {
+        ns->time[i] = (float)ns->history[i] * ns->window[i];
+        ns->time[HOP + i] = (float)ns->queue[i] * ns->window[HOP + i];
+    }
+
+    fft_forward(ns->fft, ns->time, ns->re, ns->im);
+    ns->gain(ns->re, ns->im, ns->smooth, ns->noise, ns->clean, &ns->params, BINS);
+    ns->params.smooth = SMOOTH_ALPHA;
+    fft_inverse(ns->fft, ns->re, ns->im, ns->synth);
+
+    double energy_in = 0.0, energy_out = 0.0;
+    for (int i = 0; i < HOP; i++) {
+        out[i] = to_s16(ns->synth[i] * ns->window[i] + ns->overlap[i]);
+        ns->overlap[i] = ns->synth[HOP + i] * ns->window[HOP + i];
+        energy_in += (double)ns->history[i] * (double)ns->history[i];
+        energy_out += (double)out[i] * (double)out[i];
+    }
+
+    // Parseval over the one-sided spectrum: the window's squares sum to HOP,
+    // so this is the noise energy expected in one hop
+    float noise = 0.0f;
+    for (int i = 0; i < BINS; i++) {
+        noise += ns->noise[i];
+    }
+    if (energy_in < NOISE_FRAME_RATIO * 2.0 * noise * NOISE_BIAS / FFT_SIZE) {
+        ns->noise_in += energy_in;
+        ns->noise_out += energy_out;
+    }
+
+    memcpy(ns->history, ns->queue, sizeof(ns->history));
+    ns->stats.frames++;
+}
+
+int noise_suppressor_process(noise_suppressor_t *ns, const short *in, int count, short *out)
+{
+    uint64_t start_ns = os_gettime_ns();
+    int written = 0;
+
+    while (count > 0) {
+        int n = HOP - ns->queued;
+        n = count < n ? count : n;
+        memcpy(ns->queue + ns->queued, in, (size_t)n * sizeof(short));
+        ns->queued += n;
+        in += n;
+        count -= n;
+
+        if (ns->queued == HOP) {
+            process_frame(ns, out + written);
+            written += HOP;
+            ns->queued = 0;
+        }
+    }
+
+    ns->stats.process_ns += os_gettime_ns() - start_ns;
+    return written;
+}
+
+int noise_suppressor_max_output(const noise_suppressor_t *ns, int count)
+{
+    (void)ns;
+    return count + HOP - 1;
+}
+
+int noise_suppressor_pending(const noise_suppressor_t *ns)
+{
+    return ns->queued + HOP;
+}
+
+enum audio_convert_isa noise_suppressor_get_isa(const noise_suppressor_t *ns)
+{
+    return fft_get_isa(ns->fft);
+}
+
+void noise_suppressor_reset(noise_suppressor_t *ns)
+{
+    if (!ns) {
+        return;
+    }
+
+    ns->queued = 0;
+    memset(ns->history, 0, sizeof(ns->history));
+    memset(ns->overlap, 0, sizeof(ns->overlap));
+    memset(ns->smooth, 0, sizeof(ns->smooth));
+    memset(ns->clean, 0, sizeof(ns->clean));
+
+    // The first frame sets the estimate; it only goes down from there
+    // until the spectrum's real minimum shows up
+    for (int i = 0; i < BINS; i++) {
+        ns->noise[i] = 1e30f;
+    }
+    ns->params.smooth = 0.0f;
+}
+
+void noise_suppressor_get_stats(const noise_suppressor_t *ns,
+                                struct noise_suppressor_stats *stats)
+{
+    *stats = ns->stats;
+
+    // Same Parseval sum as in process_frame, per sample and relative to
+    // full scale
+    double noise = 0.0;
+    for (int i = 0; i < BINS && ns->stats.frames > 0; i++) {
+        noise += (double)ns->noise[i] * NOISE_BIAS;
+    }
+    double mean_square = 2.0 * noise / ((double)FFT_SIZE * HOP);
+    stats->noise_dbfs = (float)(10.0 * log10(mean_square / (32768.0 * 32768.0) + 1e-12));
+    stats->reduction_db = ns->noise_out > 0.0 ?
+        (float)(10.0 * log10(ns->noise_in / ns->noise_out)) : 0.0f;
+}
+
+void noise_suppressor_destroy(noise_suppressor_t *ns)
+{
+    if (!ns) {
+        return;
+    }
+
+    fft_destroy(ns->fft);
+    free(ns->time);
+    free(ns->synth);
+    free(ns);
+}
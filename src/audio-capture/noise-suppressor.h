@@ -0,0 +1,68 @@
+#ifndef NOISE_SUPPRESSOR_H
+#define NOISE_SUPPRESSOR_H
+
+#include "audio-convert.h"
+
+#include <stdint.h>
+
+// Stationary noise suppression (fans, hum, hiss) for the recognizer feed.
+// Works on 16kHz mono s16 in 10 ms frames: a short-time spectrum over 20 ms
+// windows, a per-bin noise estimate that follows the spectral minimum, and
+// a Wiener gain from the decision-directed a priori SNR, so residual noise
+// stays smooth instead of warbling. The per-bin math has SSE2/AVX2/NEON
+// kernels next to the FFT's. Nothing is allocated after create.
+
+// Opaque handle to a noise suppressor instance
+typedef struct noise_suppressor noise_suppressor_t;
+
+#define NOISE_SUPPRESSOR_FRAME_SAMPLES 160
+
+struct noise_suppressor_config {
+    float max_suppression_db;  // Most a bin is attenuated (the gain floor)
+};
+
+#define NOISE_SUPPRESSOR_DEFAULT_DB 15.0f
+
+struct noise_suppressor_stats {
+    uint64_t frames;
+    uint64_t process_ns;     // Time spent in noise_suppressor_process()
+    float noise_dbfs;        // Current noise estimate over the whole band
+    float reduction_db;      // Input over output energy of frames at the noise floor
+};
+
+// Fill a config with the defaults above
+void noise_suppressor_config_default(struct noise_suppressor_config *config);
+
+// Returns: Noise suppressor with the best kernels for this CPU, or NULL
+noise_suppressor_t *noise_suppressor_create(const struct noise_suppressor_config *config);
+
+// Same, with the kernels of a specific instruction set (benchmarks and
+// accuracy checks)
+// Returns: NULL if the ISA is not available here
+noise_suppressor_t *noise_suppressor_create_isa(const struct noise_suppressor_config *config,
+                                                enum audio_convert_isa isa);
+
+// Denoise whatever whole frames `in` completes; the rest waits for the next call
+// out: Needs noise_suppressor_max_output(ns, count) samples
+// Returns: Samples written to out; the output lags the input by
+//          noise_suppressor_pending() samples
+int noise_suppressor_process(noise_suppressor_t *ns, const short *in, int count, short *out);
+
+// Largest output noise_suppressor_process can produce for `count` input samples
+int noise_suppressor_max_output(const noise_suppressor_t *ns, int count);
+
+// Input samples not written out yet (queued plus one frame of overlap)
+int noise_suppressor_pending(const noise_suppressor_t *ns);
+
+enum audio_convert_isa noise_suppressor_get_isa(const noise_suppressor_t *ns);
+
+// Forget the noise estimate and any queued audio, for a new unrelated stream
+// (stats are kept)
+void noise_suppressor_reset(noise_suppressor_t *ns);
+
+void noise_suppressor_get_stats(const noise_suppressor_t *ns,
+                                struct noise_suppressor_stats *stats);
+
+void noise_suppressor_destroy(noise_suppressor_t *ns);
+
+#endif // NOISE_SUPPRESSOR_H
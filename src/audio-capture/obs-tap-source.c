@@ -0,0 +1,274 @@
+#include "audio-source.h"
+
+#include <obs-module.h>
+#include <media-io/audio-resampler.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// Listens to an audio source OBS already captures instead of opening the
+// device a second time. OBS hands its audio capture callbacks the source's
+// filtered output (after noise suppression, gain and so on, before the
+// volume fader) as float planar at the output rate; libobs's resampler
+// turns that into 16 kHz mono right in the callback. The capture thread
+// then moves it into the source's ring like any other backend, since that
+// ring has a single producer.
+
+// Converted audio waiting for the capture thread, ~1 s
+#define TAP_BUFFER_SAMPLES 16000
+
+// How long a read waits for OBS to deliver audio (it does every ~20 ms)
+#define TAP_WAIT_MS 100
+
+#define NS_PER_SAMPLE (1000000000ULL / AUDIO_SOURCE_SAMPLE_RATE)
+
+struct obs_tap_source {
+    char *source_name;  // NULL for one of OBS's global audio channels
+    int channel;
+    obs_weak_source_t *weak_source;
+
+    // Filled on whichever thread outputs the source's audio, drained on the
+    // capture thread
+    pthread_mutex_t mutex;
+    bool mutex_initialized;
+    os_event_t *data_event;
+    audio_resampler_t *resampler;
+    short buffer[TAP_BUFFER_SAMPLES];
+    int buffered;
+    uint64_t buffer_timestamp_ns;  // Capture time of buffer[0]
+    long dropped_samples;
+};
+
+static void on_source_audio(void *param, obs_source_t *source, const struct audio_data *audio,
+                            bool muted)
+{
+    struct obs_tap_source *tap = param;
+    (void)source;
+
+    uint8_t *output[MAX_AV_PLANES];
+    uint32_t frames = 0;
+    uint64_t ts_offset = 0;
+    if (!audio_resampler_resample(tap->resampler, output, &frames, &ts_offset,
+                                  (const uint8_t *const *)audio->data, audio->frames)) {
+        return;
+    }
+
+    pthread_mutex_lock(&tap->mutex);
+    if (tap->buffered == 0) {
+        tap->buffer_timestamp_ns = audio->timestamp - ts_offset;
+    }
+
+    // The capture thread stalled; keep what is queued, it is older
+    int count = (int)frames;
+    if (count > TAP_BUFFER_SAMPLES - tap->buffered) {
+        tap->dropped_samples += count - (TAP_BUFFER_SAMPLES - tap->buffered);
+        count = TAP_BUFFER_SAMPLES - tap->buffered;
+    }
+
+    // Muted sources still deliver; silence keeps the stream's timing
+    if (muted) {
+        memset(tap->buffer + tap->buffered, 0, (size_t)count * sizeof(short));
+    } else {
+        memcpy(tap->buffer + tap->buffered, output[0], (size_t)count * sizeof(short));
+    }
+    tap->buffered += count;
+    pthread_mutex_unlock(&tap->mutex);
+
+    os_event_signal(tap->data_event);
+}
+
+static obs_source_t *find_source(struct obs_tap_source *tap)
+{
+    return tap->source_name ? obs_get_source_by_name(tap->source_name) :
+                              obs_get_output_source(tap->channel);
+}
+
+static const char *display_name(struct obs_tap_source *tap)
+{
+    if (tap->source_name) {
+        return tap->source_name;
+    }
+    return tap->channel == AUDIO_SOURCE_OBS_DESKTOP_AUDIO ? "Desktop Audio" : "Mic/Aux";
+}
+
+// Returns: false if the source doesn't exist (yet) or has no audio
+static bool attach(struct obs_tap_source *tap)
+{
+    obs_source_t *source = find_source(tap);
+    if (!source) {
+        blog(LOG_WARNING, "[Garmin Replay] OBS source '%s' not found", display_name(tap));
+        return false;
+    }
+    if (!(obs_source_get_output_flags(source) & OBS_SOURCE_AUDIO)) {
+        blog(LOG_WARNING, "[Garmin Replay] OBS source '%s' has no audio", display_name(tap));
+        obs_source_release(source);
+        return false;
+    }
+
+    tap->weak_source = obs_source_get_weak_source(source);
+    obs_source_add_audio_capture_callback(source, on_source_audio, tap);
+    blog(LOG_INFO, "[Garmin Replay] Listening to OBS source '%s'", obs_source_get_name(source));
+    obs_source_release(source);
+    return true;
+}
+
+static void detach(struct obs_tap_source *tap)
+{
+    if (!tap->weak_source) {
+        return;
+    }
+
+    // Once this returns, the callback isn't running and won't be again
+    obs_source_t *source = obs_weak_source_get_source(tap->weak_source);
+    if (source) {
+        obs_source_remove_audio_capture_callback(source, on_source_audio, tap);
+        obs_source_release(source);
+    }
+    obs_weak_source_release(tap->weak_source);
+    tap->weak_source = NULL;
+
+    pthread_mutex_lock(&tap->mutex);
+    tap->buffered = 0;
+    pthread_mutex_unlock(&tap->mutex);
+}
+
+// Returns: false if the source was deleted or removed from OBS
+static bool source_alive(struct obs_tap_source *tap)
+{
+    obs_source_t *source = obs_weak_source_get_source(tap->weak_source);
+    bool alive = source && !obs_source_removed(source);
+    obs_source_release(source);
+    return alive;
+}
+
+static void obs_tap_source_destroy(void *data);
+
+static void *obs_tap_source_create(const struct audio_source_config *config)
+{
+    struct obs_tap_source *tap = calloc(1, sizeof(struct obs_tap_source));
+    if (!tap) {
+        return NULL;
+    }
+
+    if (config->source_name && *config->source_name) {
+        tap->source_name = bstrdup(config->source_name);
+    }
+    tap->channel = config->obs_channel > 0 ? config->obs_channel : AUDIO_SOURCE_OBS_MIC_AUX;
+
+    struct obs_audio_info info;
+    if (!obs_get_audio_info(&info)) {
+        blog(LOG_ERROR, "[Garmin Replay] OBS audio isn't set up");
+        obs_tap_source_destroy(tap);
+        return NULL;
+    }
+
+    struct resample_info src_info = {
+        .samples_per_sec = info.samples_per_sec,
+        .format = AUDIO_FORMAT_FLOAT_PLANAR,
+        .speakers = info.speakers,
+    };
+    struct resample_info dst_info = {
+        .samples_per_sec = AUDIO_SOURCE_SAMPLE_RATE,
+        .format = AUDIO_FORMAT_16BIT,
+        .speakers = SPEAKERS_MONO,
+    };
+    tap->resampler = audio_resampler_create(&dst_info, &src_info);
+    if (!tap->resampler || pthread_mutex_init(&tap->mutex, NULL) != 0) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to create resampler for %u Hz OBS audio",
+             info.samples_per_sec);
+        obs_tap_source_destroy(tap);
+        return NULL;
+    }
+    tap->mutex_initialized = true;
+
+    if (os_event_init(&tap->data_event, OS_EVENT_TYPE_AUTO) != 0) {
+        obs_tap_source_destroy(tap);
+        return NULL;
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] OBS audio: %u Hz, %u ch, resampled by libobs",
+         info.samples_per_sec, get_audio_channels(info.speakers));
+    return tap;
+}
+
+static bool obs_tap_source_start(void *data)
+{
+    return attach(data);
+}
+
+static int obs_tap_source_read(void *data, short *buffer, int max_samples,
+                               uint64_t *timestamp_ns)
+{
+    struct obs_tap_source *tap = data;
+
+    if (os_event_timedwait(tap->data_event, TAP_WAIT_MS) != 0) {
+        return source_alive(tap) ? 0 : AUDIO_SOURCE_LOST;
+    }
+
+    pthread_mutex_lock(&tap->mutex);
+    int count = tap->buffered < max_samples ? tap->buffered : max_samples;
+    memcpy(buffer, tap->buffer, (size_t)count * sizeof(short));
+    if (timestamp_ns) {
+        *timestamp_ns = tap->buffer_timestamp_ns;
+    }
+
+    tap->buffered -= count;
+    if (tap->buffered > 0) {
+        memmove(tap->buffer, tap->buffer + count, (size_t)tap->buffered * sizeof(short));
+        tap->buffer_timestamp_ns += (uint64_t)count * NS_PER_SAMPLE;
+
+        // Come back for the rest without waiting
+        os_event_signal(tap->data_event);
+    }
+    pthread_mutex_unlock(&tap->mutex);
+
+    return count;
+}
+
+// Looks the source up by name again, so a deleted and re-added (or renamed
+// back) source is picked up
+static bool obs_tap_source_reopen(void *data)
+{
+    struct obs_tap_source *tap = data;
+    detach(tap);
+    return attach(tap);
+}
+
+static void obs_tap_source_stop(void *data)
+{
+    detach(data);
+}
+
+static void obs_tap_source_destroy(void *data)
+{
+    struct obs_tap_source *tap = data;
+    if (!tap) {
+        return;
+    }
+
+    if (tap->mutex_initialized) {
+        detach(tap);
+        pthread_mutex_destroy(&tap->mutex);
+    }
+    if (tap->dropped_samples > 0) {
+        blog(LOG_INFO, "[Garmin Replay] OBS source tap dropped %ld samples", tap->dropped_samples);
+    }
+    if (tap->data_event) {
+        os_event_destroy(tap->data_event);
+    }
+    audio_resampler_destroy(tap->resampler);
+    bfree(tap->source_name);
+    free(tap);
+}
+
+const struct audio_source_ops obs_tap_source_ops = {
+    .name = "obs source",
+    .create = obs_tap_source_create,
+    .start = obs_tap_source_start,
+    .read = obs_tap_source_read,
+    .stop = obs_tap_source_stop,
+    .destroy = obs_tap_source_destroy,
+    .reopen = obs_tap_source_reopen,
+};
@@ -0,0 +1,325 @@
+#include "resampler.h"
+
+#include "../compat/obs-compat.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RESAMPLER_SSE
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Zero crossings of the sinc on each side of the center tap
+#define SINC_ZERO_CROSSINGS 8
+
+// Passband edge as a fraction of the output Nyquist frequency
+#define SINC_ROLLOFF 0.92
+
+// Kaiser window shape, ~80 dB stopband
+#define KAISER_BETA 8.0
+
+// Input samples processed per inner block; bounds the work buffer size
+#define RESAMPLER_BLOCK 4096
+
+struct filter_bank {
+    int up;          // Interpolation factor L (number of phases)
+    int down;        // Decimation factor M
+    int taps;        // Taps per phase, multiple of 8
+    float *coeffs;   // [phase][tap], taps stored oldest sample first
+};
+
+struct resampler {
+    int src_rate;
+    int dst_rate;
+    bool passthrough;
+
+    struct filter_bank bank;
+    bool owns_bank;
+
+    // Position of the next output in upsampled units, relative to the
+    // first new input sample of the current block
+    int time;
+
+    // [taps - 1 samples of history | current block]
+    float *work;
+};
+
+// Ratios we see from real devices, resolved once and shared
+static const int COMMON_SOURCE_RATES[] = {44100, 48000, 96000};
+#define NUM_COMMON_RATES 3
+#define COMMON_TARGET_RATE 16000
+
+static struct filter_bank common_banks[NUM_COMMON_RATES];
+static pthread_once_t common_banks_once = PTHREAD_ONCE_INIT;
+
+static int gcd(int a, int b)
+{
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+static double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double half_x = x / 2.0;
+
+    for (int k = 1; k < 32; k++) {
+        term *= (half_x / k) * (half_x / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static bool build_filter_bank(struct filter_bank *bank, int src_rate, int dst_rate)
+{
+    int g = gcd(src_rate, dst_rate);
+    bank->up = dst_rate / g;
+    bank->down = src_rate / g;
+
+    // Wider filters for larger decimation so the cutoff stays sharp
+    double decimation = (double)bank->down / (double)bank->up;
+    if (decimation < 1.0) {
+        decimation = 1.0;
+    }
+    int taps = (int)ceil(2.0 * SINC_ZERO_CROSSINGS * decimation);
+    bank->taps = (taps + 7) & ~7;
+
+    int length = bank->up * bank->taps;
+    bank->coeffs = malloc((size_t)length * sizeof(float));
+    if (!bank->coeffs) {
+        return false;
+    }
+
+    // Prototype low-pass at the upsampled rate, cutoff below the lower Nyquist
+    double cutoff = 0.5 * SINC_ROLLOFF / (bank->up > bank->down ? bank->up : bank->down);
+    double center = (length - 1) / 2.0;
+    double i0_beta = bessel_i0(KAISER_BETA);
+
+    for (int j = 0; j < length; j++) {
+        double t = j - center;
+        double x = 2.0 * cutoff * t;
+        double sinc = (fabs(x) < 1e-12) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        double r = t / (length / 2.0);
+        double window = (fabs(r) >= 1.0) ? 0.0 :
+                        bessel_i0(KAISER_BETA * sqrt(1.0 - r * r)) / i0_beta;
+
+        // Gain of L makes up for the zeros inserted by upsampling
+        double h = bank->up * 2.0 * cutoff * sinc * window;
+
+        // h[phase + k * L] multiplies x[i - k]; store reversed per phase
+        int phase = j % bank->up;
+        int k = j / bank->up;
+        bank->coeffs[phase * bank->taps + (bank->taps - 1 - k)] = (float)h;
+    }
+
+    return true;
+}
+
+static void build_common_banks(void)
+{
+    for (int i = 0; i < NUM_COMMON_RATES; i++) {
+        build_filter_bank(&common_banks[i], COMMON_SOURCE_RATES[i], COMMON_TARGET_RATE);
+    }
+}
+
+static float dot_product(const float *a, const float *b, int count)
+{
+#if defined(RESAMPLER_SSE)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < count; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 0x55));
+    return _mm_cvtss_f32(acc0);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < count; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+#else
+    float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+    for (int i = 0; i < count; i += 4) {
+        acc0 += a[i] * b[i];
+        acc1 += a[i + 1] * b[i + 1];
+        acc2 += a[i + 2] * b[i + 2];
+        acc3 += a[i + 3] * b[i + 3];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+#endif
+}
+
+static short float_to_sample(float value)
+{
+    if (value >= 32767.0f) return 32767;
+    if (value <= -32768.0f) return -32768;
+    return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+}
+
+resampler_t *resampler_create(int src_rate, int dst_rate)
+{
+    if (src_rate <= 0 || dst_rate <= 0) {
+        return NULL;
+    }
+
+    resampler_t *rs = calloc(1, sizeof(resampler_t));
+    if (!rs) {
+        return NULL;
+    }
+
+    rs->src_rate = src_rate;
+    rs->dst_rate = dst_rate;
+
+    if (src_rate == dst_rate) {
+        rs->passthrough = true;
+        return rs;
+    }
+
+    if (dst_rate == COMMON_TARGET_RATE) {
+        pthread_once(&common_banks_once, build_common_banks);
+        for (int i = 0; i < NUM_COMMON_RATES; i++) {
+            if (COMMON_SOURCE_RATES[i] == src_rate && common_banks[i].coeffs) {
+                rs->bank = common_banks[i];
+                break;
+            }
+        }
+    }
+
+    if (!rs->bank.coeffs) {
+        if (!build_filter_bank(&rs->bank, src_rate, dst_rate)) {
+            free(rs);
+            return NULL;
+        }
+        rs->owns_bank = true;
+    }
+
+    rs->work = calloc((size_t)(rs->bank.taps - 1 + RESAMPLER_BLOCK), sizeof(float));
+    if (!rs->work) {
+        resampler_destroy(rs);
+        return NULL;
+    }
+
+    return rs;
+}
+
+int resampler_process(resampler_t *rs, const short *in, int in_count,
+                      short *out, int out_max)
+{
+    if (!rs || !in || !out || in_count <= 0) {
+        return 0;
+    }
+
+    if (rs->passthrough) {
+        int copy_len = in_count < out_max ? in_count : out_max;
+        memcpy(out, in, copy_len * sizeof(short));
+        return copy_len;
+    }
+
+    const int up = rs->bank.up;
+    const int down = rs->bank.down;
+    const int taps = rs->bank.taps;
+    const int history = taps - 1;
+    int written = 0;
+
+    while (in_count > 0) {
+        int block = in_count < RESAMPLER_BLOCK ? in_count : RESAMPLER_BLOCK;
+
+        float *block_start = rs->work + history;
+        for (int i = 0; i < block; i++) {
+            block_start[i] = (float)in[i];
+        }
+
+        // Step index/phase incrementally, no division per output
+        int index = rs->time / up;
+        int phase = rs->time - index * up;
+        const int index_step = down / up;
+        const int phase_step = down % up;
+
+        while (index < block) {
+            // Window ends at input sample `index`, history covers the rest
+            float value = dot_product(rs->bank.coeffs + phase * taps,
+                                      rs->work + index, taps);
+            if (written < out_max) {
+                out[written++] = float_to_sample(value);
+            }
+
+            index += index_step;
+            phase += phase_step;
+            if (phase >= up) {
+                phase -= up;
+                index++;
+            }
+        }
+        rs->time = (index - block) * up + phase;
+
+        memmove(rs->work, rs->work + block, (size_t)history * sizeof(float));
+
+        in += block;
+        in_count -= block;
+    }
+
+    return written;
+}
+
+int resampler_max_output(const resampler_t *rs, int in_count)
+{
+    if (!rs) {
+        return 0;
+    }
+    if (rs->passthrough) {
+        return in_count;
+    }
+    return (int)((long long)in_count * rs->dst_rate / rs->src_rate) + 1;
+}
+
+int resampler_get_taps(const resampler_t *rs)
+{
+    return (rs && !rs->passthrough) ? rs->bank.taps : 0;
+}
+
+void resampler_reset(resampler_t *rs)
+{
+    if (!rs || rs->passthrough) {
+        return;
+    }
+
+    rs->time = 0;
+    memset(rs->work, 0, (size_t)(rs->bank.taps - 1) * sizeof(float));
+}
+
+void resampler_destroy(resampler_t *rs)
+{
+    if (!rs) {
+        return;
+    }
+
+    if (rs->owns_bank) {
+        free(rs->bank.coeffs);
+    }
+    free(rs->work);
+    free(rs);
+}
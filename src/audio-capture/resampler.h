@@ -0,0 +1,34 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+// Streaming polyphase windowed-sinc resampler.
+// Filter history and phase carry over between calls, so audio delivered in
+// arbitrary packet sizes resamples exactly as if it were one long buffer.
+
+// Opaque handle to a resampler instance
+typedef struct resampler resampler_t;
+
+// Create a resampler converting src_rate to dst_rate
+// The 44.1k/48k/96k -> 16k filters are built once and shared by all instances
+// Returns: Resampler instance, or NULL on failure
+resampler_t *resampler_create(int src_rate, int dst_rate);
+
+// Resample a block of mono 16-bit samples
+// Never allocates; out must hold resampler_max_output(in_count) samples
+// Returns: Number of samples written to out
+int resampler_process(resampler_t *rs, const short *in, int in_count,
+                      short *out, int out_max);
+
+// Upper bound of output samples produced for in_count input samples
+int resampler_max_output(const resampler_t *rs, int in_count);
+
+// Number of filter taps applied per output sample
+int resampler_get_taps(const resampler_t *rs);
+
+// Clear filter history and phase (e.g. after a stream discontinuity)
+void resampler_reset(resampler_t *rs);
+
+// Destroy the resampler and free resources
+void resampler_destroy(resampler_t *rs);
+
+#endif // RESAMPLER_H
@@ -1,13 +1,22 @@
 #include "wasapi-capture.h"
+#include "audio-convert.h"
+#include "audio-source.h"
+#include "capture-scratch.h"
+#include "resampler.h"
+#include "../diagnostics/pipeline-stats.h"
 
 // Must include initguid.h FIRST before any Windows headers
 #define INITGUID
 #include <windows.h>
+#include <mmreg.h>
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 #include <functiondiscoverykeys_devpkey.h>
+#include <avrt.h>
 
 #include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -20,6 +29,12 @@ DEFINE_GUID(IID_IAudioClient, 0x1cb9ad4c, 0xdbfa, 0x4c32,
     0xb1, 0x78, 0xc2, 0xf5, 0x68, 0xa7, 0x03, 0xb2);
 DEFINE_GUID(IID_IAudioCaptureClient, 0xc8adbd64, 0xe71e, 0x48a0,
     0xa4, 0xde, 0x18, 0x5c, 0x39, 0x5c, 0xd3, 0x17);
+DEFINE_GUID(IID_IMMNotificationClient, 0x7991eec9, 0x7e89, 0x4d85,
+    0x83, 0x90, 0x6c, 0x70, 0x3c, 0xec, 0x60, 0xc0);
+
+// Compared by value, so this doesn't depend on uuid.lib
+static const GUID WATCH_IID_IUNKNOWN = {0x00000000, 0x0000, 0x0000,
+    {0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46}};
 
 // Vosk requires 16kHz, 16-bit, mono
 #define TARGET_SAMPLE_RATE 16000
@@ -42,11 +57,76 @@ struct wasapi_capture {
     int source_channels;
     int source_bits;
 
-    // Resampling buffer
-    float *resample_buffer;
-    int resample_buffer_size;
+    // Fused convert + downmix kernel for the mix format, picked at create
+    enum audio_sample_format sample_format;
+    audio_downmix_fn downmix;
+
+    // Conversion scratch space, sized from the device buffer up front
+    capture_scratch_t *scratch;
+
+    // Packets the endpoint flagged as a gap (its buffer overflowed)
+    long discontinuities;
+
+    // Last read stopped with packets still queued
+    bool packets_pending;
+
+    // Default device, configured or as the fallback
+    bool using_default;
+
+    // What made the last read fail
+    HRESULT last_error;
+
+    // Streaming resampler to TARGET_SAMPLE_RATE, keeps state across packets
+    resampler_t *resampler;
 };
 
+// Map the mix format onto a conversion kernel input format
+static bool get_sample_format(const WAVEFORMATEX *fmt, enum audio_sample_format *format)
+{
+    WORD tag = fmt->wFormatTag;
+
+    // Extensible: the KSDATAFORMAT_SUBTYPE GUIDs carry the format tag in Data1
+    if (tag == WAVE_FORMAT_EXTENSIBLE && fmt->cbSize >= 22) {
+        const WAVEFORMATEXTENSIBLE *ext = (const WAVEFORMATEXTENSIBLE *)fmt;
+        tag = (WORD)ext->SubFormat.Data1;
+    }
+
+    if (tag == WAVE_FORMAT_IEEE_FLOAT && fmt->wBitsPerSample == 32) {
+        *format = AUDIO_SAMPLE_F32;
+        return true;
+    }
+    if (tag != WAVE_FORMAT_PCM) {
+        return false;
+    }
+
+    switch (fmt->wBitsPerSample) {
+    case 16:
+        *format = AUDIO_SAMPLE_S16;
+        return true;
+    case 24:
+        *format = AUDIO_SAMPLE_S24;
+        return true;
+    case 32:
+        *format = AUDIO_SAMPLE_S32;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Returns: bmalloc'd wide copy, NULL for NULL
+static wchar_t *utf8_to_wide(const char *str)
+{
+    if (!str) {
+        return NULL;
+    }
+
+    int wide_len = MultiByteToWideChar(CP_UTF8, 0, str, -1, NULL, 0);
+    wchar_t *wide = bmalloc(wide_len * sizeof(wchar_t));
+    MultiByteToWideChar(CP_UTF8, 0, str, -1, wide, wide_len);
+    return wide;
+}
+
 wasapi_capture_t *wasapi_capture_create(const char *device_id)
 {
     wasapi_capture_t *capture = calloc(1, sizeof(wasapi_capture_t));
@@ -67,22 +147,20 @@ wasapi_capture_t *wasapi_capture_create(const char *device_id)
 
     // Get the audio device
     if (device_id && strlen(device_id) > 0) {
-        // Convert device ID to wide string
-        int wide_len = MultiByteToWideChar(CP_UTF8, 0, device_id, -1, NULL, 0);
-        wchar_t *wide_id = malloc(wide_len * sizeof(wchar_t));
-        MultiByteToWideChar(CP_UTF8, 0, device_id, -1, wide_id, wide_len);
-
+        wchar_t *wide_id = utf8_to_wide(device_id);
         hr = capture->device_enum->lpVtbl->GetDevice(
             capture->device_enum, wide_id, &capture->device);
-        free(wide_id);
+        bfree(wide_id);
 
         if (FAILED(hr)) {
             blog(LOG_WARNING, "[Garmin Replay] Failed to get device '%s', using default: 0x%08lX",
                  device_id, hr);
+            capture->using_default = true;
             hr = capture->device_enum->lpVtbl->GetDefaultAudioEndpoint(
                 capture->device_enum, eCapture, eConsole, &capture->device);
         }
     } else {
+        capture->using_default = true;
         hr = capture->device_enum->lpVtbl->GetDefaultAudioEndpoint(
             capture->device_enum, eCapture, eConsole, &capture->device);
     }
@@ -113,8 +191,25 @@ wasapi_capture_t *wasapi_capture_create(const char *device_id)
     capture->source_channels = capture->device_format->nChannels;
     capture->source_bits = capture->device_format->wBitsPerSample;
 
-    blog(LOG_INFO, "[Garmin Replay] Device format: %d Hz, %d ch, %d bit",
-         capture->source_sample_rate, capture->source_channels, capture->source_bits);
+    if (!get_sample_format(capture->device_format, &capture->sample_format)) {
+        blog(LOG_ERROR, "[Garmin Replay] Unsupported mix format: tag 0x%04X, %d bit",
+             capture->device_format->wFormatTag, capture->source_bits);
+        goto fail;
+    }
+
+    enum audio_convert_isa isa;
+    capture->downmix = audio_convert_select(capture->sample_format, &isa);
+
+    blog(LOG_INFO, "[Garmin Replay] Device format: %d Hz, %d ch, %s (%s conversion)",
+         capture->source_sample_rate, capture->source_channels,
+         audio_sample_format_name(capture->sample_format), audio_convert_isa_name(isa));
+
+    capture->resampler = resampler_create(capture->source_sample_rate, TARGET_SAMPLE_RATE);
+    if (!capture->resampler) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to create resampler for %d Hz",
+             capture->source_sample_rate);
+        goto fail;
+    }
 
     // Initialize audio client in shared mode
     hr = capture->audio_client->lpVtbl->Initialize(
@@ -153,13 +248,26 @@ wasapi_capture_t *wasapi_capture_create(const char *device_id)
         goto fail;
     }
 
-    // Allocate resample buffer
-    capture->resample_buffer_size = 8192;
-    capture->resample_buffer = malloc(capture->resample_buffer_size * sizeof(float));
-    if (!capture->resample_buffer) {
+    // Size scratch space for the largest packet the endpoint can hand us,
+    // so steady-state reads never touch the heap
+    UINT32 buffer_frames = 0;
+    hr = capture->audio_client->lpVtbl->GetBufferSize(capture->audio_client, &buffer_frames);
+    if (FAILED(hr)) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to get buffer size: 0x%08lX", hr);
         goto fail;
     }
 
+    REFERENCE_TIME default_period = 0;
+    capture->audio_client->lpVtbl->GetDevicePeriod(capture->audio_client, &default_period, NULL);
+
+    capture->scratch = capture_scratch_create((int)buffer_frames);
+    if (!capture->scratch) {
+        goto fail;
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] Capture buffer: %u frames, device period %.1f ms",
+         buffer_frames, default_period / 10000.0);
+
     capture->initialized = true;
     blog(LOG_INFO, "[Garmin Replay] WASAPI capture initialized");
     return capture;
@@ -186,149 +294,119 @@ bool wasapi_capture_start(wasapi_capture_t *capture)
     return true;
 }
 
-// Convert float audio to 16-bit signed
-static void float_to_s16(const float *src, short *dst, int count)
-{
-    for (int i = 0; i < count; i++) {
-        float sample = src[i];
-        if (sample < -1.0f) sample = -1.0f;
-        if (sample > 1.0f) sample = 1.0f;
-        dst[i] = (short)(sample * 32767.0f);
-    }
-}
-
-// Convert 32-bit signed to 16-bit signed
-static void s32_to_s16(const int *src, short *dst, int count)
+// Convert one captured packet to 16kHz mono
+// Returns: Number of samples written to out
+static int convert_packet(wasapi_capture_t *capture, short *mono_buffer, const BYTE *data,
+                          UINT32 frames, DWORD flags, short *out, int out_max)
 {
-    for (int i = 0; i < count; i++) {
-        dst[i] = (short)(src[i] >> 16);
-    }
-}
+    uint64_t convert_start = os_gettime_ns();
 
-// Simple downmix to mono
-static void stereo_to_mono_s16(const short *src, short *dst, int frames)
-{
-    for (int i = 0; i < frames; i++) {
-        int left = src[i * 2];
-        int right = src[i * 2 + 1];
-        dst[i] = (short)((left + right) / 2);
-    }
-}
-
-// Simple resampling (linear interpolation)
-static int resample_linear(const short *src, int src_len, int src_rate,
-                           short *dst, int dst_max, int dst_rate)
-{
-    if (src_rate == dst_rate) {
-        int copy_len = src_len < dst_max ? src_len : dst_max;
-        memcpy(dst, src, copy_len * sizeof(short));
-        return copy_len;
-    }
-
-    double ratio = (double)src_rate / (double)dst_rate;
-    int dst_len = (int)(src_len / ratio);
-    if (dst_len > dst_max) {
-        dst_len = dst_max;
-    }
-
-    for (int i = 0; i < dst_len; i++) {
-        double src_idx = i * ratio;
-        int idx0 = (int)src_idx;
-        int idx1 = idx0 + 1;
-        if (idx1 >= src_len) idx1 = src_len - 1;
-
-        double frac = src_idx - idx0;
-        dst[i] = (short)(src[idx0] * (1.0 - frac) + src[idx1] * frac);
+    pipeline_stats_add(COUNTER_PACKETS, 1);
+    if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
+        // Silence still goes through the resampler to keep its phase
+        memset(mono_buffer, 0, frames * sizeof(short));
+        pipeline_stats_add(COUNTER_SILENT_PACKETS, 1);
+    } else {
+        capture->downmix(data, mono_buffer, (int)frames, capture->source_channels);
     }
 
-    return dst_len;
+    // Resample to target rate
+    uint64_t resample_start = os_gettime_ns();
+    pipeline_stats_record(STAGE_CONVERT, resample_start - convert_start);
+    int samples = resampler_process(capture->resampler, mono_buffer, frames, out, out_max);
+    pipeline_stats_record(STAGE_RESAMPLE, os_gettime_ns() - resample_start);
+    return samples;
 }
 
-int wasapi_capture_read(wasapi_capture_t *capture, short *buffer, int max_samples)
+int wasapi_capture_read(wasapi_capture_t *capture, short *buffer, int max_samples,
+                        uint64_t *timestamp_ns)
 {
     if (!capture || !capture->initialized || !capture->capturing) {
         return -1;
     }
 
-    // Wait for audio data with timeout
-    DWORD result = WaitForSingleObject(capture->event_handle, 100);
-    if (result != WAIT_OBJECT_0) {
-        return 0;  // No data yet
+    capture->last_error = S_OK;
+
+    // Wait for audio data with timeout, unless the last call left packets behind
+    if (!capture->packets_pending) {
+        DWORD result = WaitForSingleObject(capture->event_handle, 100);
+        if (result != WAIT_OBJECT_0) {
+            // A removed endpoint stops signalling instead of failing the
+            // wait; asking it for a packet is what reports the loss
+            UINT32 packet_frames = 0;
+            HRESULT hr = capture->capture_client->lpVtbl->GetNextPacketSize(
+                capture->capture_client, &packet_frames);
+            if (FAILED(hr)) {
+                capture->last_error = hr;
+                return -1;
+            }
+            return 0;  // No data yet
+        }
     }
+    capture->packets_pending = false;
 
-    BYTE *data;
-    UINT32 frames_available;
-    DWORD flags;
+    // Drain every queued packet; one event can stand for several periods
+    // when this thread was descheduled, and leaving them queued is what
+    // overflows the shared-mode buffer
+    int samples_out = 0;
 
-    HRESULT hr = capture->capture_client->lpVtbl->GetBuffer(
-        capture->capture_client, &data, &frames_available, &flags, NULL, NULL);
-    if (FAILED(hr)) {
-        return -1;
-    }
+    for (;;) {
+        UINT32 packet_frames = 0;
+        HRESULT hr = capture->capture_client->lpVtbl->GetNextPacketSize(
+            capture->capture_client, &packet_frames);
+        if (FAILED(hr)) {
+            capture->last_error = hr;
+            return samples_out > 0 ? samples_out : -1;
+        }
+        if (packet_frames == 0) {
+            break;
+        }
 
-    if (frames_available == 0) {
-        capture->capture_client->lpVtbl->ReleaseBuffer(
-            capture->capture_client, 0);
-        return 0;
-    }
+        // Leave the packet for the next call rather than truncating it
+        if (samples_out + resampler_max_output(capture->resampler, packet_frames) > max_samples) {
+            capture->packets_pending = true;
+            break;
+        }
 
-    int samples_out = 0;
+        BYTE *data;
+        UINT32 frames_available;
+        DWORD flags;
+        UINT64 qpc_position;
 
-    if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
-        // Fill with silence
-        int silence_samples = frames_available;
-        if (silence_samples > max_samples) silence_samples = max_samples;
-        memset(buffer, 0, silence_samples * sizeof(short));
-        samples_out = silence_samples;
-    } else {
-        // Temporary buffer for format conversion
-        short *temp_buffer = malloc(frames_available * capture->source_channels * sizeof(short));
-        short *mono_buffer = malloc(frames_available * sizeof(short));
+        hr = capture->capture_client->lpVtbl->GetBuffer(
+            capture->capture_client, &data, &frames_available, &flags, NULL, &qpc_position);
+        if (FAILED(hr)) {
+            capture->last_error = hr;
+            return samples_out > 0 ? samples_out : -1;
+        }
 
-        if (!temp_buffer || !mono_buffer) {
-            free(temp_buffer);
-            free(mono_buffer);
-            capture->capture_client->lpVtbl->ReleaseBuffer(
-                capture->capture_client, frames_available);
-            return -1;
+        // QPC position is in 100ns units, the same clock os_gettime_ns() uses
+        if (samples_out == 0 && timestamp_ns) {
+            *timestamp_ns = qpc_position * 100;
         }
 
-        // Convert to 16-bit
-        WAVEFORMATEX *fmt = capture->device_format;
-        if (fmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT ||
-            (fmt->wFormatTag == WAVE_FORMAT_EXTENSIBLE && fmt->wBitsPerSample == 32)) {
-            float_to_s16((const float *)data, temp_buffer,
-                         frames_available * capture->source_channels);
-        } else if (fmt->wBitsPerSample == 32) {
-            s32_to_s16((const int *)data, temp_buffer,
-                       frames_available * capture->source_channels);
-        } else if (fmt->wBitsPerSample == 16) {
-            memcpy(temp_buffer, data, frames_available * capture->source_channels * sizeof(short));
-        } else {
-            // Unsupported format
-            memset(temp_buffer, 0, frames_available * capture->source_channels * sizeof(short));
+        if (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) {
+            capture->discontinuities++;
+            pipeline_stats_add(COUNTER_DISCONTINUITIES, 1);
         }
 
-        // Convert to mono
-        if (capture->source_channels >= 2) {
-            stereo_to_mono_s16(temp_buffer, mono_buffer, frames_available);
-        } else {
-            memcpy(mono_buffer, temp_buffer, frames_available * sizeof(short));
+        short *mono_buffer = capture_scratch_get(capture->scratch, (int)frames_available);
+        if (!mono_buffer) {
+            capture->capture_client->lpVtbl->ReleaseBuffer(
+                capture->capture_client, frames_available);
+            capture->last_error = E_OUTOFMEMORY;
+            return -1;
         }
 
-        // Resample to target rate
-        samples_out = resample_linear(mono_buffer, frames_available,
-                                       capture->source_sample_rate,
-                                       buffer, max_samples,
-                                       TARGET_SAMPLE_RATE);
+        if (frames_available > 0) {
+            samples_out += convert_packet(capture, mono_buffer, data, frames_available, flags,
+                                          buffer + samples_out, max_samples - samples_out);
+        }
 
-        free(temp_buffer);
-        free(mono_buffer);
+        capture->capture_client->lpVtbl->ReleaseBuffer(
+            capture->capture_client, frames_available);
     }
 
-    capture->capture_client->lpVtbl->ReleaseBuffer(
-        capture->capture_client, frames_available);
-
     return samples_out;
 }
 
@@ -353,6 +431,11 @@ void wasapi_capture_destroy(wasapi_capture_t *capture)
 
     wasapi_capture_stop(capture);
 
+    if (capture->initialized) {
+        blog(LOG_INFO, "[Garmin Replay] Capture hot-path allocations: %ld, discontinuities: %ld",
+             capture_scratch_get_grow_count(capture->scratch), capture->discontinuities);
+    }
+
     if (capture->capture_client) {
         capture->capture_client->lpVtbl->Release(capture->capture_client);
     }
@@ -371,14 +454,350 @@ void wasapi_capture_destroy(wasapi_capture_t *capture)
     if (capture->device_format) {
         CoTaskMemFree(capture->device_format);
     }
-    if (capture->resample_buffer) {
-        free(capture->resample_buffer);
-    }
+    capture_scratch_destroy(capture->scratch);
+    resampler_destroy(capture->resampler);
 
     free(capture);
 }
 
+long wasapi_capture_get_alloc_count(wasapi_capture_t *capture)
+{
+    return capture && capture->scratch ? capture_scratch_get_grow_count(capture->scratch) : 0;
+}
+
+bool wasapi_capture_device_lost(wasapi_capture_t *capture)
+{
+    if (!capture) {
+        return false;
+    }
+
+    switch (capture->last_error) {
+    case AUDCLNT_E_DEVICE_INVALIDATED:
+    case AUDCLNT_E_SERVICE_NOT_RUNNING:
+    case AUDCLNT_E_DEVICE_IN_USE:
+#ifdef AUDCLNT_E_RESOURCES_INVALIDATED
+    case AUDCLNT_E_RESOURCES_INVALIDATED:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool wasapi_capture_is_default(wasapi_capture_t *capture)
+{
+    return capture && capture->using_default;
+}
+
 int wasapi_capture_get_sample_rate(wasapi_capture_t *capture)
 {
     return TARGET_SAMPLE_RATE;
 }
+
+// Audio source backend
+
+// Endpoint notifications. They arrive on a system thread and only flag
+// that the capture thread should reopen: when the device being captured is
+// removed or disabled, when the default device changes while capturing
+// from it, or when the configured device comes back while capturing from
+// the default instead.
+struct device_watch {
+    IMMNotificationClient client;  // First, so the struct is the COM object
+    volatile long refs;
+    volatile bool changed;
+    volatile bool on_default;
+    wchar_t *wanted_id;  // Configured device, NULL for the default
+
+    // Device being captured, set by the capture thread on every (re)open
+    pthread_mutex_t mutex;
+    wchar_t current_id[256];
+};
+
+// Remember which endpoint the capture opened, so its removal is noticed
+static void watch_set_current(struct device_watch *watch, wasapi_capture_t *capture)
+{
+    LPWSTR id = NULL;
+    if (capture && FAILED(capture->device->lpVtbl->GetId(capture->device, &id))) {
+        id = NULL;
+    }
+
+    pthread_mutex_lock(&watch->mutex);
+    watch->current_id[0] = L'\0';
+    if (id) {
+        wcsncpy_s(watch->current_id, _countof(watch->current_id), id, _TRUNCATE);
+    }
+    pthread_mutex_unlock(&watch->mutex);
+
+    CoTaskMemFree(id);
+}
+
+// The device being captured went away: reopen, which falls back to the
+// default until it returns
+static void watch_check_current(struct device_watch *watch, LPCWSTR device_id)
+{
+    if (!device_id) {
+        return;
+    }
+
+    pthread_mutex_lock(&watch->mutex);
+    bool current = watch->current_id[0] && wcscmp(device_id, watch->current_id) == 0;
+    pthread_mutex_unlock(&watch->mutex);
+
+    if (current) {
+        os_atomic_set_bool(&watch->changed, true);
+    }
+}
+
+static HRESULT STDMETHODCALLTYPE watch_query_interface(IMMNotificationClient *client, REFIID riid,
+                                                       void **object)
+{
+    if (IsEqualIID(riid, &IID_IMMNotificationClient) || IsEqualIID(riid, &WATCH_IID_IUNKNOWN)) {
+        *object = client;
+        client->lpVtbl->AddRef(client);
+        return S_OK;
+    }
+    *object = NULL;
+    return E_NOINTERFACE;
+}
+
+// Owned by wasapi_source, which outlives the registration
+static ULONG STDMETHODCALLTYPE watch_add_ref(IMMNotificationClient *client)
+{
+    struct device_watch *watch = (struct device_watch *)client;
+    return (ULONG)InterlockedIncrement(&watch->refs);
+}
+
+static ULONG STDMETHODCALLTYPE watch_release(IMMNotificationClient *client)
+{
+    struct device_watch *watch = (struct device_watch *)client;
+    return (ULONG)InterlockedDecrement(&watch->refs);
+}
+
+static HRESULT STDMETHODCALLTYPE watch_device_state_changed(IMMNotificationClient *client,
+                                                            LPCWSTR device_id, DWORD state)
+{
+    struct device_watch *watch = (struct device_watch *)client;
+    if (state != DEVICE_STATE_ACTIVE) {
+        watch_check_current(watch, device_id);
+    } else if (watch->wanted_id && os_atomic_load_bool(&watch->on_default) && device_id &&
+               wcscmp(device_id, watch->wanted_id) == 0) {
+        os_atomic_set_bool(&watch->changed, true);
+    }
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE watch_device_added(IMMNotificationClient *client, LPCWSTR device_id)
+{
+    (void)client;
+    (void)device_id;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE watch_device_removed(IMMNotificationClient *client,
+                                                      LPCWSTR device_id)
+{
+    watch_check_current((struct device_watch *)client, device_id);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE watch_default_device_changed(IMMNotificationClient *client,
+                                                              EDataFlow flow, ERole role,
+                                                              LPCWSTR device_id)
+{
+    struct device_watch *watch = (struct device_watch *)client;
+    (void)device_id;
+    if (flow == eCapture && role == eConsole && os_atomic_load_bool(&watch->on_default)) {
+        os_atomic_set_bool(&watch->changed, true);
+    }
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE watch_property_value_changed(IMMNotificationClient *client,
+                                                              LPCWSTR device_id,
+                                                              const PROPERTYKEY key)
+{
+    (void)client;
+    (void)device_id;
+    (void)key;
+    return S_OK;
+}
+
+static IMMNotificationClientVtbl WATCH_VTBL = {
+    watch_query_interface,
+    watch_add_ref,
+    watch_release,
+    watch_device_state_changed,
+    watch_device_added,
+    watch_device_removed,
+    watch_default_device_changed,
+    watch_property_value_changed,
+};
+
+struct wasapi_source {
+    wasapi_capture_t *capture;
+    char *device_id;
+    bool com_initialized;
+    HANDLE mmcss_task;
+
+    IMMDeviceEnumerator *device_enum;
+    struct device_watch watch;
+    bool watch_mutex_initialized;
+    bool watch_registered;
+};
+
+static void wasapi_source_destroy(void *data);
+
+static void *wasapi_source_create(const struct audio_source_config *config)
+{
+    struct wasapi_source *src = calloc(1, sizeof(struct wasapi_source));
+    if (!src) {
+        return NULL;
+    }
+
+    // COM is per thread; the source lives on the thread that created it
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to initialize COM: 0x%08lX", hr);
+        free(src);
+        return NULL;
+    }
+    src->com_initialized = true;
+
+    // This runs on the capture thread: let MMCSS schedule it as audio work
+    DWORD task_index = 0;
+    src->mmcss_task = AvSetMmThreadCharacteristicsW(L"Audio", &task_index);
+
+    src->device_id = config->device_id && *config->device_id ? bstrdup(config->device_id) : NULL;
+    src->capture = wasapi_capture_create(src->device_id);
+    if (!src->capture) {
+        wasapi_source_destroy(src);
+        return NULL;
+    }
+
+    // Without notifications a removed device is still noticed by the probe
+    // on a read timeout; this notices it at once and makes following the
+    // default device work
+    src->watch.client.lpVtbl = &WATCH_VTBL;
+    src->watch.refs = 1;
+    src->watch.wanted_id = utf8_to_wide(src->device_id);
+    src->watch.on_default = wasapi_capture_is_default(src->capture);
+    if (pthread_mutex_init(&src->watch.mutex, NULL) != 0) {
+        wasapi_source_destroy(src);
+        return NULL;
+    }
+    src->watch_mutex_initialized = true;
+    watch_set_current(&src->watch, src->capture);
+    hr = CoCreateInstance(&CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
+                          &IID_IMMDeviceEnumerator, (void **)&src->device_enum);
+    if (SUCCEEDED(hr)) {
+        hr = src->device_enum->lpVtbl->RegisterEndpointNotificationCallback(
+            src->device_enum, &src->watch.client);
+        src->watch_registered = SUCCEEDED(hr);
+    }
+    if (!src->watch_registered) {
+        blog(LOG_WARNING, "[Garmin Replay] Not watching for device changes: 0x%08lX", hr);
+    }
+
+    return src;
+}
+
+static bool wasapi_source_start(void *data)
+{
+    struct wasapi_source *src = data;
+    return wasapi_capture_start(src->capture);
+}
+
+static int wasapi_source_read(void *data, short *buffer, int max_samples,
+                              uint64_t *timestamp_ns)
+{
+    struct wasapi_source *src = data;
+
+    if (os_atomic_load_bool(&src->watch.changed)) {
+        blog(LOG_INFO, "[Garmin Replay] Capture device changed");
+        return AUDIO_SOURCE_LOST;
+    }
+
+    int samples = wasapi_capture_read(src->capture, buffer, max_samples, timestamp_ns);
+    if (samples < 0) {
+        return wasapi_capture_device_lost(src->capture) ? AUDIO_SOURCE_LOST : AUDIO_SOURCE_ERROR;
+    }
+    return samples;
+}
+
+// New device lookup, client and resampler; the thread's COM and MMCSS
+// registrations stay
+static bool wasapi_source_reopen(void *data)
+{
+    struct wasapi_source *src = data;
+
+    wasapi_capture_destroy(src->capture);
+
+    // A change from here on needs another reopen
+    os_atomic_set_bool(&src->watch.changed, false);
+    src->capture = wasapi_capture_create(src->device_id);
+    watch_set_current(&src->watch, src->capture);
+    if (!src->capture) {
+        return false;
+    }
+
+    os_atomic_set_bool(&src->watch.on_default, wasapi_capture_is_default(src->capture));
+    if (!wasapi_capture_start(src->capture)) {
+        wasapi_capture_destroy(src->capture);
+        src->capture = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void wasapi_source_stop(void *data)
+{
+    struct wasapi_source *src = data;
+    wasapi_capture_stop(src->capture);
+}
+
+static void wasapi_source_destroy(void *data)
+{
+    struct wasapi_source *src = data;
+    if (!src) {
+        return;
+    }
+
+    if (src->watch_registered) {
+        src->device_enum->lpVtbl->UnregisterEndpointNotificationCallback(
+            src->device_enum, &src->watch.client);
+    }
+    if (src->device_enum) {
+        src->device_enum->lpVtbl->Release(src->device_enum);
+    }
+    if (src->watch_mutex_initialized) {
+        pthread_mutex_destroy(&src->watch.mutex);
+    }
+    bfree(src->watch.wanted_id);
+    bfree(src->device_id);
+
+    wasapi_capture_destroy(src->capture);
+    if (src->mmcss_task) {
+        AvRevertMmThreadCharacteristics(src->mmcss_task);
+    }
+    if (src->com_initialized) {
+        CoUninitialize();
+    }
+    free(src);
+}
+
+static long wasapi_source_get_scratch_grows(void *data)
+{
+    struct wasapi_source *src = data;
+    return wasapi_capture_get_alloc_count(src->capture);
+}
+
+const struct audio_source_ops wasapi_source_ops = {
+    .name = "wasapi",
+    .create = wasapi_source_create,
+    .start = wasapi_source_start,
+    .read = wasapi_source_read,
+    .stop = wasapi_source_stop,
+    .destroy = wasapi_source_destroy,
+    .reopen = wasapi_source_reopen,
+    .get_scratch_grows = wasapi_source_get_scratch_grows,
+};
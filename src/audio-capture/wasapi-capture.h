@@ -2,6 +2,7 @@
 #define WASAPI_CAPTURE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // Opaque handle to WASAPI capture instance
 typedef struct wasapi_capture wasapi_capture_t;
@@ -16,10 +17,14 @@ wasapi_capture_t *wasapi_capture_create(const char *device_id);
 bool wasapi_capture_start(wasapi_capture_t *capture);
 
 // Read audio samples from the capture buffer
+// Waits for the device event, then drains every queued packet
 // buffer: Output buffer for 16-bit signed samples
 // max_samples: Maximum number of samples to read
+// timestamp_ns: Optional, receives the capture time of the first sample
 // Returns: Number of samples read, 0 if no data, -1 on error
-int wasapi_capture_read(wasapi_capture_t *capture, short *buffer, int max_samples);
+//          (see wasapi_capture_device_lost)
+int wasapi_capture_read(wasapi_capture_t *capture, short *buffer, int max_samples,
+                        uint64_t *timestamp_ns);
 
 // Stop audio capture
 void wasapi_capture_stop(wasapi_capture_t *capture);
@@ -27,6 +32,18 @@ void wasapi_capture_stop(wasapi_capture_t *capture);
 // Destroy the capture instance and free resources
 void wasapi_capture_destroy(wasapi_capture_t *capture);
 
+// Number of heap allocations made by wasapi_capture_read
+// Scratch space is sized at create time, so this stays 0 while streaming
+long wasapi_capture_get_alloc_count(wasapi_capture_t *capture);
+
+// Whether the last failed read means the device went away (unplugged,
+// disabled, audio service restarted) rather than a plain error
+bool wasapi_capture_device_lost(wasapi_capture_t *capture);
+
+// Whether this captures from the default device, configured or as the
+// fallback for a configured device that wasn't there
+bool wasapi_capture_is_default(wasapi_capture_t *capture);
+
 // Get the sample rate of the capture
 int wasapi_capture_get_sample_rate(wasapi_capture_t *capture);
 
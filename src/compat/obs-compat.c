@@ -0,0 +1,88 @@
+#include "obs-compat.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static log_handler_t g_log_handler;
+static void *g_log_param;
+
+void base_set_log_handler(log_handler_t handler, void *param)
+{
+    g_log_handler = handler;
+    g_log_param = param;
+}
+
+void blog(int log_level, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if (g_log_handler) {
+        g_log_handler(log_level, format, args, g_log_param);
+    } else if (log_level < LOG_DEBUG) {
+        vfprintf(stderr, format, args);
+        fputc('\n', stderr);
+    }
+    va_end(args);
+}
+
+void *bmalloc(size_t size)
+{
+    // Like libobs, running out of memory isn't something callers handle
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        fprintf(stderr, "Out of memory while trying to allocate %zu bytes\n", size);
+        abort();
+    }
+    return ptr;
+}
+
+void bfree(void *ptr)
+{
+    free(ptr);
+}
+
+char *bstrdup_n(const char *str, size_t n)
+{
+    if (!str) {
+        return NULL;
+    }
+
+    char *dup = bmalloc(n + 1);
+    memcpy(dup, str, n);
+    dup[n] = '\0';
+    return dup;
+}
+
+char *bstrdup(const char *str)
+{
+    return str ? bstrdup_n(str, strlen(str)) : NULL;
+}
+
+uint64_t os_gettime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+bool os_sleepto_ns(uint64_t time_target)
+{
+    uint64_t now = os_gettime_ns();
+    if (time_target <= now) {
+        return false;
+    }
+
+    uint64_t wait_ns = time_target - now;
+    struct timespec ts = {(time_t)(wait_ns / 1000000000ULL), (long)(wait_ns % 1000000000ULL)};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+    return true;
+}
+
+FILE *os_fopen(const char *path, const char *mode)
+{
+    return fopen(path, mode);
+}
@@ -0,0 +1,62 @@
+#ifndef OBS_COMPAT_H
+#define OBS_COMPAT_H
+
+// The core sources (cmake/garmin-core.cmake) only need a sliver of libobs:
+// logging, string allocation, the monotonic clock, opening files and
+// pthreads. In the plugin that is libobs itself. With
+// GARMIN_CORE_STANDALONE, obs-compat.c stands in for it so the core can be
+// built and benchmarked without OBS.
+
+#ifndef GARMIN_CORE_STANDALONE
+
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#else
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Same levels as util/base.h
+enum {
+    LOG_ERROR = 100,
+    LOG_WARNING = 200,
+    LOG_INFO = 300,
+    LOG_DEBUG = 400,
+};
+
+typedef void (*log_handler_t)(int lvl, const char *msg, va_list args, void *p);
+
+// Without a handler, everything but LOG_DEBUG goes to stderr
+void base_set_log_handler(log_handler_t handler, void *param);
+void blog(int log_level, const char *format, ...);
+
+void *bmalloc(size_t size);
+void bfree(void *ptr);
+char *bstrdup_n(const char *str, size_t n);
+char *bstrdup(const char *str);
+
+uint64_t os_gettime_ns(void);
+
+// Returns: false if time_target had already passed
+bool os_sleepto_ns(uint64_t time_target);
+
+FILE *os_fopen(const char *path, const char *mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GARMIN_CORE_STANDALONE
+
+#endif // OBS_COMPAT_H
@@ -0,0 +1,363 @@
+#include "pipeline-stats.h"
+#include "../audio-capture/audio-source.h"
+
+#include "../compat/obs-compat.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Values below 2^SUB_BITS get a bucket each; above that, every power of two
+// is split into 2^SUB_BITS equal buckets. Anything from 2^MAX_EXPONENT ns
+// (~18 minutes) up lands in the last bucket.
+#define SUB_BITS 4
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define MAX_EXPONENT 40
+#define BUCKET_COUNT ((MAX_EXPONENT - SUB_BITS + 1) * SUB_BUCKETS)
+#define MAX_VALUE ((1ULL << MAX_EXPONENT) - 1)
+
+// Each per-run pipeline thread (capture, recognition) claims a shard the
+// first time it records and is its only writer, so a record is plain loads
+// and stores; readers sum the shards. Threads past SHARD_COUNT, and threads
+// that outlive a run, share one more shard through atomic adds.
+#define SHARD_COUNT 16
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+struct stage_histogram {
+    volatile uint64_t buckets[BUCKET_COUNT];
+    volatile uint64_t total_ns;
+    volatile uint64_t max_ns;
+};
+
+struct stats_shard {
+    struct stage_histogram stages[STAGE_COUNT];
+    volatile uint64_t counters[COUNTER_COUNT];
+};
+
+static struct {
+    struct stats_shard shards[SHARD_COUNT + 1];  // The last one is shared
+    volatile uint64_t claimed;
+    volatile uint64_t generation;                // Bumped by reset, which frees every shard
+    uint64_t reset_ns;
+} g_stats;
+
+static THREAD_LOCAL struct stats_shard *t_shard;
+static THREAD_LOCAL uint64_t t_generation;
+static THREAD_LOCAL bool t_shared;
+
+#define SHARED_SHARD (&g_stats.shards[SHARD_COUNT])
+
+static const char *STAGE_NAMES[STAGE_COUNT] = {
+    "capture wait", "convert", "resample", "echo cancel", "denoise", "auto gain",
+    "keyword spot", "vosk accept", "result json", "phrase match", "dispatch", "reconnect",
+};
+
+static int floor_log2(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+static int bucket_index(uint64_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+
+    int exponent = floor_log2(value);
+    int sub = (int)(value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+// Largest value that lands in the bucket
+static uint64_t bucket_upper(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+// For claiming shards and recording into the shared one
+// Returns: The value before the add
+static uint64_t atomic_add(volatile uint64_t *value, uint64_t n)
+{
+#ifdef _MSC_VER
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64 *)value, (__int64)n);
+#else
+    return __atomic_fetch_add(value, n, __ATOMIC_RELAXED);
+#endif
+}
+
+static void atomic_clear(volatile uint64_t *value)
+{
+#ifdef _MSC_VER
+    _InterlockedExchange64((volatile __int64 *)value, 0);
+#else
+    __atomic_store_n(value, 0, __ATOMIC_RELAXED);
+#endif
+}
+
+static void atomic_max(volatile uint64_t *value, uint64_t candidate)
+{
+#ifdef _MSC_VER
+    uint64_t current = *value;
+#else
+    uint64_t current = __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+    while (candidate > current) {
+#ifdef _MSC_VER
+        uint64_t seen = (uint64_t)_InterlockedCompareExchange64(
+            (volatile __int64 *)value, (__int64)candidate, (__int64)current);
+        if (seen == current) {
+            break;
+        }
+        current = seen;
+#else
+        if (__atomic_compare_exchange_n(value, &current, candidate, true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+            break;
+        }
+#endif
+    }
+}
+
+// The calling thread's shard, claimed on its first record since the last reset
+static struct stats_shard *thread_shard(void)
+{
+    if (t_shared) {
+        return SHARED_SHARD;
+    }
+
+    // Reset only runs while the threads owning shards are stopped
+    uint64_t generation = g_stats.generation;
+    if (t_shard && t_generation == generation) {
+        return t_shard;
+    }
+
+    uint64_t index = atomic_add(&g_stats.claimed, 1);
+    t_shard = index < SHARD_COUNT ? &g_stats.shards[index] : SHARED_SHARD;
+    t_generation = generation;
+    return t_shard;
+}
+
+void pipeline_stats_record(enum pipeline_stage stage, uint64_t ns)
+{
+    struct stats_shard *shard = thread_shard();
+    struct stage_histogram *histogram = &shard->stages[stage];
+    volatile uint64_t *bucket = &histogram->buckets[bucket_index(ns)];
+
+    if (shard == SHARED_SHARD) {
+        atomic_add(bucket, 1);
+        atomic_add(&histogram->total_ns, ns);
+        atomic_max(&histogram->max_ns, ns);
+        return;
+    }
+
+    *bucket = *bucket + 1;
+    histogram->total_ns = histogram->total_ns + ns;
+    if (ns > histogram->max_ns) {
+        histogram->max_ns = ns;
+    }
+}
+
+void pipeline_stats_add(enum pipeline_counter counter, uint64_t n)
+{
+    struct stats_shard *shard = thread_shard();
+    if (shard == SHARED_SHARD) {
+        atomic_add(&shard->counters[counter], n);
+    } else {
+        shard->counters[counter] = shard->counters[counter] + n;
+    }
+}
+
+void pipeline_stats_share_thread(void)
+{
+    t_shared = true;
+}
+
+void pipeline_stats_reset(void)
+{
+    // Owners of the per-thread shards are stopped, but the replay worker
+    // may be adding into the shared one right now
+    memset((void *)g_stats.shards, 0, sizeof(struct stats_shard) * SHARD_COUNT);
+    volatile uint64_t *shared = (volatile uint64_t *)SHARED_SHARD;
+    for (size_t i = 0; i < sizeof(struct stats_shard) / sizeof(uint64_t); i++) {
+        atomic_clear(&shared[i]);
+    }
+    g_stats.claimed = 0;
+    g_stats.generation++;
+    g_stats.reset_ns = os_gettime_ns();
+}
+
+static void summarize(enum pipeline_stage stage, struct stage_summary *summary)
+{
+    // Sum the shards first so the percentiles agree with the count (~5 KB
+    // of stack)
+    uint64_t buckets[BUCKET_COUNT] = {0};
+    uint64_t count = 0;
+    memset(summary, 0, sizeof(*summary));
+    for (int s = 0; s <= SHARD_COUNT; s++) {
+        const struct stage_histogram *histogram = &g_stats.shards[s].stages[stage];
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            uint64_t n = histogram->buckets[i];
+            buckets[i] += n;
+            count += n;
+        }
+        summary->total_ns += histogram->total_ns;
+        if (histogram->max_ns > summary->max_ns) {
+            summary->max_ns = histogram->max_ns;
+        }
+    }
+
+    summary->count = count;
+    if (!count) {
+        return;
+    }
+
+    uint64_t p50_rank = (count + 1) / 2;
+    uint64_t p99_rank = count - count / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        if (!buckets[i]) {
+            continue;
+        }
+        seen += buckets[i];
+        if (!summary->p50_ns && seen >= p50_rank) {
+            summary->p50_ns = bucket_upper(i);
+        }
+        if (seen >= p99_rank) {
+            summary->p99_ns = bucket_upper(i);
+            break;
+        }
+    }
+
+    // The bucket bound can overshoot what was actually recorded
+    if (summary->p50_ns > summary->max_ns) {
+        summary->p50_ns = summary->max_ns;
+    }
+    if (summary->p99_ns > summary->max_ns) {
+        summary->p99_ns = summary->max_ns;
+    }
+}
+
+void pipeline_stats_snapshot(struct pipeline_stats_snapshot *snapshot)
+{
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        summarize((enum pipeline_stage)i, &snapshot->stages[i]);
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        snapshot->counters[i] = 0;
+        for (int s = 0; s <= SHARD_COUNT; s++) {
+            snapshot->counters[i] += g_stats.shards[s].counters[i];
+        }
+    }
+    snapshot->elapsed_ns = g_stats.reset_ns ? os_gettime_ns() - g_stats.reset_ns : 0;
+}
+
+static const char *format_duration(uint64_t ns, char *buffer, size_t size)
+{
+    if (ns < 1000000) {
+        snprintf(buffer, size, "%.1f us", ns / 1000.0);
+    } else {
+        snprintf(buffer, size, "%.1f ms", ns / 1000000.0);
+    }
+    return buffer;
+}
+
+size_t pipeline_stats_format(const struct pipeline_stats_snapshot *snapshot, char *buffer,
+                             size_t size)
+{
+    if (!size) {
+        return 0;
+    }
+    buffer[0] = '\0';
+
+    size_t len = 0;
+    for (int i = 0; i < STAGE_COUNT && len < size; i++) {
+        const struct stage_summary *stage = &snapshot->stages[i];
+        if (!stage->count) {
+            continue;
+        }
+
+        char p50[32], p99[32], max[32];
+        int n = snprintf(buffer + len, size - len, "%-13s %8llu  p50 %9s  p99 %9s  max %9s\n",
+                         STAGE_NAMES[i], (unsigned long long)stage->count,
+                         format_duration(stage->p50_ns, p50, sizeof(p50)),
+                         format_duration(stage->p99_ns, p99, sizeof(p99)),
+                         format_duration(stage->max_ns, max, sizeof(max)));
+        if (n < 0) {
+            return len;
+        }
+        len += (size_t)n;
+    }
+    if (len >= size) {
+        return size - 1;
+    }
+
+    {
+        const uint64_t *c = snapshot->counters;
+        int n = snprintf(buffer + len, size - len,
+                         "packets %llu (%llu silent), discontinuities %llu, overflows %llu, "
+                         "decoded %.1f s of audio in %.1f s",
+                         (unsigned long long)c[COUNTER_PACKETS],
+                         (unsigned long long)c[COUNTER_SILENT_PACKETS],
+                         (unsigned long long)c[COUNTER_DISCONTINUITIES],
+                         (unsigned long long)c[COUNTER_OVERFLOWS],
+                         (double)c[COUNTER_DECODED_SAMPLES] / AUDIO_SOURCE_SAMPLE_RATE,
+                         snapshot->elapsed_ns / 1000000000.0);
+        if (n > 0) {
+            len += (size_t)n;
+        }
+    }
+
+    return len < size ? len : size - 1;
+}
+
+void pipeline_stats_log(void)
+{
+    struct pipeline_stats_snapshot snapshot;
+    pipeline_stats_snapshot(&snapshot);
+
+    char text[1024];
+    pipeline_stats_format(&snapshot, text, sizeof(text));
+
+    // blog() takes one line at a time
+    char *line = text;
+    while (line && *line) {
+        char *next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        blog(LOG_INFO, "[Garmin Replay] Stats: %s", line);
+        line = next;
+    }
+}
+
+const char *pipeline_stage_name(enum pipeline_stage stage)
+{
+    if ((unsigned int)stage >= STAGE_COUNT) {
+        return "unknown";
+    }
+    return STAGE_NAMES[stage];
+}
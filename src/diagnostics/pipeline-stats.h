@@ -0,0 +1,89 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Where time goes between the microphone and the replay buffer. Each stage
+// keeps a log-linear latency histogram (buckets ~6% wide, like HdrHistogram
+// with one significant digit and a bit), and a few counters track the
+// capture stream. Every listener has its own recognition and capture
+// threads feeding the same stages, so each thread records into its own
+// shard with plain stores; readers sum the shards in unlocked snapshots
+// that can be an event or so behind.
+
+enum pipeline_stage {
+    STAGE_CAPTURE_WAIT,   // Recognition thread blocked waiting for audio
+    STAGE_CONVERT,        // Sample format conversion and downmix, per packet (capture thread)
+    STAGE_RESAMPLE,       // Resampling to 16 kHz, per packet (capture thread)
+    STAGE_ECHO_CANCEL,    // Echo cancellation of one chunk of mic audio
+    STAGE_NOISE_SUPPRESS, // Noise suppression of one chunk of mic audio
+    STAGE_AUTO_GAIN,      // Automatic gain control of one chunk of mic audio
+    STAGE_KEYWORD_SPOT,   // Keyword prefilter over one chunk the VAD passed
+    STAGE_VOSK_ACCEPT,    // Feeding one chunk to the recognizer
+    STAGE_RESULT_JSON,    // Parsing a result and normalizing its text
+    STAGE_PHRASE_MATCH,   // Matching that text against the commands
+    STAGE_DISPATCH,       // Command detected to the replay action issued (worker thread)
+    STAGE_RECONNECT,      // Capture device fault to capturing again (capture thread)
+    STAGE_COUNT,
+};
+
+enum pipeline_counter {
+    COUNTER_PACKETS,          // Packets/chunks read from the backend
+    COUNTER_SILENT_PACKETS,   // Packets the device flagged as silence
+    COUNTER_DISCONTINUITIES,  // Gaps reported by the device
+    COUNTER_OVERFLOWS,        // 10 ms frames dropped because recognition fell behind
+    COUNTER_DECODED_SAMPLES,  // Samples fed to the recognizer
+    COUNTER_COUNT,
+};
+
+struct stage_summary {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t p50_ns;  // Percentiles are bucket upper bounds
+    uint64_t p99_ns;
+    uint64_t max_ns;
+};
+
+struct pipeline_stats_snapshot {
+    struct stage_summary stages[STAGE_COUNT];
+    uint64_t counters[COUNTER_COUNT];
+    uint64_t elapsed_ns;  // Since the last reset
+};
+
+// Any pipeline thread
+void pipeline_stats_record(enum pipeline_stage stage, uint64_t ns);
+
+// Any pipeline thread
+void pipeline_stats_add(enum pipeline_counter counter, uint64_t n);
+
+// Record from this thread into the shared shard with atomic adds. For
+// threads that keep recording across a reset (the replay worker).
+void pipeline_stats_share_thread(void);
+
+// Start over; call while the per-run pipeline threads are stopped. Threads
+// that outlive a run must have called pipeline_stats_share_thread.
+void pipeline_stats_reset(void);
+
+// Any thread
+void pipeline_stats_snapshot(struct pipeline_stats_snapshot *snapshot);
+
+// One line per stage that saw events, then the counters
+// Returns: Length written (truncated to size - 1)
+size_t pipeline_stats_format(const struct pipeline_stats_snapshot *snapshot, char *buffer,
+                             size_t size);
+
+// Write the current snapshot to the OBS log
+void pipeline_stats_log(void);
+
+const char *pipeline_stage_name(enum pipeline_stage stage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPELINE_STATS_H
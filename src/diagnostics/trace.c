@@ -0,0 +1,161 @@
+#include "trace.h"
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Events kept in memory (~1.5 MB); at a few hundred events per second of
+// audio that is the last couple of minutes
+#define TRACE_CAPACITY 32768
+
+struct trace_event {
+    // Index + 1 once the event is complete, 0 while it is being written
+    volatile long seq;
+    long epoch;          // The trace_set_enabled call it was recorded under
+    char phase;          // 'X' span, 'i' instant
+    uint8_t thread;
+    const char *name;
+    const char *arg_name;
+    uint64_t ts_ns;
+    uint64_t dur_ns;
+    double arg;
+};
+
+static struct trace_event g_events[TRACE_CAPACITY];
+static volatile long g_next_event;
+static volatile long g_epoch;
+static volatile bool g_enabled;
+static uint64_t g_start_ns;
+
+static const char *THREAD_NAMES[TRACE_THREAD_COUNT] = {
+    "capture", "recognition", "replay worker",
+};
+
+void trace_set_enabled(bool enabled)
+{
+    os_atomic_set_bool(&g_enabled, false);
+    if (!enabled) {
+        return;
+    }
+
+    // A writer that saw the old g_enabled may still be filling a slot, so
+    // the ring isn't cleared; events from earlier epochs are skipped instead
+    os_atomic_inc_long(&g_epoch);
+    g_start_ns = os_gettime_ns();
+    os_atomic_set_bool(&g_enabled, true);
+}
+
+bool trace_is_enabled(void)
+{
+    return os_atomic_load_bool(&g_enabled);
+}
+
+// Any thread: each event claims its own slot
+static void record(char phase, enum trace_thread thread, const char *name, uint64_t ts_ns,
+                   uint64_t dur_ns, const char *arg_name, double arg)
+{
+    // Epoch first: an event that raced a restart is tagged with the old one
+    long epoch = os_atomic_load_long(&g_epoch);
+    if (!os_atomic_load_bool(&g_enabled)) {
+        return;
+    }
+
+    long index = os_atomic_inc_long(&g_next_event) - 1;
+    struct trace_event *event = &g_events[(unsigned long)index % TRACE_CAPACITY];
+
+    os_atomic_set_long(&event->seq, 0);
+    event->epoch = epoch;
+    event->phase = phase;
+    event->thread = (uint8_t)thread;
+    event->name = name;
+    event->arg_name = arg_name;
+    event->ts_ns = ts_ns;
+    event->dur_ns = dur_ns;
+    event->arg = arg;
+    os_atomic_set_long(&event->seq, index + 1);
+}
+
+void trace_span(enum trace_thread thread, const char *name, uint64_t start_ns, uint64_t end_ns,
+                const char *arg_name, double arg)
+{
+    record('X', thread, name, start_ns, end_ns > start_ns ? end_ns - start_ns : 0, arg_name, arg);
+}
+
+void trace_instant(enum trace_thread thread, const char *name, uint64_t ts_ns,
+                   const char *arg_name, double arg)
+{
+    record('i', thread, name, ts_ns, 0, arg_name, arg);
+}
+
+// Microseconds since tracing started; device timestamps can be earlier
+static double trace_us(uint64_t ns)
+{
+    return (double)(int64_t)(ns - g_start_ns) / 1000.0;
+}
+
+static void write_event(FILE *file, const struct trace_event *event)
+{
+    fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"garmin\",\"ph\":\"%c\",\"ts\":%.3f,",
+            event->name, event->phase, trace_us(event->ts_ns));
+    if (event->phase == 'X') {
+        fprintf(file, "\"dur\":%.3f,", event->dur_ns / 1000.0);
+    } else {
+        fprintf(file, "\"s\":\"t\",");
+    }
+    fprintf(file, "\"pid\":1,\"tid\":%d", event->thread + 1);
+    if (event->arg_name) {
+        fprintf(file, ",\"args\":{\"%s\":%.17g}", event->arg_name, event->arg);
+    }
+    fputc('}', file);
+}
+
+bool trace_write(const char *path, uint64_t since_ns)
+{
+    FILE *file = os_fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                  "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"obs-garmin-replay\"}}");
+    for (int i = 0; i < TRACE_THREAD_COUNT; i++) {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"%s\"}}", i + 1, THREAD_NAMES[i]);
+    }
+
+    // Writers keep going meanwhile; a slot overwritten during the copy
+    // fails the sequence check and is left out
+    long epoch = os_atomic_load_long(&g_epoch);
+    long end = os_atomic_load_long(&g_next_event);
+    long begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    int written = 0;
+    for (long index = begin; index < end; index++) {
+        struct trace_event *slot = &g_events[(unsigned long)index % TRACE_CAPACITY];
+        if (os_atomic_load_long(&slot->seq) != index + 1) {
+            continue;
+        }
+        struct trace_event event = *slot;
+        if (os_atomic_load_long(&slot->seq) != index + 1) {
+            continue;
+        }
+        if (event.epoch != epoch || event.ts_ns + event.dur_ns < since_ns) {
+            continue;
+        }
+
+        write_event(file, &event);
+        written++;
+    }
+
+    fprintf(file, "\n]}\n");
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+
+    blog(ok ? LOG_INFO : LOG_WARNING, "[Garmin Replay] %s %d trace events to %s",
+         ok ? "Wrote" : "Failed writing", written, path);
+    return ok;
+}
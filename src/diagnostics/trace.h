@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-utterance pipeline timelines for chrome://tracing and Perfetto. Spans
+// and instants go into a fixed-size in-memory ring (the newest events
+// win) and are written out as trace-event JSON on request.
+//
+// Only built with GARMIN_ENABLE_TRACE; otherwise the TRACE_* macros expand
+// to nothing and their arguments are not evaluated. When built in, tracing
+// still has to be switched on at run time.
+
+// Threads as they appear in the trace
+enum trace_thread {
+    TRACE_THREAD_CAPTURE,
+    TRACE_THREAD_RECOGNITION,
+    TRACE_THREAD_REPLAY,
+    TRACE_THREAD_COUNT,
+};
+
+#ifdef GARMIN_ENABLE_TRACE
+
+// Start recording (dropping whatever is in the ring) or stop
+void trace_set_enabled(bool enabled);
+bool trace_is_enabled(void);
+
+// name and arg_name must be string literals or otherwise outlive the trace;
+// arg_name may be NULL
+void trace_span(enum trace_thread thread, const char *name, uint64_t start_ns, uint64_t end_ns,
+                const char *arg_name, double arg);
+void trace_instant(enum trace_thread thread, const char *name, uint64_t ts_ns,
+                   const char *arg_name, double arg);
+
+// Write events recorded at or after since_ns (0 = everything in the ring)
+// Returns: false if the file couldn't be written
+bool trace_write(const char *path, uint64_t since_ns);
+
+#define TRACE_SPAN(thread, name, start_ns, end_ns, arg_name, arg) \
+    trace_span(thread, name, start_ns, end_ns, arg_name, arg)
+#define TRACE_INSTANT(thread, name, ts_ns, arg_name, arg) \
+    trace_instant(thread, name, ts_ns, arg_name, arg)
+
+#else
+
+#define TRACE_SPAN(thread, name, start_ns, end_ns, arg_name, arg) ((void)0)
+#define TRACE_INSTANT(thread, name, ts_ns, arg_name, arg) ((void)0)
+
+#endif // GARMIN_ENABLE_TRACE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
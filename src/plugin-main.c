@@ -1,9 +1,21 @@
 #include "plugin-main.h"
 #include "voice-recognition/vosk-engine.h"
+#include "voice-recognition/command-table.h"
 #include "voice-recognition/phrase-detector.h"
-#include "audio-capture/wasapi-capture.h"
+#include "voice-recognition/vad.h"
+#include "voice-recognition/keyword-spotter.h"
+#include "voice-recognition/model-cache.h"
+#include "voice-recognition/engine-loader.h"
+#include "audio-capture/audio-source.h"
 #include "audio-capture/device-enum.h"
+#include "audio-capture/echo-canceller.h"
+#include "audio-capture/noise-suppressor.h"
+#include "audio-capture/auto-gain.h"
+#include "diagnostics/pipeline-stats.h"
+#include "diagnostics/trace.h"
 #include "replay-control/replay-buffer.h"
+#include "replay-control/replay-worker.h"
+#include "replay-control/trigger-arbiter.h"
 #include "settings/plugin-settings.h"
 #include "settings/properties-ui.h"
 #include "settings/settings-dialog.hpp"
@@ -13,6 +25,14 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-garmin-replay", "en-US")
 
@@ -22,124 +42,1459 @@ struct garmin_plugin_data g_plugin_data = {0};
 // Audio buffer size for processing
 #define AUDIO_BUFFER_SIZE 4096
 
-// Recognition thread function
-static DWORD WINAPI recognition_thread_func(LPVOID data)
+// Longest stretch of audio kept while the model loads (30 s, ~1 MB)
+#define BACKLOG_MAX_SAMPLES (AUDIO_SOURCE_SAMPLE_RATE * 30)
+
+#define NS_PER_SAMPLE (1000000000ULL / AUDIO_SOURCE_SAMPLE_RATE)
+
+// A trace written after a save covers the utterance that asked for it
+#define TRACE_TRIGGER_WINDOW_NS (30ULL * 1000000000ULL)
+
+// Keyword prefilter: live audio decoded after a wake before giving up on
+// it, and how often (in VAD utterances) one is decoded in full anyway, to
+// learn commands the spotter doesn't know yet and to count what it misses
+#define PREFILTER_WAKE_SAMPLES (AUDIO_SOURCE_SAMPLE_RATE * 3 / 2)
+#define PREFILTER_AUDIT_EVERY 10
+
+// Arbiter counters and clock when the current run began
+static struct trigger_arbiter_stats g_run_arbiter_start;
+static uint64_t g_run_start_ns;
+
+// Decoder time spent vs. audio the VAD kept away from it
+struct decode_accounting {
+    uint64_t decode_ns;
+    uint64_t samples_decoded;
+    uint64_t samples_captured;
+};
+
+// What recognized a command
+enum trigger_source {
+    TRIGGER_ENDPOINT,   // Final result, after trailing silence
+    TRIGGER_EARLY,      // Stable partial hypothesis
+    TRIGGER_SOURCE_COUNT,
+};
+
+static const char *TRIGGER_SOURCE_NAMES[TRIGGER_SOURCE_COUNT] = {"endpoint", "early"};
+
+// What the keyword prefilter lets through to the decoder
+enum prefilter_state {
+    PREFILTER_LEARNING,   // Too few commands learned yet: everything
+    PREFILTER_ASLEEP,     // Nothing until the spotter fires
+    PREFILTER_AWAKE,      // The spotter's lookback, then live audio until a command or the budget ends
+    PREFILTER_AUDIT,      // The rest of this VAD utterance
+};
+
+struct prefilter_counts {
+    uint64_t wakes;
+    uint64_t audits;
+    uint64_t audited_commands;   // Commands found in audited utterances
+    uint64_t missed;             // Of which the spotter didn't fire for
+    uint64_t samples_in;         // Audio the prefilter saw (what the VAD passed)
+};
+
+// End of speech to save issued, per trigger source
+struct trigger_latency {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+// Per-run state of one listener's recognition loop
+struct recognition_context {
+    struct garmin_listener *listener;
+    char log_prefix[GARMIN_LISTENER_NAME_LEN + 2];  // "name: " with several listeners
+    uint64_t cpu_start_ns;
+
+    // Echo cancellation: what the speakers play, and the mic with it removed
+    audio_source_t *echo_reference;
+    echo_canceller_t *echo;
+    short *echo_buffer;
+
+    // Microphone cleanup after the echo is gone: noise suppression (into
+    // denoise_buffer) and automatic gain (in place)
+    noise_suppressor_t *denoise;
+    short *denoise_buffer;
+    auto_gain_t *agc;
+
+    vad_t *vad;
+    short *gated_buffer;
+
+    // Keyword prefilter between the VAD and the decoder; learns the
+    // commands the decoder confirms
+    keyword_spotter_t *kws;
+    short *kws_buffer;          // Lookback handed to the decoder on a wake
+    enum prefilter_state kws_state;
+    int kws_budget;             // Live samples left to decode after a wake
+    bool kws_in_utterance;      // The VAD gate is open
+    bool kws_spotted;           // The spotter fired during this utterance
+    int kws_utterances;
+    struct prefilter_counts kws_counts;
+
+    struct decode_accounting acct;
+    uint64_t start_ns;
+    uint64_t next_stats_log_ns;  // 0 = periodic stats logging off
+
+    // Capture time and stream position of the chunk being decoded
+    // (timestamp 0 while catching up on buffered audio)
+    bool realtime_input;    // Capture timestamps track the wall clock
+    uint64_t chunk_timestamp_ns;
+    uint64_t chunk_first_sample;
+    struct trigger_latency latency[TRIGGER_SOURCE_COUNT];
+
+    // Early trigger: the last partial hypothesis and how long it has held
+    char partial[512];
+    int partial_stable_samples;
+    bool partial_checked;
+    bool early_fired;   // This utterance already saved, skip its final result
+
+    // Tracing: when the current utterance first reached the decoder
+    uint64_t utterance_start_ns;
+    int utterances;
+
+    // The capture device is gone and the source is reopening it
+    bool capture_recovering;
+};
+
+// Time from the end of speech (per the VAD) to now; 0 if the command fired
+// while the speaker was still talking
+// Returns: false if unknown, i.e. without the VAD, while catching up on
+//          buffered audio, or when file input runs faster than real time
+static bool command_latency_ns(const struct recognition_context *ctx, uint64_t *latency_ns)
 {
-    (void)data;
-    short audio_buffer[AUDIO_BUFFER_SIZE];
+    if (!ctx->vad || !ctx->realtime_input || !ctx->chunk_timestamp_ns) {
+        return false;
+    }
+
+    int64_t offset = (int64_t)vad_speech_end(ctx->vad) - (int64_t)ctx->chunk_first_sample;
+    int64_t speech_end_ns = (int64_t)ctx->chunk_timestamp_ns +
+                            offset * 1000000000LL / AUDIO_SOURCE_SAMPLE_RATE;
+    int64_t elapsed_ns = (int64_t)os_gettime_ns() - speech_end_ns;
+    *latency_ns = elapsed_ns > 0 ? (uint64_t)elapsed_ns : 0;
+    return true;
+}
 
-    blog(LOG_INFO, "[Garmin Replay] Recognition thread started");
+static void set_status(const char *text)
+{
+    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text), "%s", text);
+}
 
-    // Initialize COM for this thread
-    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
-    if (FAILED(hr)) {
-        blog(LOG_ERROR, "[Garmin Replay] Failed to initialize COM: 0x%08lX", hr);
-        return 1;
+// Trouble with one listener, named when there are several
+static void set_listener_status(const struct recognition_context *ctx, const char *text)
+{
+    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text), "%s%s",
+             ctx->log_prefix, text);
+}
+
+// CPU time of the calling thread
+static uint64_t thread_cpu_ns(void)
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
     }
+    ULARGE_INTEGER k = {.LowPart = kernel.dwLowDateTime, .HighPart = kernel.dwHighDateTime};
+    ULARGE_INTEGER u = {.LowPart = user.dwLowDateTime, .HighPart = user.dwHighDateTime};
+    return (k.QuadPart + u.QuadPart) * 100;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
 
-    // Initialize WASAPI capture
-    g_plugin_data.capture = wasapi_capture_create(g_plugin_data.device_id);
-    if (!g_plugin_data.capture) {
-        blog(LOG_ERROR, "[Garmin Replay] Failed to create audio capture");
-        CoUninitialize();
-        return 1;
+#ifdef GARMIN_ENABLE_TRACE
+bool garmin_save_trace(uint64_t window_ns, char *path, size_t path_size)
+{
+    char *dir = obs_module_config_path("traces");
+    if (!dir) {
+        return false;
     }
+    os_mkdirs(dir);
 
-    // Initialize Vosk engine
-    char model_path[512];
-    get_vosk_model_path(model_path, sizeof(model_path));
-    g_plugin_data.vosk = vosk_engine_create(model_path);
-    if (!g_plugin_data.vosk) {
-        blog(LOG_ERROR, "[Garmin Replay] Failed to create Vosk engine");
-        wasapi_capture_destroy(g_plugin_data.capture);
-        g_plugin_data.capture = NULL;
-        CoUninitialize();
-        return 1;
+    char name[64];
+    time_t now = time(NULL);
+    strftime(name, sizeof(name), "garmin-trace-%Y%m%d-%H%M%S.json", localtime(&now));
+    snprintf(path, path_size, "%s/%s", dir, name);
+    bfree(dir);
+
+    uint64_t now_ns = os_gettime_ns();
+    return trace_write(path, window_ns && now_ns > window_ns ? now_ns - window_ns : 0);
+}
+#endif
+
+// Replay worker thread: a request finished
+static void on_replay_done(enum replay_request request, enum replay_result result, void *param)
+{
+    (void)param;
+
+    // May hand the queued save to the worker
+    trigger_arbiter_request_done(g_plugin_data.trigger_arbiter, request, result);
+
+#ifdef GARMIN_ENABLE_TRACE
+    if (trace_is_enabled() && result == REPLAY_RESULT_DONE &&
+        (request == REPLAY_REQUEST_SAVE || request == REPLAY_REQUEST_SAVE_AND_RESTART)) {
+        char path[512];
+        garmin_save_trace(TRACE_TRIGGER_WINDOW_NS, path, sizeof(path));
+    }
+#endif
+
+    if (result == REPLAY_RESULT_TIMED_OUT) {
+        set_status("OBS didn't confirm, check the replay buffer");
+        return;
+    }
+
+    switch (request) {
+    case REPLAY_REQUEST_SAVE:
+    case REPLAY_REQUEST_SAVE_AND_RESTART:
+        if (result == REPLAY_RESULT_STARTED_INSTEAD) {
+            blog(LOG_INFO, "[Garmin Replay] Replay buffer started. Say the command again to save.");
+            set_status("Buffer started! Say again to save.");
+        } else if (result == REPLAY_RESULT_DONE) {
+            set_status("Saved! Listening...");
+        }
+        break;
+    case REPLAY_REQUEST_START:
+        if (result == REPLAY_RESULT_DONE) {
+            set_status("Buffer started! Listening...");
+        }
+        break;
+    case REPLAY_REQUEST_STOP:
+        if (result == REPLAY_RESULT_DONE) {
+            set_status("Buffer stopped. Listening...");
+        }
+        break;
+    case REPLAY_REQUEST_SCREENSHOT:
+        set_status("Screenshot taken! Listening...");
+        break;
     }
+}
 
-    // Start audio capture
-    if (!wasapi_capture_start(g_plugin_data.capture)) {
-        blog(LOG_ERROR, "[Garmin Replay] Failed to start audio capture");
-        vosk_engine_destroy(g_plugin_data.vosk);
-        wasapi_capture_destroy(g_plugin_data.capture);
-        g_plugin_data.vosk = NULL;
-        g_plugin_data.capture = NULL;
-        CoUninitialize();
-        return 1;
+// Hand the action to the replay worker through the arbiter; the recognition
+// thread never waits for OBS
+static void execute_action(enum garmin_action action)
+{
+    enum replay_request request;
+    switch (action) {
+    case GARMIN_ACTION_SAVE:
+        request = g_plugin_data.restart_mode == 1 ? REPLAY_REQUEST_SAVE_AND_RESTART : REPLAY_REQUEST_SAVE;
+        break;
+    case GARMIN_ACTION_SAVE_AND_RESTART:
+        request = REPLAY_REQUEST_SAVE_AND_RESTART;
+        break;
+    case GARMIN_ACTION_START_BUFFER:
+        request = REPLAY_REQUEST_START;
+        break;
+    case GARMIN_ACTION_STOP_BUFFER:
+        request = REPLAY_REQUEST_STOP;
+        break;
+    case GARMIN_ACTION_SCREENSHOT:
+        request = REPLAY_REQUEST_SCREENSHOT;
+        break;
+    default:
+        return;
     }
 
-    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
-             "Listening...");
+    // The worker only finishes a save once OBS reports it, well after this
+    // status is set
+    bool save = request == REPLAY_REQUEST_SAVE || request == REPLAY_REQUEST_SAVE_AND_RESTART;
+    enum arbiter_decision decision = trigger_arbiter_submit(
+        g_plugin_data.trigger_arbiter, request, (uint32_t)g_plugin_data.trigger_cooldown_ms);
+    TRACE_INSTANT(TRACE_THREAD_RECOGNITION, replay_request_name(request), os_gettime_ns(),
+                  "decision", decision);
 
-    // Main recognition loop
-    while (g_plugin_data.thread_running) {
-        // Read audio from microphone
-        int samples = wasapi_capture_read(g_plugin_data.capture,
-                                          audio_buffer, AUDIO_BUFFER_SIZE);
+    switch (decision) {
+    case ARBITER_RUN:
+        if (save) {
+            set_status("Command detected! Saving...");
+        }
+        break;
+    case ARBITER_QUEUED:
+        set_status("Command detected! Saving after the current save...");
+        break;
+    case ARBITER_COALESCED:
+        break;
+    case ARBITER_SUPPRESSED:
+        set_status("Still busy, command dropped. Listening...");
+        break;
+    }
+}
+
+// Act on a detected command
+static void run_command(struct recognition_context *ctx, int command_index, float confidence,
+                        enum trigger_source source)
+{
+    const struct garmin_command *command = command_table_get(g_plugin_data.commands, command_index);
+    if (!command) {
+        return;
+    }
+
+    struct garmin_listener_stats *stats = &ctx->listener->stats;
+    stats->commands++;
+
+    uint64_t latency_ns;
+    if (command_latency_ns(ctx, &latency_ns)) {
+        struct trigger_latency *latency = &ctx->latency[source];
+        latency->count++;
+        latency->total_ns += latency_ns;
+        if (latency_ns > latency->max_ns) {
+            latency->max_ns = latency_ns;
+        }
+        stats->latency_count++;
+        stats->latency_total_ns += latency_ns;
+        if (latency_ns > stats->latency_max_ns) {
+            stats->latency_max_ns = latency_ns;
+        }
+        blog(LOG_INFO, "[Garmin Replay] %sVoice command '%s' (%s) detected! Confidence: %.2f (%s, %.0f ms after speech ended)",
+             ctx->log_prefix, command->phrase, garmin_action_name(command->action), confidence,
+             TRIGGER_SOURCE_NAMES[source], latency_ns / 1000000.0);
+    } else {
+        blog(LOG_INFO, "[Garmin Replay] %sVoice command '%s' (%s) detected! Confidence: %.2f (%s)",
+             ctx->log_prefix, command->phrase, garmin_action_name(command->action), confidence,
+             TRIGGER_SOURCE_NAMES[source]);
+    }
+
+    execute_action(command->action);
+}
+
+static void reset_partial(struct recognition_context *ctx)
+{
+    ctx->partial[0] = '\0';
+    ctx->partial_stable_samples = 0;
+    ctx->partial_checked = false;
+    ctx->early_fired = false;
+}
+
+// The decoder confirmed a command: keep it as a template, and in an
+// audited utterance count whether the spotter would have woken it
+static void learn_keyword(struct recognition_context *ctx, int command_index)
+{
+    const struct garmin_command *command = command_table_get(g_plugin_data.commands, command_index);
+    if (!command) {
+        return;
+    }
+
+    if (ctx->kws_state == PREFILTER_AUDIT) {
+        ctx->kws_counts.audited_commands++;
+        if (!ctx->kws_spotted) {
+            ctx->kws_counts.missed++;
+            blog(LOG_INFO, "[Garmin Replay] %sKeyword prefilter missed '%s', learning it",
+                 ctx->log_prefix, command->phrase);
+        }
+    }
+
+    keyword_spotter_learn(ctx->kws, command->phrase);
+}
+
+// Check a final Vosk result for the trigger phrase and act on it
+// Returns: true if a command was detected
+static bool handle_final_result(struct recognition_context *ctx, const char *json)
+{
+    // Every final result ends the utterance
+    bool early_fired = ctx->early_fired;
+    reset_partial(ctx);
+
+    // Check for a command phrase
+    int command;
+    float confidence = phrase_detector_check(json, g_plugin_data.sensitivity,
+                                             g_plugin_data.commands, &command);
+
+    TRACE_INSTANT(TRACE_THREAD_RECOGNITION, "phrase decision", os_gettime_ns(),
+                  "confidence", confidence);
+    if (ctx->utterance_start_ns) {
+        TRACE_SPAN(TRACE_THREAD_RECOGNITION, "utterance", ctx->utterance_start_ns, os_gettime_ns(),
+                   "utterance", ctx->utterances);
+        ctx->utterance_start_ns = 0;
+        ctx->utterances++;
+    }
+
+    if (confidence <= 0.5f) {
+        return false;
+    }
+
+    if (ctx->kws) {
+        learn_keyword(ctx, command);
+    }
+
+    if (early_fired) {
+        // Same words the partial already acted on
+        blog(LOG_INFO, "[Garmin Replay] Command already handled by early trigger, ignoring final result");
+        return true;
+    }
+
+    run_command(ctx, command, confidence, TRIGGER_ENDPOINT);
+    return true;
+}
+
+// Early trigger: act once the partial hypothesis contains the phrase and has
+// stopped changing for early_stable_frames
+static void check_partial_result(struct recognition_context *ctx, int samples_decoded)
+{
+    if (ctx->early_fired) {
+        return;
+    }
+
+    const char *json = vosk_engine_get_partial_result(ctx->listener->vosk);
+    if (!json) {
+        return;
+    }
+
+    if (strcmp(json, ctx->partial) != 0) {
+        // Hypothesis changed; anything this long isn't just a command
+        size_t len = strlen(json);
+        if (len >= sizeof(ctx->partial)) {
+            len = 0;
+        }
+        memcpy(ctx->partial, json, len);
+        ctx->partial[len] = '\0';
+        ctx->partial_stable_samples = 0;
+        ctx->partial_checked = false;
+        return;
+    }
+
+    ctx->partial_stable_samples += samples_decoded;
+    if (ctx->partial_checked ||
+        ctx->partial_stable_samples < g_plugin_data.early_stable_frames * (AUDIO_SOURCE_SAMPLE_RATE / 100)) {
+        return;
+    }
+
+    // Matched or not, this hypothesis is only checked once
+    ctx->partial_checked = true;
+
+    int command;
+    float confidence = phrase_detector_check_partial(json, g_plugin_data.sensitivity,
+                                                     g_plugin_data.commands, &command);
+    TRACE_INSTANT(TRACE_THREAD_RECOGNITION, "partial decision", os_gettime_ns(),
+                  "confidence", confidence);
+    if (confidence > 0.5f) {
+        ctx->early_fired = true;
+        run_command(ctx, command, confidence, TRIGGER_EARLY);
+    }
+}
+
+// What the arbiter made of this run's commands, from every listener
+static void log_trigger_stats(const struct trigger_arbiter_stats *start)
+{
+    struct trigger_arbiter_stats now;
+    trigger_arbiter_get_stats(g_plugin_data.trigger_arbiter, &now);
+    if (now.triggers == start->triggers) {
+        return;
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] Commands: %llu detected, %llu run, %llu queued behind a save, "
+         "%llu coalesced, %llu suppressed",
+         (unsigned long long)(now.triggers - start->triggers),
+         (unsigned long long)(now.run - start->run),
+         (unsigned long long)(now.queued - start->queued),
+         (unsigned long long)(now.coalesced - start->coalesced),
+         (unsigned long long)(now.suppressed - start->suppressed));
+}
 
-        if (samples <= 0) {
+static void log_trigger_latency(const struct recognition_context *ctx)
+{
+    for (int i = 0; i < TRIGGER_SOURCE_COUNT; i++) {
+        const struct trigger_latency *latency = &ctx->latency[i];
+        if (!latency->count) {
             continue;
         }
+        blog(LOG_INFO, "[Garmin Replay] %sSpeech end to save (%s trigger): %llu commands, "
+             "mean %.0f ms, max %.0f ms",
+             ctx->log_prefix, TRIGGER_SOURCE_NAMES[i], (unsigned long long)latency->count,
+             latency->total_ns / (double)latency->count / 1000000.0,
+             latency->max_ns / 1000000.0);
+    }
+}
+
+// Decoder cost scales with the grammar, so report it next to the grammar size
+static void log_decode_cost(const struct recognition_context *ctx)
+{
+    const struct decode_accounting *acct = &ctx->acct;
+    if (!acct->samples_decoded) {
+        return;
+    }
+
+    double audio_sec = (double)acct->samples_decoded / AUDIO_SOURCE_SAMPLE_RATE;
+    blog(LOG_INFO, "[Garmin Replay] %sDecoder: %.1f ms per second of audio over %.1f s decoded "
+         "(grammar of %d phrases)",
+         ctx->log_prefix, (double)acct->decode_ns / 1000000.0 / audio_sec, audio_sec,
+         command_table_grammar_size(g_plugin_data.commands));
+}
+
+static void log_vad_stats(const struct recognition_context *ctx, uint64_t wall_ns)
+{
+    const struct decode_accounting *acct = &ctx->acct;
+    struct vad_stats stats;
+    vad_get_stats(ctx->vad, &stats);
+    if (stats.frames_total == 0) {
+        return;
+    }
+
+    double gated = 100.0 * (double)(stats.frames_total - stats.frames_passed) /
+                   (double)stats.frames_total;
+
+    // Project the measured decode cost onto the audio that was skipped
+    double ns_per_sample = acct->samples_decoded ?
+        (double)acct->decode_ns / (double)acct->samples_decoded : 0.0;
+    uint64_t samples_skipped = acct->samples_captured > acct->samples_decoded ?
+        acct->samples_captured - acct->samples_decoded : 0;
+    double saved_sec = ns_per_sample * (double)samples_skipped / 1000000000.0;
+
+    blog(LOG_INFO, "[Garmin Replay] %sVAD gated %.1f%% of audio over %llu utterances "
+         "(noise floor %.1f dB); decoder CPU saved ~%.1f s (%.1f%% of a core)",
+         ctx->log_prefix, gated, (unsigned long long)stats.utterances, stats.noise_floor_db, saved_sec,
+         wall_ns ? 100.0 * saved_sec * 1000000000.0 / (double)wall_ns : 0.0);
+}
+
+// Build a listener's audio source config from the current settings
+static void get_audio_source_config(const struct garmin_listener *listener,
+                                    struct audio_source_config *config)
+{
+    memset(config, 0, sizeof(*config));
+
+    if (listener->main && g_plugin_data.capture_file && *g_plugin_data.capture_file) {
+        config->type = AUDIO_SOURCE_FILE;
+        config->path = g_plugin_data.capture_file;
+        config->realtime = g_plugin_data.capture_file_realtime;
+    } else if (listener->device_id &&
+               strncmp(listener->device_id, DEVICE_ID_OBS_PREFIX,
+                       strlen(DEVICE_ID_OBS_PREFIX)) == 0) {
+        config->type = AUDIO_SOURCE_OBS;
+        config->source_name = listener->device_id + strlen(DEVICE_ID_OBS_PREFIX);
+    } else {
+#ifdef _WIN32
+        config->type = AUDIO_SOURCE_WASAPI;
+        config->device_id = listener->device_id;
+#else
+        // No direct capture here; listen to OBS's Mic/Aux source
+        config->type = AUDIO_SOURCE_OBS;
+#endif
+    }
+
+    config->fault_interval_ms = g_plugin_data.capture_fault_interval_ms;
+    config->fault_reopen_failures = g_plugin_data.capture_fault_reopen_failures;
+}
+
+static void stop_echo_cancel(struct recognition_context *ctx)
+{
+    audio_source_destroy(ctx->echo_reference);
+    echo_canceller_destroy(ctx->echo);
+    free(ctx->echo_buffer);
+    ctx->echo_reference = NULL;
+    ctx->echo = NULL;
+    ctx->echo_buffer = NULL;
+}
+
+// Tap what the speakers play (OBS's Desktop Audio unless another source is
+// named) as the echo reference for this listener's microphone. Without it
+// the microphone is recognized as is.
+static void start_echo_cancel(struct recognition_context *ctx)
+{
+    struct audio_source_config reference_config = {0};
+    reference_config.type = AUDIO_SOURCE_OBS;
+    reference_config.source_name = g_plugin_data.echo_reference;
+    reference_config.obs_channel = AUDIO_SOURCE_OBS_DESKTOP_AUDIO;
+
+    struct echo_canceller_config config;
+    echo_canceller_config_default(&config);
+
+    ctx->echo = echo_canceller_create(&config);
+    ctx->echo_buffer = ctx->echo ?
+        malloc((size_t)echo_canceller_max_output(ctx->echo, AUDIO_BUFFER_SIZE) * sizeof(short)) :
+        NULL;
+    ctx->echo_reference = ctx->echo_buffer ? audio_source_create(&reference_config) : NULL;
+    if (!ctx->echo_reference || !audio_source_start(ctx->echo_reference)) {
+        blog(LOG_WARNING, "[Garmin Replay] %sCan't listen to '%s' for echo cancellation, "
+             "recognizing the microphone as is", ctx->log_prefix,
+             g_plugin_data.echo_reference ? g_plugin_data.echo_reference : "Desktop Audio");
+        stop_echo_cancel(ctx);
+        return;
+    }
+
+    ctx->listener->stats.echo_active = true;
+    blog(LOG_INFO, "[Garmin Replay] %sEcho cancellation on, reference '%s' (%s kernels)",
+         ctx->log_prefix,
+         g_plugin_data.echo_reference ? g_plugin_data.echo_reference : "Desktop Audio",
+         audio_convert_isa_name(echo_canceller_get_isa(ctx->echo)));
+}
+
+// Hand the canceller the reference audio that has arrived, then remove the
+// echo from a chunk of microphone audio. While the reference runs late the
+// canceller holds the microphone back, so the chunk can come out shorter,
+// longer or empty, and later than it went in.
+// samples, count, timestamp_ns: The chunk; replaced by the cancelled audio
+//                               (in echo_buffer) and its capture time
+static void cancel_echo(struct recognition_context *ctx, short **samples, int *count,
+                        uint64_t *timestamp_ns)
+{
+    short reference[AUDIO_BUFFER_SIZE];
+    int reference_count;
+    while ((reference_count = audio_source_poll(ctx->echo_reference, reference,
+                                                AUDIO_BUFFER_SIZE, NULL)) > 0) {
+        echo_canceller_far_end(ctx->echo, reference, reference_count);
+    }
+
+    int held = echo_canceller_pending(ctx->echo);
+    uint64_t start_ns = os_gettime_ns();
+    int cancelled = echo_canceller_process(ctx->echo, *samples, *count, ctx->echo_buffer);
+    pipeline_stats_record(STAGE_ECHO_CANCEL, os_gettime_ns() - start_ns);
+
+    // Output starts with the audio held from earlier chunks
+    if (timestamp_ns && *timestamp_ns) {
+        *timestamp_ns -= (uint64_t)held * NS_PER_SAMPLE;
+    }
+    *samples = ctx->echo_buffer;
+    *count = cancelled;
+
+    struct echo_canceller_stats stats;
+    echo_canceller_get_stats(ctx->echo, &stats);
+    ctx->listener->stats.echo_aligned = stats.aligned;
+    ctx->listener->stats.echo_erle_db = stats.erle_db;
+}
+
+static void log_echo_stats(const struct recognition_context *ctx)
+{
+    struct echo_canceller_stats stats;
+    echo_canceller_get_stats(ctx->echo, &stats);
+    if (!stats.blocks) {
+        return;
+    }
+
+    double block_ns = ECHO_CANCELLER_BLOCK_SAMPLES * (double)NS_PER_SAMPLE;
+    double per_block_ns = (double)stats.process_ns / (double)stats.blocks;
+    blog(LOG_INFO, "[Garmin Replay] %sEcho canceller: %.1f us per %.0f ms block (%.2f%% of a core), "
+         "%.0f%% of blocks echo, %.0f%% double talk, %.0f%% passed through",
+         ctx->log_prefix, per_block_ns / 1000.0, block_ns / 1000000.0,
+         100.0 * per_block_ns / block_ns,
+         100.0 * (double)stats.echo_blocks / (double)stats.blocks,
+         100.0 * (double)stats.double_talk_blocks / (double)stats.blocks,
+         100.0 * (double)stats.bypass_blocks / (double)stats.blocks);
+    if (stats.echo_blocks) {
+        blog(LOG_INFO, "[Garmin Replay] %sEcho canceller: ERLE %.1f dB recently, %.1f dB mean; "
+             "echo trails its reference by %d ms, %llu realignments",
+             ctx->log_prefix, stats.erle_db, stats.erle_mean_db, stats.delay_ms,
+             (unsigned long long)stats.realignments);
+    } else {
+        blog(LOG_INFO, "[Garmin Replay] %sEcho canceller: never found the reference in the "
+             "microphone", ctx->log_prefix);
+    }
+}
+
+static void stop_mic_cleanup(struct recognition_context *ctx)
+{
+    noise_suppressor_destroy(ctx->denoise);
+    free(ctx->denoise_buffer);
+    auto_gain_destroy(ctx->agc);
+    ctx->denoise = NULL;
+    ctx->denoise_buffer = NULL;
+    ctx->agc = NULL;
+}
+
+// Noise suppression and automatic gain, as configured. Either one that
+// can't be created is left out with a warning.
+static void start_mic_cleanup(struct recognition_context *ctx)
+{
+    if (g_plugin_data.noise_suppress) {
+        struct noise_suppressor_config config;
+        noise_suppressor_config_default(&config);
+
+        // Sized for the longest chunk the echo canceller can hand on
+        int chunk = ctx->echo ? echo_canceller_max_output(ctx->echo, AUDIO_BUFFER_SIZE) :
+            AUDIO_BUFFER_SIZE;
+        ctx->denoise = noise_suppressor_create(&config);
+        ctx->denoise_buffer = ctx->denoise ?
+            malloc((size_t)noise_suppressor_max_output(ctx->denoise, chunk) * sizeof(short)) :
+            NULL;
+        if (!ctx->denoise_buffer) {
+            blog(LOG_WARNING, "[Garmin Replay] %sFailed to create noise suppressor, "
+                 "recognizing the noise as is", ctx->log_prefix);
+            noise_suppressor_destroy(ctx->denoise);
+            ctx->denoise = NULL;
+        } else {
+            blog(LOG_INFO, "[Garmin Replay] %sNoise suppression on, up to %.0f dB (%s kernels)",
+                 ctx->log_prefix, config.max_suppression_db,
+                 audio_convert_isa_name(noise_suppressor_get_isa(ctx->denoise)));
+        }
+    }
+
+    if (g_plugin_data.auto_gain) {
+        struct auto_gain_config config;
+        auto_gain_config_default(&config);
+
+        ctx->agc = auto_gain_create(&config);
+        if (!ctx->agc) {
+            blog(LOG_WARNING, "[Garmin Replay] %sFailed to create auto gain, "
+                 "recognizing the microphone at its own level", ctx->log_prefix);
+        } else {
+            blog(LOG_INFO, "[Garmin Replay] %sAuto gain on, speech to %.0f dBFS "
+                 "(%+.0f to %+.0f dB, %s kernels)", ctx->log_prefix, config.target_dbfs,
+                 config.min_gain_db, config.max_gain_db,
+                 audio_convert_isa_name(auto_gain_get_isa(ctx->agc)));
+        }
+    }
+}
+
+// Echo cancellation, noise suppression and automatic gain, whichever are
+// on, in that order: the echo canceller needs the mic as the speakers
+// reached it, and the gain should follow the voice rather than the noise.
+// The suppressor works on whole overlapping 10 ms frames, so like the echo
+// canceller it can return less than it got, and later.
+// samples, count, timestamp_ns: The chunk; replaced by the cleaned audio
+//                               and its capture time
+static void clean_up_audio(struct recognition_context *ctx, short **samples, int *count,
+                           uint64_t *timestamp_ns)
+{
+    if (ctx->echo) {
+        cancel_echo(ctx, samples, count, timestamp_ns);
+    }
+
+    if (ctx->denoise) {
+        int held = noise_suppressor_pending(ctx->denoise);
+        uint64_t start_ns = os_gettime_ns();
+        int denoised = noise_suppressor_process(ctx->denoise, *samples, *count,
+                                                ctx->denoise_buffer);
+        pipeline_stats_record(STAGE_NOISE_SUPPRESS, os_gettime_ns() - start_ns);
+
+        if (timestamp_ns && *timestamp_ns) {
+            *timestamp_ns -= (uint64_t)held * NS_PER_SAMPLE;
+        }
+        *samples = ctx->denoise_buffer;
+        *count = denoised;
+    }
+
+    if (ctx->agc && *count > 0) {
+        uint64_t start_ns = os_gettime_ns();
+        auto_gain_process(ctx->agc, *samples, *count, *samples);
+        pipeline_stats_record(STAGE_AUTO_GAIN, os_gettime_ns() - start_ns);
+    }
+}
+
+static void log_mic_cleanup_stats(const struct recognition_context *ctx)
+{
+    double frame_ns = NOISE_SUPPRESSOR_FRAME_SAMPLES * (double)NS_PER_SAMPLE;
+
+    if (ctx->denoise) {
+        struct noise_suppressor_stats stats;
+        noise_suppressor_get_stats(ctx->denoise, &stats);
+        if (stats.frames) {
+            double per_frame_ns = (double)stats.process_ns / (double)stats.frames;
+            blog(LOG_INFO, "[Garmin Replay] %sNoise suppressor: %.1f us per 10 ms frame "
+                 "(%.2f%% of a core), noise floor %.1f dBFS, %.1f dB removed between words",
+                 ctx->log_prefix, per_frame_ns / 1000.0, 100.0 * per_frame_ns / frame_ns,
+                 stats.noise_dbfs, stats.reduction_db);
+        }
+    }
+
+    if (ctx->agc) {
+        struct auto_gain_stats stats;
+        auto_gain_get_stats(ctx->agc, &stats);
+        if (stats.frames) {
+            double per_frame_ns = (double)stats.process_ns / (double)stats.frames;
+            blog(LOG_INFO, "[Garmin Replay] %sAuto gain: %.1f us per 10 ms frame "
+                 "(%.2f%% of a core), speech at %.1f dBFS, gain %+.1f dB, "
+                 "%.0f%% of frames speech, %llu samples clipped",
+                 ctx->log_prefix, per_frame_ns / 1000.0, 100.0 * per_frame_ns / frame_ns,
+                 stats.speech_dbfs, stats.gain_db,
+                 100.0 * (double)stats.speech_frames / (double)stats.frames,
+                 (unsigned long long)stats.clipped_samples);
+        }
+    }
+}
+
+static void stop_keyword_prefilter(struct recognition_context *ctx)
+{
+    keyword_spotter_destroy(ctx->kws);
+    free(ctx->kws_buffer);
+    ctx->kws = NULL;
+    ctx->kws_buffer = NULL;
+}
+
+static void start_keyword_prefilter(struct recognition_context *ctx)
+{
+    ctx->kws = keyword_spotter_create(NULL);
+    ctx->kws_buffer = ctx->kws ?
+        malloc((size_t)KEYWORD_SPOTTER_MAX_LOOKBACK * sizeof(short)) : NULL;
+    if (!ctx->kws_buffer) {
+        blog(LOG_WARNING, "[Garmin Replay] %sFailed to create keyword prefilter, "
+             "decoding all speech", ctx->log_prefix);
+        stop_keyword_prefilter(ctx);
+        return;
+    }
+
+    ctx->kws_state = PREFILTER_LEARNING;
+    blog(LOG_INFO, "[Garmin Replay] %sKeyword prefilter on, decoding everything until it has "
+         "learned a few commands%s", ctx->log_prefix,
+         ctx->vad ? "" : " (without the VAD it can't audit what it misses)");
+}
+
+// Run what the VAD passed through the spotter and pick what the decoder
+// gets: everything while learning or auditing, nothing while asleep, and on
+// a wake the spotter's recent audio from just before the match, which
+// already includes this chunk
+// samples: The chunk; replaced by the lookback on a wake
+// Returns: Samples to decode
+static int prefilter_keywords(struct recognition_context *ctx, const short **samples, int count)
+{
+    if (count <= 0) {
+        return 0;
+    }
+
+    uint64_t start_ns = os_gettime_ns();
+    struct keyword_spot spot;
+    bool spotted = keyword_spotter_process(ctx->kws, *samples, count, &spot);
+    uint64_t end_ns = os_gettime_ns();
+    pipeline_stats_record(STAGE_KEYWORD_SPOT, end_ns - start_ns);
+    ctx->kws_counts.samples_in += (uint64_t)count;
+
+    bool utterance_start = !ctx->kws_in_utterance;
+    if (utterance_start) {
+        ctx->kws_in_utterance = true;
+        ctx->kws_spotted = false;
+    }
+    ctx->kws_spotted |= spotted;
+
+    switch (ctx->kws_state) {
+    case PREFILTER_LEARNING:
+        return count;
+
+    case PREFILTER_ASLEEP:
+        if (spotted) {
+            TRACE_INSTANT(TRACE_THREAD_RECOGNITION, "keyword spot", end_ns,
+                          "distance", spot.distance);
+            blog(LOG_DEBUG, "[Garmin Replay] %sKeyword prefilter heard something like '%s' "
+                 "(distance %.2f, lookback %d), waking the decoder", ctx->log_prefix, spot.phrase,
+                 spot.distance, spot.lookback);
+            vosk_engine_reset(ctx->listener->vosk);
+            reset_partial(ctx);
+            ctx->kws_state = PREFILTER_AWAKE;
+            ctx->kws_budget = PREFILTER_WAKE_SAMPLES;
+            ctx->kws_counts.wakes++;
+            *samples = ctx->kws_buffer;
+            return keyword_spotter_recent_audio(ctx->kws, ctx->kws_buffer, spot.lookback);
+        }
+        if (ctx->vad && utterance_start && ++ctx->kws_utterances % PREFILTER_AUDIT_EVERY == 0) {
+            vosk_engine_reset(ctx->listener->vosk);
+            reset_partial(ctx);
+            ctx->kws_state = PREFILTER_AUDIT;
+            ctx->kws_counts.audits++;
+            return count;
+        }
+        return 0;
+
+    case PREFILTER_AWAKE:
+        ctx->kws_budget -= count;
+        return count;
+
+    case PREFILTER_AUDIT:
+        return count;
+    }
+    return count;
+}
+
+// After the decoder has had the chunk: go back to sleep once a wake found
+// its command, its budget ran out, or the utterance ended, and after an
+// audited utterance. Learning only ends between utterances, so the one
+// being decoded is finished (and flushed on the gate closing) first.
+// endpoint: The decoder finished an utterance on this chunk
+static void prefilter_update(struct recognition_context *ctx, bool detected, bool gate_closed,
+                             bool endpoint)
+{
+    if (gate_closed) {
+        ctx->kws_in_utterance = false;
+    }
+
+    switch (ctx->kws_state) {
+    case PREFILTER_LEARNING:
+        if ((gate_closed || endpoint) && keyword_spotter_ready(ctx->kws)) {
+            blog(LOG_INFO, "[Garmin Replay] %sKeyword prefilter learned enough commands, "
+                 "decoding only what sounds like one", ctx->log_prefix);
+            ctx->kws_state = PREFILTER_ASLEEP;
+        }
+        break;
+    case PREFILTER_AWAKE:
+        if (!detected && !gate_closed) {
+            if (ctx->kws_budget > 0) {
+                return;
+            }
+            // A false alarm, or a command the decoder hasn't finished yet
+            handle_final_result(ctx, vosk_engine_get_final_result(ctx->listener->vosk));
+        }
+        ctx->kws_state = PREFILTER_ASLEEP;
+        break;
+    case PREFILTER_AUDIT:
+        if (gate_closed) {
+            ctx->kws_state = PREFILTER_ASLEEP;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void log_prefilter_stats(const struct recognition_context *ctx)
+{
+    const struct prefilter_counts *counts = &ctx->kws_counts;
+    struct keyword_spotter_stats stats;
+    keyword_spotter_get_stats(ctx->kws, &stats);
+    if (!stats.frames) {
+        return;
+    }
+
+    double decoded = counts->samples_in ?
+        100.0 * (double)ctx->acct.samples_decoded / (double)counts->samples_in : 0.0;
+    double per_frame_ns = (double)stats.process_ns / (double)stats.frames;
+    blog(LOG_INFO, "[Garmin Replay] %sKeyword prefilter: %d templates, %llu wakes, decoded %.1f%% "
+         "of the speech, %.1f us per 10 ms frame (%.2f%% of a core); %llu audits found %llu commands, "
+         "%llu missed by the spotter",
+         ctx->log_prefix, stats.templates, (unsigned long long)counts->wakes, decoded,
+         per_frame_ns / 1000.0,
+         100.0 * per_frame_ns / (KEYWORD_SPOTTER_FRAME_SAMPLES * (double)NS_PER_SAMPLE),
+         (unsigned long long)counts->audits, (unsigned long long)counts->audited_commands,
+         (unsigned long long)counts->missed);
+}
+
+// Audio captured while the model loads, decoded once it is ready
+struct audio_backlog {
+    short *samples;
+    int count;
+    bool overflowed;
+};
+
+static void backlog_append(struct audio_backlog *backlog, const short *samples, int count)
+{
+    if (!backlog->samples) {
+        return;
+    }
+
+    // Keep the most recent audio; a command right before ready matters most
+    if (backlog->count + count > BACKLOG_MAX_SAMPLES) {
+        int drop = backlog->count + count - BACKLOG_MAX_SAMPLES;
+        if (drop > backlog->count) {
+            drop = backlog->count;
+        }
+        memmove(backlog->samples, backlog->samples + drop,
+                (size_t)(backlog->count - drop) * sizeof(short));
+        backlog->count -= drop;
+        backlog->overflowed = true;
+    }
+
+    memcpy(backlog->samples + backlog->count, samples, (size_t)count * sizeof(short));
+    backlog->count += count;
+}
+
+// Run one chunk of captured audio through the VAD, keyword prefilter and
+// decoder
+// timestamp_ns: Capture time of samples[0], or 0 if unknown
+static void recognize_chunk(struct recognition_context *ctx, const short *samples, int count,
+                            uint64_t timestamp_ns)
+{
+    ctx->chunk_timestamp_ns = timestamp_ns;
+    ctx->chunk_first_sample = ctx->acct.samples_captured;
+    ctx->acct.samples_captured += (uint64_t)count;
+    ctx->listener->stats.samples_captured = ctx->acct.samples_captured;
+
+    const short *decode_buffer = samples;
+    int decode_samples = count;
+    bool gate_closed = false;
+
+    if (ctx->vad) {
+        decode_samples = vad_process(ctx->vad, samples, count, ctx->gated_buffer, &gate_closed);
+        decode_buffer = ctx->gated_buffer;
+    }
 
+    if (ctx->kws) {
+        decode_samples = prefilter_keywords(ctx, &decode_buffer, decode_samples);
+    }
+
+    bool detected = false;
+    bool endpoint = false;
+    if (decode_samples > 0) {
         // Process through Vosk
-        int result = vosk_engine_process(g_plugin_data.vosk, audio_buffer, samples);
+        uint64_t decode_start = os_gettime_ns();
+        int result = vosk_engine_process(ctx->listener->vosk, decode_buffer, decode_samples);
+        uint64_t decode_end = os_gettime_ns();
+        uint64_t decode_ns = decode_end - decode_start;
+        TRACE_SPAN(TRACE_THREAD_RECOGNITION, "vosk accept", decode_start, decode_end,
+                   "samples", decode_samples);
+        if (!ctx->utterance_start_ns) {
+            ctx->utterance_start_ns = decode_start;
+        }
+        ctx->acct.decode_ns += decode_ns;
+        ctx->acct.samples_decoded += (uint64_t)decode_samples;
+        ctx->listener->stats.decode_ns = ctx->acct.decode_ns;
+        ctx->listener->stats.samples_decoded = ctx->acct.samples_decoded;
+        pipeline_stats_record(STAGE_VOSK_ACCEPT, decode_ns);
+        pipeline_stats_add(COUNTER_DECODED_SAMPLES, (uint64_t)decode_samples);
 
         if (result == 1) {
             // Final result available
-            const char *json = vosk_engine_get_result(g_plugin_data.vosk);
-
-            // Check for trigger phrase
-            float confidence = phrase_detector_check(json, g_plugin_data.sensitivity, g_plugin_data.language);
-
-            if (confidence > 0.5f) {
-                blog(LOG_INFO, "[Garmin Replay] Voice command detected! Confidence: %.2f",
-                     confidence);
-
-                // Check if replay buffer is active
-                if (!replay_buffer_is_active()) {
-                    // Start the replay buffer
-                    blog(LOG_INFO, "[Garmin Replay] Replay buffer not active, starting it...");
-                    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
-                             "Starting replay buffer...");
-
-                    obs_frontend_replay_buffer_start();
-
-                    blog(LOG_INFO, "[Garmin Replay] Replay buffer started. Say the command again to save.");
-                    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
-                             "Buffer started! Say again to save.");
-                } else {
-                    // Replay buffer is active, save it
-                    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
-                             "Command detected! Saving...");
-
-                    // Save replay buffer
-                    if (g_plugin_data.restart_mode == 1) {
-                        replay_buffer_save_and_restart();
-                    } else {
-                        replay_buffer_save();
-                    }
-
-                    snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
-                             "Saved! Listening...");
-                }
-
+            TRACE_INSTANT(TRACE_THREAD_RECOGNITION, "endpoint", decode_end, NULL, 0);
+            endpoint = true;
+            detected = handle_final_result(ctx, vosk_engine_get_result(ctx->listener->vosk));
+            if (detected) {
                 // Reset recognizer for next command
-                vosk_engine_reset(g_plugin_data.vosk);
+                vosk_engine_reset(ctx->listener->vosk);
+            }
+        } else if (result == 0 && g_plugin_data.early_trigger) {
+            check_partial_result(ctx, decode_samples);
+        }
+    }
+
+    // An asleep prefilter gave the decoder nothing to finish
+    if (gate_closed && (!ctx->kws || ctx->kws_state != PREFILTER_ASLEEP)) {
+        // Speech is over and no more audio is coming; finish the utterance now
+        TRACE_INSTANT(TRACE_THREAD_RECOGNITION, "vad endpoint", os_gettime_ns(), NULL, 0);
+        handle_final_result(ctx, vosk_engine_get_final_result(ctx->listener->vosk));
+    }
+
+    if (ctx->kws) {
+        prefilter_update(ctx, detected, gate_closed, endpoint);
+    }
+}
+
+// recognize_chunk() in pieces the VAD's buffer can take
+static void recognize_audio(struct recognition_context *ctx, const short *samples, int count,
+                            uint64_t timestamp_ns)
+{
+    for (int offset = 0; offset < count; offset += AUDIO_BUFFER_SIZE) {
+        int piece = count - offset < AUDIO_BUFFER_SIZE ? count - offset : AUDIO_BUFFER_SIZE;
+        recognize_chunk(ctx, samples + offset, piece,
+                        timestamp_ns ? timestamp_ns + (uint64_t)offset * NS_PER_SAMPLE : 0);
+    }
+}
+
+// The source ran dry (file input): flush and report throughput
+static void finish_input(struct recognition_context *ctx)
+{
+    // Flush the last utterance, the file may end mid-sentence
+    ctx->chunk_timestamp_ns = 0;
+    handle_final_result(ctx, vosk_engine_get_final_result(ctx->listener->vosk));
+
+    double audio_sec = (double)ctx->acct.samples_captured / AUDIO_SOURCE_SAMPLE_RATE;
+    double wall_sec = (double)(os_gettime_ns() - ctx->start_ns) / 1000000000.0;
+    blog(LOG_INFO, "[Garmin Replay] %sEnd of %s input: %.1f s of audio in %.2f s (%.1fx real time)",
+         ctx->log_prefix, audio_source_get_name(ctx->listener->capture), audio_sec, wall_sec,
+         wall_sec > 0.0 ? audio_sec / wall_sec : 0.0);
+    set_listener_status(ctx, "Input finished");
+}
+
+// Capture into the backlog until the background loader has an engine
+// Returns: false if capture failed or recognition was stopped first
+static bool wait_for_engine(struct recognition_context *ctx, engine_loader_t *loader,
+                            struct audio_backlog *backlog, bool *input_ended)
+{
+    struct garmin_listener *listener = ctx->listener;
+    short audio_buffer[AUDIO_BUFFER_SIZE];
+
+    while (g_plugin_data.thread_running) {
+        vosk_engine_t *engine = NULL;
+        if (engine_loader_poll(loader, &engine)) {
+            listener->vosk = engine;
+            return engine != NULL;
+        }
+
+        // The listeners load together; the main one speaks for all of them
+        if (listener->main) {
+            struct engine_loader_progress progress;
+            engine_loader_get_progress(loader, &progress);
+            snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
+                     "%s... %.1f s (%.1f s of audio buffered)",
+                     engine_loader_phase_name(progress.phase),
+                     progress.elapsed_ns / 1000000000.0,
+                     (double)backlog->count / AUDIO_SOURCE_SAMPLE_RATE);
+        }
+
+        if (*input_ended) {
+            os_sleep_ms(10);
+            continue;
+        }
+
+        int samples = audio_source_read(listener->capture, audio_buffer,
+                                        AUDIO_BUFFER_SIZE, NULL);
+        if (samples == AUDIO_SOURCE_END) {
+            *input_ended = true;
+        } else if (samples == AUDIO_SOURCE_ERROR) {
+            blog(LOG_ERROR, "[Garmin Replay] %sAudio capture failed while loading the model",
+                 ctx->log_prefix);
+            set_listener_status(ctx, "Audio capture failed");
+            return false;
+        } else if (samples > 0) {
+            short *audio = audio_buffer;
+            clean_up_audio(ctx, &audio, &samples, NULL);
+            backlog_append(backlog, audio, samples);
+        }
+    }
+
+    return false;
+}
+
+// Recognition thread function, one per listener
+static void *recognition_thread_func(void *data)
+{
+    struct garmin_listener *listener = data;
+    short audio_buffer[AUDIO_BUFFER_SIZE];
+
+    os_set_thread_name("garmin-recognition");
+
+    struct recognition_context ctx = {0};
+    ctx.listener = listener;
+    ctx.start_ns = os_gettime_ns();
+    ctx.cpu_start_ns = thread_cpu_ns();
+    if (g_plugin_data.listener_count > 1) {
+        snprintf(ctx.log_prefix, sizeof(ctx.log_prefix), "%s: ", listener->name);
+    }
+    blog(LOG_INFO, "[Garmin Replay] %sRecognition thread started", ctx.log_prefix);
+
+    // Initialize audio capture
+    struct audio_source_config source_config;
+    get_audio_source_config(listener, &source_config);
+    ctx.realtime_input = source_config.type != AUDIO_SOURCE_FILE || source_config.realtime;
+
+    listener->capture = audio_source_create(&source_config);
+    if (!listener->capture) {
+        blog(LOG_ERROR, "[Garmin Replay] %sFailed to create audio capture", ctx.log_prefix);
+        return NULL;
+    }
+
+    // Start capturing right away; audio spoken while the model loads is kept
+    if (!audio_source_start(listener->capture)) {
+        blog(LOG_ERROR, "[Garmin Replay] %sFailed to start audio capture", ctx.log_prefix);
+        audio_source_destroy(listener->capture);
+        listener->capture = NULL;
+        return NULL;
+    }
+
+    // A file has no speakers playing into it
+    if (g_plugin_data.echo_cancel && source_config.type != AUDIO_SOURCE_FILE) {
+        start_echo_cancel(&ctx);
+    }
+    start_mic_cleanup(&ctx);
+
+    // Load the Vosk engine in the background; only the first listener to
+    // get there reads the model, the others share it through the cache
+    char model_path[512];
+    get_vosk_model_path(model_path, sizeof(model_path));
+    engine_loader_t *loader = engine_loader_start(model_path,
+                                                  command_table_grammar(g_plugin_data.commands));
+
+    struct audio_backlog backlog = {0};
+    backlog.samples = malloc((size_t)BACKLOG_MAX_SAMPLES * sizeof(short));
+    bool input_ended = false;
+
+    bool ready = loader && wait_for_engine(&ctx, loader, &backlog, &input_ended);
+
+    struct engine_loader_progress progress = {0};
+    if (loader) {
+        engine_loader_get_progress(loader, &progress);
+    }
+    engine_loader_destroy(loader);
+
+    if (!ready) {
+        if (!loader || progress.phase == ENGINE_LOADER_FAILED) {
+            blog(LOG_ERROR, "[Garmin Replay] %sFailed to create Vosk engine", ctx.log_prefix);
+            set_listener_status(&ctx, "Failed to load speech model");
+        }
+        free(backlog.samples);
+        stop_echo_cancel(&ctx);
+        stop_mic_cleanup(&ctx);
+        vosk_engine_destroy(listener->vosk);
+        audio_source_destroy(listener->capture);
+        listener->vosk = NULL;
+        listener->capture = NULL;
+        blog(LOG_INFO, "[Garmin Replay] %sRecognition thread stopped", ctx.log_prefix);
+        return NULL;
+    }
+
+    listener->stats.recognizer_bytes = vosk_engine_get_resident_bytes(listener->vosk);
+    listener->stats.ready = true;
+
+    // The warm-up decodes exactly one second of audio through the grammar
+    blog(LOG_INFO, "[Garmin Replay] %sRecognition ready in %.0f ms (engine %.0f ms, warm-up %.0f ms "
+         "per second of audio, grammar of %d phrases), %.1f s of audio buffered%s",
+         ctx.log_prefix, (os_gettime_ns() - ctx.start_ns) / 1000000.0, progress.load_ns / 1000000.0,
+         progress.warm_up_ns / 1000000.0, command_table_grammar_size(g_plugin_data.commands),
+         (double)backlog.count / AUDIO_SOURCE_SAMPLE_RATE,
+         backlog.overflowed ? " (oldest audio dropped)" : "");
+
+    if (g_plugin_data.endpoint_mode != VOSK_ENDPOINT_DEFAULT &&
+        !vosk_engine_set_endpoint_mode(listener->vosk,
+                                       (enum vosk_endpoint_mode)g_plugin_data.endpoint_mode) &&
+        listener->main) {
+        blog(LOG_WARNING, "[Garmin Replay] This Vosk build can't change endpointer timing, using its default");
+    }
+    if (g_plugin_data.early_trigger && listener->main) {
+        blog(LOG_INFO, "[Garmin Replay] Early trigger on, partials must hold for %d ms",
+             g_plugin_data.early_stable_frames * 10);
+    }
+
+    // Optional voice-activity gate, decoding only runs while it is open
+    if (g_plugin_data.vad_enabled) {
+        struct vad_config vad_config;
+        vad_config_default(&vad_config);
+        vad_config.hangover_ms = g_plugin_data.vad_hangover_ms;
+
+        ctx.vad = vad_create(&vad_config);
+        ctx.gated_buffer = ctx.vad ?
+            malloc((size_t)vad_max_output(ctx.vad, AUDIO_BUFFER_SIZE) * sizeof(short)) : NULL;
+        if (!ctx.gated_buffer) {
+            blog(LOG_WARNING, "[Garmin Replay] %sFailed to create VAD, decoding all audio",
+                 ctx.log_prefix);
+            vad_destroy(ctx.vad);
+            ctx.vad = NULL;
+        }
+    }
+
+    if (g_plugin_data.keyword_prefilter) {
+        start_keyword_prefilter(&ctx);
+    }
+
+    // Catch up on what was said while loading
+    if (backlog.count > 0) {
+        if (listener->main) {
+            snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
+                     "Catching up...");
+        }
+
+        uint64_t catch_up_start = os_gettime_ns();
+        for (int offset = 0; offset < backlog.count && g_plugin_data.thread_running;
+             offset += AUDIO_BUFFER_SIZE) {
+            int count = backlog.count - offset;
+            recognize_chunk(&ctx, backlog.samples + offset,
+                            count < AUDIO_BUFFER_SIZE ? count : AUDIO_BUFFER_SIZE, 0);
+        }
+        blog(LOG_INFO, "[Garmin Replay] %sDecoded %.1f s of buffered audio in %.0f ms",
+             ctx.log_prefix, (double)backlog.count / AUDIO_SOURCE_SAMPLE_RATE,
+             (os_gettime_ns() - catch_up_start) / 1000000.0);
+    }
+    free(backlog.samples);
+
+    if (listener->main) {
+        snprintf(g_plugin_data.status_text, sizeof(g_plugin_data.status_text),
+                 "Listening... (ready in %.1f s)",
+                 (os_gettime_ns() - ctx.start_ns) / 1000000000.0);
+    }
+
+    if (input_ended) {
+        finish_input(&ctx);
+    }
+
+    // The stats are shared, so the main listener logs them for everyone
+    uint64_t stats_interval_ns = (uint64_t)g_plugin_data.stats_log_interval_s * 1000000000ULL;
+    ctx.next_stats_log_ns = stats_interval_ns && listener->main ?
+        os_gettime_ns() + stats_interval_ns : 0;
+
+    // Main recognition loop
+    while (g_plugin_data.thread_running && !input_ended) {
+        // Read audio from the source
+        uint64_t timestamp_ns = 0;
+        uint64_t wait_start = os_gettime_ns();
+        int samples = audio_source_read(listener->capture,
+                                        audio_buffer, AUDIO_BUFFER_SIZE,
+                                        &timestamp_ns);
+        uint64_t now_ns = os_gettime_ns();
+        pipeline_stats_record(STAGE_CAPTURE_WAIT, now_ns - wait_start);
+        listener->stats.cpu_ns = thread_cpu_ns() - ctx.cpu_start_ns;
+
+        if (ctx.next_stats_log_ns && now_ns >= ctx.next_stats_log_ns) {
+            pipeline_stats_log();
+            garmin_log_listener_stats();
+            ctx.next_stats_log_ns = now_ns + stats_interval_ns;
+        }
+
+        if (samples == AUDIO_SOURCE_END) {
+            finish_input(&ctx);
+            break;
+        }
+
+        if (samples == AUDIO_SOURCE_ERROR) {
+            blog(LOG_ERROR, "[Garmin Replay] %sAudio capture failed, stopping recognition",
+                 ctx.log_prefix);
+            set_listener_status(&ctx, "Audio capture failed");
+            break;
+        }
+
+        if (samples == 0) {
+            // The source keeps the decoder's stream going across a reconnect;
+            // only the status changes
+            struct audio_source_stats capture_stats;
+            audio_source_get_stats(listener->capture, &capture_stats);
+            if (capture_stats.recovering && !ctx.capture_recovering) {
+                ctx.capture_recovering = true;
+                set_listener_status(&ctx, "Microphone lost, reconnecting...");
             }
+            continue;
         }
+
+        if (ctx.capture_recovering) {
+            ctx.capture_recovering = false;
+            set_listener_status(&ctx, "Listening... (microphone reconnected)");
+        }
+
+        short *audio = audio_buffer;
+        clean_up_audio(&ctx, &audio, &samples, &timestamp_ns);
+        recognize_audio(&ctx, audio, samples, timestamp_ns);
+    }
+
+    listener->stats.cpu_ns = thread_cpu_ns() - ctx.cpu_start_ns;
+    log_trigger_latency(&ctx);
+    log_decode_cost(&ctx);
+
+    if (ctx.vad) {
+        log_vad_stats(&ctx, os_gettime_ns() - ctx.start_ns);
+        vad_destroy(ctx.vad);
+        free(ctx.gated_buffer);
+    }
+    if (ctx.kws) {
+        log_prefilter_stats(&ctx);
+        stop_keyword_prefilter(&ctx);
+    }
+    if (ctx.echo) {
+        log_echo_stats(&ctx);
     }
+    log_mic_cleanup_stats(&ctx);
 
     // Cleanup
-    wasapi_capture_stop(g_plugin_data.capture);
-    wasapi_capture_destroy(g_plugin_data.capture);
-    vosk_engine_destroy(g_plugin_data.vosk);
-    g_plugin_data.capture = NULL;
-    g_plugin_data.vosk = NULL;
+    stop_echo_cancel(&ctx);
+    stop_mic_cleanup(&ctx);
+    audio_source_destroy(listener->capture);
+    vosk_engine_destroy(listener->vosk);
+    listener->capture = NULL;
+    listener->vosk = NULL;
+
+    blog(LOG_INFO, "[Garmin Replay] %sRecognition thread stopped", ctx.log_prefix);
+    return NULL;
+}
+
+// Ready the main microphone and each extra listener for a run; skips
+// devices already listened to, which would only hear every command twice
+static void setup_listeners(void)
+{
+    g_plugin_data.listener_count = 0;
+
+    for (int i = -1; i < g_plugin_data.extra_listener_count; i++) {
+        const char *device_id = i < 0 ? g_plugin_data.device_id :
+                                        g_plugin_data.extra_listeners[i].device_id;
+        const char *name = i < 0 ? "main" : g_plugin_data.extra_listeners[i].name;
+
+        bool duplicate = false;
+        for (int j = 0; j < g_plugin_data.listener_count; j++) {
+            const char *other = g_plugin_data.listeners[j].device_id;
+            if (strcmp(other ? other : "", device_id ? device_id : "") == 0) {
+                duplicate = true;
+            }
+        }
+        if (duplicate) {
+            blog(LOG_WARNING, "[Garmin Replay] Skipping listener '%s', its device '%s' is already listened to",
+                 name && *name ? name : "", device_id && *device_id ? device_id : "default");
+            continue;
+        }
+
+        struct garmin_listener *listener = &g_plugin_data.listeners[g_plugin_data.listener_count];
+        memset(listener, 0, sizeof(*listener));
+        listener->main = i < 0;
+        listener->device_id = device_id && *device_id ? bstrdup(device_id) : NULL;
+        if (name && *name) {
+            snprintf(listener->name, sizeof(listener->name), "%s", name);
+        } else {
+            snprintf(listener->name, sizeof(listener->name), "listener %d",
+                     g_plugin_data.listener_count + 1);
+        }
+        g_plugin_data.listener_count++;
+    }
+
+    if (g_plugin_data.listener_count > 1) {
+        for (int i = 0; i < g_plugin_data.listener_count; i++) {
+            const struct garmin_listener *listener = &g_plugin_data.listeners[i];
+            blog(LOG_INFO, "[Garmin Replay] Listener '%s': %s", listener->name,
+                 listener->device_id ? listener->device_id : "default microphone");
+        }
+    }
+}
 
-    CoUninitialize();
+static void free_listeners(void)
+{
+    for (int i = 0; i < g_plugin_data.listener_count; i++) {
+        bfree(g_plugin_data.listeners[i].device_id);
+    }
+    memset(g_plugin_data.listeners, 0, sizeof(g_plugin_data.listeners));
+    g_plugin_data.listener_count = 0;
+}
+
+size_t garmin_format_listener_stats(char *buffer, size_t size)
+{
+    if (!size) {
+        return 0;
+    }
+    buffer[0] = '\0';
+
+    uint64_t elapsed_ns = g_run_start_ns ? os_gettime_ns() - g_run_start_ns : 0;
+    int recognizers = 0;
+    size_t len = 0;
+    for (int i = 0; i < g_plugin_data.listener_count && len < size; i++) {
+        const struct garmin_listener *listener = &g_plugin_data.listeners[i];
+        const struct garmin_listener_stats *stats = &listener->stats;
+        if (stats->ready) {
+            recognizers++;
+        }
+
+        double audio_sec = (double)stats->samples_decoded / AUDIO_SOURCE_SAMPLE_RATE;
+        char latency[64] = "";
+        if (stats->latency_count) {
+            snprintf(latency, sizeof(latency), ", save %.0f ms mean / %.0f ms max",
+                     stats->latency_total_ns / (double)stats->latency_count / 1000000.0,
+                     stats->latency_max_ns / 1000000.0);
+        }
+
+        char echo[48] = "";
+        if (stats->echo_active && stats->echo_aligned) {
+            snprintf(echo, sizeof(echo), ", echo -%.0f dB", stats->echo_erle_db);
+        } else if (stats->echo_active) {
+            snprintf(echo, sizeof(echo), ", echo not found");
+        }
+
+        int n = snprintf(buffer + len, size - len,
+                         "%-12s CPU %4.1f%%, decoder %.1f ms/s, %llu commands%s%s, recognizer ~%.0f MB\n",
+                         listener->name,
+                         elapsed_ns ? 100.0 * (double)stats->cpu_ns / (double)elapsed_ns : 0.0,
+                         audio_sec > 0.0 ? (double)stats->decode_ns / 1000000.0 / audio_sec : 0.0,
+                         (unsigned long long)stats->commands, latency, echo,
+                         stats->recognizer_bytes / (1024.0 * 1024.0));
+        if (n < 0) {
+            return len;
+        }
+        len += (size_t)n;
+    }
+    if (len >= size) {
+        return size - 1;
+    }
+
+    struct model_cache_stats cache;
+    model_cache_get_stats(&cache);
+    int n = snprintf(buffer + len, size - len, "%-12s ~%.0f MB, shared by %d recognizer%s", "model",
+                     cache.resident_bytes / (1024.0 * 1024.0), recognizers,
+                     recognizers == 1 ? "" : "s");
+    if (n > 0) {
+        len += (size_t)n;
+    }
+    return len < size ? len : size - 1;
+}
+
+void garmin_log_listener_stats(void)
+{
+    char text[1024];
+    garmin_format_listener_stats(text, sizeof(text));
 
-    blog(LOG_INFO, "[Garmin Replay] Recognition thread stopped");
-    return 0;
+    // blog() takes one line at a time
+    char *line = text;
+    while (line && *line) {
+        char *next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        blog(LOG_INFO, "[Garmin Replay] Listeners: %s", line);
+        line = next;
+    }
 }
 
 void start_voice_recognition(void)
@@ -150,13 +1505,41 @@ void start_voice_recognition(void)
 
     blog(LOG_INFO, "[Garmin Replay] Starting voice recognition...");
 
+    // Compiled once per run; the recognition threads only read it
+    g_plugin_data.commands = garmin_load_commands();
+    if (!g_plugin_data.commands) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to compile voice commands");
+        return;
+    }
+
+    // Per run, like the other end-of-run reports
+    pipeline_stats_reset();
+#ifdef GARMIN_ENABLE_TRACE
+    trace_set_enabled(g_plugin_data.trace_enabled);
+#endif
+    trigger_arbiter_get_stats(g_plugin_data.trigger_arbiter, &g_run_arbiter_start);
+    g_run_start_ns = os_gettime_ns();
+
+    setup_listeners();
+
     g_plugin_data.thread_running = true;
-    g_plugin_data.recognition_thread = CreateThread(
-        NULL, 0, recognition_thread_func, NULL, 0, NULL);
+    int started = 0;
+    for (int i = 0; i < g_plugin_data.listener_count; i++) {
+        struct garmin_listener *listener = &g_plugin_data.listeners[i];
+        if (pthread_create(&listener->thread, NULL, recognition_thread_func, listener) != 0) {
+            blog(LOG_ERROR, "[Garmin Replay] Failed to create recognition thread for '%s'",
+                 listener->name);
+            continue;
+        }
+        listener->thread_active = true;
+        started++;
+    }
 
-    if (!g_plugin_data.recognition_thread) {
+    if (!started) {
         g_plugin_data.thread_running = false;
-        blog(LOG_ERROR, "[Garmin Replay] Failed to create recognition thread");
+        free_listeners();
+        command_table_destroy(g_plugin_data.commands);
+        g_plugin_data.commands = NULL;
     }
 }
 
@@ -170,11 +1553,22 @@ void stop_voice_recognition(void)
 
     g_plugin_data.thread_running = false;
 
-    if (g_plugin_data.recognition_thread) {
-        WaitForSingleObject(g_plugin_data.recognition_thread, 5000);
-        CloseHandle(g_plugin_data.recognition_thread);
-        g_plugin_data.recognition_thread = NULL;
+    for (int i = 0; i < g_plugin_data.listener_count; i++) {
+        struct garmin_listener *listener = &g_plugin_data.listeners[i];
+        if (listener->thread_active) {
+            pthread_join(listener->thread, NULL);
+            listener->thread_active = false;
+        }
     }
+
+    // Run-wide reports, once every listener has finished its own
+    log_trigger_stats(&g_run_arbiter_start);
+    pipeline_stats_log();
+    garmin_log_listener_stats();
+
+    free_listeners();
+    command_table_destroy(g_plugin_data.commands);
+    g_plugin_data.commands = NULL;
 }
 
 void get_vosk_model_path(char *path, size_t max_len)
@@ -212,14 +1606,59 @@ void get_vosk_model_path(char *path, size_t max_len)
     blog(LOG_INFO, "[Garmin Replay] Using fallback model path: %s", path);
 }
 
+// The arbiter lets requests through to the replay worker
+static bool arbiter_dispatch(enum replay_request request, void *param)
+{
+    (void)param;
+    return replay_worker_submit(g_plugin_data.replay_worker, request);
+}
+
+static bool arbiter_is_active(void *param)
+{
+    (void)param;
+    return replay_buffer_is_active();
+}
+
+static const struct trigger_arbiter_ops ARBITER_OPS = {
+    .dispatch = arbiter_dispatch,
+    .is_active = arbiter_is_active,
+};
+
 // Frontend event callback
 static void on_frontend_event(enum obs_frontend_event event, void *data)
 {
     (void)data;
 
+    // Replay buffer started/stopped/saved move the worker's current step on
+    // and keep the arbiter's idea of the buffer current
+    replay_worker_handle_event(g_plugin_data.replay_worker, event);
+
     switch (event) {
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STARTING:
+        trigger_arbiter_handle_event(g_plugin_data.trigger_arbiter, BUFFER_EVENT_STARTING);
+        break;
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STARTED:
+        trigger_arbiter_handle_event(g_plugin_data.trigger_arbiter, BUFFER_EVENT_STARTED);
+        break;
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STOPPING:
+        trigger_arbiter_handle_event(g_plugin_data.trigger_arbiter, BUFFER_EVENT_STOPPING);
+        break;
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STOPPED:
+        trigger_arbiter_handle_event(g_plugin_data.trigger_arbiter, BUFFER_EVENT_STOPPED);
+        break;
+    case OBS_FRONTEND_EVENT_FINISHED_LOADING:
+        // Deferred from module load so model loading doesn't compete with
+        // OBS startup
+        if (g_plugin_data.enabled) {
+            start_voice_recognition();
+        }
+        break;
     case OBS_FRONTEND_EVENT_EXIT:
         stop_voice_recognition();
+        replay_worker_destroy(g_plugin_data.replay_worker);
+        trigger_arbiter_destroy(g_plugin_data.trigger_arbiter);
+        g_plugin_data.replay_worker = NULL;
+        g_plugin_data.trigger_arbiter = NULL;
         break;
     default:
         break;
@@ -247,6 +1686,12 @@ bool obs_module_load(void)
     // Load settings
     garmin_load_settings();
 
+    g_plugin_data.replay_worker = replay_worker_create(on_replay_done, NULL);
+    if (!g_plugin_data.replay_worker) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to start the replay worker, commands won't do anything");
+    }
+    g_plugin_data.trigger_arbiter = trigger_arbiter_create(&ARBITER_OPS, NULL);
+
     // Register frontend event callback
     obs_frontend_add_event_callback(on_frontend_event, NULL);
 
@@ -256,10 +1701,7 @@ bool obs_module_load(void)
         on_tools_menu_clicked,
         NULL);
 
-    // Start voice recognition if enabled
-    if (g_plugin_data.enabled) {
-        start_voice_recognition();
-    }
+    // Voice recognition starts on OBS_FRONTEND_EVENT_FINISHED_LOADING
 
     blog(LOG_INFO, "[Garmin Replay] Plugin loaded successfully");
     return true;
@@ -272,6 +1714,19 @@ void obs_module_unload(void)
     // Stop voice recognition
     stop_voice_recognition();
 
+    // Nothing can submit requests anymore; the worker goes first, its
+    // completions call into the arbiter
+    replay_worker_destroy(g_plugin_data.replay_worker);
+    trigger_arbiter_destroy(g_plugin_data.trigger_arbiter);
+    g_plugin_data.replay_worker = NULL;
+    g_plugin_data.trigger_arbiter = NULL;
+
+    // A load stopped halfway still holds the cache until it finishes
+    engine_loader_wait_abandoned();
+
+    // Free the cached Vosk model now that no recognizer uses it
+    model_cache_shutdown();
+
     // Remove frontend callback
     obs_frontend_remove_event_callback(on_frontend_event, NULL);
 
@@ -286,6 +1741,15 @@ void obs_module_unload(void)
         bfree(g_plugin_data.device_id);
         g_plugin_data.device_id = NULL;
     }
+    garmin_clear_extra_listeners();
+    if (g_plugin_data.echo_reference) {
+        bfree(g_plugin_data.echo_reference);
+        g_plugin_data.echo_reference = NULL;
+    }
+    if (g_plugin_data.capture_file) {
+        bfree(g_plugin_data.capture_file);
+        g_plugin_data.capture_file = NULL;
+    }
 
     blog(LOG_INFO, "[Garmin Replay] Plugin unloaded");
 }
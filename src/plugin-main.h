@@ -3,7 +3,7 @@
 
 #include <obs-module.h>
 #include <obs-frontend-api.h>
-#include <windows.h>
+#include <util/threading.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,13 +11,82 @@ extern "C" {
 
 // Forward declarations
 typedef struct vosk_engine vosk_engine_t;
-typedef struct wasapi_capture wasapi_capture_t;
+typedef struct audio_source audio_source_t;
+typedef struct command_table command_table_t;
+typedef struct replay_worker replay_worker_t;
+typedef struct trigger_arbiter trigger_arbiter_t;
 
 // Language options (prefixed to avoid Windows SDK conflicts)
 #define GARMIN_LANG_ENGLISH 0
 #define GARMIN_LANG_GERMAN  1
 #define GARMIN_LANG_FRENCH  2
 
+// Allowed range for the VAD hangover setting
+#define GARMIN_VAD_HANGOVER_MIN_MS 100
+#define GARMIN_VAD_HANGOVER_MAX_MS 3000
+
+// How long (in 10ms frames) a partial hypothesis must stay unchanged before
+// early trigger fires on it
+#define GARMIN_EARLY_STABLE_MIN_FRAMES 5
+#define GARMIN_EARLY_STABLE_MAX_FRAMES 100
+#define GARMIN_EARLY_STABLE_DEFAULT_FRAMES 20
+
+// Repeats of a command within this window are ignored
+#define GARMIN_TRIGGER_COOLDOWN_MIN_MS 0
+#define GARMIN_TRIGGER_COOLDOWN_MAX_MS 10000
+#define GARMIN_TRIGGER_COOLDOWN_DEFAULT_MS 2000
+
+// How often pipeline stats go to the log while recognition runs (0 = only
+// when it stops)
+#define GARMIN_STATS_LOG_DEFAULT_S 300
+
+// Microphones listened to at once, the main one included
+#define GARMIN_MAX_LISTENERS 4
+#define GARMIN_LISTENER_NAME_LEN 64
+
+// A microphone listened to next to the main one ("listeners" setting)
+struct garmin_listener_config {
+    char *name;
+    char *device_id;
+};
+
+// What a listener has done this run. Only its recognition thread writes;
+// readers may see a chunk or so of lag.
+struct garmin_listener_stats {
+    uint64_t cpu_ns;             // Recognition thread CPU time
+    uint64_t decode_ns;          // Of which inside the recognizer
+    uint64_t samples_captured;
+    uint64_t samples_decoded;
+    uint64_t commands;
+    uint64_t latency_count;      // Commands with a known speech-end-to-save time
+    uint64_t latency_total_ns;
+    uint64_t latency_max_ns;
+    uint64_t recognizer_bytes;   // Memory its recognizer adds to the shared model
+    bool ready;
+
+    // Echo canceller, when on and its reference could be opened
+    bool echo_active;
+    bool echo_aligned;           // Has found the echo and is cancelling it
+    float echo_erle_db;          // Echo removed over the last few seconds
+};
+
+// One microphone being listened to: its own capture source, recognizer and
+// thread. All listeners share the loaded model through the model cache and
+// send their commands through the same trigger arbiter.
+struct garmin_listener {
+    char name[GARMIN_LISTENER_NAME_LEN];
+    char *device_id;
+    bool main;                   // Takes the capture_file developer option and owns the status text
+
+    audio_source_t *capture;
+    vosk_engine_t *vosk;
+
+    pthread_t thread;
+    bool thread_active;
+
+    struct garmin_listener_stats stats;
+};
+
 // Plugin state structure
 struct garmin_plugin_data {
     // Settings
@@ -25,17 +94,66 @@ struct garmin_plugin_data {
     bool enabled;
 
     // Audio capture
-    wasapi_capture_t *capture;
     char *device_id;
 
+    // More microphones to listen to alongside device_id
+    struct garmin_listener_config extra_listeners[GARMIN_MAX_LISTENERS - 1];
+    int extra_listener_count;
+
+    // Optional file/pipe input instead of the microphone (headless profiling)
+    char *capture_file;
+    bool capture_file_realtime;
+
+    // Developer fault injection: drop the capture device every N ms of
+    // audio and fail that many reopens (0 = off)
+    int capture_fault_interval_ms;
+    int capture_fault_reopen_failures;
+
     // Voice recognition
-    vosk_engine_t *vosk;
     int sensitivity;
     int restart_mode;
     int language;  // GARMIN_LANG_ENGLISH, GARMIN_LANG_GERMAN, or GARMIN_LANG_FRENCH
+    command_table_t *commands;  // Compiled from settings for each recognition run
+
+    // Cancel what the speakers play (desktop audio, or the named OBS
+    // source) out of each microphone before it is recognized
+    bool echo_cancel;
+    char *echo_reference;  // NULL for OBS's Desktop Audio
+
+    // Microphone cleanup after echo cancellation: stationary noise
+    // suppression, then automatic gain toward a steady speech level
+    bool noise_suppress;
+    bool auto_gain;
+
+    // Voice-activity gate: only decode while speech is likely
+    bool vad_enabled;
+    int vad_hangover_ms;
 
-    // Recognition thread
-    HANDLE recognition_thread;
+    // Keyword prefilter: a cheap spotter matches speech against learned
+    // commands and only wakes the decoder for likely ones
+    bool keyword_prefilter;
+
+    // Latency: fire on stable partial hypotheses instead of waiting for the
+    // endpoint, and how much trailing silence ends an utterance
+    bool early_trigger;
+    int early_stable_frames;
+    int endpoint_mode;  // enum vosk_endpoint_mode
+
+    // Runs replay buffer actions off the recognition thread; the arbiter
+    // decides which commands reach it
+    replay_worker_t *replay_worker;
+    trigger_arbiter_t *trigger_arbiter;
+    int trigger_cooldown_ms;
+
+    // Seconds between pipeline stats dumps to the log, 0 = off
+    int stats_log_interval_s;
+
+    // Record pipeline timelines (builds with GARMIN_ENABLE_TRACE only)
+    bool trace_enabled;
+
+    // Recognition threads, one per listener
+    struct garmin_listener listeners[GARMIN_MAX_LISTENERS];
+    int listener_count;
     volatile bool thread_running;
 
     // Status
@@ -49,6 +167,13 @@ extern struct garmin_plugin_data g_plugin_data;
 void start_voice_recognition(void);
 void stop_voice_recognition(void);
 
+// One line per listener (CPU, decoder cost, speech end to save, recognizer
+// memory), then the shared model. Any thread while recognition runs, else
+// only the one that starts and stops it.
+// Returns: Length written (truncated to size - 1)
+size_t garmin_format_listener_stats(char *buffer, size_t size);
+void garmin_log_listener_stats(void);
+
 // Settings functions
 void garmin_load_settings(void);
 void garmin_save_settings(void);
@@ -56,6 +181,12 @@ void garmin_save_settings(void);
 // Utility
 void get_vosk_model_path(char *path, size_t max_len);
 
+#ifdef GARMIN_ENABLE_TRACE
+// Write the recorded trace into the plugin config's traces folder
+// window_ns: Only the most recent events, 0 = all
+bool garmin_save_trace(uint64_t window_ns, char *path, size_t path_size);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,13 +3,23 @@
 
 #include <stdbool.h>
 
+// Single non-blocking OBS calls; sequencing and waiting for OBS to finish
+// is up to replay-worker
+
 // Save the current replay buffer
 // Returns: true if save was initiated successfully
 bool replay_buffer_save(void);
 
-// Save the replay buffer and restart it
-// Returns: true on success
-bool replay_buffer_save_and_restart(void);
+// Start the replay buffer
+// Returns: false if it was already running
+bool replay_buffer_start(void);
+
+// Stop the replay buffer
+// Returns: false if it wasn't running
+bool replay_buffer_stop(void);
+
+// Take a screenshot of the program output
+void replay_take_screenshot(void);
 
 // Check if replay buffer is currently active
 bool replay_buffer_is_active(void);
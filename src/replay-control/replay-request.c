@@ -0,0 +1,13 @@
+#include "replay-request.h"
+
+static const char *REQUEST_NAMES[] = {
+    "save", "save and restart", "start buffer", "stop buffer", "screenshot",
+};
+
+const char *replay_request_name(enum replay_request request)
+{
+    if ((unsigned int)request >= sizeof(REQUEST_NAMES) / sizeof(REQUEST_NAMES[0])) {
+        return "unknown";
+    }
+    return REQUEST_NAMES[request];
+}
@@ -0,0 +1,23 @@
+#ifndef REPLAY_REQUEST_H
+#define REPLAY_REQUEST_H
+
+// What a recognized command asks of the replay buffer, and how it went
+
+enum replay_request {
+    REPLAY_REQUEST_SAVE,
+    REPLAY_REQUEST_SAVE_AND_RESTART,
+    REPLAY_REQUEST_START,
+    REPLAY_REQUEST_STOP,
+    REPLAY_REQUEST_SCREENSHOT,
+};
+
+enum replay_result {
+    REPLAY_RESULT_DONE,
+    REPLAY_RESULT_STARTED_INSTEAD,  // Save asked while the buffer was off; it was started
+    REPLAY_RESULT_SKIPPED,          // Buffer already in the requested state
+    REPLAY_RESULT_TIMED_OUT,        // OBS didn't confirm a step in time
+};
+
+const char *replay_request_name(enum replay_request request);
+
+#endif // REPLAY_REQUEST_H
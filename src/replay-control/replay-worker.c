@@ -0,0 +1,360 @@
+#include "replay-worker.h"
+#include "replay-buffer.h"
+#include "../diagnostics/pipeline-stats.h"
+#include "../diagnostics/trace.h"
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <stdlib.h>
+
+// Requests waiting behind the one in progress; more than this means the
+// user is repeating a command OBS hasn't caught up with
+#define QUEUE_SIZE 8
+
+// How long OBS gets to confirm each step. Saving a long buffer takes the
+// longest; stop and start are normally well under a second.
+#define SAVE_TIMEOUT_MS 10000
+#define STOP_TIMEOUT_MS 5000
+#define START_TIMEOUT_MS 5000
+
+// Frontend events a step can wait for
+#define EVENT_SAVED   (1u << 0)
+#define EVENT_STOPPED (1u << 1)
+#define EVENT_STARTED (1u << 2)
+
+struct queued_request {
+    enum replay_request request;
+    uint64_t queued_ns;
+};
+
+struct replay_worker {
+    pthread_t thread;
+    bool thread_active;
+
+    // Guards everything below; held only for bookkeeping, never across an
+    // OBS call
+    pthread_mutex_t mutex;
+    os_event_t *wake_event;    // New request, frontend event or stop
+    struct queued_request queue[QUEUE_SIZE];
+    int queue_head;
+    int queue_count;
+    unsigned int events;       // EVENT_* seen since the current step began
+    bool stopping;
+
+    replay_worker_done_cb done;
+    void *done_param;
+};
+
+static bool is_stopping(replay_worker_t *worker)
+{
+    pthread_mutex_lock(&worker->mutex);
+    bool stopping = worker->stopping;
+    pthread_mutex_unlock(&worker->mutex);
+    return stopping;
+}
+
+// Forget earlier occurrences of `event` right before issuing the step that
+// produces it, so a stale one can't complete the step
+static void expect_event(replay_worker_t *worker, unsigned int event)
+{
+    pthread_mutex_lock(&worker->mutex);
+    worker->events &= ~event;
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+// Returns: false on timeout or when the worker is being destroyed
+static bool wait_for_event(replay_worker_t *worker, unsigned int event, uint32_t timeout_ms)
+{
+    uint64_t deadline_ns = os_gettime_ns() + (uint64_t)timeout_ms * 1000000ULL;
+
+    for (;;) {
+        pthread_mutex_lock(&worker->mutex);
+        bool seen = (worker->events & event) != 0;
+        bool stopping = worker->stopping;
+        pthread_mutex_unlock(&worker->mutex);
+
+        if (seen) {
+            return true;
+        }
+        if (stopping) {
+            return false;
+        }
+
+        uint64_t now_ns = os_gettime_ns();
+        if (now_ns >= deadline_ns) {
+            return false;
+        }
+        os_event_timedwait(worker->wake_event,
+                           (unsigned long)((deadline_ns - now_ns + 999999) / 1000000));
+    }
+}
+
+static double ms_since(uint64_t start_ns)
+{
+    return (os_gettime_ns() - start_ns) / 1000000.0;
+}
+
+static enum replay_result run_start(replay_worker_t *worker)
+{
+    expect_event(worker, EVENT_STARTED);
+    if (!replay_buffer_start()) {
+        return REPLAY_RESULT_SKIPPED;
+    }
+
+    uint64_t start_ns = os_gettime_ns();
+    if (!wait_for_event(worker, EVENT_STARTED, START_TIMEOUT_MS)) {
+        if (!is_stopping(worker)) {
+            blog(LOG_WARNING, "[Garmin Replay] Replay buffer didn't report starting within %d ms",
+                 START_TIMEOUT_MS);
+        }
+        return REPLAY_RESULT_TIMED_OUT;
+    }
+    blog(LOG_INFO, "[Garmin Replay] Replay buffer started in %.0f ms", ms_since(start_ns));
+    return REPLAY_RESULT_DONE;
+}
+
+static enum replay_result run_stop(replay_worker_t *worker)
+{
+    expect_event(worker, EVENT_STOPPED);
+    if (!replay_buffer_stop()) {
+        return REPLAY_RESULT_SKIPPED;
+    }
+
+    uint64_t start_ns = os_gettime_ns();
+    if (!wait_for_event(worker, EVENT_STOPPED, STOP_TIMEOUT_MS)) {
+        if (!is_stopping(worker)) {
+            blog(LOG_WARNING, "[Garmin Replay] Replay buffer didn't report stopping within %d ms",
+                 STOP_TIMEOUT_MS);
+        }
+        return REPLAY_RESULT_TIMED_OUT;
+    }
+    blog(LOG_INFO, "[Garmin Replay] Replay buffer stopped in %.0f ms", ms_since(start_ns));
+    return REPLAY_RESULT_DONE;
+}
+
+// Save; with restart, stop and start the buffer once OBS has written the file
+static enum replay_result run_save(replay_worker_t *worker, bool restart)
+{
+    if (!replay_buffer_is_active()) {
+        blog(LOG_INFO, "[Garmin Replay] Replay buffer not active, starting it...");
+        enum replay_result result = run_start(worker);
+        return result == REPLAY_RESULT_DONE ? REPLAY_RESULT_STARTED_INSTEAD : result;
+    }
+
+    uint64_t start_ns = os_gettime_ns();
+    expect_event(worker, EVENT_SAVED);
+    if (!replay_buffer_save()) {
+        return REPLAY_RESULT_SKIPPED;
+    }
+    if (!wait_for_event(worker, EVENT_SAVED, SAVE_TIMEOUT_MS)) {
+        if (!is_stopping(worker)) {
+            blog(LOG_WARNING, "[Garmin Replay] Replay wasn't reported saved within %d ms",
+                 SAVE_TIMEOUT_MS);
+        }
+        return REPLAY_RESULT_TIMED_OUT;
+    }
+    double save_ms = ms_since(start_ns);
+    blog(LOG_INFO, "[Garmin Replay] Replay saved in %.0f ms", save_ms);
+
+    if (!restart) {
+        return REPLAY_RESULT_DONE;
+    }
+
+    uint64_t stop_start_ns = os_gettime_ns();
+    enum replay_result result = run_stop(worker);
+    if (result != REPLAY_RESULT_DONE) {
+        return result;
+    }
+    double stop_ms = ms_since(stop_start_ns);
+
+    uint64_t restart_ns = os_gettime_ns();
+    result = run_start(worker);
+    if (result == REPLAY_RESULT_SKIPPED) {
+        // Something else started it again in between
+        result = REPLAY_RESULT_DONE;
+    }
+    if (result == REPLAY_RESULT_DONE) {
+        blog(LOG_INFO, "[Garmin Replay] Replay buffer restarted in %.0f ms "
+             "(save %.0f ms, stop %.0f ms, start %.0f ms)",
+             ms_since(start_ns), save_ms, stop_ms, ms_since(restart_ns));
+    }
+    return result;
+}
+
+static enum replay_result run_request(replay_worker_t *worker, enum replay_request request)
+{
+    switch (request) {
+    case REPLAY_REQUEST_SAVE:
+        return run_save(worker, false);
+    case REPLAY_REQUEST_SAVE_AND_RESTART:
+        return run_save(worker, true);
+    case REPLAY_REQUEST_START:
+        return run_start(worker);
+    case REPLAY_REQUEST_STOP:
+        return run_stop(worker);
+    case REPLAY_REQUEST_SCREENSHOT:
+    default:
+        replay_take_screenshot();
+        return REPLAY_RESULT_DONE;
+    }
+}
+
+static void *worker_thread_func(void *param)
+{
+    replay_worker_t *worker = param;
+
+    os_set_thread_name("garmin-replay-worker");
+    // Outlives recognition runs, so keeps recording across pipeline_stats_reset
+    pipeline_stats_share_thread();
+
+    for (;;) {
+        pthread_mutex_lock(&worker->mutex);
+        bool stopping = worker->stopping;
+        bool have_request = !stopping && worker->queue_count > 0;
+        struct queued_request item = {0};
+        if (have_request) {
+            item = worker->queue[worker->queue_head];
+            worker->queue_head = (worker->queue_head + 1) % QUEUE_SIZE;
+            worker->queue_count--;
+        }
+        pthread_mutex_unlock(&worker->mutex);
+
+        if (stopping) {
+            break;
+        }
+        if (!have_request) {
+            os_event_wait(worker->wake_event);
+            continue;
+        }
+
+        // Requests are queued the moment a command is detected
+        uint64_t started_ns = os_gettime_ns();
+        pipeline_stats_record(STAGE_DISPATCH, started_ns - item.queued_ns);
+        blog(LOG_DEBUG, "[Garmin Replay] Running %s request, queued %.0f ms ago",
+             replay_request_name(item.request), (started_ns - item.queued_ns) / 1000000.0);
+
+        enum replay_result result = run_request(worker, item.request);
+        TRACE_SPAN(TRACE_THREAD_REPLAY, replay_request_name(item.request), started_ns,
+                   os_gettime_ns(), "result", result);
+
+        if (worker->done && !is_stopping(worker)) {
+            worker->done(item.request, result, worker->done_param);
+        }
+    }
+
+    return NULL;
+}
+
+replay_worker_t *replay_worker_create(replay_worker_done_cb done, void *param)
+{
+    replay_worker_t *worker = calloc(1, sizeof(replay_worker_t));
+    if (!worker) {
+        return NULL;
+    }
+
+    worker->done = done;
+    worker->done_param = param;
+
+    if (pthread_mutex_init(&worker->mutex, NULL) != 0) {
+        free(worker);
+        return NULL;
+    }
+    if (os_event_init(&worker->wake_event, OS_EVENT_TYPE_AUTO) != 0) {
+        pthread_mutex_destroy(&worker->mutex);
+        free(worker);
+        return NULL;
+    }
+
+    if (pthread_create(&worker->thread, NULL, worker_thread_func, worker) != 0) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to create replay worker thread");
+        os_event_destroy(worker->wake_event);
+        pthread_mutex_destroy(&worker->mutex);
+        free(worker);
+        return NULL;
+    }
+    worker->thread_active = true;
+
+    return worker;
+}
+
+bool replay_worker_submit(replay_worker_t *worker, enum replay_request request)
+{
+    if (!worker) {
+        return false;
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    bool queued = !worker->stopping && worker->queue_count < QUEUE_SIZE;
+    if (queued) {
+        struct queued_request *item =
+            &worker->queue[(worker->queue_head + worker->queue_count) % QUEUE_SIZE];
+        item->request = request;
+        item->queued_ns = os_gettime_ns();
+        worker->queue_count++;
+    }
+    pthread_mutex_unlock(&worker->mutex);
+
+    if (!queued) {
+        blog(LOG_WARNING, "[Garmin Replay] Replay worker busy, dropping %s request",
+             replay_request_name(request));
+        return false;
+    }
+
+    os_event_signal(worker->wake_event);
+    return true;
+}
+
+void replay_worker_handle_event(replay_worker_t *worker, enum obs_frontend_event event)
+{
+    if (!worker) {
+        return;
+    }
+
+    unsigned int bit;
+    switch (event) {
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_SAVED:
+        bit = EVENT_SAVED;
+        break;
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STOPPED:
+        bit = EVENT_STOPPED;
+        break;
+    case OBS_FRONTEND_EVENT_REPLAY_BUFFER_STARTED:
+        bit = EVENT_STARTED;
+        break;
+    default:
+        return;
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->events |= bit;
+    pthread_mutex_unlock(&worker->mutex);
+    os_event_signal(worker->wake_event);
+}
+
+void replay_worker_destroy(replay_worker_t *worker)
+{
+    if (!worker) {
+        return;
+    }
+
+    pthread_mutex_lock(&worker->mutex);
+    worker->stopping = true;
+    int dropped = worker->queue_count;
+    pthread_mutex_unlock(&worker->mutex);
+    os_event_signal(worker->wake_event);
+
+    if (worker->thread_active) {
+        pthread_join(worker->thread, NULL);
+    }
+
+    if (dropped > 0) {
+        blog(LOG_INFO, "[Garmin Replay] Dropped %d queued replay request%s on shutdown",
+             dropped, dropped == 1 ? "" : "s");
+    }
+
+    os_event_destroy(worker->wake_event);
+    pthread_mutex_destroy(&worker->mutex);
+    free(worker);
+}
@@ -0,0 +1,33 @@
+#ifndef REPLAY_WORKER_H
+#define REPLAY_WORKER_H
+
+#include "replay-request.h"
+
+#include <obs-frontend-api.h>
+
+#include <stdbool.h>
+
+// Runs replay buffer operations on their own thread so the recognition
+// thread never waits on OBS. Multi-step operations (save and restart) move
+// on when OBS reports the previous step done through frontend events, with
+// a timeout per step in case an event never comes.
+
+typedef struct replay_worker replay_worker_t;
+
+// Called on the worker thread when a request has finished
+typedef void (*replay_worker_done_cb)(enum replay_request request, enum replay_result result,
+                                      void *param);
+
+replay_worker_t *replay_worker_create(replay_worker_done_cb done, void *param);
+
+// Queue a request; never blocks
+// Returns: false if the queue is full
+bool replay_worker_submit(replay_worker_t *worker, enum replay_request request);
+
+// Feed OBS frontend events in (from the frontend event callback)
+void replay_worker_handle_event(replay_worker_t *worker, enum obs_frontend_event event);
+
+// Abandon queued requests and the current step, and join the thread
+void replay_worker_destroy(replay_worker_t *worker);
+
+#endif // REPLAY_WORKER_H
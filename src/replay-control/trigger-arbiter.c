@@ -0,0 +1,315 @@
+#include "trigger-arbiter.h"
+#include "../compat/obs-compat.h"
+
+#include <stdlib.h>
+
+struct trigger_arbiter {
+    struct trigger_arbiter_ops ops;
+    void *param;
+
+    pthread_mutex_t mutex;
+    enum buffer_state state;
+
+    // One save waiting for the save in flight
+    bool has_pending;
+    enum replay_request pending;
+
+    // Last command let through, for coalescing
+    bool has_last;
+    enum replay_request last_request;
+    uint64_t last_ns;
+
+    struct trigger_arbiter_stats stats;
+};
+
+static const char *STATE_NAMES[] = {
+    "idle", "starting", "active", "saving", "restarting", "stopping",
+};
+
+static bool is_save(enum replay_request request)
+{
+    return request == REPLAY_REQUEST_SAVE || request == REPLAY_REQUEST_SAVE_AND_RESTART;
+}
+
+// State the buffer enters once the worker picks `request` up
+static enum buffer_state state_after(enum replay_request request, enum buffer_state state)
+{
+    switch (request) {
+    case REPLAY_REQUEST_SAVE:
+        // The worker starts an idle buffer instead of saving
+        return state == BUFFER_IDLE ? BUFFER_STARTING : BUFFER_SAVING;
+    case REPLAY_REQUEST_SAVE_AND_RESTART:
+        return state == BUFFER_IDLE ? BUFFER_STARTING : BUFFER_RESTARTING;
+    case REPLAY_REQUEST_START:
+        return BUFFER_STARTING;
+    case REPLAY_REQUEST_STOP:
+        return BUFFER_STOPPING;
+    case REPLAY_REQUEST_SCREENSHOT:
+    default:
+        return state;
+    }
+}
+
+static enum buffer_state actual_state(trigger_arbiter_t *arbiter)
+{
+    return arbiter->ops.is_active(arbiter->param) ? BUFFER_ACTIVE : BUFFER_IDLE;
+}
+
+trigger_arbiter_t *trigger_arbiter_create(const struct trigger_arbiter_ops *ops, void *param)
+{
+    if (!ops || !ops->dispatch || !ops->is_active) {
+        return NULL;
+    }
+
+    trigger_arbiter_t *arbiter = calloc(1, sizeof(trigger_arbiter_t));
+    if (!arbiter) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&arbiter->mutex, NULL) != 0) {
+        free(arbiter);
+        return NULL;
+    }
+
+    arbiter->ops = *ops;
+    arbiter->param = param;
+    arbiter->state = actual_state(arbiter);
+    return arbiter;
+}
+
+// Hand a request on; on failure, put the state back
+// Returns: false if it wasn't taken
+static bool dispatch(trigger_arbiter_t *arbiter, enum replay_request request,
+                     enum buffer_state previous)
+{
+    if (arbiter->ops.dispatch(request, arbiter->param)) {
+        return true;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+    arbiter->state = previous;
+    arbiter->stats.run--;
+    arbiter->stats.suppressed++;
+    pthread_mutex_unlock(&arbiter->mutex);
+    return false;
+}
+
+enum arbiter_decision trigger_arbiter_submit(trigger_arbiter_t *arbiter, enum replay_request request,
+                                             uint32_t coalesce_ms)
+{
+    if (!arbiter) {
+        return ARBITER_SUPPRESSED;
+    }
+
+    uint64_t now_ns = os_gettime_ns();
+
+    pthread_mutex_lock(&arbiter->mutex);
+    arbiter->stats.triggers++;
+
+    enum buffer_state state = arbiter->state;
+    enum arbiter_decision decision = ARBITER_RUN;
+    uint64_t since_last_ns = now_ns - arbiter->last_ns;
+
+    if (arbiter->has_last && request == arbiter->last_request &&
+        since_last_ns < (uint64_t)coalesce_ms * 1000000ULL) {
+        decision = ARBITER_COALESCED;
+    } else if (is_save(request)) {
+        if (state == BUFFER_SAVING || state == BUFFER_RESTARTING) {
+            decision = arbiter->has_pending ? ARBITER_SUPPRESSED : ARBITER_QUEUED;
+        } else if (state == BUFFER_STARTING || state == BUFFER_STOPPING) {
+            // Nothing recorded yet, or about to be gone
+            decision = ARBITER_SUPPRESSED;
+        }
+    } else if (request == REPLAY_REQUEST_START) {
+        if (state != BUFFER_IDLE) {
+            decision = ARBITER_SUPPRESSED;
+        }
+    } else if (request == REPLAY_REQUEST_STOP) {
+        if (state == BUFFER_IDLE || state == BUFFER_STOPPING) {
+            decision = ARBITER_SUPPRESSED;
+        }
+    }
+
+    switch (decision) {
+    case ARBITER_RUN:
+        arbiter->state = state_after(request, state);
+        arbiter->stats.run++;
+        break;
+    case ARBITER_QUEUED:
+        arbiter->has_pending = true;
+        arbiter->pending = request;
+        arbiter->stats.queued++;
+        break;
+    case ARBITER_COALESCED:
+        arbiter->stats.coalesced++;
+        break;
+    case ARBITER_SUPPRESSED:
+        arbiter->stats.suppressed++;
+        break;
+    }
+    if (decision == ARBITER_RUN || decision == ARBITER_QUEUED) {
+        arbiter->has_last = true;
+        arbiter->last_request = request;
+        arbiter->last_ns = now_ns;
+    }
+    pthread_mutex_unlock(&arbiter->mutex);
+
+    switch (decision) {
+    case ARBITER_RUN:
+        if (!dispatch(arbiter, request, state)) {
+            decision = ARBITER_SUPPRESSED;
+        }
+        break;
+    case ARBITER_QUEUED:
+        blog(LOG_INFO, "[Garmin Replay] Queued %s until the replay buffer is done %s",
+             replay_request_name(request), buffer_state_name(state));
+        break;
+    case ARBITER_COALESCED:
+        blog(LOG_INFO, "[Garmin Replay] Ignoring %s, same command %.0f ms ago",
+             replay_request_name(request), since_last_ns / 1000000.0);
+        break;
+    case ARBITER_SUPPRESSED:
+        blog(LOG_INFO, "[Garmin Replay] Ignoring %s, replay buffer is %s%s",
+             replay_request_name(request), buffer_state_name(state),
+             is_save(request) && (state == BUFFER_SAVING || state == BUFFER_RESTARTING) ?
+                 " and a save is already queued" : "");
+        break;
+    }
+
+    return decision;
+}
+
+void trigger_arbiter_handle_event(trigger_arbiter_t *arbiter, enum buffer_event event)
+{
+    if (!arbiter) {
+        return;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+    enum buffer_state state = arbiter->state;
+
+    // A restart passes through stopped and started; the worker's completion
+    // ends it
+    switch (event) {
+    case BUFFER_EVENT_STARTING:
+        if (state == BUFFER_IDLE) {
+            state = BUFFER_STARTING;
+        }
+        break;
+    case BUFFER_EVENT_STARTED:
+        if (state == BUFFER_IDLE || state == BUFFER_STARTING || state == BUFFER_STOPPING) {
+            state = BUFFER_ACTIVE;
+        }
+        break;
+    case BUFFER_EVENT_STOPPING:
+        if (state != BUFFER_RESTARTING && state != BUFFER_IDLE) {
+            state = BUFFER_STOPPING;
+        }
+        break;
+    case BUFFER_EVENT_STOPPED:
+        if (state != BUFFER_RESTARTING) {
+            state = BUFFER_IDLE;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (state != arbiter->state) {
+        blog(LOG_DEBUG, "[Garmin Replay] Replay buffer %s -> %s",
+             buffer_state_name(arbiter->state), buffer_state_name(state));
+        arbiter->state = state;
+    }
+    pthread_mutex_unlock(&arbiter->mutex);
+}
+
+void trigger_arbiter_request_done(trigger_arbiter_t *arbiter, enum replay_request request,
+                                  enum replay_result result)
+{
+    if (!arbiter || request == REPLAY_REQUEST_SCREENSHOT) {
+        return;
+    }
+
+    bool succeeded = result == REPLAY_RESULT_DONE || result == REPLAY_RESULT_STARTED_INSTEAD;
+
+    // Skipped or timed out: trust OBS over what was expected (asked outside
+    // the lock)
+    enum buffer_state actual = succeeded ? BUFFER_IDLE : actual_state(arbiter);
+
+    pthread_mutex_lock(&arbiter->mutex);
+    enum buffer_state state = arbiter->state;
+
+    if (!succeeded) {
+        state = actual;
+    } else if (request == REPLAY_REQUEST_STOP) {
+        state = BUFFER_IDLE;
+    } else if (state == BUFFER_STARTING || state == BUFFER_SAVING || state == BUFFER_RESTARTING) {
+        // Otherwise events already moved it on (stopped from the OBS UI meanwhile)
+        state = BUFFER_ACTIVE;
+    }
+
+    bool release = false;
+    enum replay_request next = arbiter->pending;
+    enum buffer_state previous = state;
+    if (arbiter->has_pending && state == BUFFER_ACTIVE) {
+        arbiter->has_pending = false;
+        release = true;
+        state = state_after(next, state);
+        arbiter->stats.run++;
+    } else if (arbiter->has_pending && state == BUFFER_IDLE) {
+        arbiter->has_pending = false;
+        arbiter->stats.suppressed++;
+        blog(LOG_INFO, "[Garmin Replay] Dropping queued %s, the replay buffer stopped",
+             replay_request_name(next));
+    }
+    arbiter->state = state;
+    pthread_mutex_unlock(&arbiter->mutex);
+
+    if (release) {
+        blog(LOG_INFO, "[Garmin Replay] Running queued %s", replay_request_name(next));
+        dispatch(arbiter, next, previous);
+    }
+}
+
+enum buffer_state trigger_arbiter_get_state(trigger_arbiter_t *arbiter)
+{
+    if (!arbiter) {
+        return BUFFER_IDLE;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+    enum buffer_state state = arbiter->state;
+    pthread_mutex_unlock(&arbiter->mutex);
+    return state;
+}
+
+void trigger_arbiter_get_stats(trigger_arbiter_t *arbiter, struct trigger_arbiter_stats *stats)
+{
+    if (!arbiter) {
+        struct trigger_arbiter_stats empty = {0};
+        *stats = empty;
+        return;
+    }
+
+    pthread_mutex_lock(&arbiter->mutex);
+    *stats = arbiter->stats;
+    pthread_mutex_unlock(&arbiter->mutex);
+}
+
+void trigger_arbiter_destroy(trigger_arbiter_t *arbiter)
+{
+    if (!arbiter) {
+        return;
+    }
+
+    pthread_mutex_destroy(&arbiter->mutex);
+    free(arbiter);
+}
+
+const char *buffer_state_name(enum buffer_state state)
+{
+    if ((unsigned int)state >= sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0])) {
+        return "unknown";
+    }
+    return STATE_NAMES[state];
+}
@@ -0,0 +1,83 @@
+#ifndef TRIGGER_ARBITER_H
+#define TRIGGER_ARBITER_H
+
+#include "replay-request.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decides what a recognized command actually does, given what the replay
+// buffer is doing. Buffer state comes from frontend events (so starts and
+// stops made in the OBS UI count too) and from the replay worker's
+// completions. Repeats of the same command inside the coalescing window are
+// dropped, and at most one save waits behind a save that is still writing.
+// Requests go out and the buffer's running state is read through
+// trigger_arbiter_ops, which keeps this free of OBS calls.
+
+typedef struct trigger_arbiter trigger_arbiter_t;
+
+enum buffer_state {
+    BUFFER_IDLE,
+    BUFFER_STARTING,
+    BUFFER_ACTIVE,
+    BUFFER_SAVING,
+    BUFFER_RESTARTING,  // Save, stop and start in progress
+    BUFFER_STOPPING,
+};
+
+enum arbiter_decision {
+    ARBITER_RUN,         // Handed to the replay worker
+    ARBITER_QUEUED,      // Runs once the save in flight has finished
+    ARBITER_COALESCED,   // Same command inside the coalescing window
+    ARBITER_SUPPRESSED,  // Pointless in the current state, or a save is already queued
+};
+
+// Replay buffer transitions OBS reports (its REPLAY_BUFFER_* frontend events)
+enum buffer_event {
+    BUFFER_EVENT_STARTING,
+    BUFFER_EVENT_STARTED,
+    BUFFER_EVENT_STOPPING,
+    BUFFER_EVENT_STOPPED,
+};
+
+struct trigger_arbiter_ops {
+    // Hand a request that was let through to whatever carries it out
+    // Returns: false if it couldn't be taken
+    bool (*dispatch)(enum replay_request request, void *param);
+
+    // Whether the replay buffer is running right now
+    bool (*is_active)(void *param);
+};
+
+struct trigger_arbiter_stats {
+    uint64_t triggers;
+    uint64_t run;        // Including queued ones once they ran
+    uint64_t queued;
+    uint64_t coalesced;
+    uint64_t suppressed;
+};
+
+// ops: Copied; param is passed to every call
+trigger_arbiter_t *trigger_arbiter_create(const struct trigger_arbiter_ops *ops, void *param);
+
+// Arbitrate one recognized command (any thread)
+// coalesce_ms: Repeats of the last accepted command within this are dropped
+enum arbiter_decision trigger_arbiter_submit(trigger_arbiter_t *arbiter, enum replay_request request,
+                                             uint32_t coalesce_ms);
+
+// Feed replay buffer events in (from the frontend event callback)
+void trigger_arbiter_handle_event(trigger_arbiter_t *arbiter, enum buffer_event event);
+
+// A dispatched request has finished; may release the queued save
+void trigger_arbiter_request_done(trigger_arbiter_t *arbiter, enum replay_request request,
+                                  enum replay_result result);
+
+enum buffer_state trigger_arbiter_get_state(trigger_arbiter_t *arbiter);
+
+void trigger_arbiter_get_stats(trigger_arbiter_t *arbiter, struct trigger_arbiter_stats *stats);
+
+void trigger_arbiter_destroy(trigger_arbiter_t *arbiter);
+
+const char *buffer_state_name(enum buffer_state state);
+
+#endif // TRIGGER_ARBITER_H
@@ -1,5 +1,8 @@
 #include "plugin-settings.h"
 #include "../plugin-main.h"
+#include "../voice-recognition/command-table.h"
+#include "../voice-recognition/vad.h"
+#include "../voice-recognition/vosk-engine.h"
 
 #include <obs-module.h>
 #include <util/config-file.h>
@@ -25,6 +28,66 @@ const char *garmin_get_settings_path(void)
     return settings_path;
 }
 
+void garmin_clear_extra_listeners(void)
+{
+    for (int i = 0; i < g_plugin_data.extra_listener_count; i++) {
+        bfree(g_plugin_data.extra_listeners[i].name);
+        bfree(g_plugin_data.extra_listeners[i].device_id);
+    }
+    memset(g_plugin_data.extra_listeners, 0, sizeof(g_plugin_data.extra_listeners));
+    g_plugin_data.extra_listener_count = 0;
+}
+
+bool garmin_add_extra_listener(const char *name, const char *device_id)
+{
+    if (g_plugin_data.extra_listener_count >= GARMIN_MAX_LISTENERS - 1) {
+        blog(LOG_WARNING, "[Garmin Replay] Ignoring listener '%s', at most %d microphones are listened to",
+             name ? name : "", GARMIN_MAX_LISTENERS);
+        return false;
+    }
+
+    struct garmin_listener_config *listener =
+        &g_plugin_data.extra_listeners[g_plugin_data.extra_listener_count++];
+    listener->name = name && *name ? bstrdup(name) : NULL;
+    listener->device_id = device_id && *device_id ? bstrdup(device_id) : NULL;
+    return true;
+}
+
+// "listeners": [{"name": "Co-host", "device_id": "obs:Co-host Mic"}, ...]
+// Microphones listened to next to device_id; empty device_id = default
+static void load_extra_listeners(obs_data_t *data)
+{
+    garmin_clear_extra_listeners();
+
+    obs_data_array_t *listeners = obs_data_get_array(data, "listeners");
+    size_t count = listeners ? obs_data_array_count(listeners) : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        obs_data_t *item = obs_data_array_item(listeners, i);
+        garmin_add_extra_listener(obs_data_get_string(item, "name"),
+                                  obs_data_get_string(item, "device_id"));
+        obs_data_release(item);
+    }
+    obs_data_array_release(listeners);
+}
+
+static void save_extra_listeners(void)
+{
+    obs_data_array_t *listeners = obs_data_array_create();
+
+    for (int i = 0; i < g_plugin_data.extra_listener_count; i++) {
+        const struct garmin_listener_config *listener = &g_plugin_data.extra_listeners[i];
+        obs_data_t *item = obs_data_create();
+        obs_data_set_string(item, "name", listener->name ? listener->name : "");
+        obs_data_set_string(item, "device_id", listener->device_id ? listener->device_id : "");
+        obs_data_array_push_back(listeners, item);
+        obs_data_release(item);
+    }
+
+    obs_data_set_array(g_plugin_data.settings, "listeners", listeners);
+    obs_data_array_release(listeners);
+}
+
 void garmin_load_settings(void)
 {
     const char *path = garmin_get_settings_path();
@@ -41,6 +104,24 @@ void garmin_load_settings(void)
         g_plugin_data.restart_mode = 0;
         g_plugin_data.language = GARMIN_LANG_ENGLISH;
         g_plugin_data.device_id = NULL;
+        garmin_clear_extra_listeners();
+        g_plugin_data.capture_file = NULL;
+        g_plugin_data.capture_file_realtime = true;
+        g_plugin_data.capture_fault_interval_ms = 0;
+        g_plugin_data.capture_fault_reopen_failures = 0;
+        g_plugin_data.echo_cancel = false;
+        g_plugin_data.echo_reference = NULL;
+        g_plugin_data.noise_suppress = false;
+        g_plugin_data.auto_gain = false;
+        g_plugin_data.vad_enabled = true;
+        g_plugin_data.vad_hangover_ms = VAD_DEFAULT_HANGOVER_MS;
+        g_plugin_data.keyword_prefilter = false;
+        g_plugin_data.early_trigger = false;
+        g_plugin_data.early_stable_frames = GARMIN_EARLY_STABLE_DEFAULT_FRAMES;
+        g_plugin_data.endpoint_mode = VOSK_ENDPOINT_DEFAULT;
+        g_plugin_data.trigger_cooldown_ms = GARMIN_TRIGGER_COOLDOWN_DEFAULT_MS;
+        g_plugin_data.stats_log_interval_s = GARMIN_STATS_LOG_DEFAULT_S;
+        g_plugin_data.trace_enabled = false;
 
         // Store defaults in settings
         obs_data_set_bool(g_plugin_data.settings, "enabled", false);
@@ -48,6 +129,23 @@ void garmin_load_settings(void)
         obs_data_set_int(g_plugin_data.settings, "restart_mode", 0);
         obs_data_set_int(g_plugin_data.settings, "language", GARMIN_LANG_ENGLISH);
         obs_data_set_string(g_plugin_data.settings, "device_id", "");
+        obs_data_set_string(g_plugin_data.settings, "capture_file", "");
+        obs_data_set_bool(g_plugin_data.settings, "capture_file_realtime", true);
+        obs_data_set_int(g_plugin_data.settings, "capture_fault_interval_ms", 0);
+        obs_data_set_int(g_plugin_data.settings, "capture_fault_reopen_failures", 0);
+        obs_data_set_bool(g_plugin_data.settings, "echo_cancel", false);
+        obs_data_set_string(g_plugin_data.settings, "echo_reference", "");
+        obs_data_set_bool(g_plugin_data.settings, "noise_suppress", false);
+        obs_data_set_bool(g_plugin_data.settings, "auto_gain", false);
+        obs_data_set_bool(g_plugin_data.settings, "vad_enabled", true);
+        obs_data_set_int(g_plugin_data.settings, "vad_hangover_ms", VAD_DEFAULT_HANGOVER_MS);
+        obs_data_set_bool(g_plugin_data.settings, "keyword_prefilter", false);
+        obs_data_set_bool(g_plugin_data.settings, "early_trigger", false);
+        obs_data_set_int(g_plugin_data.settings, "early_stable_frames", GARMIN_EARLY_STABLE_DEFAULT_FRAMES);
+        obs_data_set_int(g_plugin_data.settings, "endpoint_mode", VOSK_ENDPOINT_DEFAULT);
+        obs_data_set_int(g_plugin_data.settings, "trigger_cooldown_ms", GARMIN_TRIGGER_COOLDOWN_DEFAULT_MS);
+        obs_data_set_int(g_plugin_data.settings, "stats_log_interval_s", GARMIN_STATS_LOG_DEFAULT_S);
+        obs_data_set_bool(g_plugin_data.settings, "trace_enabled", false);
         return;
     }
 
@@ -66,6 +164,88 @@ void garmin_load_settings(void)
     if (device_id && strlen(device_id) > 0) {
         g_plugin_data.device_id = bstrdup(device_id);
     }
+    load_extra_listeners(data);
+
+    // Developer option: feed a WAV/raw PCM file instead of the microphone
+    const char *capture_file = obs_data_get_string(data, "capture_file");
+    if (capture_file && strlen(capture_file) > 0) {
+        g_plugin_data.capture_file = bstrdup(capture_file);
+    }
+    g_plugin_data.capture_file_realtime = !obs_data_has_user_value(data, "capture_file_realtime") ||
+                                          obs_data_get_bool(data, "capture_file_realtime");
+
+    // Developer option: break the capture device on a schedule
+    g_plugin_data.capture_fault_interval_ms = (int)obs_data_get_int(data, "capture_fault_interval_ms");
+    g_plugin_data.capture_fault_reopen_failures =
+        (int)obs_data_get_int(data, "capture_fault_reopen_failures");
+    if (g_plugin_data.capture_fault_interval_ms < 0) {
+        g_plugin_data.capture_fault_interval_ms = 0;
+    }
+    if (g_plugin_data.capture_fault_reopen_failures < 0) {
+        g_plugin_data.capture_fault_reopen_failures = 0;
+    }
+
+    // Echo cancellation, off unless enabled; the reference defaults to
+    // OBS's Desktop Audio
+    g_plugin_data.echo_cancel = obs_data_get_bool(data, "echo_cancel");
+    const char *echo_reference = obs_data_get_string(data, "echo_reference");
+    if (echo_reference && strlen(echo_reference) > 0) {
+        g_plugin_data.echo_reference = bstrdup(echo_reference);
+    }
+
+    // Microphone cleanup, off unless enabled
+    g_plugin_data.noise_suppress = obs_data_get_bool(data, "noise_suppress");
+    g_plugin_data.auto_gain = obs_data_get_bool(data, "auto_gain");
+
+    // Voice-activity gate, on unless explicitly disabled
+    g_plugin_data.vad_enabled = !obs_data_has_user_value(data, "vad_enabled") ||
+                                obs_data_get_bool(data, "vad_enabled");
+    g_plugin_data.vad_hangover_ms = obs_data_has_user_value(data, "vad_hangover_ms") ?
+        (int)obs_data_get_int(data, "vad_hangover_ms") : VAD_DEFAULT_HANGOVER_MS;
+    if (g_plugin_data.vad_hangover_ms < GARMIN_VAD_HANGOVER_MIN_MS) {
+        g_plugin_data.vad_hangover_ms = GARMIN_VAD_HANGOVER_MIN_MS;
+    }
+    if (g_plugin_data.vad_hangover_ms > GARMIN_VAD_HANGOVER_MAX_MS) {
+        g_plugin_data.vad_hangover_ms = GARMIN_VAD_HANGOVER_MAX_MS;
+    }
+
+    // Keyword prefilter in front of the decoder, off unless explicitly enabled
+    g_plugin_data.keyword_prefilter = obs_data_get_bool(data, "keyword_prefilter");
+
+    // Early trigger on partial results, off unless explicitly enabled
+    g_plugin_data.early_trigger = obs_data_get_bool(data, "early_trigger");
+    g_plugin_data.early_stable_frames = obs_data_has_user_value(data, "early_stable_frames") ?
+        (int)obs_data_get_int(data, "early_stable_frames") : GARMIN_EARLY_STABLE_DEFAULT_FRAMES;
+    if (g_plugin_data.early_stable_frames < GARMIN_EARLY_STABLE_MIN_FRAMES) {
+        g_plugin_data.early_stable_frames = GARMIN_EARLY_STABLE_MIN_FRAMES;
+    }
+    if (g_plugin_data.early_stable_frames > GARMIN_EARLY_STABLE_MAX_FRAMES) {
+        g_plugin_data.early_stable_frames = GARMIN_EARLY_STABLE_MAX_FRAMES;
+    }
+
+    g_plugin_data.endpoint_mode = (int)obs_data_get_int(data, "endpoint_mode");
+    if (g_plugin_data.endpoint_mode < VOSK_ENDPOINT_DEFAULT ||
+        g_plugin_data.endpoint_mode > VOSK_ENDPOINT_VERY_LONG) {
+        g_plugin_data.endpoint_mode = VOSK_ENDPOINT_DEFAULT;
+    }
+
+    // Repeats of a command within the cooldown are dropped
+    g_plugin_data.trigger_cooldown_ms = obs_data_has_user_value(data, "trigger_cooldown_ms") ?
+        (int)obs_data_get_int(data, "trigger_cooldown_ms") : GARMIN_TRIGGER_COOLDOWN_DEFAULT_MS;
+    if (g_plugin_data.trigger_cooldown_ms < GARMIN_TRIGGER_COOLDOWN_MIN_MS) {
+        g_plugin_data.trigger_cooldown_ms = GARMIN_TRIGGER_COOLDOWN_MIN_MS;
+    }
+    if (g_plugin_data.trigger_cooldown_ms > GARMIN_TRIGGER_COOLDOWN_MAX_MS) {
+        g_plugin_data.trigger_cooldown_ms = GARMIN_TRIGGER_COOLDOWN_MAX_MS;
+    }
+
+    // Developer option: how often pipeline stats are logged
+    g_plugin_data.stats_log_interval_s = obs_data_has_user_value(data, "stats_log_interval_s") ?
+        (int)obs_data_get_int(data, "stats_log_interval_s") : GARMIN_STATS_LOG_DEFAULT_S;
+    if (g_plugin_data.stats_log_interval_s < 0) {
+        g_plugin_data.stats_log_interval_s = 0;
+    }
+    g_plugin_data.trace_enabled = obs_data_get_bool(data, "trace_enabled");
 
     // Validate sensitivity
     if (g_plugin_data.sensitivity < 1) g_plugin_data.sensitivity = 1;
@@ -102,6 +282,34 @@ void garmin_save_settings(void)
     } else {
         obs_data_set_string(g_plugin_data.settings, "device_id", "");
     }
+    save_extra_listeners();
+
+    obs_data_set_string(g_plugin_data.settings, "capture_file",
+                        g_plugin_data.capture_file ? g_plugin_data.capture_file : "");
+    obs_data_set_bool(g_plugin_data.settings, "capture_file_realtime",
+                      g_plugin_data.capture_file_realtime);
+    obs_data_set_int(g_plugin_data.settings, "capture_fault_interval_ms",
+                     g_plugin_data.capture_fault_interval_ms);
+    obs_data_set_int(g_plugin_data.settings, "capture_fault_reopen_failures",
+                     g_plugin_data.capture_fault_reopen_failures);
+
+    obs_data_set_bool(g_plugin_data.settings, "echo_cancel", g_plugin_data.echo_cancel);
+    obs_data_set_string(g_plugin_data.settings, "echo_reference",
+                        g_plugin_data.echo_reference ? g_plugin_data.echo_reference : "");
+
+    obs_data_set_bool(g_plugin_data.settings, "noise_suppress", g_plugin_data.noise_suppress);
+    obs_data_set_bool(g_plugin_data.settings, "auto_gain", g_plugin_data.auto_gain);
+
+    obs_data_set_bool(g_plugin_data.settings, "vad_enabled", g_plugin_data.vad_enabled);
+    obs_data_set_int(g_plugin_data.settings, "vad_hangover_ms", g_plugin_data.vad_hangover_ms);
+    obs_data_set_bool(g_plugin_data.settings, "keyword_prefilter", g_plugin_data.keyword_prefilter);
+
+    obs_data_set_bool(g_plugin_data.settings, "early_trigger", g_plugin_data.early_trigger);
+    obs_data_set_int(g_plugin_data.settings, "early_stable_frames", g_plugin_data.early_stable_frames);
+    obs_data_set_int(g_plugin_data.settings, "endpoint_mode", g_plugin_data.endpoint_mode);
+    obs_data_set_int(g_plugin_data.settings, "trigger_cooldown_ms", g_plugin_data.trigger_cooldown_ms);
+    obs_data_set_int(g_plugin_data.settings, "stats_log_interval_s", g_plugin_data.stats_log_interval_s);
+    obs_data_set_bool(g_plugin_data.settings, "trace_enabled", g_plugin_data.trace_enabled);
 
     // Save to file
     if (obs_data_save_json(g_plugin_data.settings, path)) {
@@ -110,3 +318,47 @@ void garmin_save_settings(void)
         blog(LOG_ERROR, "[Garmin Replay] Failed to save settings to: %s", path);
     }
 }
+
+// "commands": [{"phrase": "clip that", "action": "save", "language": 0}, ...]
+// action defaults to "save"; without "language" a command applies to all
+command_table_t *garmin_load_commands(void)
+{
+    command_table_t *table = command_table_create();
+    if (!table) {
+        return NULL;
+    }
+
+    obs_data_array_t *commands = obs_data_get_array(g_plugin_data.settings, "commands");
+    size_t count = commands ? obs_data_array_count(commands) : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        obs_data_t *item = obs_data_array_item(commands, i);
+        const char *phrase = obs_data_get_string(item, "phrase");
+        const char *action_name = obs_data_get_string(item, "action");
+
+        enum garmin_action action = GARMIN_ACTION_SAVE;
+        if (action_name && *action_name && !garmin_action_from_name(action_name, &action)) {
+            blog(LOG_WARNING, "[Garmin Replay] Ignoring command '%s': unknown action '%s'",
+                 phrase, action_name);
+        } else if (!obs_data_has_user_value(item, "language") ||
+                   (int)obs_data_get_int(item, "language") == g_plugin_data.language) {
+            command_table_add(table, phrase, action);
+        }
+
+        obs_data_release(item);
+    }
+    obs_data_array_release(commands);
+
+    if (command_table_count(table) == 0) {
+        command_table_add_defaults(table, g_plugin_data.language);
+    }
+    if (!command_table_finish(table)) {
+        blog(LOG_WARNING, "[Garmin Replay] Failed to build the phrase index, matching commands one by one");
+    }
+
+    blog(LOG_INFO, "[Garmin Replay] %d voice command%s compiled, grammar of %d phrases",
+         command_table_count(table), command_table_count(table) == 1 ? "" : "s",
+         command_table_grammar_size(table));
+
+    return table;
+}
@@ -1,6 +1,8 @@
 #ifndef PLUGIN_SETTINGS_H
 #define PLUGIN_SETTINGS_H
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,6 +16,17 @@ void garmin_save_settings(void);
 // Get the settings config file path
 const char *garmin_get_settings_path(void);
 
+// Extra microphones to listen to, kept in g_plugin_data.extra_listeners
+// Returns: false if there are already GARMIN_MAX_LISTENERS - 1
+bool garmin_add_extra_listener(const char *name, const char *device_id);
+void garmin_clear_extra_listeners(void);
+
+typedef struct command_table command_table_t;
+
+// Compile the "commands" array of the settings for the current language
+// (built-in save phrase if there are none); caller destroys the table
+command_table_t *garmin_load_commands(void);
+
 #ifdef __cplusplus
 }
 #endif
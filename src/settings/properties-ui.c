@@ -2,10 +2,14 @@
 #include "plugin-settings.h"
 #include "../plugin-main.h"
 #include "../audio-capture/device-enum.h"
+#include "../voice-recognition/vad.h"
+#include "../voice-recognition/vosk-engine.h"
 
 #include <obs-module.h>
 #include <obs-frontend-api.h>
 
+#include <stdio.h>
+
 // Callback when enabled toggle changes
 static bool on_enabled_changed(obs_properties_t *props, obs_property_t *p,
                                obs_data_t *settings)
@@ -24,22 +28,13 @@ static bool on_enabled_changed(obs_properties_t *props, obs_property_t *p,
     return true;  // Refresh UI
 }
 
-// Callback for refresh devices button
-static bool on_refresh_devices(obs_properties_t *props, obs_property_t *p,
-                               void *data)
+// Default microphone, the devices, then OBS's own audio sources
+static void populate_devices(obs_property_t *device_list)
 {
-    (void)p;
-    (void)data;
-
-    obs_property_t *device_list = obs_properties_get(props, "device_id");
-    obs_property_list_clear(device_list);
-
-    // Add default option
     obs_property_list_add_string(device_list,
                                  obs_module_text("GarminReplay.DefaultMicrophone"),
                                  "");
 
-    // Enumerate and add microphones
     device_list_t *devices = device_enum_microphones();
     if (devices) {
         for (int i = 0; i < devices->count; i++) {
@@ -50,6 +45,29 @@ static bool on_refresh_devices(obs_properties_t *props, obs_property_t *p,
         device_list_free(devices);
     }
 
+    devices = device_enum_obs_sources();
+    if (devices) {
+        for (int i = 0; i < devices->count; i++) {
+            char label[MAX_DEVICE_NAME_LEN + 64];
+            snprintf(label, sizeof(label), "%s: %s", obs_module_text("GarminReplay.ObsSource"),
+                     devices->devices[i].name);
+            obs_property_list_add_string(device_list, label, devices->devices[i].id);
+        }
+        device_list_free(devices);
+    }
+}
+
+// Callback for refresh devices button
+static bool on_refresh_devices(obs_properties_t *props, obs_property_t *p,
+                               void *data)
+{
+    (void)p;
+    (void)data;
+
+    obs_property_t *device_list = obs_properties_get(props, "device_id");
+    obs_property_list_clear(device_list);
+    populate_devices(device_list);
+
     return true;  // Refresh UI
 }
 
@@ -65,6 +83,16 @@ static void on_settings_update(void *data, obs_data_t *settings)
     g_plugin_data.sensitivity = (int)obs_data_get_int(settings, "sensitivity");
     g_plugin_data.restart_mode = (int)obs_data_get_int(settings, "restart_mode");
     g_plugin_data.language = (int)obs_data_get_int(settings, "language");
+    g_plugin_data.echo_cancel = obs_data_get_bool(settings, "echo_cancel");
+    g_plugin_data.noise_suppress = obs_data_get_bool(settings, "noise_suppress");
+    g_plugin_data.auto_gain = obs_data_get_bool(settings, "auto_gain");
+    g_plugin_data.vad_enabled = obs_data_get_bool(settings, "vad_enabled");
+    g_plugin_data.vad_hangover_ms = (int)obs_data_get_int(settings, "vad_hangover_ms");
+    g_plugin_data.keyword_prefilter = obs_data_get_bool(settings, "keyword_prefilter");
+    g_plugin_data.early_trigger = obs_data_get_bool(settings, "early_trigger");
+    g_plugin_data.early_stable_frames = (int)obs_data_get_int(settings, "early_stable_frames");
+    g_plugin_data.endpoint_mode = (int)obs_data_get_int(settings, "endpoint_mode");
+    g_plugin_data.trigger_cooldown_ms = (int)obs_data_get_int(settings, "trigger_cooldown_ms");
 
     // Update device ID
     const char *device_id = obs_data_get_string(settings, "device_id");
@@ -113,21 +141,7 @@ obs_properties_t *garmin_get_properties(void *data)
                                 obs_module_text("GarminReplay.Microphone"),
                                 OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
 
-    // Add default option
-    obs_property_list_add_string(p,
-                                 obs_module_text("GarminReplay.DefaultMicrophone"),
-                                 "");
-
-    // Populate with available devices
-    device_list_t *devices = device_enum_microphones();
-    if (devices) {
-        for (int i = 0; i < devices->count; i++) {
-            obs_property_list_add_string(p,
-                                         devices->devices[i].name,
-                                         devices->devices[i].id);
-        }
-        device_list_free(devices);
-    }
+    populate_devices(p);
 
     // Refresh button
     obs_properties_add_button(props, "refresh_devices",
@@ -157,6 +171,52 @@ obs_properties_t *garmin_get_properties(void *data)
                                 OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
     obs_property_list_add_int(p, obs_module_text("GarminReplay.SaveOnly"), 0);
     obs_property_list_add_int(p, obs_module_text("GarminReplay.SaveAndRestart"), 1);
+    p = obs_properties_add_int(props, "trigger_cooldown_ms",
+                               obs_module_text("GarminReplay.Cooldown"),
+                               GARMIN_TRIGGER_COOLDOWN_MIN_MS, GARMIN_TRIGGER_COOLDOWN_MAX_MS, 100);
+    obs_property_int_set_suffix(p, " ms");
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.CooldownDesc"));
+
+    // === Echo Cancellation ===
+    p = obs_properties_add_bool(props, "echo_cancel",
+                                obs_module_text("GarminReplay.EchoCancel"));
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.EchoDesc"));
+
+    // === Microphone Cleanup ===
+    p = obs_properties_add_bool(props, "noise_suppress",
+                                obs_module_text("GarminReplay.NoiseSuppress"));
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.NoiseSuppressDesc"));
+    p = obs_properties_add_bool(props, "auto_gain",
+                                obs_module_text("GarminReplay.AutoGain"));
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.AutoGainDesc"));
+
+    // === Voice Activity Gate ===
+    obs_properties_add_bool(props, "vad_enabled",
+                            obs_module_text("GarminReplay.VadEnable"));
+    p = obs_properties_add_int(props, "vad_hangover_ms",
+                               obs_module_text("GarminReplay.VadHangover"),
+                               GARMIN_VAD_HANGOVER_MIN_MS, GARMIN_VAD_HANGOVER_MAX_MS, 100);
+    obs_property_int_set_suffix(p, " ms");
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.VadDesc"));
+    p = obs_properties_add_bool(props, "keyword_prefilter",
+                                obs_module_text("GarminReplay.KeywordPrefilter"));
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.KeywordPrefilterDesc"));
+
+    // === Response Time ===
+    obs_properties_add_bool(props, "early_trigger",
+                            obs_module_text("GarminReplay.EarlyTrigger"));
+    p = obs_properties_add_int(props, "early_stable_frames",
+                               obs_module_text("GarminReplay.EarlyStable"),
+                               GARMIN_EARLY_STABLE_MIN_FRAMES,
+                               GARMIN_EARLY_STABLE_MAX_FRAMES, 1);
+    obs_property_set_long_description(p, obs_module_text("GarminReplay.EarlyDesc"));
+    p = obs_properties_add_list(props, "endpoint_mode",
+                                obs_module_text("GarminReplay.Endpoint"),
+                                OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(p, obs_module_text("GarminReplay.EndpointDefault"), VOSK_ENDPOINT_DEFAULT);
+    obs_property_list_add_int(p, obs_module_text("GarminReplay.EndpointShort"), VOSK_ENDPOINT_SHORT);
+    obs_property_list_add_int(p, obs_module_text("GarminReplay.EndpointLong"), VOSK_ENDPOINT_LONG);
+    obs_property_list_add_int(p, obs_module_text("GarminReplay.EndpointVeryLong"), VOSK_ENDPOINT_VERY_LONG);
 
     // === Trigger Phrases Info ===
     obs_properties_add_text(props, "phrases_info",
@@ -173,6 +233,16 @@ void garmin_get_defaults(obs_data_t *settings)
     obs_data_set_default_int(settings, "sensitivity", 70);
     obs_data_set_default_int(settings, "restart_mode", 0);
     obs_data_set_default_int(settings, "language", GARMIN_LANG_ENGLISH);
+    obs_data_set_default_bool(settings, "echo_cancel", false);
+    obs_data_set_default_bool(settings, "noise_suppress", false);
+    obs_data_set_default_bool(settings, "auto_gain", false);
+    obs_data_set_default_bool(settings, "vad_enabled", true);
+    obs_data_set_default_int(settings, "vad_hangover_ms", VAD_DEFAULT_HANGOVER_MS);
+    obs_data_set_default_bool(settings, "keyword_prefilter", false);
+    obs_data_set_default_bool(settings, "early_trigger", false);
+    obs_data_set_default_int(settings, "early_stable_frames", GARMIN_EARLY_STABLE_DEFAULT_FRAMES);
+    obs_data_set_default_int(settings, "endpoint_mode", VOSK_ENDPOINT_DEFAULT);
+    obs_data_set_default_int(settings, "trigger_cooldown_ms", GARMIN_TRIGGER_COOLDOWN_DEFAULT_MS);
 }
 
 // Dialog close callback
@@ -190,6 +260,16 @@ void garmin_show_settings_dialog(void)
     obs_data_set_int(settings, "sensitivity", g_plugin_data.sensitivity);
     obs_data_set_int(settings, "restart_mode", g_plugin_data.restart_mode);
     obs_data_set_int(settings, "language", g_plugin_data.language);
+    obs_data_set_bool(settings, "echo_cancel", g_plugin_data.echo_cancel);
+    obs_data_set_bool(settings, "noise_suppress", g_plugin_data.noise_suppress);
+    obs_data_set_bool(settings, "auto_gain", g_plugin_data.auto_gain);
+    obs_data_set_bool(settings, "vad_enabled", g_plugin_data.vad_enabled);
+    obs_data_set_int(settings, "vad_hangover_ms", g_plugin_data.vad_hangover_ms);
+    obs_data_set_bool(settings, "keyword_prefilter", g_plugin_data.keyword_prefilter);
+    obs_data_set_bool(settings, "early_trigger", g_plugin_data.early_trigger);
+    obs_data_set_int(settings, "early_stable_frames", g_plugin_data.early_stable_frames);
+    obs_data_set_int(settings, "endpoint_mode", g_plugin_data.endpoint_mode);
+    obs_data_set_int(settings, "trigger_cooldown_ms", g_plugin_data.trigger_cooldown_ms);
 
     if (g_plugin_data.device_id) {
         obs_data_set_string(settings, "device_id", g_plugin_data.device_id);
@@ -2,6 +2,9 @@
 #include "plugin-settings.h"
 #include "../plugin-main.h"
 #include "../audio-capture/device-enum.h"
+#include "../voice-recognition/vosk-engine.h"
+#include "../diagnostics/pipeline-stats.h"
+#include "../diagnostics/trace.h"
 
 #include <obs-module.h>
 #include <obs-frontend-api.h>
@@ -13,10 +16,13 @@
 #include <QCheckBox>
 #include <QComboBox>
 #include <QSlider>
+#include <QSpinBox>
 #include <QPushButton>
 #include <QGroupBox>
 #include <QMessageBox>
 #include <QIcon>
+#include <QTimer>
+#include <QFontDatabase>
 
 // Settings dialog class
 class GarminSettingsDialog : public QDialog {
@@ -29,20 +35,37 @@ private:
     void loadSettings();
     void saveSettings();
     void refreshDevices();
+    void fillDeviceCombo(QComboBox *combo);
     void onOkClicked();
     void onApplyClicked();
     void onCancelClicked();
     void onSensitivityChanged(int value);
+    void updateStats();
+#ifdef GARMIN_ENABLE_TRACE
+    void saveTrace();
+#endif
 
     // UI elements
     QCheckBox *enabledCheck;
     QComboBox *deviceCombo;
+    QComboBox *extraDeviceCombo;
     QPushButton *refreshBtn;
     QComboBox *languageCombo;
     QSlider *sensitivitySlider;
     QLabel *sensitivityLabel;
     QComboBox *restartModeCombo;
+    QSpinBox *cooldownSpin;
+    QCheckBox *echoCheck;
+    QCheckBox *noiseCheck;
+    QCheckBox *autoGainCheck;
+    QCheckBox *vadCheck;
+    QSpinBox *vadHangoverSpin;
+    QCheckBox *keywordCheck;
+    QCheckBox *earlyCheck;
+    QSpinBox *earlyStableSpin;
+    QComboBox *endpointCombo;
     QLabel *statusLabel;
+    QLabel *statsLabel;
 };
 
 GarminSettingsDialog::GarminSettingsDialog(QWidget *parent)
@@ -54,6 +77,12 @@ GarminSettingsDialog::GarminSettingsDialog(QWidget *parent)
 
     setupUI();
     loadSettings();
+
+    // The dialog is deleted on close, so this only runs while it is shown
+    QTimer *statsTimer = new QTimer(this);
+    connect(statsTimer, &QTimer::timeout, this, &GarminSettingsDialog::updateStats);
+    statsTimer->start(1000);
+    updateStats();
 }
 
 GarminSettingsDialog::~GarminSettingsDialog()
@@ -88,6 +117,14 @@ void GarminSettingsDialog::setupUI()
     deviceLayout->addWidget(refreshBtn);
     audioLayout->addLayout(deviceLayout);
 
+    // A second microphone (co-host) with its own recognizer
+    QHBoxLayout *extraDeviceLayout = new QHBoxLayout();
+    extraDeviceLayout->addWidget(new QLabel(obs_module_text("GarminReplay.AlsoListenTo")));
+    extraDeviceCombo = new QComboBox();
+    extraDeviceCombo->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    extraDeviceLayout->addWidget(extraDeviceCombo);
+    audioLayout->addLayout(extraDeviceLayout);
+
     mainLayout->addWidget(audioGroup);
 
     // === Language Section ===
@@ -142,8 +179,117 @@ void GarminSettingsDialog::setupUI()
     restartModeCombo->addItem(obs_module_text("GarminReplay.SaveAndRestart"), 1);
     saveLayout->addWidget(restartModeCombo);
 
+    QHBoxLayout *cooldownLayout = new QHBoxLayout();
+    cooldownLayout->addWidget(new QLabel(obs_module_text("GarminReplay.Cooldown")));
+    cooldownSpin = new QSpinBox();
+    cooldownSpin->setRange(GARMIN_TRIGGER_COOLDOWN_MIN_MS, GARMIN_TRIGGER_COOLDOWN_MAX_MS);
+    cooldownSpin->setSingleStep(100);
+    cooldownSpin->setSuffix(" ms");
+    cooldownLayout->addWidget(cooldownSpin);
+    saveLayout->addLayout(cooldownLayout);
+
+    QLabel *cooldownDesc = new QLabel(obs_module_text("GarminReplay.CooldownDesc"));
+    cooldownDesc->setWordWrap(true);
+    cooldownDesc->setStyleSheet("color: gray; font-size: 10px;");
+    saveLayout->addWidget(cooldownDesc);
+
     mainLayout->addWidget(saveGroup);
 
+    // === Echo Cancellation Section ===
+    QGroupBox *echoGroup = new QGroupBox(obs_module_text("GarminReplay.EchoCancellation"));
+    QVBoxLayout *echoLayout = new QVBoxLayout(echoGroup);
+
+    echoCheck = new QCheckBox(obs_module_text("GarminReplay.EchoCancel"));
+    echoLayout->addWidget(echoCheck);
+
+    QLabel *echoDesc = new QLabel(obs_module_text("GarminReplay.EchoDesc"));
+    echoDesc->setWordWrap(true);
+    echoDesc->setStyleSheet("color: gray; font-size: 10px;");
+    echoLayout->addWidget(echoDesc);
+
+    mainLayout->addWidget(echoGroup);
+
+    // === Microphone Cleanup Section ===
+    QGroupBox *cleanupGroup = new QGroupBox(obs_module_text("GarminReplay.MicCleanup"));
+    QVBoxLayout *cleanupLayout = new QVBoxLayout(cleanupGroup);
+
+    noiseCheck = new QCheckBox(obs_module_text("GarminReplay.NoiseSuppress"));
+    cleanupLayout->addWidget(noiseCheck);
+
+    autoGainCheck = new QCheckBox(obs_module_text("GarminReplay.AutoGain"));
+    cleanupLayout->addWidget(autoGainCheck);
+
+    QLabel *cleanupDesc = new QLabel(obs_module_text("GarminReplay.MicCleanupDesc"));
+    cleanupDesc->setWordWrap(true);
+    cleanupDesc->setStyleSheet("color: gray; font-size: 10px;");
+    cleanupLayout->addWidget(cleanupDesc);
+
+    mainLayout->addWidget(cleanupGroup);
+
+    // === Voice Activity Section ===
+    QGroupBox *vadGroup = new QGroupBox(obs_module_text("GarminReplay.VoiceActivity"));
+    QVBoxLayout *vadLayout = new QVBoxLayout(vadGroup);
+
+    vadCheck = new QCheckBox(obs_module_text("GarminReplay.VadEnable"));
+    vadLayout->addWidget(vadCheck);
+
+    QHBoxLayout *hangoverLayout = new QHBoxLayout();
+    hangoverLayout->addWidget(new QLabel(obs_module_text("GarminReplay.VadHangover")));
+    vadHangoverSpin = new QSpinBox();
+    vadHangoverSpin->setRange(GARMIN_VAD_HANGOVER_MIN_MS, GARMIN_VAD_HANGOVER_MAX_MS);
+    vadHangoverSpin->setSingleStep(100);
+    vadHangoverSpin->setSuffix(" ms");
+    hangoverLayout->addWidget(vadHangoverSpin);
+    vadLayout->addLayout(hangoverLayout);
+    connect(vadCheck, &QCheckBox::toggled, vadHangoverSpin, &QSpinBox::setEnabled);
+
+    QLabel *vadDesc = new QLabel(obs_module_text("GarminReplay.VadDesc"));
+    vadDesc->setWordWrap(true);
+    vadDesc->setStyleSheet("color: gray; font-size: 10px;");
+    vadLayout->addWidget(vadDesc);
+
+    keywordCheck = new QCheckBox(obs_module_text("GarminReplay.KeywordPrefilter"));
+    vadLayout->addWidget(keywordCheck);
+
+    QLabel *keywordDesc = new QLabel(obs_module_text("GarminReplay.KeywordPrefilterDesc"));
+    keywordDesc->setWordWrap(true);
+    keywordDesc->setStyleSheet("color: gray; font-size: 10px;");
+    vadLayout->addWidget(keywordDesc);
+
+    mainLayout->addWidget(vadGroup);
+
+    // === Response Time Section ===
+    QGroupBox *latencyGroup = new QGroupBox(obs_module_text("GarminReplay.ResponseTime"));
+    QVBoxLayout *latencyLayout = new QVBoxLayout(latencyGroup);
+
+    earlyCheck = new QCheckBox(obs_module_text("GarminReplay.EarlyTrigger"));
+    latencyLayout->addWidget(earlyCheck);
+
+    QHBoxLayout *stableLayout = new QHBoxLayout();
+    stableLayout->addWidget(new QLabel(obs_module_text("GarminReplay.EarlyStable")));
+    earlyStableSpin = new QSpinBox();
+    earlyStableSpin->setRange(GARMIN_EARLY_STABLE_MIN_FRAMES, GARMIN_EARLY_STABLE_MAX_FRAMES);
+    stableLayout->addWidget(earlyStableSpin);
+    latencyLayout->addLayout(stableLayout);
+    connect(earlyCheck, &QCheckBox::toggled, earlyStableSpin, &QSpinBox::setEnabled);
+
+    QHBoxLayout *endpointLayout = new QHBoxLayout();
+    endpointLayout->addWidget(new QLabel(obs_module_text("GarminReplay.Endpoint")));
+    endpointCombo = new QComboBox();
+    endpointCombo->addItem(obs_module_text("GarminReplay.EndpointDefault"), VOSK_ENDPOINT_DEFAULT);
+    endpointCombo->addItem(obs_module_text("GarminReplay.EndpointShort"), VOSK_ENDPOINT_SHORT);
+    endpointCombo->addItem(obs_module_text("GarminReplay.EndpointLong"), VOSK_ENDPOINT_LONG);
+    endpointCombo->addItem(obs_module_text("GarminReplay.EndpointVeryLong"), VOSK_ENDPOINT_VERY_LONG);
+    endpointLayout->addWidget(endpointCombo);
+    latencyLayout->addLayout(endpointLayout);
+
+    QLabel *earlyDesc = new QLabel(obs_module_text("GarminReplay.EarlyDesc"));
+    earlyDesc->setWordWrap(true);
+    earlyDesc->setStyleSheet("color: gray; font-size: 10px;");
+    latencyLayout->addWidget(earlyDesc);
+
+    mainLayout->addWidget(latencyGroup);
+
     // === Status Section ===
     QGroupBox *statusGroup = new QGroupBox(obs_module_text("GarminReplay.Status"));
     QVBoxLayout *statusLayout = new QVBoxLayout(statusGroup);
@@ -153,6 +299,23 @@ void GarminSettingsDialog::setupUI()
 
     mainLayout->addWidget(statusGroup);
 
+    // === Pipeline Statistics Section ===
+    QGroupBox *statsGroup = new QGroupBox(obs_module_text("GarminReplay.Stats"));
+    QVBoxLayout *statsLayout = new QVBoxLayout(statsGroup);
+
+    statsLabel = new QLabel();
+    statsLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    statsLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    statsLayout->addWidget(statsLabel);
+
+#ifdef GARMIN_ENABLE_TRACE
+    QPushButton *traceBtn = new QPushButton(obs_module_text("GarminReplay.SaveTrace"));
+    connect(traceBtn, &QPushButton::clicked, this, &GarminSettingsDialog::saveTrace);
+    statsLayout->addWidget(traceBtn, 0, Qt::AlignLeft);
+#endif
+
+    mainLayout->addWidget(statsGroup);
+
     // === Buttons ===
     mainLayout->addStretch();
 
@@ -181,19 +344,41 @@ void GarminSettingsDialog::setupUI()
 
 void GarminSettingsDialog::refreshDevices()
 {
-    deviceCombo->clear();
-    deviceCombo->addItem(obs_module_text("GarminReplay.DefaultMicrophone"), QString(""));
+    fillDeviceCombo(deviceCombo);
+
+    // No data marks "None"; an empty ID is the default microphone
+    fillDeviceCombo(extraDeviceCombo);
+    extraDeviceCombo->insertItem(0, obs_module_text("GarminReplay.None"), QVariant());
+}
+
+void GarminSettingsDialog::fillDeviceCombo(QComboBox *combo)
+{
+    combo->clear();
+    combo->addItem(obs_module_text("GarminReplay.DefaultMicrophone"), QString(""));
 
     device_list_t *devices = device_enum_microphones();
     if (devices) {
         for (int i = 0; i < devices->count; i++) {
-            deviceCombo->addItem(
+            combo->addItem(
                 QString::fromUtf8(devices->devices[i].name),
                 QString::fromUtf8(devices->devices[i].id)
             );
         }
         device_list_free(devices);
     }
+
+    // Sources OBS already captures, filters applied
+    devices = device_enum_obs_sources();
+    if (devices) {
+        for (int i = 0; i < devices->count; i++) {
+            combo->addItem(
+                QString("%1: %2").arg(QString::fromUtf8(obs_module_text("GarminReplay.ObsSource")),
+                                      QString::fromUtf8(devices->devices[i].name)),
+                QString::fromUtf8(devices->devices[i].id)
+            );
+        }
+        device_list_free(devices);
+    }
 }
 
 void GarminSettingsDialog::loadSettings()
@@ -208,6 +393,15 @@ void GarminSettingsDialog::loadSettings()
         deviceCombo->setCurrentIndex(deviceIndex);
     }
 
+    // Only the first extra listener has a control; more can be set in the
+    // settings file
+    int extraIndex = 0;
+    if (g_plugin_data.extra_listener_count > 0) {
+        const char *extraDevice = g_plugin_data.extra_listeners[0].device_id;
+        extraIndex = extraDeviceCombo->findData(QString::fromUtf8(extraDevice ? extraDevice : ""));
+    }
+    extraDeviceCombo->setCurrentIndex(extraIndex >= 0 ? extraIndex : 0);
+
     // Select current language
     int langIndex = languageCombo->findData(g_plugin_data.language);
     if (langIndex >= 0) {
@@ -222,6 +416,24 @@ void GarminSettingsDialog::loadSettings()
     if (modeIndex >= 0) {
         restartModeCombo->setCurrentIndex(modeIndex);
     }
+    cooldownSpin->setValue(g_plugin_data.trigger_cooldown_ms);
+
+    echoCheck->setChecked(g_plugin_data.echo_cancel);
+    noiseCheck->setChecked(g_plugin_data.noise_suppress);
+    autoGainCheck->setChecked(g_plugin_data.auto_gain);
+
+    vadCheck->setChecked(g_plugin_data.vad_enabled);
+    vadHangoverSpin->setValue(g_plugin_data.vad_hangover_ms);
+    vadHangoverSpin->setEnabled(g_plugin_data.vad_enabled);
+    keywordCheck->setChecked(g_plugin_data.keyword_prefilter);
+
+    earlyCheck->setChecked(g_plugin_data.early_trigger);
+    earlyStableSpin->setValue(g_plugin_data.early_stable_frames);
+    earlyStableSpin->setEnabled(g_plugin_data.early_trigger);
+    int endpointIndex = endpointCombo->findData(g_plugin_data.endpoint_mode);
+    if (endpointIndex >= 0) {
+        endpointCombo->setCurrentIndex(endpointIndex);
+    }
 
     // Update status
     if (g_plugin_data.enabled && g_plugin_data.thread_running) {
@@ -240,12 +452,35 @@ void GarminSettingsDialog::saveSettings()
 {
     bool wasEnabled = g_plugin_data.enabled;
     int oldLanguage = g_plugin_data.language;
+    bool oldEchoCancel = g_plugin_data.echo_cancel;
+    bool oldNoiseSuppress = g_plugin_data.noise_suppress;
+    bool oldAutoGain = g_plugin_data.auto_gain;
+    bool oldVadEnabled = g_plugin_data.vad_enabled;
+    int oldVadHangover = g_plugin_data.vad_hangover_ms;
+    bool oldKeywordPrefilter = g_plugin_data.keyword_prefilter;
+    bool oldEarlyTrigger = g_plugin_data.early_trigger;
+    int oldEarlyStable = g_plugin_data.early_stable_frames;
+    int oldEndpointMode = g_plugin_data.endpoint_mode;
+    QString oldDeviceId = QString::fromUtf8(g_plugin_data.device_id ? g_plugin_data.device_id : "");
+    bool oldHasExtra = g_plugin_data.extra_listener_count > 0;
+    QString oldExtraDeviceId = oldHasExtra && g_plugin_data.extra_listeners[0].device_id ?
+        QString::fromUtf8(g_plugin_data.extra_listeners[0].device_id) : QString("");
 
     // Update plugin state
     g_plugin_data.enabled = enabledCheck->isChecked();
     g_plugin_data.sensitivity = sensitivitySlider->value();
     g_plugin_data.language = languageCombo->currentData().toInt();
     g_plugin_data.restart_mode = restartModeCombo->currentData().toInt();
+    g_plugin_data.trigger_cooldown_ms = cooldownSpin->value();
+    g_plugin_data.echo_cancel = echoCheck->isChecked();
+    g_plugin_data.noise_suppress = noiseCheck->isChecked();
+    g_plugin_data.auto_gain = autoGainCheck->isChecked();
+    g_plugin_data.vad_enabled = vadCheck->isChecked();
+    g_plugin_data.vad_hangover_ms = vadHangoverSpin->value();
+    g_plugin_data.keyword_prefilter = keywordCheck->isChecked();
+    g_plugin_data.early_trigger = earlyCheck->isChecked();
+    g_plugin_data.early_stable_frames = earlyStableSpin->value();
+    g_plugin_data.endpoint_mode = endpointCombo->currentData().toInt();
 
     // Update device ID
     if (g_plugin_data.device_id) {
@@ -257,18 +492,53 @@ void GarminSettingsDialog::saveSettings()
         g_plugin_data.device_id = bstrdup(deviceId.toUtf8().constData());
     }
 
+    // Replace the first extra listener, keeping any others from the file
+    QVariant extraData = extraDeviceCombo->currentData();
+    bool hasExtra = extraData.isValid();
+    QString extraDeviceId = hasExtra ? extraData.toString() : QString("");
+    bool extraChanged = hasExtra != oldHasExtra || extraDeviceId != oldExtraDeviceId;
+    if (extraChanged) {
+        QList<QPair<QByteArray, QByteArray>> others;
+        for (int i = 1; i < g_plugin_data.extra_listener_count; i++) {
+            const struct garmin_listener_config *other = &g_plugin_data.extra_listeners[i];
+            others.append(qMakePair(QByteArray(other->name ? other->name : ""),
+                                    QByteArray(other->device_id ? other->device_id : "")));
+        }
+
+        garmin_clear_extra_listeners();
+        if (hasExtra) {
+            garmin_add_extra_listener(extraDeviceCombo->currentText().toUtf8().constData(),
+                                      extraDeviceId.toUtf8().constData());
+        }
+        for (const auto &other : others) {
+            garmin_add_extra_listener(other.first.constData(), other.second.constData());
+        }
+    }
+
     // Save to file
     garmin_save_settings();
 
-    // Handle enable/disable and language changes
-    bool needsRestart = (g_plugin_data.language != oldLanguage) && g_plugin_data.enabled;
+    // Handle enable/disable, device, language, echo, cleanup, VAD, keyword
+    // prefilter and response time changes
+    bool needsRestart = (g_plugin_data.language != oldLanguage ||
+                         deviceId != oldDeviceId || extraChanged ||
+                         g_plugin_data.echo_cancel != oldEchoCancel ||
+                         g_plugin_data.noise_suppress != oldNoiseSuppress ||
+                         g_plugin_data.auto_gain != oldAutoGain ||
+                         g_plugin_data.vad_enabled != oldVadEnabled ||
+                         g_plugin_data.vad_hangover_ms != oldVadHangover ||
+                         g_plugin_data.keyword_prefilter != oldKeywordPrefilter ||
+                         g_plugin_data.early_trigger != oldEarlyTrigger ||
+                         g_plugin_data.early_stable_frames != oldEarlyStable ||
+                         g_plugin_data.endpoint_mode != oldEndpointMode) &&
+                        g_plugin_data.enabled;
 
     if (g_plugin_data.enabled && !wasEnabled) {
         start_voice_recognition();
     } else if (!g_plugin_data.enabled && wasEnabled) {
         stop_voice_recognition();
     } else if (needsRestart) {
-        // Restart to load new language model
+        // Restart to load new language model / recognition settings
         stop_voice_recognition();
         start_voice_recognition();
     }
@@ -277,6 +547,48 @@ void GarminSettingsDialog::saveSettings()
     loadSettings();
 }
 
+// Per-stage latency and per-listener cost since recognition last started
+void GarminSettingsDialog::updateStats()
+{
+    if (!g_plugin_data.thread_running) {
+        statsLabel->setText(obs_module_text("GarminReplay.StatsIdle"));
+        return;
+    }
+
+    struct pipeline_stats_snapshot snapshot;
+    pipeline_stats_snapshot(&snapshot);
+
+    char text[1024];
+    pipeline_stats_format(&snapshot, text, sizeof(text));
+
+    // Then what each microphone costs
+    char listeners[1024];
+    garmin_format_listener_stats(listeners, sizeof(listeners));
+    statsLabel->setText(QString::fromUtf8(text) + "\n\n" + QString::fromUtf8(listeners));
+}
+
+#ifdef GARMIN_ENABLE_TRACE
+// Everything still in the trace ring, for chrome://tracing or Perfetto
+void GarminSettingsDialog::saveTrace()
+{
+    if (!trace_is_enabled()) {
+        QMessageBox::information(this, obs_module_text("GarminReplay.SaveTrace"),
+                                 obs_module_text("GarminReplay.TraceOff"));
+        return;
+    }
+
+    char path[512];
+    if (garmin_save_trace(0, path, sizeof(path))) {
+        QMessageBox::information(this, obs_module_text("GarminReplay.SaveTrace"),
+                                 QString(obs_module_text("GarminReplay.TraceSaved"))
+                                     .arg(QString::fromUtf8(path)));
+    } else {
+        QMessageBox::warning(this, obs_module_text("GarminReplay.SaveTrace"),
+                             obs_module_text("GarminReplay.TraceFailed"));
+    }
+}
+#endif
+
 void GarminSettingsDialog::onSensitivityChanged(int value)
 {
     sensitivityLabel->setText(QString::number(value));
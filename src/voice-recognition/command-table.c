@@ -0,0 +1,320 @@
+#include "command-table.h"
+#include "phrase-index.h"
+#include "../compat/obs-compat.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Built-in trigger phrases - using only the distinctive parts that models recognize
+// "Garmin" is a brand name that smaller models often don't recognize
+static const char *DEFAULT_PHRASES[] = {
+    "save video",         // English (garmin often recognized, but "save video" is key)
+    "video speichern",    // German (garmin not in vocabulary)
+    "enregistrer video"   // French (garmin may not be recognized)
+};
+static const int NUM_DEFAULT_PHRASES = 3;
+
+static const char *ACTION_NAMES[GARMIN_ACTION_COUNT] = {
+    "save", "start_buffer", "stop_buffer", "save_and_restart", "screenshot",
+};
+
+// Spoken on its own or in front of any command
+#define WAKE_WORD "garmin"
+
+// Closes every grammar: the bare wake word and the catch-all for anything else
+#define GRAMMAR_TAIL "\"" WAKE_WORD "\", \"[unk]\"]"
+
+struct command_table {
+    struct garmin_command *commands;
+    int count;
+    int capacity;
+
+    // "[entries..., GRAMMAR_TAIL"; the tail is rewritten on every add
+    char *grammar;
+    size_t grammar_body_len;
+    size_t grammar_capacity;
+    int grammar_size;
+
+    // Word-level index over the normalized texts, ids = command indices
+    phrase_index_t *index;
+};
+
+command_table_t *command_table_create(void)
+{
+    command_table_t *table = calloc(1, sizeof(command_table_t));
+    if (!table) {
+        return NULL;
+    }
+
+    table->grammar_capacity = 256;
+    table->grammar = malloc(table->grammar_capacity);
+    table->index = phrase_index_create();
+    if (!table->grammar || !table->index) {
+        free(table->grammar);
+        phrase_index_destroy(table->index);
+        free(table);
+        return NULL;
+    }
+    table->grammar[0] = '[';
+    table->grammar_body_len = 1;
+    memcpy(table->grammar + 1, GRAMMAR_TAIL, sizeof(GRAMMAR_TAIL));
+    table->grammar_size = 2;
+
+    return table;
+}
+
+// Characters a vocabulary word can contain: letters and digits, the
+// apostrophes and hyphens of "aujourd'hui" or "peut-etre", and any UTF-8 byte
+static bool is_word_char(unsigned char c)
+{
+    return isalnum(c) || c == '\'' || c == '-' || c >= 0x80;
+}
+
+// Grammar form: ASCII lowercase words separated by single spaces. Anything
+// else (punctuation, quotes that would need JSON escaping) splits words,
+// since the model's vocabulary has no entries containing it.
+static int clean_phrase(const char *input, char *output, int max_len)
+{
+    int j = 0;
+    bool pending_space = false;
+
+    for (const unsigned char *p = (const unsigned char *)input; *p; p++) {
+        if (!is_word_char(*p)) {
+            pending_space = j > 0;
+            continue;
+        }
+        if (j + (pending_space ? 2 : 1) > max_len) {
+            return -1;
+        }
+        if (pending_space) {
+            output[j++] = ' ';
+            pending_space = false;
+        }
+        output[j++] = (char)tolower(*p);
+    }
+
+    output[j] = '\0';
+    return j;
+}
+
+// Same folding phrase-detector applies to recognized text, so a command is
+// compared against exactly what a result normalizes to
+static int normalize_phrase(const char *input, char *output, int max_len)
+{
+    int j = 0;
+    bool last_was_space = false;
+
+    for (const unsigned char *p = (const unsigned char *)input; *p && j < max_len - 1; p++) {
+        if (isalnum(*p)) {
+            output[j++] = (char)tolower(*p);
+            last_was_space = false;
+        } else if ((isspace(*p) || *p == ',' || *p == '.') && !last_was_space && j > 0) {
+            output[j++] = ' ';
+            last_was_space = true;
+        }
+    }
+
+    if (j > 0 && output[j - 1] == ' ') {
+        j--;
+    }
+
+    output[j] = '\0';
+    return j;
+}
+
+static bool grammar_reserve(command_table_t *table, size_t extra)
+{
+    size_t needed = table->grammar_body_len + extra + sizeof(GRAMMAR_TAIL);
+    if (needed <= table->grammar_capacity) {
+        return true;
+    }
+
+    size_t capacity = table->grammar_capacity * 2;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    char *grammar = realloc(table->grammar, capacity);
+    if (!grammar) {
+        return false;
+    }
+    table->grammar = grammar;
+    table->grammar_capacity = capacity;
+    return true;
+}
+
+// Append `"prefix phrase", ` to the grammar body
+static void grammar_append(command_table_t *table, const char *prefix, const char *phrase)
+{
+    char *out = table->grammar + table->grammar_body_len;
+    size_t prefix_len = strlen(prefix);
+    size_t phrase_len = strlen(phrase);
+
+    *out++ = '"';
+    memcpy(out, prefix, prefix_len);
+    out += prefix_len;
+    memcpy(out, phrase, phrase_len);
+    out += phrase_len;
+    memcpy(out, "\", ", 3);
+
+    table->grammar_body_len += prefix_len + phrase_len + 4;
+    table->grammar_size++;
+}
+
+bool command_table_add(command_table_t *table, const char *phrase, enum garmin_action action)
+{
+    if (!table || !phrase || (unsigned int)action >= GARMIN_ACTION_COUNT) {
+        return false;
+    }
+
+    char cleaned[COMMAND_PHRASE_MAX + 1];
+    char normalized[COMMAND_PHRASE_MAX + 1];
+    if (clean_phrase(phrase, cleaned, COMMAND_PHRASE_MAX) <= 0 ||
+        normalize_phrase(cleaned, normalized, sizeof(normalized)) <= 0) {
+        blog(LOG_WARNING, "[Garmin Replay] Ignoring command phrase '%s': empty or longer than %d characters",
+             phrase, COMMAND_PHRASE_MAX);
+        return false;
+    }
+
+    if (table->count >= COMMAND_TABLE_MAX) {
+        blog(LOG_WARNING, "[Garmin Replay] Ignoring command phrase '%s': more than %d commands",
+             cleaned, COMMAND_TABLE_MAX);
+        return false;
+    }
+
+    // Grammar entries are the bare phrase and "garmin <phrase>"; the only
+    // way two commands can produce the same entry is "x" and "garmin x"
+    const char *unprefixed = strncmp(cleaned, WAKE_WORD " ", sizeof(WAKE_WORD)) == 0 ?
+        cleaned + sizeof(WAKE_WORD) : NULL;
+    bool add_bare = strcmp(cleaned, WAKE_WORD) != 0;
+    bool add_wake = add_bare && !unprefixed;
+
+    for (int i = 0; i < table->count; i++) {
+        const char *other = table->commands[i].phrase;
+        if (strcmp(table->commands[i].text, normalized) == 0) {
+            blog(LOG_WARNING, "[Garmin Replay] Ignoring duplicate command phrase '%s'", cleaned);
+            return false;
+        }
+        if (unprefixed && strcmp(other, unprefixed) == 0) {
+            add_bare = false;
+        }
+        if (strncmp(other, WAKE_WORD " ", sizeof(WAKE_WORD)) == 0 &&
+            strcmp(other + sizeof(WAKE_WORD), cleaned) == 0) {
+            add_wake = false;
+        }
+    }
+
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 8;
+        struct garmin_command *commands = realloc(table->commands,
+                                                  (size_t)capacity * sizeof(struct garmin_command));
+        if (!commands) {
+            return false;
+        }
+        table->commands = commands;
+        table->capacity = capacity;
+    }
+
+    if (!grammar_reserve(table, 2 * (strlen(cleaned) + sizeof(WAKE_WORD) + 4)) ||
+        !phrase_index_add(table->index, normalized, table->count)) {
+        return false;
+    }
+
+    struct garmin_command *command = &table->commands[table->count];
+    memset(command, 0, sizeof(*command));
+    command->phrase = bstrdup(cleaned);
+    command->text = bstrdup(normalized);
+    command->action = action;
+    fuzzy_pattern_compile(&command->pattern, normalized);
+    table->count++;
+
+    if (add_wake) {
+        grammar_append(table, WAKE_WORD " ", cleaned);
+    }
+    if (add_bare) {
+        grammar_append(table, "", cleaned);
+    }
+    memcpy(table->grammar + table->grammar_body_len, GRAMMAR_TAIL, sizeof(GRAMMAR_TAIL));
+
+    return true;
+}
+
+bool command_table_add_defaults(command_table_t *table, int language)
+{
+    // 0 = English, 1 = German, 2 = French
+    if (language < 0 || language >= NUM_DEFAULT_PHRASES) {
+        language = 0;  // Default to English
+    }
+    return command_table_add(table, DEFAULT_PHRASES[language], GARMIN_ACTION_SAVE);
+}
+
+bool command_table_finish(command_table_t *table)
+{
+    return table && phrase_index_build(table->index);
+}
+
+const phrase_index_t *command_table_index(const command_table_t *table)
+{
+    return table && phrase_index_is_built(table->index) ? table->index : NULL;
+}
+
+int command_table_count(const command_table_t *table)
+{
+    return table ? table->count : 0;
+}
+
+const struct garmin_command *command_table_get(const command_table_t *table, int index)
+{
+    if (!table || index < 0 || index >= table->count) {
+        return NULL;
+    }
+    return &table->commands[index];
+}
+
+const char *command_table_grammar(const command_table_t *table)
+{
+    return table ? table->grammar : NULL;
+}
+
+int command_table_grammar_size(const command_table_t *table)
+{
+    return table ? table->grammar_size : 0;
+}
+
+void command_table_destroy(command_table_t *table)
+{
+    if (!table) {
+        return;
+    }
+
+    for (int i = 0; i < table->count; i++) {
+        bfree(table->commands[i].phrase);
+        bfree(table->commands[i].text);
+    }
+    free(table->commands);
+    free(table->grammar);
+    phrase_index_destroy(table->index);
+    free(table);
+}
+
+const char *garmin_action_name(enum garmin_action action)
+{
+    if ((unsigned int)action >= GARMIN_ACTION_COUNT) {
+        return "unknown";
+    }
+    return ACTION_NAMES[action];
+}
+
+bool garmin_action_from_name(const char *name, enum garmin_action *action)
+{
+    if (!name) {
+        return false;
+    }
+    for (int i = 0; i < GARMIN_ACTION_COUNT; i++) {
+        if (strcmp(name, ACTION_NAMES[i]) == 0) {
+            *action = (enum garmin_action)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,76 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include "fuzzy-match.h"
+
+#include <stdbool.h>
+
+// Voice commands for one recognition run: phrase -> action. The table is
+// filled once when recognition starts and read-only afterwards; the Vosk
+// grammar and the fuzzy patterns are compiled as phrases are added and the
+// phrase index once the last one is in, so the per-result cost is only the
+// matching itself.
+
+// Longest accepted phrase, bounded by the fuzzy matcher
+#define COMMAND_PHRASE_MAX FUZZY_PATTERN_MAX
+
+// Upper bound on table size, to keep a broken settings file from building
+// a grammar Vosk can't handle
+#define COMMAND_TABLE_MAX 1024
+
+enum garmin_action {
+    GARMIN_ACTION_SAVE,               // Save (or save and restart, per restart_mode)
+    GARMIN_ACTION_START_BUFFER,
+    GARMIN_ACTION_STOP_BUFFER,
+    GARMIN_ACTION_SAVE_AND_RESTART,   // Always restarts, regardless of restart_mode
+    GARMIN_ACTION_SCREENSHOT,
+    GARMIN_ACTION_COUNT,
+};
+
+struct garmin_command {
+    char *phrase;                 // Grammar form: lowercase, single spaces
+    char *text;                   // Normalized like recognized text, for matching
+    enum garmin_action action;
+    struct fuzzy_pattern pattern; // Compiled from text
+};
+
+typedef struct command_table command_table_t;
+typedef struct phrase_index phrase_index_t;
+
+command_table_t *command_table_create(void);
+
+// Add a command; phrases are case-folded and whitespace-collapsed first
+// Returns: false if the phrase is empty, too long, matches an existing one
+//          after normalization, or the table is full
+bool command_table_add(command_table_t *table, const char *phrase, enum garmin_action action);
+
+// Add the built-in save phrase for `language` (GARMIN_LANG_*)
+bool command_table_add_defaults(command_table_t *table, int language);
+
+// Build the phrase index; call after the last add
+bool command_table_finish(command_table_t *table);
+
+// Index over the command texts (hit ids are command indices)
+// Returns: NULL until command_table_finish, or after a later add
+const phrase_index_t *command_table_index(const command_table_t *table);
+
+int command_table_count(const command_table_t *table);
+
+const struct garmin_command *command_table_get(const command_table_t *table, int index);
+
+// Vosk grammar JSON for all commands, with and without the "garmin" prefix
+// The string is owned by the table and valid until the next add
+const char *command_table_grammar(const command_table_t *table);
+
+// Number of phrases in the grammar, including "garmin" and "[unk]"
+int command_table_grammar_size(const command_table_t *table);
+
+void command_table_destroy(command_table_t *table);
+
+// Settings name of an action ("save", "start_buffer", ...)
+const char *garmin_action_name(enum garmin_action action);
+
+// Returns: false if `name` isn't an action
+bool garmin_action_from_name(const char *name, enum garmin_action *action);
+
+#endif // COMMAND_TABLE_H
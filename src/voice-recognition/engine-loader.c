@@ -0,0 +1,216 @@
+#include "engine-loader.h"
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <stdlib.h>
+
+struct engine_loader {
+    char *model_path;
+    char *grammar;
+    pthread_t thread;
+    bool thread_active;
+
+    // Under abandoned_mutex: a destroy before the thread finished leaves the
+    // rest to the thread
+    bool finished;
+    bool abandoned;
+
+    uint64_t start_ns;
+    volatile long phase;     // enum engine_loader_phase
+    uint64_t load_ns;        // Written before phase leaves LOADING
+    uint64_t warm_up_ns;     // Written before phase becomes READY
+
+    // Owned here until a poll hands it out
+    vosk_engine_t *engine;
+    bool engine_taken;
+};
+
+// Loaders given up on mid-load, still running detached
+static pthread_mutex_t abandoned_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t abandoned_done = PTHREAD_COND_INITIALIZER;
+static int abandoned_count = 0;
+
+static void free_loader(engine_loader_t *loader)
+{
+    if (!loader->engine_taken) {
+        vosk_engine_destroy(loader->engine);
+    }
+
+    bfree(loader->model_path);
+    bfree(loader->grammar);
+    free(loader);
+}
+
+static bool is_abandoned(engine_loader_t *loader)
+{
+    pthread_mutex_lock(&abandoned_mutex);
+    bool abandoned = loader->abandoned;
+    pthread_mutex_unlock(&abandoned_mutex);
+    return abandoned;
+}
+
+// Returns: true if nobody waits for the result anymore and the loader was freed
+static bool finish_loader(engine_loader_t *loader)
+{
+    pthread_mutex_lock(&abandoned_mutex);
+    loader->finished = true;
+    bool abandoned = loader->abandoned;
+    pthread_mutex_unlock(&abandoned_mutex);
+
+    if (!abandoned) {
+        return false;
+    }
+
+    // Releases the model back to the cache
+    free_loader(loader);
+
+    pthread_mutex_lock(&abandoned_mutex);
+    abandoned_count--;
+    pthread_cond_broadcast(&abandoned_done);
+    pthread_mutex_unlock(&abandoned_mutex);
+    return true;
+}
+
+static void *loader_thread_func(void *param)
+{
+    engine_loader_t *loader = param;
+
+    os_set_thread_name("garmin-model-loader");
+
+    uint64_t start_ns = os_gettime_ns();
+    loader->engine = vosk_engine_create(loader->model_path, loader->grammar);
+    loader->load_ns = os_gettime_ns() - start_ns;
+
+    if (!loader->engine) {
+        os_atomic_set_long(&loader->phase, ENGINE_LOADER_FAILED);
+        finish_loader(loader);
+        return NULL;
+    }
+
+    os_atomic_set_long(&loader->phase, ENGINE_LOADER_WARMING);
+
+    // No point warming up an engine nobody will use
+    if (!is_abandoned(loader)) {
+        start_ns = os_gettime_ns();
+        vosk_engine_warm_up(loader->engine);
+        loader->warm_up_ns = os_gettime_ns() - start_ns;
+    }
+
+    os_atomic_set_long(&loader->phase, ENGINE_LOADER_READY);
+    finish_loader(loader);
+    return NULL;
+}
+
+engine_loader_t *engine_loader_start(const char *model_path, const char *grammar)
+{
+    engine_loader_t *loader = calloc(1, sizeof(engine_loader_t));
+    if (!loader) {
+        return NULL;
+    }
+
+    loader->model_path = bstrdup(model_path);
+    loader->grammar = grammar ? bstrdup(grammar) : NULL;
+    loader->start_ns = os_gettime_ns();
+    loader->phase = ENGINE_LOADER_LOADING;
+
+    if (pthread_create(&loader->thread, NULL, loader_thread_func, loader) != 0) {
+        blog(LOG_ERROR, "[Garmin Replay] Failed to create model loader thread");
+        bfree(loader->model_path);
+        bfree(loader->grammar);
+        free(loader);
+        return NULL;
+    }
+    loader->thread_active = true;
+
+    return loader;
+}
+
+bool engine_loader_poll(engine_loader_t *loader, vosk_engine_t **engine)
+{
+    *engine = NULL;
+    if (!loader) {
+        return true;
+    }
+
+    long phase = os_atomic_load_long(&loader->phase);
+    if (phase == ENGINE_LOADER_FAILED) {
+        return true;
+    }
+    if (phase != ENGINE_LOADER_READY) {
+        return false;
+    }
+
+    if (!loader->engine_taken) {
+        *engine = loader->engine;
+        loader->engine_taken = true;
+    }
+    return true;
+}
+
+void engine_loader_get_progress(engine_loader_t *loader, struct engine_loader_progress *progress)
+{
+    progress->phase = (enum engine_loader_phase)os_atomic_load_long(&loader->phase);
+    progress->elapsed_ns = os_gettime_ns() - loader->start_ns;
+    progress->load_ns = progress->phase != ENGINE_LOADER_LOADING ? loader->load_ns : 0;
+    progress->warm_up_ns = progress->phase == ENGINE_LOADER_READY ? loader->warm_up_ns : 0;
+}
+
+const char *engine_loader_phase_name(enum engine_loader_phase phase)
+{
+    switch (phase) {
+    case ENGINE_LOADER_LOADING:
+        return "Loading speech model";
+    case ENGINE_LOADER_WARMING:
+        return "Warming up recognizer";
+    case ENGINE_LOADER_READY:
+        return "Ready";
+    case ENGINE_LOADER_FAILED:
+    default:
+        return "Model load failed";
+    }
+}
+
+void engine_loader_destroy(engine_loader_t *loader)
+{
+    if (!loader) {
+        return;
+    }
+
+    // vosk_model_new can't be interrupted, and stopping (from the UI
+    // thread) shouldn't wait for it: leave the thread to clean up after
+    // itself
+    if (loader->thread_active) {
+        pthread_mutex_lock(&abandoned_mutex);
+        bool finished = loader->finished;
+        if (!finished) {
+            loader->abandoned = true;
+            abandoned_count++;
+        }
+        pthread_mutex_unlock(&abandoned_mutex);
+
+        if (!finished) {
+            pthread_detach(loader->thread);
+            blog(LOG_INFO, "[Garmin Replay] Stopped during model load, finishing it in the "
+                 "background");
+            return;
+        }
+        pthread_join(loader->thread, NULL);
+    }
+
+    free_loader(loader);
+}
+
+void engine_loader_wait_abandoned(void)
+{
+    pthread_mutex_lock(&abandoned_mutex);
+    if (abandoned_count > 0) {
+        blog(LOG_INFO, "[Garmin Replay] Waiting for %d model load%s to finish", abandoned_count,
+             abandoned_count == 1 ? "" : "s");
+    }
+    while (abandoned_count > 0) {
+        pthread_cond_wait(&abandoned_done, &abandoned_mutex);
+    }
+    pthread_mutex_unlock(&abandoned_mutex);
+}
@@ -0,0 +1,53 @@
+#ifndef ENGINE_LOADER_H
+#define ENGINE_LOADER_H
+
+#include "vosk-engine.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Builds a Vosk engine on a background thread: model load (through the
+// model cache), recognizer creation and a short warm-up decode. The caller
+// keeps capturing audio meanwhile and polls for the result.
+
+typedef struct engine_loader engine_loader_t;
+
+enum engine_loader_phase {
+    ENGINE_LOADER_LOADING,   // Reading the model / creating the recognizer
+    ENGINE_LOADER_WARMING,   // Synthetic warm-up decode
+    ENGINE_LOADER_READY,
+    ENGINE_LOADER_FAILED,
+};
+
+struct engine_loader_progress {
+    enum engine_loader_phase phase;
+    uint64_t elapsed_ns;     // Since engine_loader_start
+    uint64_t load_ns;        // Engine creation time, once known
+    uint64_t warm_up_ns;     // Warm-up decode time, once known
+};
+
+// Start loading the model at `model_path` in the background
+// grammar: Passed to vosk_engine_create (copied), NULL for free-form
+engine_loader_t *engine_loader_start(const char *model_path, const char *grammar);
+
+// Non-blocking check for completion
+// engine: Receives the engine (ownership passes to the caller) once ready,
+//         or NULL if loading failed
+// Returns: true once the loader has finished, either way
+bool engine_loader_poll(engine_loader_t *loader, vosk_engine_t **engine);
+
+void engine_loader_get_progress(engine_loader_t *loader, struct engine_loader_progress *progress);
+
+// Human-readable phase name for status text
+const char *engine_loader_phase_name(enum engine_loader_phase phase);
+
+// Free the loader, destroying an engine nobody took. Doesn't block: a
+// loader still loading is abandoned, and its thread frees it (and its
+// engine) when the load finishes.
+void engine_loader_destroy(engine_loader_t *loader);
+
+// Block until every abandoned loader has finished (module unload, before
+// the model cache shuts down)
+void engine_loader_wait_abandoned(void);
+
+#endif // ENGINE_LOADER_H
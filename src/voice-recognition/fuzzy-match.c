@@ -0,0 +1,95 @@
+#include "fuzzy-match.h"
+
+#include <ctype.h>
+#include <string.h>
+
+bool fuzzy_pattern_compile(struct fuzzy_pattern *pattern, const char *text)
+{
+    memset(pattern, 0, sizeof(*pattern));
+
+    int length = text ? (int)strlen(text) : 0;
+    if (length == 0 || length > FUZZY_PATTERN_MAX) {
+        return false;
+    }
+
+    // Both cases get the bit, so matching never calls tolower
+    for (int i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        uint64_t bit = 1ULL << i;
+        pattern->peq[tolower(c)] |= bit;
+        pattern->peq[toupper(c)] |= bit;
+    }
+    pattern->length = length;
+
+    return true;
+}
+
+// Column-by-column scan of the DP matrix, with the vertical deltas of a
+// whole column packed into Pv/Mv. The only difference between the two modes
+// is the top row: global matching pays 1 per skipped text character
+// (carry-in 1), substring search starts anywhere for free (carry-in 0).
+// Returns: Distance at the last column; best/best_end track the minimum
+static int scan(const struct fuzzy_pattern *pattern, const char *text, int len,
+                uint64_t carry_in, int *best, int *best_end)
+{
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    uint64_t high_bit = 1ULL << (pattern->length - 1);
+    int score = pattern->length;
+
+    if (best) {
+        *best = score;
+        *best_end = 0;
+    }
+
+    for (int j = 0; j < len; j++) {
+        uint64_t eq = pattern->peq[(unsigned char)text[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & high_bit) {
+            score++;
+        } else if (mh & high_bit) {
+            score--;
+        }
+
+        ph = (ph << 1) | carry_in;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        if (best && score < *best) {
+            *best = score;
+            *best_end = j + 1;
+        }
+    }
+
+    return score;
+}
+
+int fuzzy_distance(const struct fuzzy_pattern *pattern, const char *text, int len)
+{
+    if (!pattern->length) {
+        return len;
+    }
+    return scan(pattern, text, len, 1, NULL, NULL);
+}
+
+int fuzzy_search(const struct fuzzy_pattern *pattern, const char *text, int len, int *end)
+{
+    if (!pattern->length) {
+        if (end) {
+            *end = 0;
+        }
+        return 0;
+    }
+
+    int best, best_end;
+    scan(pattern, text, len, 0, &best, &best_end);
+    if (end) {
+        *end = best_end;
+    }
+    return best;
+}
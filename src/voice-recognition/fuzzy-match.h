@@ -0,0 +1,31 @@
+#ifndef FUZZY_MATCH_H
+#define FUZZY_MATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bit-parallel edit distance (Myers 1999, in Hyyro's formulation). A pattern
+// of up to 64 characters is compiled once into per-character match masks;
+// matching then costs a handful of word operations per text character and
+// never allocates. Matching is ASCII case-insensitive.
+
+#define FUZZY_PATTERN_MAX 64
+
+struct fuzzy_pattern {
+    uint64_t peq[256];   // Bit i set where pattern[i] matches the character
+    int length;
+};
+
+// Compile `text` into `pattern`
+// Returns: false if text is empty or longer than FUZZY_PATTERN_MAX
+bool fuzzy_pattern_compile(struct fuzzy_pattern *pattern, const char *text);
+
+// Levenshtein distance between the pattern and all of text[0..len)
+int fuzzy_distance(const struct fuzzy_pattern *pattern, const char *text, int len);
+
+// Smallest edit distance between the pattern and any substring of
+// text[0..len), so extra words around the phrase cost nothing
+// end: Optional, receives the offset just past the best match
+int fuzzy_search(const struct fuzzy_pattern *pattern, const char *text, int len, int *end);
+
+#endif // FUZZY_MATCH_H
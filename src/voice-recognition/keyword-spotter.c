@@ -0,0 +1,575 @@
+#include "keyword-spotter.h"
+#include "../audio-capture/fft.h"
+
+#include "../compat/obs-compat.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// 25 ms Hamming windows every 10 ms, zero-padded to the FFT size
+#define HOP      KEYWORD_SPOTTER_FRAME_SAMPLES
+#define WINDOW   400
+#define FFT_SIZE 512
+#define BINS     (FFT_SIZE / 2 + 1)
+
+#define PRE_EMPHASIS 0.97f
+
+// Mel filterbank and cepstra (c0, the level, is left out so gain doesn't
+// matter), with the usual sine lifter so the higher cepstra count too
+#define MEL_BANDS   24
+#define MEL_LOW_HZ  100.0
+#define MEL_HIGH_HZ 7000.0
+#define CEPSTRA     12
+#define LIFTER      22.0
+
+// Running cepstral mean over ~2 s of speech; removes the microphone's
+// coloring. Pauses don't move it (they'd pull it towards the room noise, so
+// the same phrase would look different after a long silence than in a
+// stream of talk), so it only follows frames CMN_ABOVE_FLOOR_DB over the
+// noise floor, which tracks the quietest frames and rises FLOOR_RISE_DB a
+// frame.
+#define CMN_ALPHA          0.995f
+#define CMN_ABOVE_FLOOR_DB 10.0f
+#define FLOOR_RISE_DB      0.05f
+
+// Recent frames kept for learning, as long as the audio lookback
+#define FEATURE_FRAMES (KEYWORD_SPOTTER_MAX_LOOKBACK / HOP)
+
+// A learned phrase is 0.25-2 s of speech ending in the last active frame
+// (within ACTIVE_RANGE_DB of the loudest recent frame) and starting after a
+// pause of at least GAP_FRAMES. Frames under SILENCE_DB (about 3 LSB RMS)
+// are never speech, so gated or digitally silent audio can't be learned.
+#define MIN_TEMPLATE_FRAMES 25
+#define MAX_TEMPLATE_FRAMES 200
+#define ACTIVE_RANGE_DB     25.0f
+#define GAP_FRAMES          30
+#define SILENCE_DB          10.0f
+
+#define MAX_TEMPLATES 16
+
+// Templates needed before the spotter may gate the decoder
+#define READY_TEMPLATES 2
+
+// A match is reported once no path has beaten it for SETTLE_FRAMES, so
+// it's the best alignment rather than the first one under the threshold
+#define SETTLE_FRAMES 10
+
+// Extra audio handed over in front of a match (300 ms), for word onsets
+// the match didn't cover
+#define LOOKBACK_MARGIN 4800
+
+struct kws_template {
+    char phrase[KEYWORD_SPOTTER_PHRASE_LEN];
+    int frames;
+    uint64_t learned_at;   // Order of learning, oldest is replaced first
+    float features[MAX_TEMPLATE_FRAMES][CEPSTRA];
+
+    // DTW columns for the last input frame: path cost, path length in input
+    // frames, and cost per frame (what paths are compared by)
+    float cost[MAX_TEMPLATE_FRAMES];
+    float mean[MAX_TEMPLATE_FRAMES];
+    int length[MAX_TEMPLATE_FRAMES];
+};
+
+struct keyword_spotter {
+    struct keyword_spotter_config config;
+    fft_t *fft;
+
+    float window[WINDOW];
+    float *time;                    // FFT_SIZE samples, zero past WINDOW
+    float re[BINS], im[BINS];
+
+    // Mel filterbank: band m weighs bins mel_first[m] .. + mel_count[m]
+    int mel_first[MEL_BANDS];
+    int mel_count[MEL_BANDS];
+    float *mel_weights;             // Each band's weights, back to back
+    float dct[CEPSTRA][MEL_BANDS];  // Liftered DCT-II rows for c1 .. c12
+
+    // Frame assembly: pre-emphasized input, the last WINDOW - HOP samples
+    // of the previous window followed by the hop being filled
+    float frame[WINDOW];
+    int queued;
+    float last_sample;
+
+    float cmn[CEPSTRA];
+    bool cmn_valid;
+    float floor_db;
+
+    // Recent frames: unit-length normalized cepstra and level, newest at
+    // feature_head - 1
+    float (*features)[CEPSTRA];
+    float *energy_db;
+    int feature_head;
+    int feature_count;
+
+    // Recent input audio, newest at audio_head - 1
+    short *audio;
+    int audio_head;
+    int audio_count;
+
+    uint64_t samples;               // Input consumed since create or reset
+
+    struct kws_template *templates;
+    int template_count;
+    uint64_t learn_count;
+
+    // Best match so far, waiting to settle
+    bool candidate;
+    int candidate_age;
+    uint64_t candidate_start_sample;
+    struct keyword_spot candidate_spot;
+
+    // Hit in the current keyword_spotter_process call
+    bool hit;
+    uint64_t hit_start_sample;
+    struct keyword_spot hit_spot;
+
+    struct keyword_spotter_stats stats;
+};
+
+void keyword_spotter_config_default(struct keyword_spotter_config *config)
+{
+    config->threshold = KEYWORD_SPOTTER_DEFAULT_THRESHOLD;
+    config->templates_per_phrase = KEYWORD_SPOTTER_DEFAULT_TEMPLATES;
+}
+
+static double hz_to_mel(double hz)
+{
+    return 2595.0 * log10(1.0 + hz / 700.0);
+}
+
+static double mel_to_hz(double mel)
+{
+    return 700.0 * (pow(10.0, mel / 2595.0) - 1.0);
+}
+
+// Triangular filters evenly spaced on the mel scale
+static bool build_filterbank(struct keyword_spotter *ks)
+{
+    double edges[MEL_BANDS + 2];
+    double low = hz_to_mel(MEL_LOW_HZ), high = hz_to_mel(MEL_HIGH_HZ);
+    for (int i = 0; i < MEL_BANDS + 2; i++) {
+        edges[i] = mel_to_hz(low + (high - low) * i / (MEL_BANDS + 1)) * FFT_SIZE / 16000.0;
+    }
+
+    int total = 0;
+    for (int m = 0; m < MEL_BANDS; m++) {
+        int first = (int)ceil(edges[m]);
+        int last = (int)floor(edges[m + 2]);
+        ks->mel_first[m] = first;
+        ks->mel_count[m] = last >= first ? last - first + 1 : 0;
+        total += ks->mel_count[m];
+    }
+
+    ks->mel_weights = malloc((size_t)(total ? total : 1) * sizeof(float));
+    if (!ks->mel_weights) {
+        return false;
+    }
+
+    float *w = ks->mel_weights;
+    for (int m = 0; m < MEL_BANDS; m++) {
+        for (int i = 0; i < ks->mel_count[m]; i++) {
+            double bin = ks->mel_first[m] + i;
+            double rise = (bin - edges[m]) / (edges[m + 1] - edges[m]);
+            double fall = (edges[m + 2] - bin) / (edges[m + 2] - edges[m + 1]);
+            *w++ = (float)fmax(0.0, fmin(rise, fall));
+        }
+    }
+
+    for (int k = 0; k < CEPSTRA; k++) {
+        double lifter = 1.0 + LIFTER / 2.0 * sin(M_PI * (k + 1) / LIFTER);
+        for (int m = 0; m < MEL_BANDS; m++) {
+            ks->dct[k][m] = (float)(lifter * sqrt(2.0 / MEL_BANDS) *
+                                    cos(M_PI * (k + 1) * (m + 0.5) / MEL_BANDS));
+        }
+    }
+    return true;
+}
+
+static void reset_matches(struct keyword_spotter *ks)
+{
+    for (int t = 0; t < ks->template_count; t++) {
+        struct kws_template *tmpl = &ks->templates[t];
+        for (int j = 0; j < tmpl->frames; j++) {
+            tmpl->cost[j] = INFINITY;
+            tmpl->mean[j] = INFINITY;
+            tmpl->length[j] = 0;
+        }
+    }
+    ks->candidate = false;
+}
+
+keyword_spotter_t *keyword_spotter_create(const struct keyword_spotter_config *config)
+{
+    keyword_spotter_t *ks = calloc(1, sizeof(keyword_spotter_t));
+    if (!ks) {
+        return NULL;
+    }
+
+    if (config) {
+        ks->config = *config;
+    } else {
+        keyword_spotter_config_default(&ks->config);
+    }
+    if (ks->config.threshold <= 0.0f) {
+        ks->config.threshold = KEYWORD_SPOTTER_DEFAULT_THRESHOLD;
+    }
+    if (ks->config.templates_per_phrase < 1) {
+        ks->config.templates_per_phrase = KEYWORD_SPOTTER_DEFAULT_TEMPLATES;
+    }
+
+    ks->fft = fft_create(FFT_SIZE);
+    ks->time = calloc(FFT_SIZE, sizeof(float));
+    ks->features = calloc(FEATURE_FRAMES, sizeof(*ks->features));
+    ks->energy_db = calloc(FEATURE_FRAMES, sizeof(float));
+    ks->audio = calloc(KEYWORD_SPOTTER_MAX_LOOKBACK, sizeof(short));
+    ks->templates = calloc(MAX_TEMPLATES, sizeof(struct kws_template));
+    if (!ks->fft || !ks->time || !ks->features || !ks->energy_db || !ks->audio ||
+        !ks->templates || !build_filterbank(ks)) {
+        keyword_spotter_destroy(ks);
+        return NULL;
+    }
+
+    for (int i = 0; i < WINDOW; i++) {
+        ks->window[i] = (float)(0.54 - 0.46 * cos(2.0 * M_PI * i / (WINDOW - 1)));
+    }
+
+    keyword_spotter_reset(ks);
+    return ks;
+}
+
+// Cepstra of the assembled window, normalized for matching, and its level
+static void compute_features(struct keyword_spotter *ks, float *features, float *energy_db)
+{
+    double energy = 0.0;
+    for (int i = 0; i < WINDOW; i++) {
+        ks->time[i] = ks->frame[i] * ks->window[i];
+        energy += (double)ks->frame[i] * ks->frame[i];
+    }
+    *energy_db = (float)(10.0 * log10(energy / WINDOW + 1.0));
+
+    fft_forward(ks->fft, ks->time, ks->re, ks->im);
+
+    float log_mel[MEL_BANDS];
+    const float *w = ks->mel_weights;
+    for (int m = 0; m < MEL_BANDS; m++) {
+        const float *re = ks->re + ks->mel_first[m];
+        const float *im = ks->im + ks->mel_first[m];
+        float sum = 0.0f;
+        for (int i = 0; i < ks->mel_count[m]; i++) {
+            sum += w[i] * (re[i] * re[i] + im[i] * im[i]);
+        }
+        w += ks->mel_count[m];
+        log_mel[m] = logf(sum + 1.0f);
+    }
+
+    float cepstra[CEPSTRA];
+    for (int k = 0; k < CEPSTRA; k++) {
+        float c = 0.0f;
+        for (int m = 0; m < MEL_BANDS; m++) {
+            c += ks->dct[k][m] * log_mel[m];
+        }
+        cepstra[k] = c;
+    }
+
+    if (!ks->cmn_valid) {
+        memcpy(ks->cmn, cepstra, sizeof(ks->cmn));
+        ks->cmn_valid = true;
+        ks->floor_db = *energy_db;
+    }
+
+    ks->floor_db = fminf(ks->floor_db + FLOOR_RISE_DB, *energy_db);
+    bool speech = *energy_db > ks->floor_db + CMN_ABOVE_FLOOR_DB && *energy_db > SILENCE_DB;
+
+    float norm = 0.0f;
+    for (int k = 0; k < CEPSTRA; k++) {
+        if (speech) {
+            ks->cmn[k] = CMN_ALPHA * ks->cmn[k] + (1.0f - CMN_ALPHA) * cepstra[k];
+        }
+        features[k] = cepstra[k] - ks->cmn[k];
+        norm += features[k] * features[k];
+    }
+
+    // Distances are cosines; silence is a zero vector, equally far from all
+    float scale = norm > 1e-6f ? 1.0f / sqrtf(norm) : 0.0f;
+    for (int k = 0; k < CEPSTRA; k++) {
+        features[k] *= scale;
+    }
+}
+
+// Advance every template's DTW by one input frame. A path may start at any
+// input frame (the phrase can begin anywhere), each input frame moves it
+// 0, 1 or 2 template frames, and it is scored by its mean frame distance
+// 1 - cos. A path reaching a template's last frame after M/2 .. 2M input
+// frames with a mean under the threshold is a candidate, and the best
+// candidate is a hit once it has settled.
+// Returns: true if a template matched on this frame
+static bool match_frame(struct keyword_spotter *ks, const float *x)
+{
+    for (int t = 0; t < ks->template_count; t++) {
+        struct kws_template *tmpl = &ks->templates[t];
+        int frames = tmpl->frames;
+
+        // Right to left, so column j - 1 and j - 2 still hold the last frame
+        for (int j = frames - 1; j >= 0; j--) {
+            const float *y = tmpl->features[j];
+            float dot = 0.0f;
+            for (int k = 0; k < CEPSTRA; k++) {
+                dot += x[k] * y[k];
+            }
+            float d = 1.0f - dot;
+
+            float cost = 0.0f;
+            int length = 0;
+            if (j > 0) {
+                int from = j;
+                if (tmpl->mean[j - 1] < tmpl->mean[from]) {
+                    from = j - 1;
+                }
+                if (j > 1 && tmpl->mean[j - 2] < tmpl->mean[from]) {
+                    from = j - 2;
+                }
+                cost = tmpl->cost[from];
+                length = tmpl->length[from];
+                if (length == 0 || length >= 2 * frames) {
+                    tmpl->cost[j] = INFINITY;
+                    tmpl->mean[j] = INFINITY;
+                    tmpl->length[j] = 0;
+                    continue;
+                }
+            }
+
+            tmpl->cost[j] = cost + d;
+            tmpl->length[j] = length + 1;
+            tmpl->mean[j] = tmpl->cost[j] / (float)tmpl->length[j];
+        }
+
+        int last = frames - 1;
+        float mean = tmpl->mean[last];
+        if (tmpl->length[last] * 2 >= frames && mean < ks->config.threshold &&
+            (!ks->candidate || mean < ks->candidate_spot.distance)) {
+            ks->candidate = true;
+            ks->candidate_age = 0;
+            ks->candidate_spot.distance = mean;
+            snprintf(ks->candidate_spot.phrase, sizeof(ks->candidate_spot.phrase), "%s",
+                     tmpl->phrase);
+
+            // The first input frame of the path starts WINDOW samples
+            // before the end of the frame HOP samples later
+            uint64_t end = ks->samples;
+            uint64_t span = (uint64_t)tmpl->length[last] * HOP + (WINDOW - HOP);
+            ks->candidate_start_sample = span < end ? end - span : 0;
+        }
+    }
+
+    if (!ks->candidate || ++ks->candidate_age < SETTLE_FRAMES) {
+        return false;
+    }
+    ks->hit = true;
+    ks->hit_spot = ks->candidate_spot;
+    ks->hit_start_sample = ks->candidate_start_sample;
+    return true;
+}
+
+static void process_frame(struct keyword_spotter *ks)
+{
+    float *features = ks->features[ks->feature_head];
+    compute_features(ks, features, &ks->energy_db[ks->feature_head]);
+    ks->feature_head = (ks->feature_head + 1) % FEATURE_FRAMES;
+    if (ks->feature_count < FEATURE_FRAMES) {
+        ks->feature_count++;
+    }
+
+    if (match_frame(ks, features)) {
+        // One hit per phrase: the paths start over after it
+        reset_matches(ks);
+    }
+
+    memmove(ks->frame, ks->frame + HOP, (WINDOW - HOP) * sizeof(float));
+    ks->stats.frames++;
+}
+
+bool keyword_spotter_process(keyword_spotter_t *ks, const short *in, int count,
+                             struct keyword_spot *spot)
+{
+    uint64_t start_ns = os_gettime_ns();
+    ks->hit = false;
+
+    for (int i = 0; i < count; i++) {
+        ks->audio[ks->audio_head] = in[i];
+        ks->audio_head = (ks->audio_head + 1) % KEYWORD_SPOTTER_MAX_LOOKBACK;
+
+        float sample = (float)in[i];
+        ks->frame[WINDOW - HOP + ks->queued] = sample - PRE_EMPHASIS * ks->last_sample;
+        ks->last_sample = sample;
+        ks->samples++;
+
+        if (++ks->queued == HOP) {
+            ks->queued = 0;
+            process_frame(ks);
+        }
+    }
+    ks->audio_count += count;
+    if (ks->audio_count > KEYWORD_SPOTTER_MAX_LOOKBACK) {
+        ks->audio_count = KEYWORD_SPOTTER_MAX_LOOKBACK;
+    }
+
+    if (ks->hit) {
+        *spot = ks->hit_spot;
+        uint64_t lookback = ks->samples - ks->hit_start_sample + LOOKBACK_MARGIN;
+        spot->lookback = lookback < KEYWORD_SPOTTER_MAX_LOOKBACK ?
+            (int)lookback : KEYWORD_SPOTTER_MAX_LOOKBACK;
+        ks->stats.spots++;
+    }
+
+    ks->stats.process_ns += os_gettime_ns() - start_ns;
+    return ks->hit;
+}
+
+int keyword_spotter_recent_audio(const keyword_spotter_t *ks, short *out, int count)
+{
+    if (count > ks->audio_count) {
+        count = ks->audio_count;
+    }
+
+    int start = (ks->audio_head - count + KEYWORD_SPOTTER_MAX_LOOKBACK) % KEYWORD_SPOTTER_MAX_LOOKBACK;
+    int first = KEYWORD_SPOTTER_MAX_LOOKBACK - start < count ? KEYWORD_SPOTTER_MAX_LOOKBACK - start : count;
+    memcpy(out, ks->audio + start, (size_t)first * sizeof(short));
+    memcpy(out + first, ks->audio, (size_t)(count - first) * sizeof(short));
+    return count;
+}
+
+// Recent frame `age` frames back from the newest (0)
+static int recent_frame(const struct keyword_spotter *ks, int age)
+{
+    return (ks->feature_head - 1 - age + 2 * FEATURE_FRAMES) % FEATURE_FRAMES;
+}
+
+bool keyword_spotter_learn(keyword_spotter_t *ks, const char *phrase)
+{
+    float peak = -INFINITY;
+    for (int age = 0; age < ks->feature_count; age++) {
+        float e = ks->energy_db[recent_frame(ks, age)];
+        peak = e > peak ? e : peak;
+    }
+    float active = peak - ACTIVE_RANGE_DB;
+    active = active > SILENCE_DB ? active : SILENCE_DB;
+
+    // Back from the end: skip the trailing silence, then take frames until
+    // a long enough pause
+    int end = 0;
+    while (end < ks->feature_count && ks->energy_db[recent_frame(ks, end)] < active) {
+        end++;
+    }
+    int begin = end;
+    for (int age = end, gap = 0; age < ks->feature_count && gap < GAP_FRAMES; age++) {
+        if (ks->energy_db[recent_frame(ks, age)] >= active) {
+            begin = age;
+            gap = 0;
+        } else {
+            gap++;
+        }
+    }
+
+    int frames = begin - end + 1;
+    if (end >= ks->feature_count || frames < MIN_TEMPLATE_FRAMES || frames > MAX_TEMPLATE_FRAMES) {
+        ks->stats.rejected++;
+        return false;
+    }
+
+    // This phrase's oldest template once it has enough of them, else a free
+    // slot, else the oldest of all
+    int slot = -1, same = 0;
+    for (int t = 0; t < ks->template_count; t++) {
+        if (strcmp(ks->templates[t].phrase, phrase) == 0) {
+            same++;
+            if (slot < 0 || ks->templates[t].learned_at < ks->templates[slot].learned_at) {
+                slot = t;
+            }
+        }
+    }
+    if (same < ks->config.templates_per_phrase) {
+        slot = ks->template_count < MAX_TEMPLATES ? ks->template_count++ : -1;
+    }
+    if (slot < 0) {
+        slot = 0;
+        for (int t = 1; t < ks->template_count; t++) {
+            if (ks->templates[t].learned_at < ks->templates[slot].learned_at) {
+                slot = t;
+            }
+        }
+    }
+
+    struct kws_template *tmpl = &ks->templates[slot];
+    snprintf(tmpl->phrase, sizeof(tmpl->phrase), "%s", phrase);
+    tmpl->frames = frames;
+    tmpl->learned_at = ++ks->learn_count;
+    for (int j = 0; j < frames; j++) {
+        memcpy(tmpl->features[j], ks->features[recent_frame(ks, begin - j)], sizeof(tmpl->features[j]));
+        tmpl->cost[j] = INFINITY;
+        tmpl->mean[j] = INFINITY;
+        tmpl->length[j] = 0;
+    }
+
+    ks->stats.learned++;
+    return true;
+}
+
+bool keyword_spotter_ready(const keyword_spotter_t *ks)
+{
+    return ks->template_count >= READY_TEMPLATES;
+}
+
+void keyword_spotter_copy_templates(keyword_spotter_t *dst, const keyword_spotter_t *src)
+{
+    memcpy(dst->templates, src->templates, (size_t)src->template_count * sizeof(struct kws_template));
+    dst->template_count = src->template_count;
+    dst->learn_count = src->learn_count;
+    reset_matches(dst);
+}
+
+void keyword_spotter_reset(keyword_spotter_t *ks)
+{
+    if (!ks) {
+        return;
+    }
+
+    memset(ks->frame, 0, sizeof(ks->frame));
+    ks->queued = 0;
+    ks->last_sample = 0.0f;
+    ks->cmn_valid = false;
+    ks->feature_head = 0;
+    ks->feature_count = 0;
+    ks->audio_head = 0;
+    ks->audio_count = 0;
+    ks->samples = 0;
+    reset_matches(ks);
+}
+
+void keyword_spotter_get_stats(const keyword_spotter_t *ks, struct keyword_spotter_stats *stats)
+{
+    *stats = ks->stats;
+    stats->templates = ks->template_count;
+}
+
+void keyword_spotter_destroy(keyword_spotter_t *ks)
+{
+    if (!ks) {
+        return;
+    }
+
+    fft_destroy(ks->fft);
+    free(ks->time);
+    free(ks->mel_weights);
+    free(ks->features);
+    free(ks->energy_db);
+    free(ks->audio);
+    free(ks->templates);
+    free(ks);
+}
@@ -0,0 +1,88 @@
+#ifndef KEYWORD_SPOTTER_H
+#define KEYWORD_SPOTTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cheap always-on keyword spotter in front of the decoder. Works on 16kHz
+// mono s16 in 10ms frames: 12 MFCCs per frame (25ms window, running
+// cepstral mean removed), matched against recorded templates of the
+// command phrases with streaming subsequence DTW. A hit means "this might
+// be a command", so the caller can wake the full decoder and hand it the
+// audio of the match from the lookback ring.
+//
+// Templates are learned, not shipped: after the decoder confirms a command,
+// keyword_spotter_learn() keeps the frames of the phrase that was just
+// spoken. Until enough are learned the spotter isn't ready and the caller
+// should decode everything. Nothing is allocated after create.
+
+// Opaque handle to a keyword spotter instance
+typedef struct keyword_spotter keyword_spotter_t;
+
+#define KEYWORD_SPOTTER_FRAME_SAMPLES 160
+
+// Audio kept for keyword_spotter_recent_audio (5 s)
+#define KEYWORD_SPOTTER_MAX_LOOKBACK 80000
+
+#define KEYWORD_SPOTTER_PHRASE_LEN 64
+
+struct keyword_spotter_config {
+    float threshold;           // Largest mean frame distance (0-2) that counts as a hit
+    int templates_per_phrase;  // Most recent examples kept of each phrase
+};
+
+#define KEYWORD_SPOTTER_DEFAULT_THRESHOLD 0.2f
+#define KEYWORD_SPOTTER_DEFAULT_TEMPLATES 3
+
+// A possible command
+struct keyword_spot {
+    char phrase[KEYWORD_SPOTTER_PHRASE_LEN];  // Phrase of the best matching template
+    float distance;                           // Its mean frame distance
+    int lookback;   // Samples from just before the match to the end of the input so far
+};
+
+struct keyword_spotter_stats {
+    uint64_t frames;
+    uint64_t process_ns;   // Time spent in keyword_spotter_process()
+    uint64_t spots;
+    uint64_t learned;      // Templates learned (including replaced ones)
+    uint64_t rejected;     // Learn calls with no usable phrase in the recent audio
+    int templates;         // Templates held right now
+};
+
+// Fill a config with the defaults above
+void keyword_spotter_config_default(struct keyword_spotter_config *config);
+
+keyword_spotter_t *keyword_spotter_create(const struct keyword_spotter_config *config);
+
+// Run `count` samples through the spotter
+// spot: Filled in when this returns true
+// Returns: true if a template matched in this input
+bool keyword_spotter_process(keyword_spotter_t *ks, const short *in, int count,
+                             struct keyword_spot *spot);
+
+// Copy the most recent `count` samples seen (up to KEYWORD_SPOTTER_MAX_LOOKBACK)
+// Returns: Number of samples copied, fewer if the spotter hasn't seen that many
+int keyword_spotter_recent_audio(const keyword_spotter_t *ks, short *out, int count);
+
+// Keep the last phrase in the recent audio (speech after the last long
+// pause, trailing silence trimmed) as a template for `phrase`, replacing
+// that phrase's oldest one when it already has templates_per_phrase
+// Returns: false if there was no phrase of plausible length to keep
+bool keyword_spotter_learn(keyword_spotter_t *ks, const char *phrase);
+
+// Whether enough templates are learned to stop decoding everything
+bool keyword_spotter_ready(const keyword_spotter_t *ks);
+
+// Replace dst's templates with src's (dst keeps its own audio and stats)
+void keyword_spotter_copy_templates(keyword_spotter_t *dst, const keyword_spotter_t *src);
+
+// Forget the recent audio and any partial match, for a new unrelated
+// stream (templates and stats are kept)
+void keyword_spotter_reset(keyword_spotter_t *ks);
+
+void keyword_spotter_get_stats(const keyword_spotter_t *ks, struct keyword_spotter_stats *stats);
+
+void keyword_spotter_destroy(keyword_spotter_t *ks);
+
+#endif // KEYWORD_SPOTTER_H
@@ -0,0 +1,251 @@
+#include "model-cache.h"
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct cache_entry {
+    char *path;
+    VoskModel *model;   // NULL while loading, and after a failed load
+    bool loading;
+    int refs;           // Includes the loader and anyone waiting on it
+    uint64_t load_ns;
+    uint64_t resident_bytes;
+    struct cache_entry *next;
+};
+
+// Never held across vosk_model_new; users of a path that is still loading
+// take a reference on its entry and wait on cache_cond instead
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cache_cond = PTHREAD_COND_INITIALIZER;
+static struct cache_entry *cache_entries = NULL;
+static struct model_cache_stats cache_stats = {0};
+
+// Copy of cache_stats for model_cache_get_stats, under its own lock so the
+// settings dialog and stop path never wait on cache_mutex
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct model_cache_stats stats_snapshot = {0};
+
+// Called with cache_mutex held after cache_stats changes
+static void publish_stats(void)
+{
+    pthread_mutex_lock(&snapshot_mutex);
+    stats_snapshot = cache_stats;
+    pthread_mutex_unlock(&snapshot_mutex);
+}
+
+static void free_entry(struct cache_entry *entry)
+{
+    if (entry->model) {
+        blog(LOG_INFO, "[Garmin Replay] Model cache: freeing %s", entry->path);
+        vosk_model_free(entry->model);
+    }
+    bfree(entry->path);
+    free(entry);
+}
+
+static void unlink_entry(struct cache_entry *entry)
+{
+    for (struct cache_entry **link = &cache_entries; *link; link = &(*link)->next) {
+        if (*link == entry) {
+            *link = entry->next;
+            return;
+        }
+    }
+}
+
+// Unlink models nobody is using, to make room before loading another.
+// Returns them as a list for the caller to free once cache_mutex is dropped.
+static struct cache_entry *evict_idle(void)
+{
+    struct cache_entry **link = &cache_entries;
+    struct cache_entry *evicted = NULL;
+
+    while (*link) {
+        struct cache_entry *entry = *link;
+        if (entry->refs == 0) {
+            *link = entry->next;
+            cache_stats.models_resident--;
+            cache_stats.resident_bytes -= entry->resident_bytes;
+            entry->next = evicted;
+            evicted = entry;
+        } else {
+            link = &entry->next;
+        }
+    }
+
+    return evicted;
+}
+
+static void free_entries(struct cache_entry *entries)
+{
+    while (entries) {
+        struct cache_entry *entry = entries;
+        entries = entry->next;
+        free_entry(entry);
+    }
+}
+
+// Wait for another thread's load of `entry`; called with cache_mutex held
+// and a reference on the entry. Returns the model, or NULL if the load failed.
+static VoskModel *wait_for_load(struct cache_entry *entry)
+{
+    while (entry->loading) {
+        pthread_cond_wait(&cache_cond, &cache_mutex);
+    }
+
+    if (!entry->model && --entry->refs == 0) {
+        // Last one out of a failed load drops the entry
+        unlink_entry(entry);
+        free_entry(entry);
+        return NULL;
+    }
+
+    return entry->model;
+}
+
+VoskModel *model_cache_acquire(const char *path)
+{
+    if (!path || !*path) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+
+    for (struct cache_entry *entry = cache_entries; entry; entry = entry->next) {
+        if (strcmp(entry->path, path) != 0 || (!entry->loading && !entry->model)) {
+            continue;
+        }
+
+        entry->refs++;
+        if (entry->loading) {
+            blog(LOG_INFO, "[Garmin Replay] Model cache: waiting for load in progress: %s", path);
+        }
+        VoskModel *model = wait_for_load(entry);
+        if (model) {
+            cache_stats.hits++;
+            blog(LOG_INFO, "[Garmin Replay] Model cache hit: %s (saved %.0f ms load, %ld hits / %ld misses)",
+                 path, entry->load_ns / 1000000.0, cache_stats.hits, cache_stats.misses);
+            publish_stats();
+        }
+        pthread_mutex_unlock(&cache_mutex);
+        return model;
+    }
+
+    struct cache_entry *entry = calloc(1, sizeof(struct cache_entry));
+    if (!entry) {
+        pthread_mutex_unlock(&cache_mutex);
+        return NULL;
+    }
+
+    cache_stats.misses++;
+    struct cache_entry *evicted = evict_idle();
+    publish_stats();
+
+    entry->path = bstrdup(path);
+    entry->loading = true;
+    entry->refs = 1;
+    entry->next = cache_entries;
+    cache_entries = entry;
+
+    pthread_mutex_unlock(&cache_mutex);
+
+    free_entries(evicted);
+
+    blog(LOG_INFO, "[Garmin Replay] Model cache miss, loading Vosk model from: %s", path);
+
+    // Other threads allocate meanwhile, but next to a model they are noise
+    uint64_t start_resident = os_get_proc_resident_size();
+    uint64_t start_ns = os_gettime_ns();
+    VoskModel *model = vosk_model_new(path);
+    uint64_t load_ns = os_gettime_ns() - start_ns;
+    uint64_t end_resident = os_get_proc_resident_size();
+
+    pthread_mutex_lock(&cache_mutex);
+
+    entry->loading = false;
+    pthread_cond_broadcast(&cache_cond);
+
+    if (!model) {
+        if (--entry->refs == 0) {
+            unlink_entry(entry);
+            free_entry(entry);
+        }
+        pthread_mutex_unlock(&cache_mutex);
+        return NULL;
+    }
+
+    entry->model = model;
+    entry->load_ns = load_ns;
+    entry->resident_bytes = end_resident > start_resident ? end_resident - start_resident : 0;
+
+    cache_stats.models_resident++;
+    cache_stats.load_ns_total += load_ns;
+    cache_stats.resident_bytes += entry->resident_bytes;
+    publish_stats();
+
+    blog(LOG_INFO, "[Garmin Replay] Model loaded in %.0f ms, %.0f MB (%ld hits / %ld misses)",
+         load_ns / 1000000.0, entry->resident_bytes / (1024.0 * 1024.0), cache_stats.hits,
+         cache_stats.misses);
+
+    pthread_mutex_unlock(&cache_mutex);
+    return model;
+}
+
+void model_cache_release(VoskModel *model)
+{
+    if (!model) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+
+    for (struct cache_entry *entry = cache_entries; entry; entry = entry->next) {
+        if (entry->model == model) {
+            if (entry->refs > 0) {
+                entry->refs--;
+            }
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void model_cache_get_stats(struct model_cache_stats *stats)
+{
+    pthread_mutex_lock(&snapshot_mutex);
+    *stats = stats_snapshot;
+    pthread_mutex_unlock(&snapshot_mutex);
+}
+
+void model_cache_shutdown(void)
+{
+    pthread_mutex_lock(&cache_mutex);
+
+    if (cache_stats.hits || cache_stats.misses) {
+        blog(LOG_INFO, "[Garmin Replay] Model cache: %ld hits, %ld misses, %.0f ms spent loading",
+             cache_stats.hits, cache_stats.misses, cache_stats.load_ns_total / 1000000.0);
+    }
+
+    while (cache_entries) {
+        struct cache_entry *entry = cache_entries;
+        cache_entries = entry->next;
+        if (entry->loading) {
+            // The loader still owns it; leak rather than free under its feet
+            blog(LOG_WARNING, "[Garmin Replay] Model cache: %s still loading at shutdown", entry->path);
+            continue;
+        }
+        if (entry->refs > 0) {
+            blog(LOG_WARNING, "[Garmin Replay] Model cache: %s still has %d users at shutdown",
+                 entry->path, entry->refs);
+        }
+        free_entry(entry);
+    }
+
+    pthread_mutex_unlock(&cache_mutex);
+}
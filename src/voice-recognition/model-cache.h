@@ -0,0 +1,34 @@
+#ifndef MODEL_CACHE_H
+#define MODEL_CACHE_H
+
+#include <vosk_api.h>
+
+#include <stdint.h>
+
+// Process-wide cache of loaded Vosk models, keyed by model path.
+// Models stay resident after their last user goes away, so restarting
+// recognition (settings Apply, device change) does not reload from disk.
+// Idle models are evicted when a different model has to be loaded.
+
+struct model_cache_stats {
+    long hits;
+    long misses;
+    int models_resident;
+    uint64_t load_ns_total;   // Time spent in vosk_model_new
+    uint64_t resident_bytes;  // Process memory growth while loading the resident models
+};
+
+// Get the model for `path`, loading it on a miss
+// Returns: Model with a reference held by the caller, or NULL if loading failed
+VoskModel *model_cache_acquire(const char *path);
+
+// Drop a reference taken with model_cache_acquire
+void model_cache_release(VoskModel *model);
+
+// Copy of the latest counters; never waits on a load, so safe from the UI thread
+void model_cache_get_stats(struct model_cache_stats *stats);
+
+// Free every cached model; call once no recognizers are left (module unload)
+void model_cache_shutdown(void);
+
+#endif // MODEL_CACHE_H
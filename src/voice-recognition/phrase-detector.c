@@ -1,73 +1,37 @@
 #include "phrase-detector.h"
-#include <obs-module.h>
+#include "command-table.h"
+#include "fuzzy-match.h"
+#include "phrase-index.h"
+#include "vosk-json.h"
+#include "../diagnostics/pipeline-stats.h"
+#include "../compat/obs-compat.h"
 
 #include <string.h>
-#include <stdlib.h>
 #include <ctype.h>
 
-// Trigger phrases - using only the distinctive parts that models recognize
-// "Garmin" is a brand name that smaller models often don't recognize
-static const char *TRIGGER_PHRASES[] = {
-    "save video",         // English (garmin often recognized, but "save video" is key)
-    "video speichern",    // German (garmin not in vocabulary)
-    "enregistrer video"   // French (garmin may not be recognized)
-};
-static const int NUM_TRIGGER_PHRASES = 3;
+// Index candidates verified per result; exact occurrences come first, so
+// only loose candidates of a very repetitive command table can be cut off
+#define MAX_CANDIDATES 128
 
-// Minimum string for matching
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-
-// Levenshtein distance for fuzzy string matching
-static int levenshtein_distance(const char *s1, const char *s2)
-{
-    int len1 = (int)strlen(s1);
-    int len2 = (int)strlen(s2);
-
-    // Allocate matrix
-    int *matrix = malloc((len1 + 1) * (len2 + 1) * sizeof(int));
-    if (!matrix) {
-        return 1000;  // Large distance on allocation failure
-    }
-
-    // Initialize first row and column
-    for (int i = 0; i <= len1; i++) {
-        matrix[i * (len2 + 1)] = i;
-    }
-    for (int j = 0; j <= len2; j++) {
-        matrix[j] = j;
-    }
-
-    // Fill in the matrix
-    for (int i = 1; i <= len1; i++) {
-        for (int j = 1; j <= len2; j++) {
-            int cost = (tolower((unsigned char)s1[i - 1]) ==
-                        tolower((unsigned char)s2[j - 1])) ? 0 : 1;
-
-            int del = matrix[(i - 1) * (len2 + 1) + j] + 1;
-            int ins = matrix[i * (len2 + 1) + (j - 1)] + 1;
-            int sub = matrix[(i - 1) * (len2 + 1) + (j - 1)] + cost;
-
-            int min = del;
-            if (ins < min) min = ins;
-            if (sub < min) min = sub;
-
-            matrix[i * (len2 + 1) + j] = min;
-        }
-    }
-
-    int result = matrix[len1 * (len2 + 1) + len2];
-    free(matrix);
-    return result;
-}
-
-// Normalize text: lowercase, remove punctuation, collapse whitespace
-static void normalize_text(const char *input, char *output, int max_len)
+// Normalize text straight from the JSON string: lowercase, remove
+// punctuation, collapse whitespace. Escapes are decoded on the fly; none of
+// them produce letters, so they're dropped or (\n, \t, \r) become spaces.
+static int normalize_text(const struct vosk_json_view *input, char *output, int max_len)
 {
     int j = 0;
     bool last_was_space = false;
 
-    for (int i = 0; input[i] && j < max_len - 1; i++) {
-        unsigned char c = (unsigned char)input[i];
+    for (int i = 0; i < input->len && j < max_len - 1; i++) {
+        unsigned char c = (unsigned char)input->ptr[i];
+
+        if (c == '\\' && i + 1 < input->len) {
+            char escaped = input->ptr[++i];
+            if (escaped == 'u') {
+                i += 4;
+                continue;
+            }
+            c = (escaped == 'n' || escaped == 't' || escaped == 'r') ? ' ' : 0;
+        }
 
         if (isalnum(c)) {
             output[j++] = (char)tolower(c);
@@ -86,143 +50,274 @@ static void normalize_text(const char *input, char *output, int max_len)
     }
 
     output[j] = '\0';
+    return j;
 }
 
-// Extract text field from Vosk JSON result
-// Simple JSON parsing - looks for "text" : "..." pattern
-static bool extract_text_from_json(const char *json, char *text, int max_len)
+// Copy the next space-separated word of `*phrase` into `word`
+// Returns: false once the phrase is exhausted
+static bool next_phrase_word(const char **phrase, char *word, int max_len)
 {
-    // Look for "text" field
-    const char *text_key = strstr(json, "\"text\"");
-    if (!text_key) {
-        return false;
+    const char *p = *phrase;
+    while (*p == ' ') {
+        p++;
     }
-
-    // Find the colon
-    const char *colon = strchr(text_key + 6, ':');
-    if (!colon) {
+    if (!*p) {
         return false;
     }
 
-    // Find the opening quote
-    const char *start = strchr(colon, '"');
-    if (!start) {
-        return false;
+    int len = 0;
+    while (p[len] && p[len] != ' ') {
+        len++;
     }
-    start++;  // Move past the quote
-
-    // Find the closing quote
-    const char *end = strchr(start, '"');
-    if (!end) {
-        return false;
+    if (len > max_len - 1) {
+        len = max_len - 1;
     }
+    memcpy(word, p, len);
+    word[len] = '\0';
 
-    // Copy the text
-    int len = (int)(end - start);
-    if (len >= max_len) {
-        len = max_len - 1;
+    while (*p && *p != ' ') {
+        p++;
     }
+    *phrase = p;
+    return true;
+}
 
-    strncpy(text, start, len);
-    text[len] = '\0';
+// Smallest edit distance between the pattern and a run of whole words of
+// the text, one word shorter to one word longer than the phrase
+static int word_window_distance(const struct fuzzy_pattern *pattern, const char *text, int len,
+                                int phrase_words)
+{
+    int min_words = phrase_words > 1 ? phrase_words - 1 : 1;
+    int best = pattern->length + len;
+
+    for (int start = 0; start < len; start++) {
+        if (start > 0 && text[start - 1] != ' ') {
+            continue;
+        }
+        int words = 0;
+        for (int end = start; end <= len && words <= phrase_words; end++) {
+            if (end < len && text[end] != ' ') {
+                continue;
+            }
+            words++;
+            if (words >= min_words) {
+                int distance = fuzzy_distance(pattern, text + start, end - start);
+                if (distance < best) {
+                    best = distance;
+                }
+            }
+        }
+    }
 
-    return len > 0;
+    return best;
 }
 
-// Check if a string contains all words of the trigger phrase
-// More lenient than exact match - allows extra words
+// Check if a string contains all words of the trigger phrase as whole
+// words ("saved videos" doesn't contain "save video")
+// More lenient than exact match - allows extra words and any order
 static bool contains_trigger_words(const char *text, const char *trigger)
 {
-    char trigger_copy[256];
-    strncpy(trigger_copy, trigger, sizeof(trigger_copy) - 1);
-    trigger_copy[sizeof(trigger_copy) - 1] = '\0';
-
-    // Tokenize trigger phrase
-    char *word = strtok(trigger_copy, " ");
-    while (word) {
-        // Check if this word appears in the text
-        if (!strstr(text, word)) {
+    char word[64];
+    while (next_phrase_word(&trigger, word, sizeof(word))) {
+        const char *scan = text;
+        char heard[64];
+        bool found = false;
+        while (!found && next_phrase_word(&scan, heard, sizeof(heard))) {
+            found = strcmp(heard, word) == 0;
+        }
+        if (!found) {
             return false;
         }
-        word = strtok(NULL, " ");
     }
 
     return true;
 }
 
-float phrase_detector_check(const char *vosk_result_json, int sensitivity, int language)
+// Mean recognizer confidence of the words that make up the trigger phrase
+// Returns: -1 if any trigger word has no entry in the word array (partials
+//          without partial words, models without scores)
+static float trigger_word_confidence(const struct vosk_json_result *result, const char *trigger)
 {
-    if (!vosk_result_json || sensitivity < 1 || sensitivity > 100) {
-        return 0.0f;
+    char word[64];
+    float total = 0.0f;
+    int count = 0;
+
+    while (next_phrase_word(&trigger, word, sizeof(word))) {
+        int found = -1;
+        for (int i = 0; i < result->word_count && found < 0; i++) {
+            char heard[64];
+            normalize_text(&result->words[i].word, heard, sizeof(heard));
+            if (strcmp(heard, word) == 0) {
+                found = i;
+            }
+        }
+        if (found < 0) {
+            return -1.0f;
+        }
+        total += result->words[found].conf;
+        count++;
+    }
+
+    return count ? total / (float)count : -1.0f;
+}
+
+// Score one command against the normalized text, using the three methods
+// from strictest to loosest
+// all_words: Every command word occurs in the text as a whole word
+// Returns: Confidence (0.0 - 1.0), or 0 if outside the allowed distance
+static float score_command(const struct garmin_command *command, const struct vosk_json_result *result,
+                           const char *normalized, int text_len, float max_error_rate, bool all_words)
+{
+    const struct fuzzy_pattern *pattern = &command->pattern;
+    int phrase_len = pattern->length;
+    int max_distance = (int)(phrase_len * max_error_rate);
+    float best_confidence = 0.0f;
+
+    // Method 1: Levenshtein distance to the whole transcript
+    int distance = fuzzy_distance(pattern, normalized, text_len);
+    const char *match_kind = "whole";
+
+    // Method 2: Best approximate occurrence, so surrounding words like
+    // "uh ... now" don't count against the phrase. The occurrence has to
+    // cover whole words ("saved videos" is two edits from "save video", not
+    // one); the plain substring distance is a lower bound for that and
+    // settles most texts in one pass.
+    if (distance > 0) {
+        int substring_distance = fuzzy_search(pattern, normalized, text_len, NULL);
+        if (substring_distance < distance && substring_distance <= max_distance) {
+            int phrase_words = 1;
+            for (const char *p = command->text; *p; p++) {
+                phrase_words += *p == ' ';
+            }
+            substring_distance = word_window_distance(pattern, normalized, text_len, phrase_words);
+        }
+        if (substring_distance < distance) {
+            distance = substring_distance;
+            match_kind = "substring";
+        }
     }
 
-    // Extract text from JSON
-    char raw_text[512];
-    if (!extract_text_from_json(vosk_result_json, raw_text, sizeof(raw_text))) {
+    if (distance <= max_distance) {
+        best_confidence = 1.0f - ((float)distance / (float)phrase_len);
+        blog(LOG_DEBUG, "[Garmin Replay] Match found: '%s' -> '%s' (%s, dist=%d, conf=%.2f)",
+             normalized, command->text, match_kind, distance, best_confidence);
+    }
+
+    // Method 3: Check if all trigger words are present in any order
+    if (best_confidence < 0.6f && all_words) {
+        // Score on what the recognizer says about those words; fall back
+        // to partial credit when it didn't report per-word scores
+        float word_confidence = trigger_word_confidence(result, command->text);
+        if (word_confidence < 0.0f) {
+            word_confidence = 0.75f;
+        }
+        if (word_confidence > best_confidence) {
+            best_confidence = word_confidence;
+            blog(LOG_DEBUG, "[Garmin Replay] Word match: '%s' contains '%s' (conf=%.2f)",
+                 normalized, command->text, word_confidence);
+        }
+    }
+
+    return best_confidence;
+}
+
+// Shared by final and partial checks
+// verbose: Log what was heard at INFO (final results) or only DEBUG (partials,
+//          which are checked many times per utterance)
+static float check_json(const char *vosk_json, int sensitivity, const command_table_t *commands,
+                        int *command, bool verbose)
+{
+    *command = -1;
+    if (!vosk_json || !commands || sensitivity < 1 || sensitivity > 100) {
         return 0.0f;
     }
 
+    // One pass over the JSON; text and words are views into it. A parse
+    // error still leaves whatever was read before it.
+    uint64_t parse_start = os_gettime_ns();
+    struct vosk_json_result result;
+    vosk_json_parse(vosk_json, strlen(vosk_json), &result);
+
     // Normalize the recognized text
     char normalized[512];
-    normalize_text(raw_text, normalized, sizeof(normalized));
+    int text_len = result.text.len ?
+        normalize_text(&result.text, normalized, sizeof(normalized)) : 0;
+    pipeline_stats_record(STAGE_RESULT_JSON, os_gettime_ns() - parse_start);
 
     // Skip if too short
-    if (strlen(normalized) < 5) {
+    if (text_len < 5) {
         return 0.0f;
     }
 
-    // Select the trigger phrase based on language
-    // 0 = English, 1 = German, 2 = French
-    const char *trigger_phrase;
-    if (language >= 0 && language < NUM_TRIGGER_PHRASES) {
-        trigger_phrase = TRIGGER_PHRASES[language];
-    } else {
-        trigger_phrase = TRIGGER_PHRASES[0];  // Default to English
-    }
-
     // Debug: Log what we heard and what we're looking for
-    blog(LOG_INFO, "[Garmin Replay] Heard: '%s' | Looking for: '%s' (lang=%d)",
-         normalized, trigger_phrase, language);
+    blog(verbose ? LOG_INFO : LOG_DEBUG, "[Garmin Replay] Heard%s: '%s' | Looking for %d command%s",
+         verbose ? "" : " (partial)", normalized, command_table_count(commands),
+         command_table_count(commands) == 1 ? "" : "s");
 
     // Calculate maximum allowed edit distance based on sensitivity
     // sensitivity 100 = exact match (0 edits)
     // sensitivity 50 = moderate (allow ~15% errors)
     // sensitivity 1 = very loose (allow ~30% errors)
     float max_error_rate = (100.0f - (float)sensitivity) / 100.0f * 0.3f;
+    uint64_t match_start = os_gettime_ns();
 
+    // Best-scoring command wins; ties go to the one listed first
     float best_confidence = 0.0f;
-    int phrase_len = (int)strlen(trigger_phrase);
-    int max_distance = (int)(phrase_len * max_error_rate);
-
-    // Method 1: Exact Levenshtein distance
-    int distance = levenshtein_distance(normalized, trigger_phrase);
-
-    if (distance <= max_distance) {
-        float confidence = 1.0f - ((float)distance / (float)phrase_len);
-        if (confidence > best_confidence) {
-            best_confidence = confidence;
-            blog(LOG_DEBUG, "[Garmin Replay] Match found: '%s' -> '%s' (dist=%d, conf=%.2f)",
-                 normalized, trigger_phrase, distance, confidence);
+    const phrase_index_t *index = command_table_index(commands);
+    if (index) {
+        // Only commands sharing words with the text are scored, so the cost
+        // follows the utterance rather than the table size
+        struct phrase_hit hits[MAX_CANDIDATES];
+        int hit_count = phrase_index_find(index, normalized, text_len, hits, MAX_CANDIDATES);
+        for (int i = 0; i < hit_count; i++) {
+            const struct garmin_command *candidate = command_table_get(commands, hits[i].id);
+            float confidence = 1.0f;
+            if (hits[i].exact) {
+                blog(LOG_DEBUG, "[Garmin Replay] Match found: '%s' -> '%s' (exact words, conf=1.00)",
+                     normalized, candidate->text);
+            } else {
+                confidence = score_command(candidate, &result, normalized, text_len,
+                                           max_error_rate, hits[i].all_words);
+            }
+            if (confidence > best_confidence ||
+                (confidence == best_confidence && confidence > 0.0f && hits[i].id < *command)) {
+                best_confidence = confidence;
+                *command = hits[i].id;
+            }
         }
-    }
-
-    // Method 2: Check if all trigger words are present (more lenient)
-    if (best_confidence < 0.6f) {
-        if (contains_trigger_words(normalized, trigger_phrase)) {
-            // Give partial credit for containing all words
-            float word_confidence = 0.75f;
-            if (word_confidence > best_confidence) {
-                best_confidence = word_confidence;
-                blog(LOG_DEBUG, "[Garmin Replay] Word match: '%s' contains '%s'",
-                     normalized, trigger_phrase);
+    } else {
+        int count = command_table_count(commands);
+        for (int i = 0; i < count; i++) {
+            const struct garmin_command *candidate = command_table_get(commands, i);
+            float confidence = score_command(candidate, &result, normalized, text_len, max_error_rate,
+                                             contains_trigger_words(normalized, candidate->text));
+            if (confidence > best_confidence) {
+                best_confidence = confidence;
+                *command = i;
             }
         }
     }
 
+    pipeline_stats_record(STAGE_PHRASE_MATCH, os_gettime_ns() - match_start);
+
     if (best_confidence > 0.5f) {
-        blog(LOG_INFO, "[Garmin Replay] Trigger phrase detected in: '%s' (confidence: %.2f)",
-             normalized, best_confidence);
+        const struct garmin_command *match = command_table_get(commands, *command);
+        blog(LOG_INFO, "[Garmin Replay] Trigger phrase detected in %s: '%s' -> '%s' (%s, confidence: %.2f)",
+             verbose ? "result" : "partial", normalized, match->phrase,
+             garmin_action_name(match->action), best_confidence);
     }
 
     return best_confidence;
 }
+
+float phrase_detector_check(const char *vosk_result_json, int sensitivity,
+                            const command_table_t *commands, int *command)
+{
+    return check_json(vosk_result_json, sensitivity, commands, command, true);
+}
+
+float phrase_detector_check_partial(const char *vosk_partial_json, int sensitivity,
+                                    const command_table_t *commands, int *command)
+{
+    return check_json(vosk_partial_json, sensitivity, commands, command, false);
+}
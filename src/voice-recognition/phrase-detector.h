@@ -1,11 +1,20 @@
 #ifndef PHRASE_DETECTOR_H
 #define PHRASE_DETECTOR_H
 
-// Check if the Vosk result JSON contains a trigger phrase
+typedef struct command_table command_table_t;
+
+// Check if the Vosk result JSON contains one of the command phrases
 // vosk_result_json: The JSON result string from Vosk
 // sensitivity: Sensitivity level (1-100), higher = stricter matching
-// language: Language to check (0=English, 1=German, 2=French)
+// commands: Compiled command table to match against
+// command: Receives the index of the best-matching command, or -1
 // Returns: Confidence level (0.0 - 1.0), or 0 if no match
-float phrase_detector_check(const char *vosk_result_json, int sensitivity, int language);
+float phrase_detector_check(const char *vosk_result_json, int sensitivity,
+                            const command_table_t *commands, int *command);
+
+// Same check on a partial hypothesis ({"partial" : "..."}), logging only at
+// debug level since partials are polled while the user is still talking
+float phrase_detector_check_partial(const char *vosk_partial_json, int sensitivity,
+                                    const command_table_t *commands, int *command);
 
 #endif // PHRASE_DETECTOR_H
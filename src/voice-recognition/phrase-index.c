@@ -0,0 +1,713 @@
+#include "phrase-index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Shortest word that takes part in fuzzy lookups; shorter ones are one edit
+// away from too many others ("a"/"i", "to"/"do")
+#define FUZZY_MIN_WORD 3
+
+// Candidate accumulator of one find call, kept on the stack; with more
+// distinct candidate phrases than 3/4 of this, the rest are dropped
+#define ACC_SLOTS_MAX 1024
+
+struct int_list {
+    int *items;
+    int count;
+    int capacity;
+};
+
+// Occurrence of a word in a phrase
+struct posting {
+    int phrase;
+    int position;
+};
+
+struct posting_list {
+    struct posting *items;
+    int count;
+    int capacity;
+};
+
+// Open addressing, linear probing; key == NULL marks an empty slot
+struct map_slot {
+    char *key;
+    int len;
+    uint32_t hash;
+    int value;
+};
+
+struct string_map {
+    struct map_slot *slots;
+    uint32_t mask;
+    int count;
+};
+
+// Trie edges keyed by (node, word); key 0 marks an empty slot
+struct edge_slot {
+    uint64_t key;
+    int child;
+};
+
+struct edge_map {
+    struct edge_slot *slots;
+    uint32_t mask;
+    int count;
+};
+
+struct trie_node {
+    int first_child;
+    int next_sibling;
+    int word;       // Edge label from the parent
+    int fail;       // Longest proper suffix that is also a trie path
+    int output;     // Phrase ending here, or -1
+    int dict;       // Nearest node on the fail chain with an output, or -1
+};
+
+struct phrase_info {
+    int id;
+    int words;
+};
+
+struct phrase_index {
+    struct string_map words;          // word -> word id
+    struct posting_list *postings;    // Per word id
+    int word_count;
+    int word_capacity;
+
+    // Each word with one character deleted -> the words that produce it
+    struct string_map variants;
+    struct int_list *variant_words;
+    int variant_count;
+    int variant_capacity;
+
+    struct phrase_info *phrases;
+    int phrase_count;
+    int phrase_capacity;
+
+    struct trie_node *nodes;
+    int node_count;
+    int node_capacity;
+    struct edge_map edges;
+    bool built;
+};
+
+// ---------------------------------------------------------------------------
+// Containers
+
+static bool grow(void **items, int *capacity, int needed, size_t item_size)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+    int new_capacity = *capacity ? *capacity * 2 : 8;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void *grown = realloc(*items, (size_t)new_capacity * item_size);
+    if (!grown) {
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+static bool int_list_push(struct int_list *list, int value)
+{
+    // Words repeat a variant when they have doubled letters ("book" -> "bok")
+    if (list->count && list->items[list->count - 1] == value) {
+        return true;
+    }
+    if (!grow((void **)&list->items, &list->capacity, list->count + 1, sizeof(int))) {
+        return false;
+    }
+    list->items[list->count++] = value;
+    return true;
+}
+
+static uint32_t hash_bytes(const char *data, int len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int map_find(const struct string_map *map, const char *key, int len, uint32_t hash)
+{
+    if (!map->slots) {
+        return -1;
+    }
+    for (uint32_t i = hash & map->mask;; i = (i + 1) & map->mask) {
+        const struct map_slot *slot = &map->slots[i];
+        if (!slot->key) {
+            return -1;
+        }
+        if (slot->hash == hash && slot->len == len && memcmp(slot->key, key, (size_t)len) == 0) {
+            return slot->value;
+        }
+    }
+}
+
+static void map_place(struct map_slot *slots, uint32_t mask, const struct map_slot *entry)
+{
+    uint32_t i = entry->hash & mask;
+    while (slots[i].key) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = *entry;
+}
+
+// Insert a key known to be absent; the key bytes are copied
+static bool map_insert(struct string_map *map, const char *key, int len, uint32_t hash, int value)
+{
+    uint32_t capacity = map->slots ? map->mask + 1 : 0;
+    if ((uint32_t)(map->count + 1) * 4 > capacity * 3) {
+        uint32_t new_capacity = capacity ? capacity * 2 : 64;
+        struct map_slot *slots = calloc(new_capacity, sizeof(struct map_slot));
+        if (!slots) {
+            return false;
+        }
+        for (uint32_t i = 0; i < capacity; i++) {
+            if (map->slots[i].key) {
+                map_place(slots, new_capacity - 1, &map->slots[i]);
+            }
+        }
+        free(map->slots);
+        map->slots = slots;
+        map->mask = new_capacity - 1;
+    }
+
+    struct map_slot entry = {malloc((size_t)len + 1), len, hash, value};
+    if (!entry.key) {
+        return false;
+    }
+    memcpy(entry.key, key, (size_t)len);
+    entry.key[len] = '\0';
+    map_place(map->slots, map->mask, &entry);
+    map->count++;
+    return true;
+}
+
+static void map_free(struct string_map *map)
+{
+    if (map->slots) {
+        for (uint32_t i = 0; i <= map->mask; i++) {
+            free(map->slots[i].key);
+        }
+    }
+    free(map->slots);
+}
+
+static uint64_t edge_key(int node, int word)
+{
+    // +1 keeps (root, word 0) away from the empty marker
+    return (((uint64_t)(uint32_t)node << 32) | (uint32_t)word) + 1;
+}
+
+static uint32_t edge_hash(uint64_t key)
+{
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(key >> 32);
+}
+
+static int edge_find(const struct edge_map *map, int node, int word)
+{
+    if (!map->slots) {
+        return -1;
+    }
+    uint64_t key = edge_key(node, word);
+    for (uint32_t i = edge_hash(key) & map->mask;; i = (i + 1) & map->mask) {
+        if (map->slots[i].key == key) {
+            return map->slots[i].child;
+        }
+        if (!map->slots[i].key) {
+            return -1;
+        }
+    }
+}
+
+static void edge_place(struct edge_slot *slots, uint32_t mask, struct edge_slot entry)
+{
+    uint32_t i = edge_hash(entry.key) & mask;
+    while (slots[i].key) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = entry;
+}
+
+static bool edge_insert(struct edge_map *map, int node, int word, int child)
+{
+    uint32_t capacity = map->slots ? map->mask + 1 : 0;
+    if ((uint32_t)(map->count + 1) * 2 > capacity) {
+        uint32_t new_capacity = capacity ? capacity * 2 : 64;
+        struct edge_slot *slots = calloc(new_capacity, sizeof(struct edge_slot));
+        if (!slots) {
+            return false;
+        }
+        for (uint32_t i = 0; i < capacity; i++) {
+            if (map->slots[i].key) {
+                edge_place(slots, new_capacity - 1, map->slots[i]);
+            }
+        }
+        free(map->slots);
+        map->slots = slots;
+        map->mask = new_capacity - 1;
+    }
+
+    struct edge_slot entry = {edge_key(node, word), child};
+    edge_place(map->slots, map->mask, entry);
+    map->count++;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Building
+
+static int new_node(phrase_index_t *index, int word)
+{
+    if (!grow((void **)&index->nodes, &index->node_capacity, index->node_count + 1,
+              sizeof(struct trie_node))) {
+        return -1;
+    }
+    struct trie_node *node = &index->nodes[index->node_count];
+    node->first_child = -1;
+    node->next_sibling = -1;
+    node->word = word;
+    node->fail = 0;
+    node->output = -1;
+    node->dict = -1;
+    return index->node_count++;
+}
+
+phrase_index_t *phrase_index_create(void)
+{
+    phrase_index_t *index = calloc(1, sizeof(phrase_index_t));
+    if (!index) {
+        return NULL;
+    }
+
+    // Root
+    if (new_node(index, -1) < 0) {
+        free(index);
+        return NULL;
+    }
+    index->built = true;
+
+    return index;
+}
+
+static bool add_variants(phrase_index_t *index, const char *word, int len, int word_id)
+{
+    char variant[64];
+    if (len < FUZZY_MIN_WORD || len > (int)sizeof(variant)) {
+        return true;
+    }
+
+    for (int i = 0; i < len; i++) {
+        memcpy(variant, word, (size_t)i);
+        memcpy(variant + i, word + i + 1, (size_t)(len - i - 1));
+
+        uint32_t hash = hash_bytes(variant, len - 1);
+        int slot = map_find(&index->variants, variant, len - 1, hash);
+        if (slot < 0) {
+            if (!grow((void **)&index->variant_words, &index->variant_capacity,
+                      index->variant_count + 1, sizeof(struct int_list))) {
+                return false;
+            }
+            slot = index->variant_count;
+            memset(&index->variant_words[slot], 0, sizeof(struct int_list));
+            if (!map_insert(&index->variants, variant, len - 1, hash, slot)) {
+                return false;
+            }
+            index->variant_count++;
+        }
+        if (!int_list_push(&index->variant_words[slot], word_id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns: Word id, or -1 on allocation failure
+static int intern_word(phrase_index_t *index, const char *word, int len)
+{
+    uint32_t hash = hash_bytes(word, len);
+    int id = map_find(&index->words, word, len, hash);
+    if (id >= 0) {
+        return id;
+    }
+
+    if (!grow((void **)&index->postings, &index->word_capacity, index->word_count + 1,
+              sizeof(struct posting_list))) {
+        return -1;
+    }
+    id = index->word_count;
+    memset(&index->postings[id], 0, sizeof(struct posting_list));
+    if (!map_insert(&index->words, word, len, hash, id) || !add_variants(index, word, len, id)) {
+        return -1;
+    }
+    index->word_count++;
+    return id;
+}
+
+bool phrase_index_add(phrase_index_t *index, const char *phrase, int id)
+{
+    if (!index || !phrase) {
+        return false;
+    }
+
+    int word_ids[PHRASE_INDEX_MAX_WORDS];
+    int words = 0;
+    for (const char *p = phrase; *p;) {
+        if (*p == ' ') {
+            p++;
+            continue;
+        }
+        int len = 0;
+        while (p[len] && p[len] != ' ') {
+            len++;
+        }
+        if (words == PHRASE_INDEX_MAX_WORDS) {
+            return false;
+        }
+        word_ids[words] = intern_word(index, p, len);
+        if (word_ids[words] < 0) {
+            return false;
+        }
+        words++;
+        p += len;
+    }
+    if (!words || !grow((void **)&index->phrases, &index->phrase_capacity,
+                        index->phrase_count + 1, sizeof(struct phrase_info))) {
+        return false;
+    }
+
+    int phrase_slot = index->phrase_count;
+    for (int k = 0; k < words; k++) {
+        struct posting_list *list = &index->postings[word_ids[k]];
+        if (!grow((void **)&list->items, &list->capacity, list->count + 1, sizeof(struct posting))) {
+            return false;
+        }
+        list->items[list->count].phrase = phrase_slot;
+        list->items[list->count].position = k;
+        list->count++;
+    }
+
+    int node = 0;
+    for (int k = 0; k < words; k++) {
+        int child = edge_find(&index->edges, node, word_ids[k]);
+        if (child < 0) {
+            child = new_node(index, word_ids[k]);
+            if (child < 0 || !edge_insert(&index->edges, node, word_ids[k], child)) {
+                return false;
+            }
+            index->nodes[child].next_sibling = index->nodes[node].first_child;
+            index->nodes[node].first_child = child;
+        }
+        node = child;
+    }
+    if (index->nodes[node].output < 0) {
+        index->nodes[node].output = phrase_slot;
+    }
+
+    index->phrases[phrase_slot].id = id;
+    index->phrases[phrase_slot].words = words;
+    index->phrase_count++;
+    index->built = false;
+    return true;
+}
+
+bool phrase_index_build(phrase_index_t *index)
+{
+    if (!index) {
+        return false;
+    }
+
+    int *queue = malloc((size_t)index->node_count * sizeof(int));
+    if (!queue) {
+        return false;
+    }
+
+    // Breadth-first, so every fail target is final before it is used
+    int head = 0;
+    int tail = 0;
+    for (int child = index->nodes[0].first_child; child >= 0; child = index->nodes[child].next_sibling) {
+        index->nodes[child].fail = 0;
+        index->nodes[child].dict = -1;
+        queue[tail++] = child;
+    }
+
+    while (head < tail) {
+        int node = queue[head++];
+        for (int child = index->nodes[node].first_child; child >= 0;
+             child = index->nodes[child].next_sibling) {
+            int word = index->nodes[child].word;
+            int fail = index->nodes[node].fail;
+            int target;
+            while ((target = edge_find(&index->edges, fail, word)) < 0 && fail != 0) {
+                fail = index->nodes[fail].fail;
+            }
+
+            struct trie_node *c = &index->nodes[child];
+            c->fail = target >= 0 ? target : 0;
+            c->dict = index->nodes[c->fail].output >= 0 ? c->fail : index->nodes[c->fail].dict;
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+    index->built = true;
+    return true;
+}
+
+bool phrase_index_is_built(const phrase_index_t *index)
+{
+    return index && index->built;
+}
+
+// ---------------------------------------------------------------------------
+// Matching
+
+struct candidate {
+    int phrase;           // -1 = empty slot
+    uint32_t exact_mask;  // Phrase positions seen as the exact word
+    uint32_t any_mask;    // Positions seen exactly or one edit away
+    bool sequence;        // Automaton found the whole phrase in order
+};
+
+struct accumulator {
+    struct candidate slots[ACC_SLOTS_MAX];
+    uint32_t mask;
+    int count;
+};
+
+static struct candidate *acc_get(struct accumulator *acc, int phrase)
+{
+    uint32_t i = ((uint32_t)phrase * 2654435761u) & acc->mask;
+    while (acc->slots[i].phrase >= 0) {
+        if (acc->slots[i].phrase == phrase) {
+            return &acc->slots[i];
+        }
+        i = (i + 1) & acc->mask;
+    }
+    if ((uint32_t)(acc->count + 1) * 4 > (acc->mask + 1) * 3) {
+        return NULL;
+    }
+    acc->count++;
+    acc->slots[i].phrase = phrase;
+    return &acc->slots[i];
+}
+
+static void acc_add_word(struct accumulator *acc, const phrase_index_t *index, int word, bool exact)
+{
+    const struct posting_list *list = &index->postings[word];
+    for (int i = 0; i < list->count; i++) {
+        struct candidate *candidate = acc_get(acc, list->items[i].phrase);
+        if (!candidate) {
+            return;
+        }
+        uint32_t bit = 1u << list->items[i].position;
+        candidate->any_mask |= bit;
+        if (exact) {
+            candidate->exact_mask |= bit;
+        }
+    }
+}
+
+static void acc_add_variant_words(struct accumulator *acc, const phrase_index_t *index,
+                                  const char *key, int len, int exact_word)
+{
+    int slot = map_find(&index->variants, key, len, hash_bytes(key, len));
+    if (slot < 0) {
+        return;
+    }
+    const struct int_list *list = &index->variant_words[slot];
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i] != exact_word) {
+            acc_add_word(acc, index, list->items[i], false);
+        }
+    }
+}
+
+// Phrase words within one edit of the token: the token with a character
+// dropped (insertion), a word with a character dropped (deletion), or both
+// (substitution)
+static void acc_add_fuzzy(struct accumulator *acc, const phrase_index_t *index,
+                          const char *token, int len, int exact_word)
+{
+    char variant[64];
+    if (len < FUZZY_MIN_WORD || len > (int)sizeof(variant)) {
+        return;
+    }
+
+    acc_add_variant_words(acc, index, token, len, exact_word);
+
+    for (int i = 0; i < len; i++) {
+        memcpy(variant, token, (size_t)i);
+        memcpy(variant + i, token + i + 1, (size_t)(len - i - 1));
+
+        if (len - 1 >= FUZZY_MIN_WORD) {
+            int word = map_find(&index->words, variant, len - 1, hash_bytes(variant, len - 1));
+            if (word >= 0 && word != exact_word) {
+                acc_add_word(acc, index, word, false);
+            }
+        }
+        acc_add_variant_words(acc, index, variant, len - 1, exact_word);
+    }
+}
+
+static void acc_add_part(struct accumulator *acc, const phrase_index_t *index, const char *part, int len)
+{
+    int word = map_find(&index->words, part, len, hash_bytes(part, len));
+    if (word >= 0) {
+        acc_add_word(acc, index, word, false);
+    }
+}
+
+// Phrase words run together in an unknown token, with or without a letter
+// where the space was ("savevideo", "savefvideo")
+static void acc_add_split(struct accumulator *acc, const phrase_index_t *index,
+                          const char *token, int len)
+{
+    const int min_part = FUZZY_MIN_WORD - 1;
+    for (int split = min_part; split + min_part <= len; split++) {
+        acc_add_part(acc, index, token, split);
+        acc_add_part(acc, index, token + split, len - split);
+        if (split + 1 + min_part <= len) {
+            acc_add_part(acc, index, token + split + 1, len - split - 1);
+        }
+    }
+}
+
+static int popcount32(uint32_t v)
+{
+    int count = 0;
+    while (v) {
+        v &= v - 1;
+        count++;
+    }
+    return count;
+}
+
+int phrase_index_find(const phrase_index_t *index, const char *text, int len,
+                      struct phrase_hit *hits, int max_hits)
+{
+    if (!index || !index->built) {
+        return -1;
+    }
+
+    // Sized to the phrase count so small tables don't pay for clearing 1024 slots
+    struct accumulator acc;
+    uint32_t slots = 16;
+    while (slots < ACC_SLOTS_MAX && slots < (uint32_t)index->phrase_count * 2) {
+        slots *= 2;
+    }
+    acc.mask = slots - 1;
+    acc.count = 0;
+    for (uint32_t i = 0; i < slots; i++) {
+        acc.slots[i].phrase = -1;
+        acc.slots[i].exact_mask = 0;
+        acc.slots[i].any_mask = 0;
+        acc.slots[i].sequence = false;
+    }
+
+    int state = 0;
+    for (int i = 0; i < len;) {
+        if (text[i] == ' ') {
+            i++;
+            continue;
+        }
+        const char *token = text + i;
+        int token_len = 0;
+        while (i < len && text[i] != ' ') {
+            i++;
+            token_len++;
+        }
+
+        int word = map_find(&index->words, token, token_len, hash_bytes(token, token_len));
+
+        // Automaton step; unknown words break every partial match
+        if (word < 0) {
+            state = 0;
+        } else {
+            int next;
+            while ((next = edge_find(&index->edges, state, word)) < 0 && state != 0) {
+                state = index->nodes[state].fail;
+            }
+            state = next >= 0 ? next : 0;
+        }
+        for (int node = index->nodes[state].output >= 0 ? state : index->nodes[state].dict;
+             node > 0; node = index->nodes[node].dict) {
+            struct candidate *candidate = acc_get(&acc, index->nodes[node].output);
+            if (candidate) {
+                candidate->sequence = true;
+            }
+        }
+
+        if (word >= 0) {
+            acc_add_word(&acc, index, word, true);
+        } else {
+            acc_add_split(&acc, index, token, token_len);
+        }
+        acc_add_fuzzy(&acc, index, token, token_len, word);
+    }
+
+    // Exact occurrences first, then phrases with at most one word missing
+    // (two-word phrases "say video" still reach the verifier) that the
+    // caller has to check with a real edit distance
+    int count = 0;
+    for (int pass = 0; pass < 2 && count < max_hits; pass++) {
+        for (uint32_t i = 0; i < slots && count < max_hits; i++) {
+            const struct candidate *candidate = &acc.slots[i];
+            if (candidate->phrase < 0 || candidate->sequence != (pass == 0)) {
+                continue;
+            }
+
+            const struct phrase_info *phrase = &index->phrases[candidate->phrase];
+            uint32_t full = phrase->words >= 32 ? 0xFFFFFFFFu : (1u << phrase->words) - 1;
+            int matched = popcount32(candidate->any_mask);
+            if (!candidate->sequence && matched < phrase->words - 1) {
+                continue;
+            }
+
+            hits[count].id = phrase->id;
+            hits[count].exact = candidate->sequence;
+            hits[count].all_words = candidate->exact_mask == full;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int phrase_index_vocabulary_size(const phrase_index_t *index)
+{
+    return index ? index->word_count : 0;
+}
+
+void phrase_index_destroy(phrase_index_t *index)
+{
+    if (!index) {
+        return;
+    }
+
+    for (int i = 0; i < index->word_count; i++) {
+        free(index->postings[i].items);
+    }
+    for (int i = 0; i < index->variant_count; i++) {
+        free(index->variant_words[i].items);
+    }
+    map_free(&index->words);
+    map_free(&index->variants);
+    free(index->postings);
+    free(index->variant_words);
+    free(index->phrases);
+    free(index->nodes);
+    free(index->edges.slots);
+    free(index);
+}
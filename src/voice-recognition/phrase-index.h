@@ -0,0 +1,49 @@
+#ifndef PHRASE_INDEX_H
+#define PHRASE_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Word-level index over many phrases. Phrase words are interned into IDs and
+// the phrases compiled into an Aho-Corasick automaton over those IDs, so one
+// pass over an utterance finds every exact occurrence no matter how many
+// phrases there are. Phrases with all but at most one word in the utterance,
+// exactly or one edit away (via a deletion neighbourhood), come back as
+// candidates for the caller to verify with a real edit distance.
+
+// Enough for any phrase that fits in 64 characters
+#define PHRASE_INDEX_MAX_WORDS 32
+
+typedef struct phrase_index phrase_index_t;
+
+struct phrase_hit {
+    int id;              // As passed to phrase_index_add
+    bool exact;          // The phrase occurs word for word
+    bool all_words;      // Every phrase word occurs as a whole word, in any order
+};
+
+phrase_index_t *phrase_index_create(void);
+
+// Add a phrase of space-separated words (normalized, single spaces)
+// Returns: false on allocation failure or more than PHRASE_INDEX_MAX_WORDS words
+bool phrase_index_add(phrase_index_t *index, const char *phrase, int id);
+
+// Link the automaton; call once after the last add. Adding again afterwards
+// needs another build.
+bool phrase_index_build(phrase_index_t *index);
+
+bool phrase_index_is_built(const phrase_index_t *index);
+
+// Find the phrases an utterance may contain
+// text: Normalized utterance, words separated by single spaces
+// hits: Receives up to max_hits hits, exact ones first
+// Returns: Number of hits written, or -1 if the index isn't built
+int phrase_index_find(const phrase_index_t *index, const char *text, int len,
+                      struct phrase_hit *hits, int max_hits);
+
+// Distinct words across all phrases
+int phrase_index_vocabulary_size(const phrase_index_t *index);
+
+void phrase_index_destroy(phrase_index_t *index);
+
+#endif // PHRASE_INDEX_H
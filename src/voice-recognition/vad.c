@@ -0,0 +1,303 @@
+#include "vad.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 10ms at 16kHz, the pipeline's frame size
+#define VAD_FRAME_SAMPLES 160
+
+// Consecutive speech frames needed to open (rejects clicks and pops)
+#define ONSET_FRAMES 2
+
+// Above this fraction of sign changes a frame looks like hiss, not voice
+#define MAX_SPEECH_ZCR 0.35f
+
+// The floor never drops below this, so digital silence doesn't turn the
+// slightest noise into "speech" (roughly 10 LSB RMS)
+#define MIN_FLOOR_DB 20.0f
+
+// Noise floor smoothing per frame: fast to fall, slow to rise, and very
+// slow while the gate is open so sustained game audio is eventually
+// treated as background
+#define FLOOR_FALL_RATE 0.2f
+#define FLOOR_RISE_RATE 0.01f
+#define FLOOR_OPEN_RATE 0.0005f
+
+struct vad {
+    struct vad_config config;
+    int hangover_frames;
+
+    // Adaptive background level
+    float noise_floor_db;
+    bool floor_valid;
+
+    // Gate state
+    bool open;
+    int speech_run;
+    int silence_run;
+    uint64_t speech_end_frame;   // frames_total just after the last speech frame
+
+    // Frame being assembled from input that isn't frame-aligned
+    short frame[VAD_FRAME_SAMPLES];
+    int frame_fill;
+
+    // Most recent gated frames, replayed when the gate opens
+    short *preroll;
+    int preroll_frames;
+    int preroll_head;
+    int preroll_count;
+
+    struct vad_stats stats;
+};
+
+void vad_config_default(struct vad_config *config)
+{
+    config->hangover_ms = VAD_DEFAULT_HANGOVER_MS;
+    config->preroll_ms = VAD_DEFAULT_PREROLL_MS;
+    config->threshold_db = VAD_DEFAULT_THRESHOLD_DB;
+}
+
+vad_t *vad_create(const struct vad_config *config)
+{
+    vad_t *vad = calloc(1, sizeof(vad_t));
+    if (!vad) {
+        return NULL;
+    }
+
+    if (config) {
+        vad->config = *config;
+    } else {
+        vad_config_default(&vad->config);
+    }
+
+    if (vad->config.hangover_ms < 0) vad->config.hangover_ms = 0;
+    if (vad->config.preroll_ms < 0) vad->config.preroll_ms = 0;
+    if (vad->config.threshold_db <= 0.0f) vad->config.threshold_db = VAD_DEFAULT_THRESHOLD_DB;
+
+    vad->hangover_frames = (vad->config.hangover_ms + 9) / 10;
+    vad->preroll_frames = (vad->config.preroll_ms + 9) / 10;
+
+    if (vad->preroll_frames > 0) {
+        vad->preroll = malloc((size_t)vad->preroll_frames * VAD_FRAME_SAMPLES * sizeof(short));
+        if (!vad->preroll) {
+            free(vad);
+            return NULL;
+        }
+    }
+
+    return vad;
+}
+
+static bool is_speech_frame(vad_t *vad, const short *frame)
+{
+    double energy = 0.0;
+    int crossings = 0;
+
+    for (int i = 0; i < VAD_FRAME_SAMPLES; i++) {
+        energy += (double)frame[i] * frame[i];
+        if (i > 0 && ((frame[i] >= 0) != (frame[i - 1] >= 0))) {
+            crossings++;
+        }
+    }
+
+    float level_db = (float)(10.0 * log10(energy / VAD_FRAME_SAMPLES + 1.0));
+    float zcr = (float)crossings / (VAD_FRAME_SAMPLES - 1);
+
+    if (!vad->floor_valid) {
+        vad->noise_floor_db = level_db;
+        vad->floor_valid = true;
+    }
+
+    float floor_db = vad->noise_floor_db < MIN_FLOOR_DB ? MIN_FLOOR_DB : vad->noise_floor_db;
+    float above = level_db - floor_db;
+    float threshold = vad->config.threshold_db;
+
+    // Loud frames count regardless of ZCR (fricatives, sibilants)
+    bool speech = above > threshold && (zcr < MAX_SPEECH_ZCR || above > 2.0f * threshold);
+
+    float rate;
+    if (vad->open) {
+        rate = FLOOR_OPEN_RATE;
+    } else if (speech) {
+        rate = 0.0f;
+    } else {
+        rate = level_db < vad->noise_floor_db ? FLOOR_FALL_RATE : FLOOR_RISE_RATE;
+    }
+    vad->noise_floor_db += rate * (level_db - vad->noise_floor_db);
+
+    return speech;
+}
+
+static void preroll_push(vad_t *vad, const short *frame)
+{
+    if (!vad->preroll_frames) {
+        return;
+    }
+
+    memcpy(vad->preroll + (size_t)vad->preroll_head * VAD_FRAME_SAMPLES, frame,
+           VAD_FRAME_SAMPLES * sizeof(short));
+    vad->preroll_head = (vad->preroll_head + 1) % vad->preroll_frames;
+    if (vad->preroll_count < vad->preroll_frames) {
+        vad->preroll_count++;
+    }
+}
+
+// Copy the pre-roll out oldest first and empty it
+static int preroll_drain(vad_t *vad, short *out)
+{
+    int first = (vad->preroll_head - vad->preroll_count + vad->preroll_frames) %
+                (vad->preroll_frames ? vad->preroll_frames : 1);
+    int written = 0;
+
+    for (int i = 0; i < vad->preroll_count; i++) {
+        int index = (first + i) % vad->preroll_frames;
+        memcpy(out + written, vad->preroll + (size_t)index * VAD_FRAME_SAMPLES,
+               VAD_FRAME_SAMPLES * sizeof(short));
+        written += VAD_FRAME_SAMPLES;
+    }
+
+    vad->preroll_count = 0;
+    return written;
+}
+
+// Run one complete frame through the gate
+static int process_frame(vad_t *vad, const short *frame, short *out, bool *closed)
+{
+    bool speech = is_speech_frame(vad, frame);
+    vad->stats.frames_total++;
+    if (speech) {
+        vad->speech_end_frame = vad->stats.frames_total;
+    }
+
+    if (!vad->open) {
+        vad->speech_run = speech ? vad->speech_run + 1 : 0;
+
+        if (vad->speech_run < ONSET_FRAMES) {
+            preroll_push(vad, frame);
+            return 0;
+        }
+
+        // Open: replay what led up to this frame, then the frame itself
+        vad->open = true;
+        vad->silence_run = 0;
+        vad->stats.utterances++;
+
+        int written = preroll_drain(vad, out);
+        memcpy(out + written, frame, VAD_FRAME_SAMPLES * sizeof(short));
+        written += VAD_FRAME_SAMPLES;
+        vad->stats.frames_passed += (uint64_t)(written / VAD_FRAME_SAMPLES);
+        return written;
+    }
+
+    vad->silence_run = speech ? 0 : vad->silence_run + 1;
+    if (vad->silence_run > vad->hangover_frames) {
+        vad->open = false;
+        vad->speech_run = 0;
+        if (closed) {
+            *closed = true;
+        }
+        preroll_push(vad, frame);
+        return 0;
+    }
+
+    memcpy(out, frame, VAD_FRAME_SAMPLES * sizeof(short));
+    vad->stats.frames_passed++;
+    return VAD_FRAME_SAMPLES;
+}
+
+int vad_process(vad_t *vad, const short *in, int count, short *out, bool *closed)
+{
+    if (closed) {
+        *closed = false;
+    }
+    if (!vad || !in || !out || count <= 0) {
+        return 0;
+    }
+
+    int written = 0;
+    int offset = 0;
+
+    // Finish a frame left over from the previous call
+    if (vad->frame_fill > 0) {
+        int n = VAD_FRAME_SAMPLES - vad->frame_fill;
+        if (n > count) {
+            n = count;
+        }
+        memcpy(vad->frame + vad->frame_fill, in, n * sizeof(short));
+        vad->frame_fill += n;
+        offset = n;
+
+        if (vad->frame_fill < VAD_FRAME_SAMPLES) {
+            return 0;
+        }
+        written += process_frame(vad, vad->frame, out, closed);
+        vad->frame_fill = 0;
+    }
+
+    while (offset + VAD_FRAME_SAMPLES <= count) {
+        written += process_frame(vad, in + offset, out + written, closed);
+        offset += VAD_FRAME_SAMPLES;
+    }
+
+    if (offset < count) {
+        vad->frame_fill = count - offset;
+        memcpy(vad->frame, in + offset, vad->frame_fill * sizeof(short));
+    }
+
+    return written;
+}
+
+int vad_max_output(const vad_t *vad, int count)
+{
+    if (!vad) {
+        return 0;
+    }
+    return vad->preroll_frames * VAD_FRAME_SAMPLES + count + VAD_FRAME_SAMPLES;
+}
+
+bool vad_is_open(const vad_t *vad)
+{
+    return vad && vad->open;
+}
+
+uint64_t vad_speech_end(const vad_t *vad)
+{
+    return vad ? vad->speech_end_frame * VAD_FRAME_SAMPLES : 0;
+}
+
+void vad_get_stats(const vad_t *vad, struct vad_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!vad) {
+        return;
+    }
+
+    *stats = vad->stats;
+    stats->noise_floor_db = vad->noise_floor_db;
+}
+
+void vad_reset(vad_t *vad)
+{
+    if (!vad) {
+        return;
+    }
+
+    vad->open = false;
+    vad->floor_valid = false;
+    vad->speech_run = 0;
+    vad->silence_run = 0;
+    vad->frame_fill = 0;
+    vad->preroll_head = 0;
+    vad->preroll_count = 0;
+}
+
+void vad_destroy(vad_t *vad)
+{
+    if (!vad) {
+        return;
+    }
+
+    free(vad->preroll);
+    free(vad);
+}
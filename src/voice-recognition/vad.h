@@ -0,0 +1,59 @@
+#ifndef VAD_H
+#define VAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Voice-activity gate in front of the decoder. Works on 16kHz mono s16 in
+// 10ms frames: energy against an adaptive noise floor, with zero-crossing
+// rate to reject broadband hiss. A pre-roll ring replays the audio just
+// before the gate opens so word onsets are not clipped.
+
+typedef struct vad vad_t;
+
+struct vad_config {
+    int hangover_ms;     // Keep decoding this long after speech stops
+    int preroll_ms;      // Audio replayed when the gate opens
+    float threshold_db;  // Required level above the noise floor
+};
+
+struct vad_stats {
+    uint64_t frames_total;
+    uint64_t frames_passed;   // Frames handed to the decoder (incl. pre-roll)
+    uint64_t utterances;      // Times the gate opened
+    float noise_floor_db;
+};
+
+#define VAD_DEFAULT_HANGOVER_MS 600
+#define VAD_DEFAULT_PREROLL_MS  300
+#define VAD_DEFAULT_THRESHOLD_DB 9.0f
+
+// Fill a config with the defaults above
+void vad_config_default(struct vad_config *config);
+
+vad_t *vad_create(const struct vad_config *config);
+
+// Classify `count` samples and pass through whatever should be decoded
+// out: Receives pre-roll + speech; needs vad_max_output(vad, count) samples
+// closed: Optional, set true when the gate closed during this call
+// Returns: Number of samples written to out (0 while gated)
+int vad_process(vad_t *vad, const short *in, int count, short *out, bool *closed);
+
+// Largest output vad_process can produce for `count` input samples
+int vad_max_output(const vad_t *vad, int count);
+
+// Whether the gate is currently open
+bool vad_is_open(const vad_t *vad);
+
+// Input position just past the last frame classified as speech, counted in
+// samples since vad_create (only whole frames are classified)
+uint64_t vad_speech_end(const vad_t *vad);
+
+void vad_get_stats(const vad_t *vad, struct vad_stats *stats);
+
+// Close the gate and forget the noise floor and pre-roll
+void vad_reset(vad_t *vad);
+
+void vad_destroy(vad_t *vad);
+
+#endif // VAD_H
@@ -1,33 +1,39 @@
 #include "vosk-engine.h"
+#include "model-cache.h"
 #include <vosk_api.h>
 #include <obs-module.h>
+#include <util/platform.h>
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define VOSK_SAMPLE_RATE 16000.0f
 
+// Warm-up signal: one second, fed in 100ms chunks like the live loop
+#define WARM_UP_SAMPLES 16000
+#define WARM_UP_CHUNK   1600
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 struct vosk_engine {
     VoskModel *model;
     VoskRecognizer *recognizer;
     bool initialized;
+    uint64_t resident_bytes;
 };
 
-// Grammar JSON to limit vocabulary to trigger phrases
-// This improves recognition accuracy by constraining the search space
-static const char *TRIGGER_GRAMMAR =
-    "["
-    "\"garmin save video\", "
-    "\"garmin video speichern\", "
-    "\"garmin enregistrer video\", "
-    "\"garmin\", "
-    "\"save video\", "
-    "\"video speichern\", "
-    "\"enregistrer video\", "
-    "\"[unk]\""
-    "]";
-
-vosk_engine_t *vosk_engine_create(const char *model_path)
+// Process memory growth since `start`; other threads allocate too, so this is
+// only an estimate
+static uint64_t resident_growth(uint64_t start)
+{
+    uint64_t now = os_get_proc_resident_size();
+    return now > start ? now - start : 0;
+}
+
+vosk_engine_t *vosk_engine_create(const char *model_path, const char *grammar)
 {
     vosk_engine_t *engine = calloc(1, sizeof(vosk_engine_t));
     if (!engine) {
@@ -37,10 +43,8 @@ vosk_engine_t *vosk_engine_create(const char *model_path)
     // Set Vosk log level (0 = errors only)
     vosk_set_log_level(0);
 
-    blog(LOG_INFO, "[Garmin Replay] Loading Vosk model from: %s", model_path);
-
-    // Load the model
-    engine->model = vosk_model_new(model_path);
+    // Shared model, only read from disk the first time this path is used
+    engine->model = model_cache_acquire(model_path);
     if (!engine->model) {
         blog(LOG_ERROR, "[Garmin Replay] Failed to load Vosk model from: %s", model_path);
         blog(LOG_ERROR, "[Garmin Replay] Please download a model from https://alphacephei.com/vosk/models");
@@ -48,12 +52,16 @@ vosk_engine_t *vosk_engine_create(const char *model_path)
         return NULL;
     }
 
+    uint64_t start_resident = os_get_proc_resident_size();
+
     // Create recognizer with grammar for better accuracy
     // The grammar limits what the recognizer will output
-    engine->recognizer = vosk_recognizer_new_grm(
-        engine->model,
-        VOSK_SAMPLE_RATE,
-        TRIGGER_GRAMMAR);
+    if (grammar) {
+        engine->recognizer = vosk_recognizer_new_grm(
+            engine->model,
+            VOSK_SAMPLE_RATE,
+            grammar);
+    }
 
     if (!engine->recognizer) {
         blog(LOG_WARNING, "[Garmin Replay] Grammar mode not available, using standard recognizer");
@@ -63,7 +71,7 @@ vosk_engine_t *vosk_engine_create(const char *model_path)
 
     if (!engine->recognizer) {
         blog(LOG_ERROR, "[Garmin Replay] Failed to create Vosk recognizer");
-        vosk_model_free(engine->model);
+        model_cache_release(engine->model);
         free(engine);
         return NULL;
     }
@@ -71,6 +79,7 @@ vosk_engine_t *vosk_engine_create(const char *model_path)
     // Enable word timestamps for better phrase detection
     vosk_recognizer_set_words(engine->recognizer, 1);
 
+    engine->resident_bytes = resident_growth(start_resident);
     engine->initialized = true;
     blog(LOG_INFO, "[Garmin Replay] Vosk engine initialized successfully");
 
@@ -97,6 +106,15 @@ const char *vosk_engine_get_result(vosk_engine_t *engine)
     return vosk_recognizer_result(engine->recognizer);
 }
 
+const char *vosk_engine_get_final_result(vosk_engine_t *engine)
+{
+    if (!engine || !engine->initialized || !engine->recognizer) {
+        return NULL;
+    }
+
+    return vosk_recognizer_final_result(engine->recognizer);
+}
+
 const char *vosk_engine_get_partial_result(vosk_engine_t *engine)
 {
     if (!engine || !engine->initialized || !engine->recognizer) {
@@ -106,6 +124,74 @@ const char *vosk_engine_get_partial_result(vosk_engine_t *engine)
     return vosk_recognizer_partial_result(engine->recognizer);
 }
 
+void vosk_engine_warm_up(vosk_engine_t *engine)
+{
+    if (!engine || !engine->initialized || !engine->recognizer) {
+        return;
+    }
+
+    // Voiced-sounding harmonics with a gliding pitch plus a little noise,
+    // enough to push the decoder through feature extraction and search
+    uint64_t start_resident = os_get_proc_resident_size();
+    short chunk[WARM_UP_CHUNK];
+    unsigned int seed = 1;
+    double phase = 0.0;
+
+    for (int offset = 0; offset < WARM_UP_SAMPLES; offset += WARM_UP_CHUNK) {
+        for (int i = 0; i < WARM_UP_CHUNK; i++) {
+            double t = (double)(offset + i) / VOSK_SAMPLE_RATE;
+            phase += 2.0 * M_PI * (120.0 + 80.0 * t) / VOSK_SAMPLE_RATE;
+            seed = seed * 1103515245u + 12345u;
+            double noise = (double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0;
+            double v = 4000.0 * sin(phase) + 2000.0 * sin(3.0 * phase) + 300.0 * noise;
+            chunk[i] = (short)v;
+        }
+        vosk_recognizer_accept_waveform_s(engine->recognizer, chunk, WARM_UP_CHUNK);
+    }
+
+    vosk_recognizer_final_result(engine->recognizer);
+    vosk_recognizer_reset(engine->recognizer);
+
+    // The decoder sizes its buffers on first use
+    engine->resident_bytes += resident_growth(start_resident);
+}
+
+uint64_t vosk_engine_get_resident_bytes(const vosk_engine_t *engine)
+{
+    return engine ? engine->resident_bytes : 0;
+}
+
+bool vosk_engine_set_endpoint_mode(vosk_engine_t *engine, enum vosk_endpoint_mode mode)
+{
+    if (!engine || !engine->initialized || !engine->recognizer) {
+        return false;
+    }
+
+#ifdef HAVE_VOSK_ENDPOINTER
+    vosk_recognizer_set_endpointer_mode(engine->recognizer, (VoskEndpointerMode)mode);
+    return true;
+#else
+    // Older libvosk releases don't export the endpointer API
+    (void)mode;
+    return false;
+#endif
+}
+
+bool vosk_engine_set_grammar(vosk_engine_t *engine, const char *grammar)
+{
+    if (!engine || !engine->initialized || !engine->recognizer || !grammar) {
+        return false;
+    }
+
+#ifdef HAVE_VOSK_SET_GRM
+    // Recompiles only the grammar FST; the decoder and its buffers stay
+    vosk_recognizer_set_grm(engine->recognizer, grammar);
+    return true;
+#else
+    return false;
+#endif
+}
+
 void vosk_engine_reset(vosk_engine_t *engine)
 {
     if (engine && engine->recognizer) {
@@ -123,9 +209,8 @@ void vosk_engine_destroy(vosk_engine_t *engine)
         vosk_recognizer_free(engine->recognizer);
     }
 
-    if (engine->model) {
-        vosk_model_free(engine->model);
-    }
+    // The model stays cached for the next engine
+    model_cache_release(engine->model);
 
     free(engine);
 
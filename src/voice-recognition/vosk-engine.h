@@ -2,14 +2,17 @@
 #define VOSK_ENGINE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // Opaque handle to Vosk engine instance
 typedef struct vosk_engine vosk_engine_t;
 
 // Create a new Vosk engine instance
 // model_path: Path to the Vosk model directory
+// grammar: JSON list of phrases to restrict recognition to, or NULL for
+//          the model's full vocabulary
 // Returns: Engine instance, or NULL on failure
-vosk_engine_t *vosk_engine_create(const char *model_path);
+vosk_engine_t *vosk_engine_create(const char *model_path, const char *grammar);
 
 // Process audio samples through the recognizer
 // samples: 16-bit signed PCM samples at 16kHz mono
@@ -21,9 +24,37 @@ int vosk_engine_process(vosk_engine_t *engine, const short *samples, int count);
 // The returned string is valid until the next call to process or get_result
 const char *vosk_engine_get_result(vosk_engine_t *engine);
 
+// Flush the recognizer and get the result for any pending audio (JSON string)
+// Use at end of stream, when no trailing silence will trigger an endpoint
+const char *vosk_engine_get_final_result(vosk_engine_t *engine);
+
 // Get partial recognition result (JSON string)
 const char *vosk_engine_get_partial_result(vosk_engine_t *engine);
 
+// Decode a second of synthetic audio and discard the result, so lazy
+// initialization and model page-in happen before the first real command
+void vosk_engine_warm_up(vosk_engine_t *engine);
+
+// Memory the recognizer added on top of the shared model, measured as
+// process growth while it was created and warmed up (approximate)
+uint64_t vosk_engine_get_resident_bytes(const vosk_engine_t *engine);
+
+// How much trailing silence ends an utterance, mirrors Vosk's VoskEndpointerMode
+enum vosk_endpoint_mode {
+    VOSK_ENDPOINT_DEFAULT,
+    VOSK_ENDPOINT_SHORT,       // Shortest silence, lowest latency for short commands
+    VOSK_ENDPOINT_LONG,
+    VOSK_ENDPOINT_VERY_LONG,
+};
+
+// Change the endpointer timing
+// Returns: false if the linked Vosk build has no endpointer control
+bool vosk_engine_set_endpoint_mode(vosk_engine_t *engine, enum vosk_endpoint_mode mode);
+
+// Swap the grammar of a live recognizer without rebuilding it
+// Returns: false if the linked Vosk build has no vosk_recognizer_set_grm
+bool vosk_engine_set_grammar(vosk_engine_t *engine, const char *grammar);
+
 // Reset the recognizer for the next utterance
 void vosk_engine_reset(vosk_engine_t *engine);
 
@@ -0,0 +1,418 @@
+#include "vosk-json.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Deeper nesting than this is never produced by Vosk; reject rather than recurse
+#define MAX_DEPTH 16
+
+struct cursor {
+    const char *p;
+    const char *end;
+};
+
+static void skip_ws(struct cursor *c)
+{
+    // All four JSON whitespace characters are <= ' ', nothing else that low
+    // is valid outside a string
+    while (c->p < c->end && (unsigned char)*c->p <= ' ') {
+        c->p++;
+    }
+}
+
+// Consume `ch` after optional whitespace
+static bool expect(struct cursor *c, char ch)
+{
+    skip_ws(c);
+    if (c->p < c->end && *c->p == ch) {
+        c->p++;
+        return true;
+    }
+    return false;
+}
+
+static bool is_hex(char ch)
+{
+    return (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
+
+static bool parse_string(struct cursor *c, struct vosk_json_view *view)
+{
+    if (!expect(c, '"')) {
+        return false;
+    }
+
+    const char *start = c->p;
+    for (;;) {
+        // memchr is vectorized; escapes are rare enough to step over singly
+        const char *quote = memchr(c->p, '"', (size_t)(c->end - c->p));
+        if (!quote) {
+            return false;
+        }
+        const char *backslash = memchr(c->p, '\\', (size_t)(quote - c->p));
+        if (!backslash) {
+            view->ptr = start;
+            view->len = (int)(quote - start);
+            c->p = quote + 1;
+            return true;
+        }
+
+        c->p = backslash;
+        if (c->end - c->p < 2) {
+            return false;
+        }
+        if (c->p[1] == 'u') {
+            if (c->end - c->p < 6 || !is_hex(c->p[2]) || !is_hex(c->p[3]) ||
+                !is_hex(c->p[4]) || !is_hex(c->p[5])) {
+                return false;
+            }
+            c->p += 6;
+        } else {
+            c->p += 2;
+        }
+    }
+}
+
+// JSON number grammar, accumulated in integers and scaled once at the end;
+// strtod would follow the process locale
+static bool parse_number(struct cursor *c, double *out)
+{
+    static const double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+    };
+
+    skip_ws(c);
+
+    bool negative = false;
+    if (c->p < c->end && *c->p == '-') {
+        negative = true;
+        c->p++;
+    }
+
+    if (c->p >= c->end || *c->p < '0' || *c->p > '9') {
+        return false;
+    }
+
+    // Digits past the 18th only shift the decimal point
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+        if (digits < 18) {
+            mantissa = mantissa * 10 + (uint64_t)(*c->p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+        c->p++;
+    }
+
+    if (c->p < c->end && *c->p == '.') {
+        c->p++;
+        if (c->p >= c->end || *c->p < '0' || *c->p > '9') {
+            return false;
+        }
+        while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+            if (digits < 18) {
+                mantissa = mantissa * 10 + (uint64_t)(*c->p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+            c->p++;
+        }
+    }
+
+    if (c->p < c->end && (*c->p == 'e' || *c->p == 'E')) {
+        c->p++;
+        int exp_sign = 1;
+        if (c->p < c->end && (*c->p == '+' || *c->p == '-')) {
+            exp_sign = *c->p == '-' ? -1 : 1;
+            c->p++;
+        }
+        if (c->p >= c->end || *c->p < '0' || *c->p > '9') {
+            return false;
+        }
+        int value = 0;
+        while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+            if (value < 10000) {
+                value = value * 10 + (*c->p - '0');
+            }
+            c->p++;
+        }
+        exponent += exp_sign * value;
+    }
+
+    double value = (double)mantissa;
+    while (exponent > 0 && value != 0.0) {
+        int step = exponent > 18 ? 18 : exponent;
+        value *= POW10[step];
+        exponent -= step;
+        if (value > 1e300) {
+            break;
+        }
+    }
+    while (exponent < 0 && value != 0.0) {
+        int step = -exponent > 18 ? 18 : -exponent;
+        value /= POW10[step];
+        exponent += step;
+    }
+
+    *out = negative ? -value : value;
+    return true;
+}
+
+static bool skip_literal(struct cursor *c, const char *literal)
+{
+    size_t len = strlen(literal);
+    if ((size_t)(c->end - c->p) < len || memcmp(c->p, literal, len) != 0) {
+        return false;
+    }
+    c->p += len;
+    return true;
+}
+
+// Step over any value the caller has no use for
+static bool skip_value(struct cursor *c, int depth)
+{
+    if (depth > MAX_DEPTH) {
+        return false;
+    }
+
+    skip_ws(c);
+    if (c->p >= c->end) {
+        return false;
+    }
+
+    struct vosk_json_view view;
+    double number;
+
+    switch (*c->p) {
+    case '"':
+        return parse_string(c, &view);
+    case '{':
+        c->p++;
+        if (expect(c, '}')) {
+            return true;
+        }
+        do {
+            if (!parse_string(c, &view) || !expect(c, ':') || !skip_value(c, depth + 1)) {
+                return false;
+            }
+        } while (expect(c, ','));
+        return expect(c, '}');
+    case '[':
+        c->p++;
+        if (expect(c, ']')) {
+            return true;
+        }
+        do {
+            if (!skip_value(c, depth + 1)) {
+                return false;
+            }
+        } while (expect(c, ','));
+        return expect(c, ']');
+    case 't':
+        return skip_literal(c, "true");
+    case 'f':
+        return skip_literal(c, "false");
+    case 'n':
+        return skip_literal(c, "null");
+    default:
+        return parse_number(c, &number);
+    }
+}
+
+static bool view_is(const struct vosk_json_view *view, const char *key)
+{
+    size_t len = strlen(key);
+    return (size_t)view->len == len && memcmp(view->ptr, key, len) == 0;
+}
+
+// {"conf" : 1.0, "end" : 1.11, "start" : 0.87, "word" : "what"}
+static bool parse_word(struct cursor *c, struct vosk_json_word *word)
+{
+    memset(word, 0, sizeof(*word));
+    word->conf = 1.0f;   // Absent when the model has no confidence scores
+
+    if (!expect(c, '{')) {
+        return false;
+    }
+    if (expect(c, '}')) {
+        return true;
+    }
+
+    do {
+        struct vosk_json_view key;
+        if (!parse_string(c, &key) || !expect(c, ':')) {
+            return false;
+        }
+
+        double number;
+        if (view_is(&key, "word")) {
+            if (!parse_string(c, &word->word)) {
+                return false;
+            }
+        } else if (view_is(&key, "conf") || view_is(&key, "start") || view_is(&key, "end")) {
+            if (!parse_number(c, &number)) {
+                return false;
+            }
+            if (key.ptr[0] == 'c') {
+                word->conf = (float)number;
+            } else if (key.ptr[0] == 's') {
+                word->start = (float)number;
+            } else {
+                word->end = (float)number;
+            }
+        } else if (!skip_value(c, 2)) {
+            return false;
+        }
+    } while (expect(c, ','));
+
+    return expect(c, '}');
+}
+
+static bool parse_words(struct cursor *c, struct vosk_json_result *result)
+{
+    if (!expect(c, '[')) {
+        return false;
+    }
+    if (expect(c, ']')) {
+        return true;
+    }
+
+    do {
+        struct vosk_json_word word;
+        if (!parse_word(c, &word)) {
+            return false;
+        }
+        if (result->word_count < VOSK_JSON_MAX_WORDS) {
+            result->words[result->word_count++] = word;
+        }
+        result->words_total++;
+    } while (expect(c, ','));
+
+    return expect(c, ']');
+}
+
+bool vosk_json_parse(const char *json, size_t len, struct vosk_json_result *result)
+{
+    // The word array is only valid up to word_count, no need to clear it
+    result->text.ptr = NULL;
+    result->text.len = 0;
+    result->partial = false;
+    result->word_count = 0;
+    result->words_total = 0;
+    if (!json) {
+        return false;
+    }
+
+    struct cursor c = {json, json + len};
+
+    if (!expect(&c, '{')) {
+        return false;
+    }
+    if (expect(&c, '}')) {
+        return true;
+    }
+
+    do {
+        struct vosk_json_view key;
+        if (!parse_string(&c, &key) || !expect(&c, ':')) {
+            return false;
+        }
+
+        if (view_is(&key, "text") || view_is(&key, "partial")) {
+            if (!parse_string(&c, &result->text)) {
+                return false;
+            }
+            result->partial = key.ptr[0] == 'p';
+        } else if (view_is(&key, "result") || view_is(&key, "partial_result")) {
+            if (!parse_words(&c, result)) {
+                return false;
+            }
+        } else if (!skip_value(&c, 1)) {
+            // "alternatives", "spk" and anything newer
+            return false;
+        }
+    } while (expect(&c, ','));
+
+    return expect(&c, '}');
+}
+
+static int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    return ch - 'A' + 10;
+}
+
+int vosk_json_copy(const struct vosk_json_view *view, char *out, int max_len)
+{
+    int j = 0;
+    if (max_len <= 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < view->len && j < max_len - 1; i++) {
+        char ch = view->ptr[i];
+        if (ch != '\\' || i + 1 >= view->len) {
+            out[j++] = ch;
+            continue;
+        }
+
+        ch = view->ptr[++i];
+        switch (ch) {
+        case 'n': out[j++] = '\n'; break;
+        case 't': out[j++] = '\t'; break;
+        case 'r': out[j++] = '\r'; break;
+        case 'b': out[j++] = '\b'; break;
+        case 'f': out[j++] = '\f'; break;
+        case 'u': {
+            if (i + 4 >= view->len) {
+                i = view->len;
+                break;
+            }
+            unsigned int code = 0;
+            for (int k = 1; k <= 4; k++) {
+                code = (code << 4) | (unsigned int)hex_value(view->ptr[i + k]);
+            }
+            i += 4;
+
+            // Basic plane only; a surrogate half becomes '?'
+            char utf8[3];
+            int n;
+            if (code < 0x80) {
+                utf8[0] = (char)code;
+                n = 1;
+            } else if (code < 0x800) {
+                utf8[0] = (char)(0xC0 | (code >> 6));
+                utf8[1] = (char)(0x80 | (code & 0x3F));
+                n = 2;
+            } else if (code >= 0xD800 && code <= 0xDFFF) {
+                utf8[0] = '?';
+                n = 1;
+            } else {
+                utf8[0] = (char)(0xE0 | (code >> 12));
+                utf8[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+                utf8[2] = (char)(0x80 | (code & 0x3F));
+                n = 3;
+            }
+            if (j + n > max_len - 1) {
+                i = view->len;
+                break;
+            }
+            memcpy(out + j, utf8, n);
+            j += n;
+            break;
+        }
+        default:
+            // \" \\ \/
+            out[j++] = ch;
+            break;
+        }
+    }
+
+    out[j] = '\0';
+    return j;
+}
@@ -0,0 +1,45 @@
+#ifndef VOSK_JSON_H
+#define VOSK_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Single-pass tokenizer for the JSON Vosk returns from result, final_result
+// and partial_result. Nothing is copied or allocated: strings come back as
+// views into the input with escapes left in place. Numbers are parsed by
+// hand, so the process locale (decimal comma in de/fr) doesn't matter.
+
+// Words kept from the "result" array; the rest are counted but dropped
+#define VOSK_JSON_MAX_WORDS 32
+
+// Bytes of a JSON string between its quotes, still escaped
+struct vosk_json_view {
+    const char *ptr;
+    int len;
+};
+
+// One entry of the word array that vosk_recognizer_set_words(..., 1) adds
+struct vosk_json_word {
+    struct vosk_json_view word;
+    float conf;    // 0..1
+    float start;   // Seconds since the recognizer started
+    float end;
+};
+
+struct vosk_json_result {
+    struct vosk_json_view text;   // "text", or "partial" for partial results
+    bool partial;
+    struct vosk_json_word words[VOSK_JSON_MAX_WORDS];
+    int word_count;               // Entries filled in words
+    int words_total;              // Entries in the JSON, may exceed word_count
+};
+
+// Parse `len` bytes of Vosk JSON (no terminator needed)
+// Returns: false on malformed input; result then holds whatever was read
+bool vosk_json_parse(const char *json, size_t len, struct vosk_json_result *result);
+
+// Unescape a view into `out` (always NUL-terminated)
+// Returns: Bytes written, excluding the terminator
+int vosk_json_copy(const struct vosk_json_view *view, char *out, int max_len);
+
+#endif // VOSK_JSON_H
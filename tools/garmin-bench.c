@@ -0,0 +1,2165 @@
+// Microbenchmarks for the audio and matching hot paths, with correctness
+// checks against reference implementations.
+// Usage: garmin-bench [--json] [case-name-filter]
+// --json writes the timings as JSON to stdout (everything else to stderr).
+// The exit status is 1 if any check failed.
+// The "grammar" case needs a build with Vosk and GARMIN_BENCH_MODEL=<Vosk
+// model directory>.
+
+#include "audio-capture/audio-convert.h"
+#include "audio-capture/audio-source.h"
+#include "audio-capture/capture-scratch.h"
+#include "audio-capture/resampler.h"
+#include "audio-capture/fft.h"
+#include "audio-capture/echo-canceller.h"
+#include "audio-capture/noise-suppressor.h"
+#include "audio-capture/auto-gain.h"
+#include "voice-recognition/vad.h"
+#include "voice-recognition/keyword-spotter.h"
+#include "voice-recognition/fuzzy-match.h"
+#include "voice-recognition/vosk-json.h"
+#include "voice-recognition/command-table.h"
+#include "voice-recognition/phrase-detector.h"
+#include "voice-recognition/phrase-index.h"
+#include "replay-control/trigger-arbiter.h"
+#include "diagnostics/pipeline-stats.h"
+#include "compat/obs-compat.h"
+
+#ifdef HAVE_VOSK
+#include "voice-recognition/vosk-engine.h"
+#include "voice-recognition/model-cache.h"
+#endif
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// One WASAPI shared-mode period
+#define PACKET_MS 10
+
+struct bench_case {
+    const char *name;
+    void (*run)(void);
+};
+
+static bool g_json;
+static int g_reported;
+static int g_failures;
+
+static void report(const char *name, uint64_t elapsed_ns, uint64_t ops, const char *unit)
+{
+    double ns_per_op = ops ? (double)elapsed_ns / (double)ops : 0.0;
+    double per_sec = elapsed_ns ? (double)ops * 1e9 / (double)elapsed_ns : 0.0;
+    if (g_json) {
+        printf("%s\n    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"unit\": \"%s\", \"ops\": %llu}",
+               g_reported ? "," : "", name, ns_per_op, unit, (unsigned long long)ops);
+    } else {
+        printf("%-40s %10.2f ns/%s %14.0f %s/s\n", name, ns_per_op, unit, per_sec, unit);
+    }
+    g_reported++;
+}
+
+// Everything besides timings; kept out of the way of the JSON
+static void note(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(g_json ? stderr : stdout, format, args);
+    va_end(args);
+}
+
+// A correctness check; failures show up in the exit status
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        note("%-40s FAILED\n", what);
+        g_failures++;
+    }
+}
+
+static void fill_test_signal(short *buf, int count, int rate, unsigned int seed)
+{
+    // Speech-band tones plus noise, roughly -12 dBFS
+    for (int i = 0; i < count; i++) {
+        double t = (double)i / rate;
+        double v = 0.25 * sin(2.0 * M_PI * 220.0 * t) +
+                   0.15 * sin(2.0 * M_PI * 1330.0 * t) +
+                   0.05 * sin(2.0 * M_PI * 3170.0 * t);
+        seed = seed * 1103515245u + 12345u;
+        v += 0.02 * ((double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0);
+        buf[i] = (short)(v * 32767.0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Resampler
+
+// Per-packet linear interpolation, as wasapi-capture.c did before the
+// polyphase resampler (kept here as the speed baseline)
+static int legacy_resample_linear(const short *src, int src_len, int src_rate,
+                                  short *dst, int dst_max, int dst_rate)
+{
+    double ratio = (double)src_rate / (double)dst_rate;
+    int dst_len = (int)(src_len / ratio);
+    if (dst_len > dst_max) {
+        dst_len = dst_max;
+    }
+
+    for (int i = 0; i < dst_len; i++) {
+        double src_idx = i * ratio;
+        int idx0 = (int)src_idx;
+        int idx1 = idx0 + 1;
+        if (idx1 >= src_len) idx1 = src_len - 1;
+
+        double frac = src_idx - idx0;
+        dst[i] = (short)(src[idx0] * (1.0 - frac) + src[idx1] * frac);
+    }
+
+    return dst_len;
+}
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Direct double-precision evaluation of the same windowed-sinc design,
+// one output at a time over the whole signal (no polyphase, no streaming)
+static void reference_resample(const short *src, int src_len, int src_rate,
+                               double *dst, int dst_len, int dst_rate, int taps_per_phase)
+{
+    int g = src_rate, b = dst_rate;
+    while (b) {
+        int t = g % b;
+        g = b;
+        b = t;
+    }
+    int up = dst_rate / g, down = src_rate / g;
+    int length = up * taps_per_phase;
+    double cutoff = 0.5 * 0.92 / (up > down ? up : down);
+    double center = (length - 1) / 2.0;
+    double i0_beta = bessel_i0(8.0);
+
+    for (int n = 0; n < dst_len; n++) {
+        long long t = (long long)n * down;
+        long long index = t / up;
+        int phase = (int)(t % up);
+        double acc = 0.0;
+        for (int k = 0; k < taps_per_phase; k++) {
+            long long x_index = index - k;
+            if (x_index < 0 || x_index >= src_len) {
+                continue;
+            }
+            double j = phase + (double)k * up - center;
+            double x = 2.0 * cutoff * j;
+            double sinc = fabs(x) < 1e-12 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double r = j / (length / 2.0);
+            double w = fabs(r) >= 1.0 ? 0.0 : bessel_i0(8.0 * sqrt(1.0 - r * r)) / i0_beta;
+            acc += src[x_index] * up * 2.0 * cutoff * sinc * w;
+        }
+        dst[n] = acc;
+    }
+}
+
+static void bench_resampler_rate(int src_rate)
+{
+    const int seconds = 10;
+    const int src_len = src_rate * seconds;
+    const int packet = src_rate * PACKET_MS / 1000;
+    const int dst_cap = 16000 * seconds + 64;
+
+    short *src = malloc(src_len * sizeof(short));
+    short *dst = malloc(dst_cap * sizeof(short));
+    fill_test_signal(src, src_len, src_rate, 1);
+
+    char name[64];
+
+    // Legacy per-packet linear interpolation
+    uint64_t start = os_gettime_ns();
+    int produced = 0;
+    for (int off = 0; off + packet <= src_len; off += packet) {
+        produced += legacy_resample_linear(src + off, packet, src_rate,
+                                           dst + produced, dst_cap - produced, 16000);
+    }
+    snprintf(name, sizeof(name), "resample_linear %dk->16k", src_rate / 1000);
+    report(name, os_gettime_ns() - start, (uint64_t)src_len, "sample");
+
+    // Streaming polyphase, same packetization
+    resampler_t *rs = resampler_create(src_rate, 16000);
+    start = os_gettime_ns();
+    produced = 0;
+    for (int off = 0; off + packet <= src_len; off += packet) {
+        produced += resampler_process(rs, src + off, packet,
+                                      dst + produced, dst_cap - produced);
+    }
+    snprintf(name, sizeof(name), "resampler_process %dk->16k (%d taps)",
+             src_rate / 1000, resampler_get_taps(rs));
+    report(name, os_gettime_ns() - start, (uint64_t)src_len, "sample");
+
+    // Accuracy: stream the first second in uneven chunks and compare
+    // against the direct evaluation over the unsplit signal
+    const int check_src = src_rate;
+    const int check_dst = 16000;
+    double *ref = malloc(check_dst * sizeof(double));
+    reference_resample(src, check_src, src_rate, ref, check_dst, 16000, resampler_get_taps(rs));
+
+    resampler_reset(rs);
+    produced = 0;
+    int chunk = 1;
+    for (int off = 0; off < check_src; off += chunk, chunk = chunk * 7 % 613 + 1) {
+        int len = off + chunk <= check_src ? chunk : check_src - off;
+        produced += resampler_process(rs, src + off, len, dst + produced, dst_cap - produced);
+    }
+
+    double max_err = 0.0, err_energy = 0.0, sig_energy = 0.0;
+    int compared = produced < check_dst ? produced : check_dst;
+    for (int i = 0; i < compared; i++) {
+        double ref_clamped = ref[i] > 32767.0 ? 32767.0 : (ref[i] < -32768.0 ? -32768.0 : ref[i]);
+        double err = fabs(dst[i] - ref_clamped);
+        if (err > max_err) max_err = err;
+        err_energy += err * err;
+        sig_energy += ref_clamped * ref_clamped;
+    }
+    note("%-40s max error %.2f LSB, SNR %.1f dB over %d samples\n", "  accuracy vs reference",
+           max_err, err_energy > 0.0 ? 10.0 * log10(sig_energy / err_energy) : 999.0, compared);
+    // Off by at most rounding of the output sample
+    check(max_err <= 1.0 && compared == check_dst, name);
+
+    resampler_destroy(rs);
+    free(ref);
+    free(src);
+    free(dst);
+}
+
+static void bench_resampler(void)
+{
+    bench_resampler_rate(44100);
+    bench_resampler_rate(48000);
+    bench_resampler_rate(96000);
+}
+
+// ---------------------------------------------------------------------------
+// Sample conversion + downmix
+
+#define CONVERT_FRAMES 4801   // Odd length exercises the scalar tails
+
+static void fill_convert_input(unsigned char *buf, enum audio_sample_format format,
+                               int samples, unsigned int seed)
+{
+    for (int i = 0; i < samples; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t bits = (seed >> 8) ^ (seed << 20);
+
+        if (format == AUDIO_SAMPLE_F32) {
+            // Mostly in range, with overs, exact edges and the odd NaN
+            float v = (float)((int32_t)bits) / 1.5e9f;
+            if (i % 97 == 0) v = 1.0f;
+            if (i % 101 == 0) v = -1.0f;
+            if (i % 499 == 0) v = NAN;
+            memcpy(buf + (size_t)i * 4, &v, 4);
+        } else if (format == AUDIO_SAMPLE_S32) {
+            int32_t v = (int32_t)bits;
+            if (i % 97 == 0) v = INT32_MIN;
+            if (i % 101 == 0) v = INT32_MAX;
+            memcpy(buf + (size_t)i * 4, &v, 4);
+        } else if (format == AUDIO_SAMPLE_S24) {
+            memcpy(buf + (size_t)i * 3, &bits, 3);
+        } else {
+            int16_t v = (int16_t)bits;
+            if (i % 97 == 0) v = INT16_MIN;
+            memcpy(buf + (size_t)i * 2, &v, 2);
+        }
+    }
+}
+
+static void bench_convert(void)
+{
+    static const int CHANNEL_COUNTS[] = {1, 2, 6, 8};
+    const int iterations = 200;
+
+    unsigned char *input = malloc((size_t)CONVERT_FRAMES * 8 * 4);
+    short *expected = malloc(CONVERT_FRAMES * sizeof(short));
+    short *output = malloc(CONVERT_FRAMES * sizeof(short));
+
+    enum audio_convert_isa selected;
+    audio_convert_select(AUDIO_SAMPLE_F32, &selected);
+    note("convert: runtime dispatch selects %s\n", audio_convert_isa_name(selected));
+
+    for (int f = 0; f < AUDIO_SAMPLE_FORMAT_COUNT; f++) {
+        enum audio_sample_format format = (enum audio_sample_format)f;
+
+        for (size_t c = 0; c < sizeof(CHANNEL_COUNTS) / sizeof(CHANNEL_COUNTS[0]); c++) {
+            int channels = CHANNEL_COUNTS[c];
+            fill_convert_input(input, format, CONVERT_FRAMES * channels, (unsigned int)(f * 31 + channels));
+            audio_convert_get(format, AUDIO_ISA_SCALAR)(input, expected, CONVERT_FRAMES, channels);
+
+            for (int isa = 0; isa < AUDIO_ISA_COUNT; isa++) {
+                audio_downmix_fn fn = audio_convert_get(format, (enum audio_convert_isa)isa);
+                if (!fn) {
+                    continue;
+                }
+
+                // Bit-exactness against scalar, including every tail length
+                int mismatches = 0;
+                for (int frames = CONVERT_FRAMES - 17; frames <= CONVERT_FRAMES; frames++) {
+                    memset(output, 0x55, CONVERT_FRAMES * sizeof(short));
+                    fn(input, output, frames, channels);
+                    for (int i = 0; i < frames; i++) {
+                        mismatches += output[i] != expected[i];
+                    }
+                }
+
+                uint64_t start = os_gettime_ns();
+                for (int n = 0; n < iterations; n++) {
+                    fn(input, output, CONVERT_FRAMES, channels);
+                }
+                uint64_t elapsed = os_gettime_ns() - start;
+
+                char name[64];
+                snprintf(name, sizeof(name), "convert %s %dch %s", audio_sample_format_name(format),
+                         channels, audio_convert_isa_name((enum audio_convert_isa)isa));
+                report(name, elapsed, (uint64_t)iterations * CONVERT_FRAMES, "frame");
+                if (mismatches) {
+                    note("%-40s NOT bit-exact: %d mismatches\n", "", mismatches);
+                }
+                check(mismatches == 0, name);
+            }
+        }
+    }
+
+    free(input);
+    free(expected);
+    free(output);
+}
+
+// A 48 kHz stereo float device as WASAPI sets it up in shared mode: a
+// 100 ms endpoint buffer, delivered in 10 ms periods
+#define DEVICE_RATE          48000
+#define DEVICE_BUFFER_FRAMES (DEVICE_RATE / 10)
+#define DEVICE_PERIOD_FRAMES (DEVICE_RATE * PACKET_MS / 1000)
+
+// Written to the working directory and removed afterwards
+#define CAPTURE_WAV_PATH "garmin-bench-capture.wav"
+
+static void put_le16(unsigned char *p, unsigned int value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static void put_le32(unsigned char *p, unsigned int value)
+{
+    put_le16(p, value & 0xFFFF);
+    put_le16(p + 2, value >> 16);
+}
+
+// A float WAV in the device format, so the file source converts exactly
+// what the WASAPI path does
+static bool write_device_wav(const char *path, int frames)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    unsigned int data_bytes = (unsigned int)frames * 2 * sizeof(float);
+    unsigned char header[44];
+    memcpy(header, "RIFF", 4);
+    put_le32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_le32(header + 16, 16);
+    put_le16(header + 20, 3);  // IEEE float
+    put_le16(header + 22, 2);
+    put_le32(header + 24, DEVICE_RATE);
+    put_le32(header + 28, DEVICE_RATE * 2 * sizeof(float));
+    put_le16(header + 32, 2 * sizeof(float));
+    put_le16(header + 34, 32);
+    memcpy(header + 36, "data", 4);
+    put_le32(header + 40, data_bytes);
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    float period[DEVICE_PERIOD_FRAMES * 2];
+    for (int done = 0; ok && done < frames; done += DEVICE_PERIOD_FRAMES) {
+        int n = frames - done < DEVICE_PERIOD_FRAMES ? frames - done : DEVICE_PERIOD_FRAMES;
+        for (int i = 0; i < n; i++) {
+            period[2 * i] = (float)sin((done + i) * 0.01) * 0.5f;
+            period[2 * i + 1] = (float)sin((done + i) * 0.013) * 0.5f;
+        }
+        ok = fwrite(period, sizeof(float) * 2, (size_t)n, file) == (size_t)n;
+    }
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+// The file source's read path, the one garmin-eval and --input clips use:
+// read, downmix into its capture scratch, resample out of it
+static void check_capture_read_path(void)
+{
+    const int packets = 2000;
+    if (!write_device_wav(CAPTURE_WAV_PATH, packets * DEVICE_PERIOD_FRAMES)) {
+        check(false, "capture read path");
+        return;
+    }
+
+    struct audio_source_config config = {
+        .type = AUDIO_SOURCE_FILE,
+        .path = CAPTURE_WAV_PATH,
+    };
+    void *src = file_source_ops.create(&config);
+    if (!src || !file_source_ops.start(src)) {
+        check(false, "capture read path");
+        file_source_ops.destroy(src);
+        remove(CAPTURE_WAV_PATH);
+        return;
+    }
+
+    static short output[DEVICE_BUFFER_FRAMES];
+    int reads = 0;
+    long samples = 0;
+    int result;
+    uint64_t start = os_gettime_ns();
+    while ((result = file_source_ops.read(src, output, DEVICE_BUFFER_FRAMES, NULL)) >= 0) {
+        reads++;
+        samples += result;
+    }
+    report("file source packet (48k stereo f32, 10 ms)", os_gettime_ns() - start,
+           (uint64_t)reads, "packet");
+
+    long grows = file_source_ops.get_scratch_grows(src);
+    long expected = (long)packets * AUDIO_SOURCE_SAMPLE_RATE * PACKET_MS / 1000;
+    note("%-40s %ld hot-path allocations over %d packets, %ld of %ld samples\n", "", grows,
+         reads, samples, expected);
+    check(result == AUDIO_SOURCE_END && reads == packets &&
+          labs(samples - expected) <= AUDIO_SOURCE_SAMPLE_RATE / 100, "capture read path");
+    check(grows == 0, "capture scratch steady state");
+
+    file_source_ops.stop(src);
+    file_source_ops.destroy(src);
+    remove(CAPTURE_WAV_PATH);
+}
+
+static void bench_capture_scratch(void)
+{
+    check_capture_read_path();
+
+    // A packet bigger than the device buffer grows it once, then fits
+    capture_scratch_t *scratch = capture_scratch_create(DEVICE_BUFFER_FRAMES);
+    int big = DEVICE_BUFFER_FRAMES * 2;
+    bool got = scratch && capture_scratch_get(scratch, DEVICE_PERIOD_FRAMES) != NULL &&
+               capture_scratch_get(scratch, big) != NULL &&
+               capture_scratch_get(scratch, big) != NULL &&
+               capture_scratch_get(scratch, DEVICE_PERIOD_FRAMES) != NULL;
+    check(got && capture_scratch_get_grow_count(scratch) == 1 &&
+          capture_scratch_get_frames(scratch) >= big, "capture scratch grows once");
+    capture_scratch_destroy(scratch);
+}
+
+// ---------------------------------------------------------------------------
+// FFT and echo cancellation
+
+#define FFT_BENCH_SIZE 256
+
+static void bench_fft(void)
+{
+    const int iterations = 20000;
+    const int n = FFT_BENCH_SIZE;
+    const int bins = n / 2 + 1;
+    float input[FFT_BENCH_SIZE], output[FFT_BENCH_SIZE];
+    float ref_re[FFT_BENCH_SIZE / 2 + 1], ref_im[FFT_BENCH_SIZE / 2 + 1];
+    float re[FFT_BENCH_SIZE / 2 + 1], im[FFT_BENCH_SIZE / 2 + 1];
+
+    short signal[FFT_BENCH_SIZE];
+    fill_test_signal(signal, n, 16000, 5);
+    for (int i = 0; i < n; i++) {
+        input[i] = signal[i];
+    }
+
+    // Direct DFT as the reference
+    double peak = 0.0;
+    for (int k = 0; k < bins; k++) {
+        double sum_re = 0.0, sum_im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double angle = -2.0 * M_PI * (double)k * (double)i / (double)n;
+            sum_re += input[i] * cos(angle);
+            sum_im += input[i] * sin(angle);
+        }
+        ref_re[k] = (float)sum_re;
+        ref_im[k] = (float)sum_im;
+        peak = fmax(peak, fmax(fabs(sum_re), fabs(sum_im)));
+    }
+
+    fft_t *selected = fft_create(n);
+    note("fft: runtime dispatch selects %s\n", audio_convert_isa_name(fft_get_isa(selected)));
+    fft_destroy(selected);
+
+    for (int isa = 0; isa < AUDIO_ISA_COUNT; isa++) {
+        fft_t *fft = fft_create_isa(n, (enum audio_convert_isa)isa);
+        if (!fft) {
+            continue;
+        }
+
+        fft_forward(fft, input, re, im);
+        fft_inverse(fft, re, im, output);
+        double spectrum_error = 0.0, round_trip_error = 0.0;
+        for (int k = 0; k < bins; k++) {
+            spectrum_error = fmax(spectrum_error, fmax(fabs(re[k] - ref_re[k]), fabs(im[k] - ref_im[k])));
+        }
+        for (int i = 0; i < n; i++) {
+            round_trip_error = fmax(round_trip_error, fabs(output[i] - input[i]));
+        }
+
+        uint64_t start = os_gettime_ns();
+        for (int i = 0; i < iterations; i++) {
+            fft_forward(fft, input, re, im);
+            fft_inverse(fft, re, im, output);
+        }
+        uint64_t elapsed = os_gettime_ns() - start;
+
+        char name[64];
+        snprintf(name, sizeof(name), "fft %d forward+inverse %s", n,
+                 audio_convert_isa_name((enum audio_convert_isa)isa));
+        report(name, elapsed, (uint64_t)iterations, "pair");
+        note("%-40s spectrum error %.1e of peak, round trip %.1e\n", "", spectrum_error / peak,
+             round_trip_error / 32768.0);
+        check(spectrum_error / peak < 1e-5 && round_trip_error < 0.05, name);
+
+        fft_destroy(fft);
+    }
+}
+
+// Room echo of `far` as heard `delay_ms` later: a direct path plus ~25 ms
+// of decaying reflections, about 12 dB below the source
+static void add_echo(const float *far, float *mic, int count, int delay_ms, unsigned int seed)
+{
+    const int taps = 16000 / 10;
+    float *response = malloc(taps * sizeof(float));
+    for (int i = 0; i < taps; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double r = (double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0;
+        response[i] = (float)(0.06 * r * exp(-i / (0.025 * 16000)));
+    }
+    response[0] = 0.2f;
+
+    int delay = delay_ms * 16;
+    for (int i = 0; i < count; i++) {
+        double v = 0.0;
+        for (int k = 0; k < taps && i - delay - k >= 0; k++) {
+            v += response[k] * far[i - delay - k];
+        }
+        mic[i] += (float)v;
+    }
+    free(response);
+}
+
+static void bench_echo_cancel(void)
+{
+    // 20 s of speech-like far audio (noise in syllable-length bursts) echoed
+    // 40 ms later into a mic with low noise and 2 s of near-end talk at
+    // 14 s. The reference arrives 120 ms after it played, in 20 ms packets
+    // like OBS delivers it, so the mic has to wait for it.
+    const int rate = 16000;
+    const int total = rate * 20;
+    const int reference_lag = rate * 120 / 1000;
+    float *far = calloc(total, sizeof(float));
+    float *mic = calloc(total, sizeof(float));
+    short *far_s16 = malloc(total * sizeof(short));
+    short *mic_s16 = malloc(total * sizeof(short));
+    short *near = calloc(total, sizeof(short));
+    short *out = calloc(total, sizeof(short));
+    unsigned int seed = 23;
+
+    double level = 0.0, target = 0.0, colored = 0.0;
+    for (int i = 0; i < total; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double r = (double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0;
+        if (i % 1600 == 0) {
+            target = fabs(r) > 0.4 ? fabs(r) : 0.05;
+        }
+        level += 0.002 * (target - level);
+        colored = 0.7 * colored + 0.3 * r;
+        far[i] = (float)(16000.0 * level * colored);
+        far_s16[i] = (short)far[i];
+    }
+
+    add_echo(far, mic, total, 40, 31);
+    for (int i = 0; i < total; i++) {
+        double t = (double)i / rate;
+        seed = seed * 1103515245u + 12345u;
+        double noise = 20.0 * ((double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0);
+        if (t >= 14.0 && t < 16.0) {
+            near[i] = (short)(6000.0 * sin(2.0 * M_PI * 180.0 * t) * (0.5 + 0.5 * sin(2.0 * M_PI * 4.0 * t)));
+        }
+        double v = mic[i] + near[i] + noise;
+        mic_s16[i] = (short)(v > 32767.0 ? 32767.0 : v < -32768.0 ? -32768.0 : v);
+    }
+
+    struct echo_canceller_config config;
+    echo_canceller_config_default(&config);
+    echo_canceller_t *aec = echo_canceller_create(&config);
+    short *chunk_out = malloc((size_t)echo_canceller_max_output(aec, 160) * sizeof(short));
+
+    int written = 0, far_sent = 0;
+    for (int off = 0; off + 160 <= total; off += 160) {
+        int far_ready = (off - reference_lag) / 320 * 320;
+        if (far_ready > far_sent) {
+            echo_canceller_far_end(aec, far_s16 + far_sent, far_ready - far_sent);
+            far_sent = far_ready;
+        }
+        int samples = echo_canceller_process(aec, mic_s16 + off, 160, chunk_out);
+        memcpy(out + written, chunk_out, (size_t)samples * sizeof(short));
+        written += samples;
+    }
+
+    struct echo_canceller_stats stats;
+    echo_canceller_get_stats(aec, &stats);
+    report("echo_canceller_process (8ms blocks)", stats.process_ns, stats.blocks, "block");
+
+    // Output sample i is mic sample i, just written out later
+    double mic_energy = 0.0, out_energy = 0.0;
+    for (int i = 17 * rate; i < 20 * rate && i < written; i++) {
+        mic_energy += (double)mic_s16[i] * mic_s16[i];
+        out_energy += (double)out[i] * out[i];
+    }
+    double erle_db = out_energy > 0.0 ? 10.0 * log10(mic_energy / out_energy) : 0.0;
+
+    double near_energy = 0.0, before = 0.0, after = 0.0;
+    for (int i = (int)(14.2 * rate); i < (int)(15.8 * rate); i++) {
+        near_energy += (double)near[i] * near[i];
+        before += ((double)mic_s16[i] - near[i]) * ((double)mic_s16[i] - near[i]);
+        after += ((double)out[i] - near[i]) * ((double)out[i] - near[i]);
+    }
+    double snr_before = 10.0 * log10(near_energy / before);
+    double snr_after = 10.0 * log10(near_energy / after);
+
+    double audio_sec = (double)stats.blocks * ECHO_CANCELLER_BLOCK_SAMPLES / rate;
+    note("%-40s %s, echo trails reference by %d ms (expected 40 - 120 = -80), "
+         "%.2f%% of a core\n", "", audio_convert_isa_name(echo_canceller_get_isa(aec)),
+         stats.delay_ms, 100.0 * (double)stats.process_ns / (audio_sec * 1e9));
+    note("%-40s ERLE %.1f dB after convergence (%.1f dB running), near-end talk "
+         "%.1f -> %.1f dB over echo, %d ms held\n", "", erle_db, stats.erle_db,
+         snr_before, snr_after, echo_canceller_pending(aec) * 1000 / rate);
+    check(stats.aligned && stats.delay_ms >= -96 && stats.delay_ms <= -64, "echo delay estimate");
+    check(erle_db >= 20.0, "echo ERLE after convergence");
+    check(snr_after > snr_before, "echo near-end talk kept");
+
+    // The same far audio without any echo of it must not line up
+    echo_canceller_destroy(aec);
+    aec = echo_canceller_create(&config);
+    far_sent = 0;
+    for (int off = 0; off + 160 <= total; off += 160) {
+        int far_ready = (off - reference_lag) / 320 * 320;
+        if (far_ready > far_sent) {
+            echo_canceller_far_end(aec, far_s16 + far_sent, far_ready - far_sent);
+            far_sent = far_ready;
+        }
+        short noise_only[160];
+        for (int i = 0; i < 160; i++) {
+            noise_only[i] = (short)(mic_s16[off + i] - (short)mic[off + i]);
+        }
+        echo_canceller_process(aec, noise_only, 160, chunk_out);
+    }
+    echo_canceller_get_stats(aec, &stats);
+    check(!stats.aligned && stats.bypass_blocks == stats.blocks, "echo no false alignment");
+
+    echo_canceller_destroy(aec);
+    free(chunk_out);
+    free(far);
+    free(mic);
+    free(far_s16);
+    free(mic_s16);
+    free(near);
+    free(out);
+}
+
+// ---------------------------------------------------------------------------
+// Noise suppression and auto gain
+
+#define SPEECH_PAUSE    0
+#define SPEECH_VOICED   1
+#define SPEECH_EDGE     2
+
+// Speech-like phrases every 3 s from 1 s on: four 180 ms voiced syllables
+// (harmonics of a 110-220 Hz pitch falling off as 1/k, 15 ms ramps) with
+// 70 ms gaps, at `rms` over the syllables. label[] marks the flat parts of
+// syllables, and pauses more than 150 ms clear of any syllable.
+static void fill_speech(float *speech, unsigned char *label, int count, int rate, double rms,
+                        unsigned int seed)
+{
+    const double syllable = 0.18, gap = 0.07, ramp = 0.015;
+    const int harmonics = 16;
+    double norm = 0.0;
+    for (int k = 1; k <= harmonics; k++) {
+        norm += 1.0 / ((double)k * k);
+    }
+    norm = rms * sqrt(2.0 / norm);
+
+    double pitch = 150.0, phase = 0.0;
+    int last_syllable = -1;
+    for (int i = 0; i < count; i++) {
+        double t = (double)i / rate;
+        double cycle = fmod(t, 3.0);
+        int index = (int)((cycle - 1.0) / (syllable + gap));
+        double local = cycle - 1.0 - index * (syllable + gap);
+
+        speech[i] = 0.0f;
+        label[i] = cycle < 0.85 || cycle > 2.15 ? SPEECH_PAUSE : SPEECH_EDGE;
+        if (t < 1.0 || cycle < 1.0 || index >= 4 || local >= syllable) {
+            continue;
+        }
+
+        int id = (int)(t / 3.0) * 4 + index;
+        if (id != last_syllable) {
+            seed = seed * 1103515245u + 12345u;
+            pitch = 110.0 + 110.0 * (double)((seed >> 16) & 0x7FFF) / 32768.0;
+            last_syllable = id;
+        }
+        phase += 2.0 * M_PI * pitch / rate;
+
+        double v = 0.0;
+        for (int k = 1; k <= harmonics && k * pitch < 3800.0; k++) {
+            v += sin(k * phase) / k;
+        }
+        double envelope = fmin(1.0, fmin(local, syllable - local) / ramp);
+        speech[i] = (float)(norm * envelope * v);
+        label[i] = envelope >= 1.0 ? SPEECH_VOICED : SPEECH_EDGE;
+    }
+}
+
+static short clamp_s16(double v)
+{
+    return (short)(v > 32767.0 ? 32767.0 : v < -32768.0 ? -32768.0 : v);
+}
+
+static void bench_noise_suppress(void)
+{
+    // 20 s of phrases at -20 dBFS over fan-like noise (lowpassed hiss plus
+    // 100 Hz hum) about 10 dB below them, fed in 256-sample packets
+    const int rate = 16000;
+    const int total = rate * 20;
+    const int packet = 256;
+    float *speech = malloc(total * sizeof(float));
+    unsigned char *label = malloc(total);
+    short *noisy = malloc(total * sizeof(short));
+    short *reference = NULL;
+    short *out = malloc((size_t)(total + packet) * sizeof(short));
+    unsigned int seed = 41;
+
+    fill_speech(speech, label, total, rate, 3300.0, 11);
+    double colored = 0.0;
+    for (int i = 0; i < total; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double r = (double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0;
+        colored = 0.9 * colored + 0.1 * r;
+        double noise = 5500.0 * colored + 250.0 * sin(2.0 * M_PI * 100.0 * i / rate);
+        noisy[i] = clamp_s16(speech[i] + noise);
+    }
+
+    struct noise_suppressor_config config;
+    noise_suppressor_config_default(&config);
+    noise_suppressor_t *selected = noise_suppressor_create(&config);
+    note("noise-suppress: runtime dispatch selects %s\n",
+         audio_convert_isa_name(noise_suppressor_get_isa(selected)));
+    noise_suppressor_destroy(selected);
+
+    for (int isa = 0; isa < AUDIO_ISA_COUNT; isa++) {
+        noise_suppressor_t *ns = noise_suppressor_create_isa(&config, (enum audio_convert_isa)isa);
+        if (!ns) {
+            continue;
+        }
+
+        int written = 0;
+        for (int off = 0; off + packet <= total; off += packet) {
+            written += noise_suppressor_process(ns, noisy + off, packet, out + written);
+        }
+
+        struct noise_suppressor_stats stats;
+        noise_suppressor_get_stats(ns, &stats);
+        char name[64];
+        snprintf(name, sizeof(name), "noise_suppressor_process %s",
+                 audio_convert_isa_name((enum audio_convert_isa)isa));
+        report(name, stats.process_ns, stats.frames, "frame");
+
+        // Output sample i + HOP is input sample i
+        const int lag = NOISE_SUPPRESSOR_FRAME_SAMPLES;
+        double pause_in = 0.0, pause_out = 0.0, voiced_speech = 0.0, voiced_out = 0.0;
+        double speech_energy = 0.0, error_before = 0.0, error_after = 0.0;
+        for (int i = rate; i + lag < written; i++) {
+            double in = noisy[i], o = out[i + lag], s = speech[i];
+            if (label[i] == SPEECH_PAUSE) {
+                pause_in += in * in;
+                pause_out += o * o;
+            } else if (label[i] == SPEECH_VOICED) {
+                voiced_speech += s * s;
+                voiced_out += o * o;
+            }
+            speech_energy += s * s;
+            error_before += (in - s) * (in - s);
+            error_after += (o - s) * (o - s);
+        }
+        double reduction_db = 10.0 * log10(pause_in / pause_out);
+        double speech_db = 10.0 * log10(voiced_out / voiced_speech);
+        double snr_before = 10.0 * log10(speech_energy / error_before);
+        double snr_after = 10.0 * log10(speech_energy / error_after);
+
+        if (!reference) {
+            reference = malloc((size_t)written * sizeof(short));
+            memcpy(reference, out, (size_t)written * sizeof(short));
+            note("%-40s noise %.1f dB lower in pauses, speech level %+.1f dB, SNR %.1f -> %.1f dB,\n"
+                 "%-40s noise floor %.1f dBFS, %.1f dB removed by its own count, %.3f%% of a core\n",
+                 "", reduction_db, speech_db, snr_before, snr_after, "", stats.noise_dbfs,
+                 stats.reduction_db,
+                 100.0 * (double)stats.process_ns / (double)(stats.frames * 10000000ull));
+            check(reduction_db >= 10.0, "noise suppression in pauses");
+            check(speech_db > -3.0, "noise suppression keeps speech level");
+            check(snr_after > snr_before + 3.0, "noise suppression SNR gain");
+        } else {
+            int max_diff = 0;
+            for (int i = 0; i < written; i++) {
+                int diff = abs(out[i] - reference[i]);
+                max_diff = diff > max_diff ? diff : max_diff;
+            }
+            note("%-40s output within %d of scalar\n", "", max_diff);
+            check(max_diff <= 4, name);
+        }
+
+        noise_suppressor_destroy(ns);
+    }
+
+    free(speech);
+    free(label);
+    free(noisy);
+    free(reference);
+    free(out);
+}
+
+// Level of the flat parts of syllables in samples [from, to), in dBFS
+static double voiced_dbfs(const short *samples, const unsigned char *label, int from, int to)
+{
+    double energy = 0.0;
+    int count = 0;
+    for (int i = from; i < to; i++) {
+        if (label[i] == SPEECH_VOICED) {
+            energy += (double)samples[i] * samples[i];
+            count++;
+        }
+    }
+    return 10.0 * log10(energy / count / (32768.0 * 32768.0) + 1e-12);
+}
+
+static void bench_auto_gain(void)
+{
+    // 20 s of phrases: a distant talker at -45 dBFS for 12 s, then someone
+    // leaning into the mic at -10 dBFS. Low noise throughout.
+    const int rate = 16000;
+    const int total = rate * 20;
+    const int quiet_end = rate * 12;
+    const int packet = 256;
+    float *speech = malloc(total * sizeof(float));
+    unsigned char *label = malloc(total);
+    short *in = malloc(total * sizeof(short));
+    short *out = malloc(total * sizeof(short));
+    short *reference = NULL;
+    unsigned int seed = 53;
+
+    fill_speech(speech, label, total, rate, 1.0, 17);
+    const double quiet = 32768.0 * pow(10.0, -45.0 / 20.0);
+    const double loud = 32768.0 * pow(10.0, -10.0 / 20.0);
+    for (int i = 0; i < total; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double noise = 8.0 * ((double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0);
+        in[i] = clamp_s16(speech[i] * (i < quiet_end ? quiet : loud) + noise);
+    }
+
+    struct auto_gain_config config;
+    auto_gain_config_default(&config);
+    auto_gain_t *selected = auto_gain_create(&config);
+    note("auto-gain: runtime dispatch selects %s\n",
+         audio_convert_isa_name(auto_gain_get_isa(selected)));
+    auto_gain_destroy(selected);
+
+    for (int isa = 0; isa < AUDIO_ISA_COUNT; isa++) {
+        auto_gain_t *agc = auto_gain_create_isa(&config, (enum audio_convert_isa)isa);
+        if (!agc) {
+            continue;
+        }
+
+        // In place, as the plugin runs it
+        memcpy(out, in, total * sizeof(short));
+        for (int off = 0; off + packet <= total; off += packet) {
+            auto_gain_process(agc, out + off, packet, out + off);
+        }
+
+        struct auto_gain_stats stats;
+        auto_gain_get_stats(agc, &stats);
+        char name[64];
+        snprintf(name, sizeof(name), "auto_gain_process %s",
+                 audio_convert_isa_name((enum audio_convert_isa)isa));
+        report(name, stats.process_ns, stats.frames, "frame");
+
+        if (!reference) {
+            reference = malloc(total * sizeof(short));
+            memcpy(reference, out, total * sizeof(short));
+
+            double quiet_db = voiced_dbfs(out, label, rate * 7, quiet_end);
+            double loud_db = voiced_dbfs(out, label, rate * 15, total);
+            note("%-40s -45 dBFS speech -> %.1f dBFS, -10 dBFS -> %.1f dBFS (target %.0f),\n"
+                 "%-40s %llu samples clipped, %.3f%% of a core\n", "", quiet_db, loud_db,
+                 config.target_dbfs, "", (unsigned long long)stats.clipped_samples,
+                 100.0 * (double)stats.process_ns / (double)(stats.frames * 10000000ull));
+            check(fabs(quiet_db - config.target_dbfs) <= 3.0, "auto gain lifts quiet speech");
+            check(fabs(loud_db - config.target_dbfs) <= 3.0, "auto gain lowers loud speech");
+            check(stats.clipped_samples <= (uint64_t)(total - quiet_end) / 200,
+                  "auto gain clipping on a jump in level");
+        } else {
+            int max_diff = 0;
+            for (int i = 0; i < total; i++) {
+                int diff = abs(out[i] - reference[i]);
+                max_diff = diff > max_diff ? diff : max_diff;
+            }
+            note("%-40s output within %d of scalar\n", "", max_diff);
+            check(max_diff <= 1, name);
+        }
+
+        auto_gain_destroy(agc);
+    }
+
+    free(speech);
+    free(label);
+    free(in);
+    free(out);
+    free(reference);
+}
+
+// ---------------------------------------------------------------------------
+// Voice-activity gate
+
+static void bench_vad(void)
+{
+    // 60 s of low noise with a 0.8 s voiced burst every 5 s
+    const int rate = 16000;
+    const int total = rate * 60;
+    const int chunk = 1600;
+    short *signal = malloc(total * sizeof(short));
+    unsigned int seed = 7;
+
+    for (int i = 0; i < total; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double v = 60.0 * ((double)((seed >> 16) & 0x7FFF) / 16384.0 - 1.0);
+        double t = (double)i / rate;
+        int second = (int)t;
+        if (second % 5 == 2 && t - second < 0.8) {
+            v += 6000.0 * sin(2.0 * M_PI * 180.0 * t) + 3000.0 * sin(2.0 * M_PI * 540.0 * t);
+        }
+        signal[i] = (short)v;
+    }
+
+    vad_t *vad = vad_create(NULL);
+    short *out = malloc((size_t)vad_max_output(vad, chunk) * sizeof(short));
+
+    uint64_t start = os_gettime_ns();
+    for (int off = 0; off + chunk <= total; off += chunk) {
+        vad_process(vad, signal + off, chunk, out, NULL);
+    }
+    report("vad_process (10ms frames)", os_gettime_ns() - start, (uint64_t)total / 160, "frame");
+
+    struct vad_stats stats;
+    vad_get_stats(vad, &stats);
+    note("%-40s %.1f%% gated, %llu utterances (expected 12)\n", "  synthetic speech/noise",
+           100.0 * (double)(stats.frames_total - stats.frames_passed) / (double)stats.frames_total,
+           (unsigned long long)stats.utterances);
+    check(stats.utterances == 12, "vad utterance count");
+
+    vad_destroy(vad);
+    free(out);
+    free(signal);
+}
+
+// ---------------------------------------------------------------------------
+// Keyword spotting
+
+// F1/F2 (Hz) of seven vowels, the syllables of the synthetic words
+static const double VOWELS[][2] = {
+    {730, 1090}, {270, 2290}, {300, 870}, {530, 1840}, {570, 840}, {660, 1720}, {490, 1350},
+};
+#define VOWEL_COUNT 7
+#define WORD_SYLLABLES_MAX 6
+
+// A synthetic spoken word: 170 ms voiced syllables with formants gliding
+// into each vowel, all stretched by `tempo`, formants scaled by `tract`
+// (speaker size), at `rms` over the word
+// Returns: Samples written
+static int synth_word(short *out, const int *vowels, int count, double tempo, double pitch,
+                      double tract, double rms, const float *noise)
+{
+    const int rate = 16000;
+    int syllable = (int)(0.17 * tempo * rate);
+    int total = syllable * count;
+    float *v = malloc((size_t)total * sizeof(float));
+    double phase = 0.0, energy = 0.0;
+
+    for (int i = 0; i < total; i++) {
+        int s = i / syllable;
+        double local = (double)(i % syllable) / syllable;
+        const double *to = VOWELS[vowels[s]];
+        const double *from = VOWELS[vowels[s > 0 ? s - 1 : s]];
+        double glide = fmin(1.0, local / 0.3);
+        double f1 = tract * (from[0] + (to[0] - from[0]) * glide);
+        double f2 = tract * (from[1] + (to[1] - from[1]) * glide);
+        double f0 = pitch * (1.0 + 0.05 * sin(2.0 * M_PI * 5.0 * i / rate) - 0.1 * local);
+        phase += 2.0 * M_PI * f0 / rate;
+
+        double sample = 0.0;
+        for (int k = 1; k * f0 < 4000.0; k++) {
+            double f = k * f0;
+            double a = 1.0 / (1.0 + pow((f - f1) / 90.0, 2.0)) +
+                       0.7 / (1.0 + pow((f - f2) / 120.0, 2.0)) + 0.02;
+            sample += a * sin(k * phase);
+        }
+        v[i] = (float)(sample * (0.3 + 0.7 * sin(M_PI * local)));
+        energy += (double)v[i] * v[i];
+    }
+
+    double scale = rms / sqrt(energy / total);
+    for (int i = 0; i < total; i++) {
+        out[i] = clamp_s16(v[i] * scale + noise[i]);
+    }
+    free(v);
+    return total;
+}
+
+static unsigned int next_random(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+static double random_between(unsigned int *seed, double low, double high)
+{
+    return low + (high - low) * (double)next_random(seed) / 32768.0;
+}
+
+// A word from a random speaker: pitch, size, tempo and level all vary
+static int synth_random_speaker(short *out, const int *vowels, int count, unsigned int *seed,
+                                const float *noise)
+{
+    double pitch = random_between(seed, 100.0, 220.0);
+    double tract = random_between(seed, 0.92, 1.08);
+    double tempo = random_between(seed, 0.85, 1.15);
+    double rms = 3000.0 * pow(10.0, random_between(seed, -6.0, 6.0) / 20.0);
+    return synth_word(out, vowels, count, tempo, pitch, tract, rms, noise);
+}
+
+static void bench_keyword_spot(void)
+{
+    // Two four-syllable commands learned from two utterances each, then 60
+    // words from random speakers: each command 20 times and 20 words of
+    // random syllables ("chatter"), 0.7-1.2 s apart over -55 dBFS noise
+    static const int COMMANDS[2][4] = {{0, 1, 2, 3}, {4, 5, 1, 6}};
+    static const char *NAMES[2] = {"command one", "command two"};
+    const int rate = 16000;
+    const int packet = 1024;
+    const int noise_len = rate * 4;
+    const int max_word = (int)(0.17 * 1.15 * rate) * WORD_SYLLABLES_MAX + 1;
+    unsigned int seed = 29;
+
+    float *noise = malloc(noise_len * sizeof(float));
+    for (int i = 0; i < noise_len; i++) {
+        noise[i] = (float)(60.0 * ((double)next_random(&seed) / 16384.0 - 1.0));
+    }
+
+    // Room for the stream: up to 1.2 s of noise plus a word, 60 times
+    int capacity = 60 * (rate * 6 / 5 + max_word) + rate;
+    short *stream = malloc((size_t)capacity * sizeof(short));
+    int word_start[60], word_end[60], word_kind[60];
+
+    keyword_spotter_t *ks = keyword_spotter_create(NULL);
+    struct keyword_spot spot;
+
+    // Enrollment, as the plugin does after confirmed commands
+    for (int n = 0; n < 4; n++) {
+        int len = 0;
+        for (int i = 0; i < rate * 6 / 10; i++) {
+            stream[len++] = (short)noise[i];
+        }
+        len += synth_random_speaker(stream + len, COMMANDS[n % 2], 4, &seed, noise + len);
+        for (int i = 0; i < rate * 6 / 10; i++, len++) {
+            stream[len] = (short)noise[len % noise_len];
+        }
+        keyword_spotter_process(ks, stream, len, &spot);
+        check(keyword_spotter_learn(ks, NAMES[n % 2]), "keyword spotter learns a command");
+    }
+    check(keyword_spotter_ready(ks), "keyword spotter ready after enrollment");
+    keyword_spotter_reset(ks);
+
+    int len = 0;
+    for (int n = 0; n < 60; n++) {
+        int gap = (int)(random_between(&seed, 0.7, 1.2) * rate);
+        for (int i = 0; i < gap; i++, len++) {
+            stream[len] = (short)noise[len % noise_len];
+        }
+
+        int kind = n % 3;
+        int vowels[WORD_SYLLABLES_MAX];
+        int count = 4;
+        if (kind < 2) {
+            memcpy(vowels, COMMANDS[kind], sizeof(COMMANDS[kind]));
+        } else {
+            count = 3 + (int)(next_random(&seed) % 4);
+            for (int i = 0; i < count; i++) {
+                vowels[i] = (int)(next_random(&seed) % VOWEL_COUNT);
+            }
+        }
+
+        // The noise loops; synth_word wants it contiguous
+        float *word_noise = malloc((size_t)max_word * sizeof(float));
+        for (int i = 0; i < max_word; i++) {
+            word_noise[i] = noise[(len + i) % noise_len];
+        }
+        word_start[n] = len;
+        len += synth_random_speaker(stream + len, vowels, count, &seed, word_noise);
+        word_end[n] = len;
+        word_kind[n] = kind;
+        free(word_noise);
+    }
+    for (int i = 0; i < rate; i++, len++) {
+        stream[len] = (short)noise[len % noise_len];
+    }
+
+    // A hit belongs to the last word that started before it, if it came
+    // within 400 ms of that word's end
+    int hits[3] = {0}, wrong = 0, stray = 0, short_lookback = 0;
+    bool heard[60] = {false};
+    uint64_t start = os_gettime_ns();
+    for (int off = 0; off < len; off += packet) {
+        int n = len - off < packet ? len - off : packet;
+        if (!keyword_spotter_process(ks, stream + off, n, &spot)) {
+            continue;
+        }
+
+        int at = off + n, word = -1;
+        for (int w = 0; w < 60 && word_start[w] < at; w++) {
+            word = w;
+        }
+        if (word < 0 || at > word_end[word] + rate * 4 / 10 || heard[word]) {
+            stray++;
+            continue;
+        }
+        heard[word] = true;
+        hits[word_kind[word]]++;
+        if (word_kind[word] < 2 && strcmp(spot.phrase, NAMES[word_kind[word]]) != 0) {
+            wrong++;
+        }
+        if (at - spot.lookback > word_start[word]) {
+            short_lookback++;
+        }
+    }
+    uint64_t elapsed = os_gettime_ns() - start;
+
+    struct keyword_spotter_stats stats;
+    keyword_spotter_get_stats(ks, &stats);
+    report("keyword_spotter_process (4 templates)", elapsed, stats.frames, "frame");
+    note("%-40s commands found %d/20 and %d/20 (%d as the other one), chatter %d/20,\n"
+         "%-40s %d stray hits, %d lookbacks short of the word, %.3f%% of a core\n", "",
+         hits[0], hits[1], wrong, hits[2], "", stray, short_lookback,
+         100.0 * (double)elapsed / ((double)stats.frames * 10000000.0));
+    check(hits[0] >= 18 && hits[1] >= 18, "keyword spotter recall");
+    check(hits[2] <= 4 && stray <= 2, "keyword spotter false wakes");
+    check(short_lookback == 0, "keyword spotter lookback covers the word");
+
+    keyword_spotter_destroy(ks);
+    free(stream);
+    free(noise);
+}
+
+// ---------------------------------------------------------------------------
+// Phrase matching
+
+// The (n+1)x(m+1) matrix Levenshtein phrase-detector.c used before the
+// bit-parallel matcher (kept here as the speed and correctness baseline)
+static int legacy_levenshtein(const char *s1, const char *s2)
+{
+    int len1 = (int)strlen(s1);
+    int len2 = (int)strlen(s2);
+
+    int *matrix = malloc((len1 + 1) * (len2 + 1) * sizeof(int));
+    if (!matrix) {
+        return 1000;
+    }
+
+    for (int i = 0; i <= len1; i++) {
+        matrix[i * (len2 + 1)] = i;
+    }
+    for (int j = 0; j <= len2; j++) {
+        matrix[j] = j;
+    }
+
+    for (int i = 1; i <= len1; i++) {
+        for (int j = 1; j <= len2; j++) {
+            int cost = (tolower((unsigned char)s1[i - 1]) ==
+                        tolower((unsigned char)s2[j - 1])) ? 0 : 1;
+
+            int del = matrix[(i - 1) * (len2 + 1) + j] + 1;
+            int ins = matrix[i * (len2 + 1) + (j - 1)] + 1;
+            int sub = matrix[(i - 1) * (len2 + 1) + (j - 1)] + cost;
+
+            int min = del;
+            if (ins < min) min = ins;
+            if (sub < min) min = sub;
+
+            matrix[i * (len2 + 1) + j] = min;
+        }
+    }
+
+    int result = matrix[len1 * (len2 + 1) + len2];
+    free(matrix);
+    return result;
+}
+
+#define CORPUS_SIZE 2000
+#define CORPUS_TEXT_MAX 160
+
+// Transcripts shaped like Vosk output: the phrase alone, with fillers around
+// it, with a recognition error, or unrelated chatter
+static void build_corpus(char corpus[][CORPUS_TEXT_MAX], const char *phrase, bool *has_phrase)
+{
+    static const char *FILLERS[] = {
+        "uh", "okay", "garmin", "now", "please", "the", "that", "was", "close",
+        "nice", "shot", "go", "left", "again", "what", "video", "save",
+    };
+    const int num_fillers = (int)(sizeof(FILLERS) / sizeof(FILLERS[0]));
+    unsigned int seed = 11;
+
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        char *text = corpus[i];
+        text[0] = '\0';
+        seed = seed * 1103515245u + 12345u;
+        int kind = (int)((seed >> 16) % 4);
+        int before = kind == 0 ? 0 : (int)((seed >> 8) % 3);
+        int after = kind == 0 ? 0 : (int)((seed >> 4) % 3);
+        has_phrase[i] = kind != 3;
+
+        for (int w = 0; w < before + (kind == 3 ? 4 : 0); w++) {
+            seed = seed * 1103515245u + 12345u;
+            strcat(text, FILLERS[(seed >> 16) % num_fillers]);
+            strcat(text, " ");
+        }
+        if (kind != 3) {
+            size_t at = strlen(text);
+            strcat(text, phrase);
+            if (kind == 2) {
+                // One substituted letter, like "safe video"
+                seed = seed * 1103515245u + 12345u;
+                text[at + (seed >> 16) % strlen(phrase)] = 'f';
+            }
+        }
+        for (int w = 0; w < after; w++) {
+            seed = seed * 1103515245u + 12345u;
+            strcat(text, " ");
+            strcat(text, FILLERS[(seed >> 16) % num_fillers]);
+        }
+    }
+}
+
+static void bench_phrase_match(void)
+{
+    static char corpus[CORPUS_SIZE][CORPUS_TEXT_MAX];
+    static bool has_phrase[CORPUS_SIZE];
+    const char *phrase = "save video";
+    const int max_distance = 1;   // Sensitivity 70 on a 10-letter phrase
+    const int rounds = 50;
+
+    build_corpus(corpus, phrase, has_phrase);
+
+    int lengths[CORPUS_SIZE];
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        lengths[i] = (int)strlen(corpus[i]);
+    }
+
+    struct fuzzy_pattern pattern;
+    uint64_t start = os_gettime_ns();
+    for (int r = 0; r < 100000; r++) {
+        fuzzy_pattern_compile(&pattern, phrase);
+    }
+    report("fuzzy_pattern_compile", os_gettime_ns() - start, 100000, "call");
+
+    volatile int sink = 0;
+
+    start = os_gettime_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            sink += legacy_levenshtein(corpus[i], phrase);
+        }
+    }
+    report("legacy matrix levenshtein", os_gettime_ns() - start,
+           (uint64_t)rounds * CORPUS_SIZE, "text");
+
+    start = os_gettime_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            sink += fuzzy_distance(&pattern, corpus[i], lengths[i]);
+        }
+    }
+    report("fuzzy_distance (global)", os_gettime_ns() - start,
+           (uint64_t)rounds * CORPUS_SIZE, "text");
+
+    start = os_gettime_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < CORPUS_SIZE; i++) {
+            sink += fuzzy_search(&pattern, corpus[i], lengths[i], NULL);
+        }
+    }
+    report("fuzzy_search (substring)", os_gettime_ns() - start,
+           (uint64_t)rounds * CORPUS_SIZE, "text");
+    (void)sink;
+
+    // Same distances as the baseline, and how many phrases each mode finds
+    int mismatches = 0;
+    int found_global = 0, found_substring = 0, false_hits = 0, with_phrase = 0;
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        int global = fuzzy_distance(&pattern, corpus[i], lengths[i]);
+        if (global != legacy_levenshtein(corpus[i], phrase)) {
+            mismatches++;
+        }
+        bool hit_substring = fuzzy_search(&pattern, corpus[i], lengths[i], NULL) <= max_distance;
+        with_phrase += has_phrase[i];
+        found_global += has_phrase[i] && global <= max_distance;
+        found_substring += has_phrase[i] && hit_substring;
+        false_hits += !has_phrase[i] && hit_substring;
+    }
+
+    note("%-40s %d/%d distances differ from baseline\n", "  global vs legacy", mismatches,
+           CORPUS_SIZE);
+    note("%-40s global %d/%d, substring %d/%d, %d hits in other chatter\n", "  phrases found (max distance 1)",
+           found_global, with_phrase, found_substring, with_phrase, false_hits);
+    check(mismatches == 0, "fuzzy_distance vs legacy");
+}
+
+// ---------------------------------------------------------------------------
+// Vosk result JSON
+
+// A final result as Vosk prints it with vosk_recognizer_set_words(..., 1)
+static const char *SAMPLE_RESULT_JSON =
+    "{\n"
+    "  \"result\" : [{\n"
+    "      \"conf\" : 0.913427,\n"
+    "      \"end\" : 1.110000,\n"
+    "      \"start\" : 0.870000,\n"
+    "      \"word\" : \"garmin\"\n"
+    "    }, {\n"
+    "      \"conf\" : 1.000000,\n"
+    "      \"end\" : 1.470000,\n"
+    "      \"start\" : 1.110000,\n"
+    "      \"word\" : \"save\"\n"
+    "    }, {\n"
+    "      \"conf\" : 0.874102,\n"
+    "      \"end\" : 1.920000,\n"
+    "      \"start\" : 1.470000,\n"
+    "      \"word\" : \"video\"\n"
+    "    }],\n"
+    "  \"text\" : \"garmin save video\"\n"
+    "}";
+
+// strstr for the key, then copy up to the next quote, as phrase-detector.c
+// did before the tokenizer (kept here as the speed baseline)
+static bool legacy_extract_text(const char *json, char *text, int max_len)
+{
+    const char *text_key = strstr(json, "\"text\"");
+    if (!text_key) {
+        return false;
+    }
+    const char *colon = strchr(text_key + 6, ':');
+    if (!colon) {
+        return false;
+    }
+    const char *start = strchr(colon, '"');
+    if (!start) {
+        return false;
+    }
+    start++;
+    const char *end = strchr(start, '"');
+    if (!end) {
+        return false;
+    }
+    int len = (int)(end - start);
+    if (len >= max_len) {
+        len = max_len - 1;
+    }
+    strncpy(text, start, len);
+    text[len] = '\0';
+    return len > 0;
+}
+
+// Views must stay inside the input and counts inside their bounds
+static bool result_is_sane(const struct vosk_json_result *result, const char *json, size_t len)
+{
+    const struct vosk_json_view *views[VOSK_JSON_MAX_WORDS + 1];
+    int count = 0;
+
+    if (result->word_count < 0 || result->word_count > VOSK_JSON_MAX_WORDS ||
+        result->words_total < result->word_count) {
+        return false;
+    }
+
+    views[count++] = &result->text;
+    for (int i = 0; i < result->word_count; i++) {
+        views[count++] = &result->words[i].word;
+    }
+    for (int i = 0; i < count; i++) {
+        const struct vosk_json_view *view = views[i];
+        if (view->len < 0 || (view->len > 0 && (view->ptr < json ||
+                                                view->ptr + view->len > json + len))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int check_known_inputs(void)
+{
+    struct {
+        const char *json;
+        bool ok;
+        const char *text;
+        int words;
+    } cases[] = {
+        {"{\"text\" : \"save video\"}", true, "save video", 0},
+        {"{\n  \"partial\" : \"save\"\n}", true, "save", 0},
+        {"{\"text\" : \"say \\\"save\\\" video\"}", true, "say \"save\" video", 0},
+        {"{\"text\" : \"vid\\u00e9o\"}", true, "vid\xc3\xa9o", 0},
+        {"{\"alternatives\" : [{\"confidence\" : 1.5e2, \"text\" : \"no\"}], \"text\" : \"yes\"}",
+         true, "yes", 0},
+        {"{\"result\" : [{\"word\" : \"a\", \"conf\" : 0.5}, {\"word\" : \"b\"}], \"text\" : \"a b\"}",
+         true, "a b", 2},
+        {"{\"text\" : \"unterminated}", false, "", 0},
+        {"{\"text\" : \"ok\", \"x\" : [[[[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]]]}", false, "ok", 0},
+        {"", false, "", 0},
+    };
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        struct vosk_json_result result;
+        bool ok = vosk_json_parse(cases[i].json, strlen(cases[i].json), &result);
+        char text[128];
+        vosk_json_copy(&result.text, text, sizeof(text));
+        if (ok != cases[i].ok || strcmp(text, cases[i].text) != 0 ||
+            result.word_count != cases[i].words) {
+            note("%-40s case %d: ok=%d text='%s' words=%d\n", "  MISMATCH", (int)i, ok, text,
+                   result.word_count);
+            failures++;
+        }
+    }
+
+    struct vosk_json_result result;
+    vosk_json_parse(SAMPLE_RESULT_JSON, strlen(SAMPLE_RESULT_JSON), &result);
+    if (result.word_count != 3 || fabsf(result.words[2].conf - 0.874102f) > 1e-6f ||
+        fabsf(result.words[1].start - 1.11f) > 1e-6f || fabsf(result.words[0].end - 1.11f) > 1e-6f) {
+        note("%-40s word array not parsed as expected\n", "  MISMATCH");
+        failures++;
+    }
+
+    return failures;
+}
+
+// Random edits of valid results: flipped bytes, JSON punctuation dropped in,
+// truncation. Each input lives in an exact-size heap block with no
+// terminator, so running this under ASan catches any overread.
+static void fuzz_vosk_json(int iterations, int *parsed, int *violations)
+{
+    static const char PUNCTUATION[] = "{}[]\":,\\u0e- ";
+    size_t base_len = strlen(SAMPLE_RESULT_JSON);
+    char *work = malloc(base_len * 2);
+    unsigned int seed = 99;
+
+    *parsed = 0;
+    *violations = 0;
+
+    for (int it = 0; it < iterations; it++) {
+        size_t len = base_len;
+        memcpy(work, SAMPLE_RESULT_JSON, base_len);
+
+        seed = seed * 1103515245u + 12345u;
+        int edits = 1 + (int)((seed >> 16) % 8);
+        for (int e = 0; e < edits; e++) {
+            seed = seed * 1103515245u + 12345u;
+            size_t at = (seed >> 8) % len;
+            switch ((seed >> 4) % 4) {
+            case 0:
+                work[at] = (char)(seed >> 20);
+                break;
+            case 1:
+                work[at] = PUNCTUATION[(seed >> 20) % (sizeof(PUNCTUATION) - 1)];
+                break;
+            case 2:
+                if (len < base_len * 2 - 1) {
+                    memmove(work + at + 1, work + at, len - at);
+                    work[at] = PUNCTUATION[(seed >> 20) % (sizeof(PUNCTUATION) - 1)];
+                    len++;
+                }
+                break;
+            default:
+                len = at + 1;
+                break;
+            }
+        }
+
+        char *input = malloc(len);
+        memcpy(input, work, len);
+
+        struct vosk_json_result result;
+        if (vosk_json_parse(input, len, &result)) {
+            (*parsed)++;
+        }
+        char text[64];
+        vosk_json_copy(&result.text, text, sizeof(text));
+        if (!result_is_sane(&result, input, len)) {
+            (*violations)++;
+        }
+        free(input);
+    }
+
+    free(work);
+}
+
+static void bench_vosk_json(void)
+{
+    const int iterations = 200000;
+    size_t len = strlen(SAMPLE_RESULT_JSON);
+    volatile int sink = 0;
+
+    // Through a volatile pointer so the constant input isn't folded away
+    const char *volatile json = SAMPLE_RESULT_JSON;
+
+    uint64_t start = os_gettime_ns();
+    for (int i = 0; i < iterations; i++) {
+        char text[512];
+        sink += legacy_extract_text(json, text, sizeof(text));
+    }
+    uint64_t elapsed = os_gettime_ns() - start;
+    report("legacy strstr text extraction", elapsed, iterations, "result");
+
+    start = os_gettime_ns();
+    for (int i = 0; i < iterations; i++) {
+        struct vosk_json_result result;
+        sink += vosk_json_parse(json, len, &result);
+    }
+    elapsed = os_gettime_ns() - start;
+    report("vosk_json_parse (text + 3 words)", elapsed, iterations, "result");
+    note("%-40s %.0f MB/s\n", "", elapsed ? (double)len * iterations * 1000.0 / (double)elapsed : 0.0);
+    (void)sink;
+
+    int failures = check_known_inputs();
+    note("%-40s %d failures\n", "  known inputs", failures);
+
+    int parsed, violations;
+    fuzz_vosk_json(100000, &parsed, &violations);
+    note("%-40s 100000 mutated inputs, %d still valid, %d invariant violations\n", "  fuzz",
+           parsed, violations);
+    check(failures == 0, "vosk_json known inputs");
+    check(violations == 0, "vosk_json fuzz invariants");
+}
+
+#ifdef HAVE_VOSK
+
+// ---------------------------------------------------------------------------
+// Grammar size vs. decoder cost. Needs a real model, so it only runs with
+// GARMIN_BENCH_MODEL pointing at a Vosk model directory.
+
+#define GRAMMAR_AUDIO_SAMPLES (16000 * 5)
+#define GRAMMAR_CHUNK 1600
+
+// Common short words that every small model has in its vocabulary
+static const char *GRAMMAR_WORDS[] = {
+    "save", "video", "clip", "that", "start", "stop", "replay", "buffer",
+    "take", "picture", "mark", "scene", "one", "two", "three", "four",
+    "five", "six", "seven", "eight", "nine", "ten", "camera", "game",
+    "switch", "next", "back", "mute", "music", "record", "play", "show",
+};
+#define NUM_GRAMMAR_WORDS (int)(sizeof(GRAMMAR_WORDS) / sizeof(GRAMMAR_WORDS[0]))
+
+// `count` distinct three-word commands
+static command_table_t *build_command_table(int count)
+{
+    command_table_t *table = command_table_create();
+    for (int i = 0; i < count; i++) {
+        char phrase[64];
+        snprintf(phrase, sizeof(phrase), "%s %s %s",
+                 GRAMMAR_WORDS[i % NUM_GRAMMAR_WORDS],
+                 GRAMMAR_WORDS[(i / NUM_GRAMMAR_WORDS) % NUM_GRAMMAR_WORDS],
+                 GRAMMAR_WORDS[(i / NUM_GRAMMAR_WORDS / NUM_GRAMMAR_WORDS + 7) % NUM_GRAMMAR_WORDS]);
+        command_table_add(table, phrase, GARMIN_ACTION_SAVE);
+    }
+    return table;
+}
+
+static void bench_grammar(void)
+{
+    static const int SIZES[] = {1, 4, 16, 64, 256, 1024};
+
+    const char *model_path = getenv("GARMIN_BENCH_MODEL");
+    if (!model_path || !*model_path) {
+        note("%-40s skipped, set GARMIN_BENCH_MODEL to a model directory\n", "grammar");
+        return;
+    }
+
+    vosk_engine_t *engine = vosk_engine_create(model_path, NULL);
+    if (!engine) {
+        note("%-40s failed to load %s\n", "grammar", model_path);
+        return;
+    }
+
+    short *audio = malloc(GRAMMAR_AUDIO_SAMPLES * sizeof(short));
+    fill_test_signal(audio, GRAMMAR_AUDIO_SAMPLES, 16000, 5);
+
+    for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); i++) {
+        command_table_t *table = build_command_table(SIZES[i]);
+        const char *grammar = command_table_grammar(table);
+
+        // Live swap where libvosk supports it, otherwise a new recognizer
+        uint64_t start = os_gettime_ns();
+        bool swapped = vosk_engine_set_grammar(engine, grammar);
+        if (!swapped) {
+            vosk_engine_destroy(engine);
+            engine = vosk_engine_create(model_path, grammar);
+            if (!engine) {
+                command_table_destroy(table);
+                break;
+            }
+        }
+        uint64_t apply_ns = os_gettime_ns() - start;
+
+        start = os_gettime_ns();
+        for (int offset = 0; offset < GRAMMAR_AUDIO_SAMPLES; offset += GRAMMAR_CHUNK) {
+            vosk_engine_process(engine, audio + offset, GRAMMAR_CHUNK);
+        }
+        vosk_engine_get_final_result(engine);
+        uint64_t decode_ns = os_gettime_ns() - start;
+        vosk_engine_reset(engine);
+
+        char name[64];
+        snprintf(name, sizeof(name), "grammar %d commands (%d phrases)", SIZES[i],
+                 command_table_grammar_size(table));
+        note("%-40s %10.1f ms/s of audio %8.1f ms to apply (%s)\n", name,
+               decode_ns / 1000000.0 / ((double)GRAMMAR_AUDIO_SAMPLES / 16000.0),
+               apply_ns / 1000000.0, swapped ? "set_grm" : "new recognizer");
+
+        command_table_destroy(table);
+    }
+
+    free(audio);
+    vosk_engine_destroy(engine);
+    model_cache_shutdown();
+}
+
+#endif // HAVE_VOSK
+
+// ---------------------------------------------------------------------------
+// Many-command matching
+
+#define INDEX_PHRASES_MAX 1000
+// A corpus text in its {"text" : "..."} wrapper
+#define INDEX_TEXT_MAX (CORPUS_TEXT_MAX + 16)
+
+// Invented two-syllable words ("baku", "toze", ...), so the vocabulary grows
+// with the table like it does for real command lists
+static void make_word(unsigned int n, char *word)
+{
+    static const char CONSONANTS[] = "bdfgklmnprstvz";
+    static const char VOWELS[] = "aeiou";
+    word[0] = CONSONANTS[n % 14];
+    word[1] = VOWELS[(n / 14) % 5];
+    word[2] = CONSONANTS[(n / 70) % 14];
+    word[3] = VOWELS[(n / 980) % 5];
+    word[4] = '\0';
+}
+
+// Command 0 is the default "save video", the rest three invented words
+static void make_index_phrase(int i, char *phrase)
+{
+    if (i == 0) {
+        strcpy(phrase, "save video");
+        return;
+    }
+    unsigned int seed = (unsigned int)i * 2654435761u;
+    char words[3][8];
+    for (int w = 0; w < 3; w++) {
+        seed = seed * 1103515245u + 12345u;
+        make_word((seed >> 8) % 4900, words[w]);
+    }
+    sprintf(phrase, "%s %s %s", words[0], words[1], words[2]);
+}
+
+static void quiet_log(int level, const char *format, va_list args, void *param)
+{
+    (void)level;
+    (void)format;
+    (void)args;
+    (void)param;
+}
+
+static void bench_phrase_index(void)
+{
+    static const int SIZES[] = {1, 10, 100, 1000};
+    static char corpus[CORPUS_SIZE][CORPUS_TEXT_MAX];
+    static bool has_phrase[CORPUS_SIZE];
+    static char results[CORPUS_SIZE][INDEX_TEXT_MAX];
+    const int sensitivity = 50;
+    const int rounds = 5;
+
+    // Every fourth transcript says one of the invented commands instead,
+    // every eighth with a letter misheard
+    build_corpus(corpus, "save video", has_phrase);
+    unsigned int seed = 3;
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        char phrase[64];
+        seed = seed * 1103515245u + 12345u;
+        if (i % 4 == 3) {
+            make_index_phrase(1 + (int)((seed >> 8) % (INDEX_PHRASES_MAX - 1)), phrase);
+            if (i % 8 == 7) {
+                phrase[(seed >> 4) % strlen(phrase)] = 'x';
+            }
+            snprintf(results[i], INDEX_TEXT_MAX, "{\"text\" : \"okay %s\"}", phrase);
+        } else {
+            snprintf(results[i], INDEX_TEXT_MAX, "{\"text\" : \"%.*s\"}", CORPUS_TEXT_MAX - 1,
+                     corpus[i]);
+        }
+    }
+
+    // Every result logs what was heard; that would swamp the timings
+    base_set_log_handler(quiet_log, NULL);
+
+    char summary[64];
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++) {
+        command_table_t *table = command_table_create();
+        for (int i = 0; i < SIZES[s]; i++) {
+            char phrase[64];
+            make_index_phrase(i, phrase);
+            command_table_add(table, phrase, GARMIN_ACTION_SAVE);
+        }
+
+        static int linear_command[CORPUS_SIZE];
+        static float linear_confidence[CORPUS_SIZE];
+        volatile float sink = 0.0f;
+
+        // Before command_table_finish the detector scores every command
+        uint64_t start = os_gettime_ns();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < CORPUS_SIZE; i++) {
+                linear_confidence[i] = phrase_detector_check(results[i], sensitivity, table,
+                                                             &linear_command[i]);
+            }
+        }
+        uint64_t linear_ns = os_gettime_ns() - start;
+
+        command_table_finish(table);
+
+        int differ = 0, triggers = 0;
+        start = os_gettime_ns();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < CORPUS_SIZE; i++) {
+                int command;
+                float confidence = phrase_detector_check(results[i], sensitivity, table, &command);
+                sink += confidence;
+                if (r == 0) {
+                    bool hit = confidence > 0.5f;
+                    bool linear_hit = linear_confidence[i] > 0.5f;
+                    triggers += hit;
+                    differ += hit != linear_hit || (hit && command != linear_command[i]);
+                }
+            }
+        }
+        uint64_t index_ns = os_gettime_ns() - start;
+        (void)sink;
+
+        snprintf(summary, sizeof(summary), "phrase_detector_check %d commands linear", SIZES[s]);
+        report(summary, linear_ns, (uint64_t)rounds * CORPUS_SIZE, "result");
+        snprintf(summary, sizeof(summary), "phrase_detector_check %d commands indexed", SIZES[s]);
+        report(summary, index_ns, (uint64_t)rounds * CORPUS_SIZE, "result");
+        note("%-40s %d words, %d triggers, %d differ\n", "",
+             phrase_index_vocabulary_size(command_table_index(table)), triggers, differ);
+        check(differ == 0, summary);
+
+        command_table_destroy(table);
+    }
+
+    // Whole words only: inflected forms no longer contain the phrase
+    static const char *PROBES[] = {
+        "{\"text\" : \"i saved videos\"}",
+        "{\"text\" : \"video unsaved\"}",
+        "{\"text\" : \"save videos\"}",
+        "{\"text\" : \"video save\"}",
+    };
+    command_table_t *table = command_table_create();
+    command_table_add(table, "save video", GARMIN_ACTION_SAVE);
+    command_table_finish(table);
+    for (size_t i = 0; i < sizeof(PROBES) / sizeof(PROBES[0]); i++) {
+        int command;
+        float confidence = phrase_detector_check(PROBES[i], sensitivity, table, &command);
+        note("  %-38s confidence %.2f%s\n", PROBES[i], confidence,
+               confidence > 0.5f ? " (trigger)" : "");
+    }
+    command_table_destroy(table);
+
+    base_set_log_handler(NULL, NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline stats
+
+#define STATS_SAMPLES 1000000
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// More threads than there are shards, so some share the overflow shard
+#define STATS_THREADS 20
+#define STATS_THREAD_EVENTS 100000
+
+static void *record_stats_thread(void *data)
+{
+    uint64_t ns = (uint64_t)(uintptr_t)data;
+    for (int i = 0; i < STATS_THREAD_EVENTS; i++) {
+        pipeline_stats_record(STAGE_RESULT_JSON, ns + (uint64_t)(i % 1000));
+        pipeline_stats_add(COUNTER_PACKETS, 1);
+    }
+    return NULL;
+}
+
+// Every event from concurrent threads is counted once
+static void check_stats_threads(void)
+{
+    pipeline_stats_reset();
+    pthread_t threads[STATS_THREADS];
+    int started = 0;
+    for (int t = 0; t < STATS_THREADS; t++) {
+        if (pthread_create(&threads[t], NULL, record_stats_thread,
+                           (void *)(uintptr_t)(1000 * (t + 1))) != 0) {
+            break;
+        }
+        started++;
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    struct pipeline_stats_snapshot snapshot;
+    pipeline_stats_snapshot(&snapshot);
+    const struct stage_summary *stage = &snapshot.stages[STAGE_RESULT_JSON];
+    uint64_t expected = (uint64_t)started * STATS_THREAD_EVENTS;
+    note("  %d threads: %llu of %llu events, %llu packets, max %llu ns\n", started,
+         (unsigned long long)stage->count, (unsigned long long)expected,
+         (unsigned long long)snapshot.counters[COUNTER_PACKETS],
+         (unsigned long long)stage->max_ns);
+    check(started == STATS_THREADS && stage->count == expected &&
+          snapshot.counters[COUNTER_PACKETS] == expected &&
+          stage->max_ns == 1000ULL * STATS_THREADS + 999, "pipeline_stats threads");
+}
+
+#define SHARED_RESETS 1000
+
+struct shared_recorder {
+    pthread_mutex_t mutex;
+    bool finish;
+};
+
+// Like the replay worker: records all along, whatever resets go by
+static void *shared_recorder_thread(void *data)
+{
+    struct shared_recorder *recorder = data;
+    pipeline_stats_share_thread();
+    for (;;) {
+        pthread_mutex_lock(&recorder->mutex);
+        bool finish = recorder->finish;
+        pthread_mutex_unlock(&recorder->mutex);
+        if (finish) {
+            break;
+        }
+        pipeline_stats_record(STAGE_DISPATCH, 1000);
+    }
+    for (int i = 0; i < STATS_THREAD_EVENTS; i++) {
+        pipeline_stats_record(STAGE_RECONNECT, 2000);
+    }
+    return NULL;
+}
+
+// Resets while a thread that outlives runs keeps recording lose nothing
+// recorded after them
+static void check_stats_shared_reset(void)
+{
+    struct shared_recorder recorder = {.finish = false};
+    pthread_mutex_init(&recorder.mutex, NULL);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, shared_recorder_thread, &recorder) != 0) {
+        check(false, "pipeline_stats shared reset");
+        pthread_mutex_destroy(&recorder.mutex);
+        return;
+    }
+
+    for (int i = 0; i < SHARED_RESETS; i++) {
+        pipeline_stats_reset();
+    }
+    pthread_mutex_lock(&recorder.mutex);
+    recorder.finish = true;
+    pthread_mutex_unlock(&recorder.mutex);
+    pthread_join(thread, NULL);
+    pthread_mutex_destroy(&recorder.mutex);
+
+    struct pipeline_stats_snapshot snapshot;
+    pipeline_stats_snapshot(&snapshot);
+    const struct stage_summary *stage = &snapshot.stages[STAGE_RECONNECT];
+    note("  %d resets under a shared recorder: %llu of %d events after them, max %llu ns\n",
+         SHARED_RESETS, (unsigned long long)stage->count, STATS_THREAD_EVENTS,
+         (unsigned long long)stage->max_ns);
+    check(stage->count == STATS_THREAD_EVENTS && stage->max_ns == 2000 &&
+          snapshot.stages[STAGE_DISPATCH].max_ns == 1000, "pipeline_stats shared reset");
+}
+
+static void bench_pipeline_stats(void)
+{
+    // Heavy-tailed latencies from ~100 ns up to a few ms, like decode times
+    static uint64_t values[STATS_SAMPLES];
+    unsigned int seed = 11;
+    for (int i = 0; i < STATS_SAMPLES; i++) {
+        seed = seed * 1103515245u + 12345u;
+        double u = ((seed >> 8) & 0xFFFF) / 65536.0;
+        values[i] = (uint64_t)(100.0 * exp(u * u * 10.0));
+    }
+
+    const int rounds = 10;
+    pipeline_stats_reset();
+    uint64_t start = os_gettime_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < STATS_SAMPLES; i++) {
+            pipeline_stats_record(STAGE_VOSK_ACCEPT, values[i]);
+        }
+    }
+    report("pipeline_stats_record", os_gettime_ns() - start,
+           (uint64_t)rounds * STATS_SAMPLES, "event");
+
+    // What an instrumented stage pays around the record: two clock reads
+    volatile uint64_t sink = 0;
+    start = os_gettime_ns();
+    for (int i = 0; i < STATS_SAMPLES; i++) {
+        sink += os_gettime_ns();
+    }
+    report("os_gettime_ns", os_gettime_ns() - start, STATS_SAMPLES, "call");
+    (void)sink;
+
+    struct pipeline_stats_snapshot snapshot;
+    start = os_gettime_ns();
+    pipeline_stats_snapshot(&snapshot);
+    uint64_t snapshot_ns = os_gettime_ns() - start;
+
+    qsort(values, STATS_SAMPLES, sizeof(values[0]), compare_u64);
+    uint64_t p50 = values[STATS_SAMPLES / 2 - 1];
+    uint64_t p99 = values[STATS_SAMPLES - STATS_SAMPLES / 100 - 1];
+    const struct stage_summary *stage = &snapshot.stages[STAGE_VOSK_ACCEPT];
+    note("  snapshot %.1f us, %llu events; p50 %llu ns (exact %llu, %+.1f%%), "
+           "p99 %llu ns (exact %llu, %+.1f%%), max %llu ns (exact %llu)\n",
+           snapshot_ns / 1000.0, (unsigned long long)stage->count,
+           (unsigned long long)stage->p50_ns, (unsigned long long)p50,
+           100.0 * ((double)stage->p50_ns - (double)p50) / (double)p50,
+           (unsigned long long)stage->p99_ns, (unsigned long long)p99,
+           100.0 * ((double)stage->p99_ns - (double)p99) / (double)p99,
+           (unsigned long long)stage->max_ns, (unsigned long long)values[STATS_SAMPLES - 1]);
+
+    check(fabs((double)stage->p50_ns - (double)p50) <= 0.07 * (double)p50, "pipeline_stats p50");
+    check(fabs((double)stage->p99_ns - (double)p99) <= 0.07 * (double)p99, "pipeline_stats p99");
+
+    char text[1024];
+    pipeline_stats_format(&snapshot, text, sizeof(text));
+    note("%s\n", text);
+
+    check_stats_threads();
+    check_stats_shared_reset();
+}
+
+// ---------------------------------------------------------------------------
+// Trigger arbitration
+
+// Stands in for the replay worker and the replay buffer
+struct fake_buffer {
+    bool active;
+    bool accept;
+    int dispatched;
+    enum replay_request last;
+};
+
+static bool fake_dispatch(enum replay_request request, void *param)
+{
+    struct fake_buffer *buffer = param;
+    if (!buffer->accept) {
+        return false;
+    }
+    buffer->dispatched++;
+    buffer->last = request;
+    return true;
+}
+
+static bool fake_is_active(void *param)
+{
+    struct fake_buffer *buffer = param;
+    return buffer->active;
+}
+
+static const struct trigger_arbiter_ops FAKE_BUFFER_OPS = {
+    .dispatch = fake_dispatch,
+    .is_active = fake_is_active,
+};
+
+static void check_arbiter_states(void)
+{
+    struct fake_buffer buffer = {.active = true, .accept = true};
+    trigger_arbiter_t *arbiter = trigger_arbiter_create(&FAKE_BUFFER_OPS, &buffer);
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_ACTIVE, "arbiter initial state");
+
+    // A save behind a save queues once, then is suppressed; repeats coalesce
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE, 0) == ARBITER_RUN, "arbiter save");
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_SAVING, "arbiter saving");
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE, 60000) == ARBITER_COALESCED,
+          "arbiter coalesce");
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE_AND_RESTART, 0) == ARBITER_QUEUED,
+          "arbiter queue behind save");
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE, 0) == ARBITER_SUPPRESSED,
+          "arbiter second queued save");
+
+    // Finishing the save releases the queued restart
+    trigger_arbiter_request_done(arbiter, REPLAY_REQUEST_SAVE, REPLAY_RESULT_DONE);
+    check(buffer.dispatched == 2 && buffer.last == REPLAY_REQUEST_SAVE_AND_RESTART,
+          "arbiter releases queued save");
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_RESTARTING, "arbiter restarting");
+
+    // The restart's own stop/start events don't end it, the completion does
+    trigger_arbiter_handle_event(arbiter, BUFFER_EVENT_STOPPED);
+    trigger_arbiter_handle_event(arbiter, BUFFER_EVENT_STARTED);
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_RESTARTING, "arbiter restart events");
+    trigger_arbiter_request_done(arbiter, REPLAY_REQUEST_SAVE_AND_RESTART, REPLAY_RESULT_DONE);
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_ACTIVE, "arbiter restart done");
+
+    // A request the worker couldn't take leaves the state alone
+    buffer.accept = false;
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_STOP, 0) == ARBITER_SUPPRESSED,
+          "arbiter dispatch failure");
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_ACTIVE, "arbiter state after failure");
+    buffer.accept = true;
+
+    // Stopped from the OBS UI: saves and stops are pointless, starts aren't
+    trigger_arbiter_handle_event(arbiter, BUFFER_EVENT_STOPPING);
+    trigger_arbiter_handle_event(arbiter, BUFFER_EVENT_STOPPED);
+    check(trigger_arbiter_get_state(arbiter) == BUFFER_IDLE, "arbiter stopped from UI");
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_STOP, 0) == ARBITER_SUPPRESSED,
+          "arbiter stop while idle");
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_START, 0) == ARBITER_RUN,
+          "arbiter start while idle");
+    check(trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE, 0) == ARBITER_SUPPRESSED,
+          "arbiter save while starting");
+
+    struct trigger_arbiter_stats stats;
+    trigger_arbiter_get_stats(arbiter, &stats);
+    check(stats.triggers == 8 && stats.run == 3 && stats.queued == 1 && stats.coalesced == 1 &&
+              stats.suppressed == 4,
+          "arbiter stats");
+
+    trigger_arbiter_destroy(arbiter);
+}
+
+static void bench_arbiter(void)
+{
+    const int iterations = 1000000;
+    struct fake_buffer buffer = {.active = true, .accept = true};
+    trigger_arbiter_t *arbiter = trigger_arbiter_create(&FAKE_BUFFER_OPS, &buffer);
+
+    // Decisions are logged; that would swamp the timings
+    base_set_log_handler(quiet_log, NULL);
+
+    // The common path: a save let through, then its completion
+    uint64_t start = os_gettime_ns();
+    for (int i = 0; i < iterations; i++) {
+        trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE, 0);
+        trigger_arbiter_request_done(arbiter, REPLAY_REQUEST_SAVE, REPLAY_RESULT_DONE);
+    }
+    report("trigger_arbiter save + done", os_gettime_ns() - start, iterations, "trigger");
+    check(buffer.dispatched == iterations, "arbiter dispatched every save");
+
+    // Repeats inside the coalescing window, dropped without a dispatch
+    start = os_gettime_ns();
+    for (int i = 0; i < iterations; i++) {
+        trigger_arbiter_submit(arbiter, REPLAY_REQUEST_SAVE, 60000);
+    }
+    report("trigger_arbiter coalesced", os_gettime_ns() - start, iterations, "trigger");
+    trigger_arbiter_destroy(arbiter);
+
+    check_arbiter_states();
+    base_set_log_handler(NULL, NULL);
+}
+
+// ---------------------------------------------------------------------------
+
+static const struct bench_case CASES[] = {
+    {"resampler", bench_resampler},
+    {"convert", bench_convert},
+    {"capture-scratch", bench_capture_scratch},
+    {"fft", bench_fft},
+    {"echo-cancel", bench_echo_cancel},
+    {"noise-suppress", bench_noise_suppress},
+    {"auto-gain", bench_auto_gain},
+    {"vad", bench_vad},
+    {"keyword-spot", bench_keyword_spot},
+    {"phrase-match", bench_phrase_match},
+    {"vosk-json", bench_vosk_json},
+#ifdef HAVE_VOSK
+    {"grammar", bench_grammar},
+#endif
+    {"phrase-index", bench_phrase_index},
+    {"pipeline-stats", bench_pipeline_stats},
+    {"arbiter", bench_arbiter},
+};
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            g_json = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    if (g_json) {
+        printf("{\n  \"benchmarks\": [");
+    }
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++) {
+        if (filter && !strstr(CASES[i].name, filter)) {
+            continue;
+        }
+        CASES[i].run();
+    }
+    if (g_json) {
+        printf("\n  ],\n  \"failures\": %d\n}\n", g_failures);
+    }
+    if (g_failures) {
+        fprintf(stderr, "%d check%s failed\n", g_failures, g_failures == 1 ? "" : "s");
+    }
+
+    return g_failures ? 1 : 0;
+}
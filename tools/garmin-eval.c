@@ -0,0 +1,1233 @@
+// Offline accuracy and speed evaluation of the recognizer + phrase detector.
+// Usage: garmin-eval --model <Vosk model directory> [options] <clip directory>
+//
+// The clip directory holds WAV (or raw 16 kHz s16le) clips and a labels.tsv
+// describing them, one clip per line:
+//
+//   # clip                        expect   phrase end (s, positives only)
+//   positive/alex-01.wav          save     2.35
+//   near-miss/save-the-date.wav   none
+//   noise/match-01.wav            none
+//
+// `expect` is an action name ("save", "start_buffer", ...) or "none". The
+// clip's directory is its category in the report. Every clip is decoded once
+// per run, the way the recognition thread does it (file source, noise
+// suppression and auto gain if asked for, VAD gate, endpointing, early
+// trigger); the detector is then replayed over the recorded results for each
+// sensitivity. The report goes to stdout (or --output) as JSON so runs from
+// different builds can be diffed.
+//
+// --noise and --gain make clean clips harder before any of that: a looped
+// noise recording mixed in at a given level (from a different point in it for
+// each clip), and a mic gain that is too low or too high. Comparing runs with
+// and without --denoise/--agc on the same degraded clips shows what the
+// cleanup buys.
+//
+// --kws puts the keyword prefilter in front of the decoder. Its templates
+// are learned first from a separate enrollment directory (same labels.tsv
+// format), decoded in full the way the plugin does until it has learned
+// enough, from every command the detector confirms at the plugin's default
+// sensitivity. The workers then get a frozen copy: they decode only from a
+// spot, with the lookback and wake budget of the plugin, and don't audit.
+// A wake decodes until its budget runs out or the gate closes (the plugin
+// also stops at a detection), so decoded_audio_s is an upper bound; compare
+// it and the false reject rate with a run without --kws.
+
+#include "audio-capture/audio-source.h"
+#include "audio-capture/noise-suppressor.h"
+#include "audio-capture/auto-gain.h"
+#include "voice-recognition/vad.h"
+#include "voice-recognition/keyword-spotter.h"
+#include "voice-recognition/command-table.h"
+#include "voice-recognition/phrase-detector.h"
+#include "voice-recognition/vosk-engine.h"
+#include "voice-recognition/model-cache.h"
+
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Same read size as the recognition thread
+#define AUDIO_BUFFER_SIZE 4096
+
+#define MAX_SENSITIVITIES 100
+#define MAX_CATEGORIES 32
+#define LABELS_FILE "labels.tsv"
+#define DEFAULT_NOISE_DBFS -35.0f
+
+// As the plugin: templates are learned at its default sensitivity, and a
+// wake decodes 1.5 s of live audio after the lookback
+#define KWS_ENROLL_SENSITIVITY 70
+#define KWS_WAKE_SAMPLES (AUDIO_SOURCE_SAMPLE_RATE * 3 / 2)
+
+// One result the recognizer produced while decoding a clip
+struct clip_event {
+    bool partial;          // Stable partial hypothesis (early trigger)
+    uint64_t position;     // Input samples consumed when it was available
+    char *json;
+};
+
+struct clip {
+    char *path;            // Relative to the clip directory
+    char *category;
+    bool positive;
+    enum garmin_action expect;
+    double phrase_end_s;   // < 0 when not labeled
+
+    // Filled by the workers
+    bool decoded;
+    uint64_t samples;
+    uint64_t samples_decoded;   // Including lookback handed over on a wake
+    uint64_t decode_ns;
+    uint64_t spot_ns;
+    int wakes;
+    struct clip_event *events;
+    int event_count;
+    int event_capacity;
+
+    // Per sensitivity: first detected action, or -1
+    int first_action[MAX_SENSITIVITIES];
+};
+
+struct eval_options {
+    const char *model_path;
+    const char *clip_dir;
+    const char *output_path;
+    int language;
+    int sensitivities[MAX_SENSITIVITIES];
+    int sensitivity_count;
+    int threads;
+    bool vad_enabled;
+    int vad_hangover_ms;
+    int endpoint_mode;
+    int early_stable_frames;   // 0 = early trigger off
+    bool denoise;
+    bool auto_gain;
+    bool verbose;
+
+    // Degradation applied to every clip before anything else
+    float gain_db;             // Simulated mic gain
+    const char *noise_path;    // Noise recording to mix in, NULL for none
+    float noise_dbfs;          // Its RMS level once mixed in
+    short *noise;              // noise_path, read once
+    int noise_count;
+    float noise_scale;         // Brings the recording to noise_dbfs
+
+    // Keyword prefilter
+    const char *kws_dir;       // Enrollment clips, NULL for no prefilter
+    float kws_threshold;
+    keyword_spotter_t *kws;    // Enrolled templates the workers copy
+    int kws_enroll_clips;
+};
+
+struct eval_job {
+    const struct eval_options *options;
+    struct clip *clips;
+    int clip_count;
+    volatile long next_clip;
+};
+
+struct eval_worker {
+    struct eval_job *job;
+    vosk_engine_t *engine;
+    pthread_t thread;
+};
+
+// A worker's audio stages between the file and the recognizer, all optional
+struct clip_pipeline {
+    noise_suppressor_t *denoise;
+    short *denoise_buffer;
+    auto_gain_t *agc;
+    vad_t *vad;
+    short *gated_buffer;
+    keyword_spotter_t *kws;
+    short *kws_buffer;
+    const command_table_t *learn_commands;   // Enrolling: decode all, learn confirmed commands
+};
+
+static bool g_verbose;
+
+// Decoding logs every result; only problems are interesting here
+static void eval_log(int level, const char *format, va_list args, void *param)
+{
+    (void)param;
+    if (level > LOG_WARNING && !g_verbose) {
+        return;
+    }
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+}
+
+// ---------------------------------------------------------------------------
+// Decoding
+
+static void add_event(struct clip *clip, bool partial, uint64_t position, const char *json)
+{
+    if (!json) {
+        return;
+    }
+
+    if (clip->event_count == clip->event_capacity) {
+        int capacity = clip->event_capacity ? clip->event_capacity * 2 : 8;
+        struct clip_event *events = realloc(clip->events, (size_t)capacity * sizeof(*events));
+        if (!events) {
+            return;
+        }
+        clip->events = events;
+        clip->event_capacity = capacity;
+    }
+
+    struct clip_event *event = &clip->events[clip->event_count++];
+    event->partial = partial;
+    event->position = position;
+    event->json = bstrdup(json);
+}
+
+// Early trigger bookkeeping, as check_partial_result() in plugin-main.c
+struct partial_state {
+    char text[512];
+    int stable_samples;
+    bool checked;
+};
+
+static void track_partial(struct clip *clip, vosk_engine_t *engine, struct partial_state *state,
+                          int samples_decoded, int stable_frames, uint64_t position)
+{
+    const char *json = vosk_engine_get_partial_result(engine);
+    if (!json) {
+        return;
+    }
+
+    if (strcmp(json, state->text) != 0) {
+        size_t len = strlen(json);
+        if (len >= sizeof(state->text)) {
+            len = 0;
+        }
+        memcpy(state->text, json, len);
+        state->text[len] = '\0';
+        state->stable_samples = 0;
+        state->checked = false;
+        return;
+    }
+
+    state->stable_samples += samples_decoded;
+    if (state->checked || state->stable_samples < stable_frames * (AUDIO_SOURCE_SAMPLE_RATE / 100)) {
+        return;
+    }
+
+    state->checked = true;
+    add_event(clip, true, position, json);
+}
+
+// Decode one clip and record every final result and early-trigger candidate.
+// The plugin also resets the recognizer after a detection; Vosk starts a new
+// utterance after each final result anyway, so the recorded results don't
+// depend on the sensitivity.
+// Mix the noise recording into a chunk and apply the simulated mic gain
+// position: Where in the noise recording the chunk starts
+static void degrade(const struct eval_options *options, short *samples, int count,
+                    uint64_t position)
+{
+    float gain = powf(10.0f, options->gain_db / 20.0f);
+    for (int i = 0; i < count; i++) {
+        float v = (float)samples[i] * gain;
+        if (options->noise_count) {
+            v += (float)options->noise[(position + (uint64_t)i) % (uint64_t)options->noise_count] *
+                 options->noise_scale;
+        }
+        v = v > -32768.0f ? v : -32768.0f;
+        v = v < 32767.0f ? v : 32767.0f;
+        samples[i] = (short)lrintf(v);
+    }
+}
+
+// Where each clip starts in the noise recording; the same on every run
+static uint64_t noise_offset(const struct clip *clip)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *c = clip->path; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// A final result: record it, and when enrolling learn the command it confirms
+static void finish_utterance(struct clip_pipeline *pipeline, struct clip *clip, const char *json)
+{
+    add_event(clip, false, clip->samples, json);
+
+    int command;
+    if (pipeline->learn_commands && json &&
+        phrase_detector_check(json, KWS_ENROLL_SENSITIVITY, pipeline->learn_commands,
+                              &command) > 0.5f) {
+        keyword_spotter_learn(pipeline->kws,
+                              command_table_get(pipeline->learn_commands, command)->phrase);
+    }
+}
+
+static void decode_clip(const struct eval_options *options, vosk_engine_t *engine,
+                        struct clip_pipeline *pipeline, const char *clip_dir, struct clip *clip)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", clip_dir, clip->path);
+
+    struct audio_source_config config = {0};
+    config.type = AUDIO_SOURCE_FILE;
+    config.path = path;
+
+    void *source = file_source_ops.create(&config);
+    if (!source || !file_source_ops.start(source)) {
+        fprintf(stderr, "garmin-eval: can't read %s\n", path);
+        if (source) {
+            file_source_ops.destroy(source);
+        }
+        return;
+    }
+
+    noise_suppressor_reset(pipeline->denoise);
+    auto_gain_reset(pipeline->agc);
+    vad_reset(pipeline->vad);
+    keyword_spotter_reset(pipeline->kws);
+    vosk_engine_reset(engine);
+
+    // The prefilter gates the decoder unless it's enrolling
+    bool gating = pipeline->kws && !pipeline->learn_commands;
+    bool awake = false;
+    int wake_budget = 0;
+
+    bool degraded = options->noise_count || options->gain_db != 0.0f;
+    uint64_t noise_start = noise_offset(clip);
+
+    struct partial_state partial = {0};
+    short buffer[AUDIO_BUFFER_SIZE];
+    uint64_t start = os_gettime_ns();
+
+    for (;;) {
+        int count = file_source_ops.read(source, buffer, AUDIO_BUFFER_SIZE, NULL);
+        if (count < 0) {
+            break;
+        }
+        if (degraded) {
+            degrade(options, buffer, count, noise_start + clip->samples);
+        }
+        clip->samples += (uint64_t)count;
+
+        short *decode_buffer = buffer;
+        int decode_samples = count;
+        if (pipeline->denoise) {
+            decode_samples = noise_suppressor_process(pipeline->denoise, decode_buffer,
+                                                      decode_samples, pipeline->denoise_buffer);
+            decode_buffer = pipeline->denoise_buffer;
+        }
+        if (pipeline->agc) {
+            auto_gain_process(pipeline->agc, decode_buffer, decode_samples, decode_buffer);
+        }
+
+        bool gate_closed = false;
+        if (pipeline->vad) {
+            decode_samples = vad_process(pipeline->vad, decode_buffer, decode_samples,
+                                         pipeline->gated_buffer, &gate_closed);
+            decode_buffer = pipeline->gated_buffer;
+        }
+
+        if (pipeline->kws && decode_samples > 0) {
+            uint64_t spot_start = os_gettime_ns();
+            struct keyword_spot spot;
+            bool spotted = keyword_spotter_process(pipeline->kws, decode_buffer, decode_samples,
+                                                   &spot);
+            clip->spot_ns += os_gettime_ns() - spot_start;
+
+            if (!gating) {
+                // Enrolling decodes everything
+            } else if (awake) {
+                wake_budget -= decode_samples;
+            } else if (spotted) {
+                vosk_engine_reset(engine);
+                memset(&partial, 0, sizeof(partial));
+                awake = true;
+                wake_budget = KWS_WAKE_SAMPLES;
+                clip->wakes++;
+                decode_samples = keyword_spotter_recent_audio(pipeline->kws, pipeline->kws_buffer,
+                                                              spot.lookback);
+                decode_buffer = pipeline->kws_buffer;
+            } else {
+                decode_samples = 0;
+            }
+        }
+
+        if (decode_samples > 0) {
+            clip->samples_decoded += (uint64_t)decode_samples;
+            int result = vosk_engine_process(engine, decode_buffer, decode_samples);
+            if (result == 1) {
+                finish_utterance(pipeline, clip, vosk_engine_get_result(engine));
+                memset(&partial, 0, sizeof(partial));
+            } else if (result == 0 && options->early_stable_frames > 0) {
+                track_partial(clip, engine, &partial, decode_samples,
+                              options->early_stable_frames, clip->samples);
+            }
+        }
+
+        // An asleep prefilter gave the decoder nothing to finish
+        if ((gate_closed || (awake && wake_budget <= 0)) && (!gating || awake)) {
+            finish_utterance(pipeline, clip, vosk_engine_get_final_result(engine));
+            memset(&partial, 0, sizeof(partial));
+            awake = false;
+        }
+    }
+
+    // The clip may end mid-utterance
+    if (!gating || awake) {
+        finish_utterance(pipeline, clip, vosk_engine_get_final_result(engine));
+    }
+
+    clip->decode_ns = os_gettime_ns() - start;
+    clip->decoded = true;
+    file_source_ops.destroy(source);
+}
+
+// A stage that can't be created is left out, as in the plugin, except the
+// prefilter: a run with --kws that decoded everything would be misleading
+// Returns: false if the prefilter was asked for and couldn't be created
+static bool init_pipeline(const struct eval_options *options, struct clip_pipeline *pipeline)
+{
+    memset(pipeline, 0, sizeof(*pipeline));
+    int chunk = AUDIO_BUFFER_SIZE;
+    if (options->denoise) {
+        struct noise_suppressor_config config;
+        noise_suppressor_config_default(&config);
+        pipeline->denoise = noise_suppressor_create(&config);
+        pipeline->denoise_buffer = pipeline->denoise ?
+            malloc((size_t)noise_suppressor_max_output(pipeline->denoise, chunk) * sizeof(short)) :
+            NULL;
+        if (!pipeline->denoise_buffer) {
+            noise_suppressor_destroy(pipeline->denoise);
+            pipeline->denoise = NULL;
+        } else {
+            chunk = noise_suppressor_max_output(pipeline->denoise, chunk);
+        }
+    }
+    if (options->auto_gain) {
+        struct auto_gain_config config;
+        auto_gain_config_default(&config);
+        pipeline->agc = auto_gain_create(&config);
+    }
+    if (options->vad_enabled) {
+        struct vad_config config;
+        vad_config_default(&config);
+        config.hangover_ms = options->vad_hangover_ms;
+        pipeline->vad = vad_create(&config);
+        pipeline->gated_buffer = pipeline->vad ?
+            malloc((size_t)vad_max_output(pipeline->vad, chunk) * sizeof(short)) : NULL;
+        if (!pipeline->gated_buffer) {
+            vad_destroy(pipeline->vad);
+            pipeline->vad = NULL;
+        }
+    }
+    if (options->kws_dir) {
+        struct keyword_spotter_config config;
+        keyword_spotter_config_default(&config);
+        config.threshold = options->kws_threshold;
+        pipeline->kws = keyword_spotter_create(&config);
+        pipeline->kws_buffer = malloc((size_t)KEYWORD_SPOTTER_MAX_LOOKBACK * sizeof(short));
+        if (!pipeline->kws || !pipeline->kws_buffer) {
+            return false;
+        }
+        if (options->kws) {
+            keyword_spotter_copy_templates(pipeline->kws, options->kws);
+        }
+    }
+    return true;
+}
+
+static void free_pipeline(struct clip_pipeline *pipeline)
+{
+    noise_suppressor_destroy(pipeline->denoise);
+    free(pipeline->denoise_buffer);
+    auto_gain_destroy(pipeline->agc);
+    free(pipeline->gated_buffer);
+    vad_destroy(pipeline->vad);
+    keyword_spotter_destroy(pipeline->kws);
+    free(pipeline->kws_buffer);
+}
+
+static void *worker_thread(void *data)
+{
+    struct eval_worker *worker = data;
+    struct eval_job *job = worker->job;
+    const struct eval_options *options = job->options;
+
+    struct clip_pipeline pipeline;
+    if (!init_pipeline(options, &pipeline)) {
+        fprintf(stderr, "garmin-eval: failed to create the keyword prefilter\n");
+        free_pipeline(&pipeline);
+        return NULL;
+    }
+
+    for (;;) {
+        long index = os_atomic_inc_long(&job->next_clip) - 1;
+        if (index >= job->clip_count) {
+            break;
+        }
+        decode_clip(options, worker->engine, &pipeline, options->clip_dir, &job->clips[index]);
+    }
+
+    free_pipeline(&pipeline);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Scoring
+
+// Replay the detector over a clip's results, as handle_final_result() and
+// check_partial_result() would have acted on them
+static int first_detection(const struct clip *clip, const command_table_t *commands,
+                           int sensitivity, uint64_t *position)
+{
+    bool early_fired = false;
+
+    for (int i = 0; i < clip->event_count; i++) {
+        const struct clip_event *event = &clip->events[i];
+        int command;
+        float confidence;
+
+        if (event->partial) {
+            if (early_fired) {
+                continue;
+            }
+            confidence = phrase_detector_check_partial(event->json, sensitivity, commands,
+                                                       &command);
+            early_fired = confidence > 0.5f;
+        } else {
+            bool skip = early_fired;
+            early_fired = false;
+            confidence = phrase_detector_check(event->json, sensitivity, commands, &command);
+            if (skip) {
+                continue;
+            }
+        }
+
+        if (confidence > 0.5f) {
+            *position = event->position;
+            return command;
+        }
+    }
+
+    return -1;
+}
+
+struct sensitivity_result {
+    int positives;
+    int accepted;
+    int wrong_command;       // Positive clips that triggered a different action
+    int negatives;
+    int false_accepts;
+    double negative_s;
+    double *latencies_ms;    // Phrase end to detection, accepted positives with a label
+    int latency_count;
+    int category_detections[MAX_CATEGORIES];
+};
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double *sorted, int count, double p)
+{
+    int rank = (int)(p * count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[(rank > count ? count : rank) - 1];
+}
+
+static int category_index(const char **categories, int *count, const char *category)
+{
+    for (int i = 0; i < *count; i++) {
+        if (strcmp(categories[i], category) == 0) {
+            return i;
+        }
+    }
+    if (*count == MAX_CATEGORIES) {
+        return MAX_CATEGORIES - 1;
+    }
+    categories[*count] = category;
+    return (*count)++;
+}
+
+// ---------------------------------------------------------------------------
+// Report
+
+static void write_json_string(FILE *out, const char *text)
+{
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static uint64_t peak_memory_bytes(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (uint64_t)counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (uint64_t)usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static void write_report(FILE *out, const struct eval_options *options,
+                         const command_table_t *commands, struct clip *clips, int clip_count,
+                         uint64_t wall_ns)
+{
+    const char *categories[MAX_CATEGORIES];
+    int category_count = 0;
+    int *clip_category = calloc((size_t)clip_count, sizeof(int));
+    int category_clips[MAX_CATEGORIES] = {0};
+    double category_s[MAX_CATEGORIES] = {0};
+
+    double audio_s = 0.0;
+    double decoded_audio_s = 0.0;
+    uint64_t decode_ns = 0;
+    uint64_t spot_ns = 0;
+    int wakes = 0;
+    int decoded = 0;
+    if (!clip_category) {
+        return;
+    }
+    for (int i = 0; i < clip_count; i++) {
+        clip_category[i] = category_index(categories, &category_count, clips[i].category);
+        if (!clips[i].decoded) {
+            continue;
+        }
+        double clip_s = (double)clips[i].samples / AUDIO_SOURCE_SAMPLE_RATE;
+        audio_s += clip_s;
+        decoded_audio_s += (double)clips[i].samples_decoded / AUDIO_SOURCE_SAMPLE_RATE;
+        decode_ns += clips[i].decode_ns;
+        spot_ns += clips[i].spot_ns;
+        wakes += clips[i].wakes;
+        decoded++;
+        category_clips[clip_category[i]]++;
+        category_s[clip_category[i]] += clip_s;
+    }
+
+    fprintf(out, "{\n  \"config\": {\n    \"model\": ");
+    write_json_string(out, options->model_path);
+    fprintf(out, ",\n    \"threads\": %d,\n    \"vad\": %s,\n    \"vad_hangover_ms\": %d,\n"
+                 "    \"endpoint_mode\": %d,\n    \"early_stable_frames\": %d,\n"
+                 "    \"denoise\": %s,\n    \"auto_gain\": %s,\n    \"gain_db\": %.1f,\n"
+                 "    \"noise\": ",
+            options->threads, options->vad_enabled ? "true" : "false", options->vad_hangover_ms,
+            options->endpoint_mode, options->early_stable_frames,
+            options->denoise ? "true" : "false", options->auto_gain ? "true" : "false",
+            options->gain_db);
+    if (options->noise_path) {
+        write_json_string(out, options->noise_path);
+    } else {
+        fprintf(out, "null");
+    }
+    fprintf(out, ",\n    \"noise_dbfs\": %.1f,\n    \"kws\": ", options->noise_dbfs);
+    if (options->kws_dir) {
+        write_json_string(out, options->kws_dir);
+    } else {
+        fprintf(out, "null");
+    }
+    fprintf(out, ",\n    \"kws_threshold\": %.3f,\n    \"commands\": [", options->kws_threshold);
+    for (int i = 0; i < command_table_count(commands); i++) {
+        const struct garmin_command *command = command_table_get(commands, i);
+        fprintf(out, "%s{\"phrase\": ", i ? ", " : "");
+        write_json_string(out, command->phrase);
+        fprintf(out, ", \"action\": \"%s\"}", garmin_action_name(command->action));
+    }
+    fprintf(out, "]\n  },\n");
+
+    fprintf(out, "  \"clips\": %d,\n  \"decoded\": %d,\n  \"audio_s\": %.3f,\n", clip_count,
+            decoded, audio_s);
+    fprintf(out, "  \"wall_s\": %.3f,\n  \"decode_s\": %.3f,\n  \"real_time_factor\": %.4f,\n",
+            wall_ns / 1e9, decode_ns / 1e9, audio_s > 0.0 ? decode_ns / 1e9 / audio_s : 0.0);
+    fprintf(out, "  \"decoded_audio_s\": %.3f,\n", decoded_audio_s);
+    fprintf(out, "  \"peak_memory_mb\": %.1f,\n", peak_memory_bytes() / (1024.0 * 1024.0));
+
+    if (options->kws) {
+        struct keyword_spotter_stats stats;
+        keyword_spotter_get_stats(options->kws, &stats);
+        fprintf(out, "  \"kws\": {\"enrollment_clips\": %d, \"templates\": %d, \"wakes\": %d, "
+                     "\"spotter_s\": %.3f},\n",
+                options->kws_enroll_clips, stats.templates, wakes, spot_ns / 1e9);
+    } else {
+        fprintf(out, "  \"kws\": null,\n");
+    }
+
+    fprintf(out, "  \"categories\": {");
+    for (int c = 0; c < category_count; c++) {
+        fprintf(out, "%s\n    ", c ? "," : "");
+        write_json_string(out, categories[c]);
+        fprintf(out, ": {\"clips\": %d, \"audio_s\": %.3f}", category_clips[c], category_s[c]);
+    }
+    fprintf(out, "\n  },\n  \"sensitivity\": [");
+
+    double *latencies = malloc((size_t)(clip_count > 0 ? clip_count : 1) * sizeof(double));
+
+    for (int s = 0; s < options->sensitivity_count; s++) {
+        int sensitivity = options->sensitivities[s];
+        struct sensitivity_result r = {0};
+        r.latencies_ms = latencies;
+
+        for (int i = 0; i < clip_count; i++) {
+            struct clip *clip = &clips[i];
+            clip->first_action[s] = -1;
+            if (!clip->decoded) {
+                continue;
+            }
+
+            uint64_t position = 0;
+            int command = first_detection(clip, commands, sensitivity, &position);
+            int action = command >= 0 ? (int)command_table_get(commands, command)->action : -1;
+            clip->first_action[s] = action;
+            if (action >= 0) {
+                r.category_detections[clip_category[i]]++;
+            }
+
+            if (!clip->positive) {
+                r.negatives++;
+                r.negative_s += (double)clip->samples / AUDIO_SOURCE_SAMPLE_RATE;
+                if (action >= 0) {
+                    r.false_accepts++;
+                }
+                continue;
+            }
+
+            r.positives++;
+            if (action == (int)clip->expect) {
+                r.accepted++;
+                if (clip->phrase_end_s >= 0.0 && latencies) {
+                    double detected_s = (double)position / AUDIO_SOURCE_SAMPLE_RATE;
+                    r.latencies_ms[r.latency_count++] = (detected_s - clip->phrase_end_s) * 1000.0;
+                }
+            } else if (action >= 0) {
+                r.wrong_command++;
+            }
+        }
+
+        int rejected = r.positives - r.accepted;
+        fprintf(out, "%s\n    {\"value\": %d, \"positives\": %d, \"false_rejects\": %d, "
+                     "\"false_reject_rate\": %.4f, \"wrong_command\": %d,\n"
+                     "     \"negatives\": %d, \"false_accepts\": %d, \"false_accept_rate\": %.4f, "
+                     "\"false_accepts_per_hour\": %.2f,\n     \"latency_ms\": ",
+                s ? "," : "", sensitivity, r.positives, rejected,
+                r.positives ? (double)rejected / r.positives : 0.0, r.wrong_command,
+                r.negatives, r.false_accepts,
+                r.negatives ? (double)r.false_accepts / r.negatives : 0.0,
+                r.negative_s > 0.0 ? r.false_accepts * 3600.0 / r.negative_s : 0.0);
+
+        if (r.latency_count) {
+            qsort(r.latencies_ms, (size_t)r.latency_count, sizeof(double), compare_double);
+            double total = 0.0;
+            for (int i = 0; i < r.latency_count; i++) {
+                total += r.latencies_ms[i];
+            }
+            fprintf(out, "{\"count\": %d, \"mean\": %.1f, \"p50\": %.1f, \"p95\": %.1f, "
+                         "\"max\": %.1f}",
+                    r.latency_count, total / r.latency_count,
+                    percentile(r.latencies_ms, r.latency_count, 0.50),
+                    percentile(r.latencies_ms, r.latency_count, 0.95),
+                    r.latencies_ms[r.latency_count - 1]);
+        } else {
+            fprintf(out, "null");
+        }
+
+        fprintf(out, ",\n     \"detections_by_category\": {");
+        for (int c = 0; c < category_count; c++) {
+            fputs(c ? ", " : "", out);
+            write_json_string(out, categories[c]);
+            fprintf(out, ": %d", r.category_detections[c]);
+        }
+        fprintf(out, "}}");
+    }
+    free(latencies);
+    free(clip_category);
+
+    // Per clip, the first action detected at each sensitivity (null = none)
+    fprintf(out, "\n  ],\n  \"clip_results\": [");
+    for (int i = 0; i < clip_count; i++) {
+        const struct clip *clip = &clips[i];
+        fprintf(out, "%s\n    {\"clip\": ", i ? "," : "");
+        write_json_string(out, clip->path);
+        fprintf(out, ", \"expect\": \"%s\", \"audio_s\": %.3f, \"decoded_s\": %.3f, "
+                     "\"decode_ms\": %.1f, \"detected\": [",
+                clip->positive ? garmin_action_name(clip->expect) : "none",
+                (double)clip->samples / AUDIO_SOURCE_SAMPLE_RATE,
+                (double)clip->samples_decoded / AUDIO_SOURCE_SAMPLE_RATE, clip->decode_ns / 1e6);
+        for (int s = 0; s < options->sensitivity_count; s++) {
+            int action = clip->decoded ? clip->first_action[s] : -1;
+            fputs(s ? ", " : "", out);
+            if (action >= 0) {
+                fprintf(out, "\"%s\"", garmin_action_name((enum garmin_action)action));
+            } else {
+                fprintf(out, "null");
+            }
+        }
+        fprintf(out, "]%s}", clip->decoded ? "" : ", \"error\": true");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+// ---------------------------------------------------------------------------
+// Setup
+
+// Returns: Number of clips, or -1 if the labels can't be read
+static int load_labels(const char *clip_dir, struct clip **clips_out)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", clip_dir, LABELS_FILE);
+
+    FILE *file = os_fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "garmin-eval: can't open %s\n", path);
+        return -1;
+    }
+
+    struct clip *clips = NULL;
+    int count = 0, capacity = 0;
+    char line[1024];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char name[768], expect[64];
+        double phrase_end = -1.0;
+
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        int fields = sscanf(line, "%767s %63s %lf", name, expect, &phrase_end);
+        if (fields <= 0) {
+            continue;
+        }
+
+        enum garmin_action action = GARMIN_ACTION_SAVE;
+        bool positive = fields >= 2 && strcmp(expect, "none") != 0;
+        if (fields < 2 || (positive && !garmin_action_from_name(expect, &action))) {
+            fprintf(stderr, "garmin-eval: %s:%d: expected '<clip> <action|none> [phrase end s]'\n",
+                    path, line_number);
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            struct clip *grown = realloc(clips, (size_t)capacity * sizeof(*clips));
+            if (!grown) {
+                break;
+            }
+            clips = grown;
+        }
+
+        struct clip *clip = &clips[count++];
+        memset(clip, 0, sizeof(*clip));
+        clip->path = bstrdup(name);
+        clip->positive = positive;
+        clip->expect = action;
+        clip->phrase_end_s = positive && fields >= 3 ? phrase_end : -1.0;
+
+        char *slash = strrchr(clip->path, '/');
+        clip->category = slash ? bstrdup_n(clip->path, (size_t)(slash - clip->path)) : bstrdup(".");
+    }
+
+    fclose(file);
+    *clips_out = clips;
+    return count;
+}
+
+static void free_clips(struct clip *clips, int count)
+{
+    for (int i = 0; i < count; i++) {
+        for (int e = 0; e < clips[i].event_count; e++) {
+            bfree(clips[i].events[e].json);
+        }
+        free(clips[i].events);
+        bfree(clips[i].path);
+        bfree(clips[i].category);
+    }
+    free(clips);
+}
+
+// Learn the prefilter's templates from the enrollment clips, on one engine
+// since each clip learns from what the ones before it taught
+// Returns: false if the prefilter can't gate the decoder after them
+static bool enroll_keywords(struct eval_options *options, const command_table_t *commands,
+                            vosk_engine_t *engine)
+{
+    struct clip *clips = NULL;
+    int clip_count = load_labels(options->kws_dir, &clips);
+    if (clip_count <= 0) {
+        fprintf(stderr, "garmin-eval: no enrollment clips in %s\n", options->kws_dir);
+        return false;
+    }
+
+    struct clip_pipeline pipeline;
+    bool ok = init_pipeline(options, &pipeline);
+    if (ok) {
+        pipeline.learn_commands = commands;
+        for (int i = 0; i < clip_count; i++) {
+            decode_clip(options, engine, &pipeline, options->kws_dir, &clips[i]);
+        }
+
+        struct keyword_spotter_stats stats;
+        keyword_spotter_get_stats(pipeline.kws, &stats);
+        ok = keyword_spotter_ready(pipeline.kws);
+        fprintf(stderr, "garmin-eval: keyword prefilter learned %d templates from %d enrollment "
+                        "clips%s\n", stats.templates, clip_count,
+                ok ? "" : ", not enough to gate the decoder");
+        if (ok) {
+            options->kws = pipeline.kws;
+            options->kws_enroll_clips = clip_count;
+            pipeline.kws = NULL;
+        }
+    } else {
+        fprintf(stderr, "garmin-eval: failed to create the keyword prefilter\n");
+    }
+
+    free_pipeline(&pipeline);
+    free_clips(clips, clip_count);
+    return ok;
+}
+
+static bool parse_sensitivities(const char *list, struct eval_options *options)
+{
+    options->sensitivity_count = 0;
+    while (*list) {
+        char *end;
+        long value = strtol(list, &end, 10);
+        if (end == list || value < 1 || value > 100 ||
+            options->sensitivity_count == MAX_SENSITIVITIES) {
+            return false;
+        }
+        options->sensitivities[options->sensitivity_count++] = (int)value;
+        list = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return false;
+        }
+    }
+    return options->sensitivity_count > 0;
+}
+
+// "phrase=action", e.g. "clip that=save"
+static bool add_command_arg(command_table_t *commands, const char *arg)
+{
+    const char *equals = strrchr(arg, '=');
+    enum garmin_action action;
+    if (!equals || !garmin_action_from_name(equals + 1, &action)) {
+        return false;
+    }
+
+    char *phrase = bstrdup_n(arg, (size_t)(equals - arg));
+    bool added = command_table_add(commands, phrase, action);
+    bfree(phrase);
+    return added;
+}
+
+// Read the whole noise recording and work out how to scale it to noise_dbfs
+static bool load_noise(struct eval_options *options)
+{
+    struct audio_source_config config = {0};
+    config.type = AUDIO_SOURCE_FILE;
+    config.path = options->noise_path;
+
+    void *source = file_source_ops.create(&config);
+    if (!source || !file_source_ops.start(source)) {
+        fprintf(stderr, "garmin-eval: can't read noise %s\n", options->noise_path);
+        if (source) {
+            file_source_ops.destroy(source);
+        }
+        return false;
+    }
+
+    int capacity = 0;
+    double energy = 0.0;
+    for (;;) {
+        if (capacity - options->noise_count < AUDIO_BUFFER_SIZE) {
+            capacity = capacity ? capacity * 2 : AUDIO_SOURCE_SAMPLE_RATE * 10;
+            short *grown = realloc(options->noise, (size_t)capacity * sizeof(short));
+            if (!grown) {
+                break;
+            }
+            options->noise = grown;
+        }
+
+        short *chunk = options->noise + options->noise_count;
+        int count = file_source_ops.read(source, chunk, AUDIO_BUFFER_SIZE, NULL);
+        if (count < 0) {
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            energy += (double)chunk[i] * chunk[i];
+        }
+        options->noise_count += count;
+    }
+    file_source_ops.destroy(source);
+
+    if (!options->noise_count || energy <= 0.0) {
+        fprintf(stderr, "garmin-eval: noise %s is empty or silent\n", options->noise_path);
+        free(options->noise);
+        options->noise = NULL;
+        options->noise_count = 0;
+        return false;
+    }
+
+    double rms = sqrt(energy / options->noise_count);
+    options->noise_scale = (float)(32768.0 * pow(10.0, options->noise_dbfs / 20.0) / rms);
+    fprintf(stderr, "garmin-eval: mixing in %.1f s of noise at %.1f dBFS\n",
+            (double)options->noise_count / AUDIO_SOURCE_SAMPLE_RATE, options->noise_dbfs);
+    return true;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: garmin-eval --model DIR [options] CLIP_DIR\n"
+            "  --model DIR            Vosk model directory\n"
+            "  --language N           Built-in command: 0 English, 1 German, 2 French (default 0)\n"
+            "  --command PHRASE=ACTION  Custom command instead of the built-in one (repeatable)\n"
+            "  --sensitivity LIST     Comma-separated values to score (default 50,60,70,80,90)\n"
+            "  --threads N            Decoder threads (default: logical cores)\n"
+            "  --no-vad               Decode all audio instead of gating on voice activity\n"
+            "  --vad-hangover MS      Gate hangover (default %d)\n"
+            "  --endpoint N           0 default, 1 short, 2 long, 3 very long\n"
+            "  --early FRAMES         Early trigger after FRAMES x 10 ms of stable partial (default off)\n"
+            "  --denoise              Suppress stationary noise before the VAD, as the plugin's noise_suppress\n"
+            "  --agc                  Automatic gain before the VAD, as the plugin's auto_gain\n"
+            "  --noise FILE           Mix this noise recording (looped) into every clip\n"
+            "  --noise-level DBFS     RMS level of the mixed-in noise (default %.0f)\n"
+            "  --gain DB              Scale every clip first, e.g. -20 for a mic set too low\n"
+            "  --kws DIR              Keyword prefilter, its templates learned from the clips in DIR\n"
+            "  --kws-threshold X      Prefilter match threshold, 0-2 (default %.2f)\n"
+            "  --output FILE          Write the JSON report to FILE instead of stdout\n"
+            "  --verbose              Log everything the recognizer and detector log\n"
+            "CLIP_DIR must contain " LABELS_FILE ", see the top of tools/garmin-eval.c.\n",
+            VAD_DEFAULT_HANGOVER_MS, DEFAULT_NOISE_DBFS, KEYWORD_SPOTTER_DEFAULT_THRESHOLD);
+}
+
+int main(int argc, char **argv)
+{
+    struct eval_options options = {0};
+    options.vad_enabled = true;
+    options.vad_hangover_ms = VAD_DEFAULT_HANGOVER_MS;
+    options.noise_dbfs = DEFAULT_NOISE_DBFS;
+    options.kws_threshold = KEYWORD_SPOTTER_DEFAULT_THRESHOLD;
+    options.threads = os_get_logical_cores();
+    parse_sensitivities("50,60,70,80,90", &options);
+
+    command_table_t *commands = command_table_create();
+    bool custom_commands = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+
+        if (strcmp(arg, "--help") == 0) {
+            usage();
+            command_table_destroy(commands);
+            return 0;
+        } else if (strcmp(arg, "--no-vad") == 0) {
+            options.vad_enabled = false;
+            continue;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            options.verbose = true;
+            continue;
+        } else if (strcmp(arg, "--denoise") == 0) {
+            options.denoise = true;
+            continue;
+        } else if (strcmp(arg, "--agc") == 0) {
+            options.auto_gain = true;
+            continue;
+        } else if (arg[0] != '-' || !arg[1]) {
+            options.clip_dir = arg;
+            continue;
+        } else if (!value) {
+            ok = false;
+        } else if (strcmp(arg, "--model") == 0) {
+            options.model_path = value;
+        } else if (strcmp(arg, "--language") == 0) {
+            options.language = atoi(value);
+        } else if (strcmp(arg, "--command") == 0) {
+            ok = add_command_arg(commands, value);
+            custom_commands = true;
+        } else if (strcmp(arg, "--sensitivity") == 0) {
+            ok = parse_sensitivities(value, &options);
+        } else if (strcmp(arg, "--threads") == 0) {
+            options.threads = atoi(value);
+        } else if (strcmp(arg, "--vad-hangover") == 0) {
+            options.vad_hangover_ms = atoi(value);
+        } else if (strcmp(arg, "--endpoint") == 0) {
+            options.endpoint_mode = atoi(value);
+        } else if (strcmp(arg, "--early") == 0) {
+            options.early_stable_frames = atoi(value);
+        } else if (strcmp(arg, "--output") == 0) {
+            options.output_path = value;
+        } else if (strcmp(arg, "--noise") == 0) {
+            options.noise_path = value;
+        } else if (strcmp(arg, "--noise-level") == 0) {
+            options.noise_dbfs = (float)atof(value);
+        } else if (strcmp(arg, "--gain") == 0) {
+            options.gain_db = (float)atof(value);
+        } else if (strcmp(arg, "--kws") == 0) {
+            options.kws_dir = value;
+        } else if (strcmp(arg, "--kws-threshold") == 0) {
+            options.kws_threshold = (float)atof(value);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "garmin-eval: bad option %s%s%s\n", arg, value ? " " : "",
+                    value ? value : "");
+            usage();
+            command_table_destroy(commands);
+            return 2;
+        }
+        i++;
+    }
+
+    if (!options.model_path || !options.clip_dir) {
+        usage();
+        command_table_destroy(commands);
+        return 2;
+    }
+    if (options.threads < 1) {
+        options.threads = 1;
+    }
+
+    g_verbose = options.verbose;
+    base_set_log_handler(eval_log, NULL);
+
+    if (!custom_commands) {
+        command_table_add_defaults(commands, options.language);
+    }
+    command_table_finish(commands);
+
+    if (options.noise_path && !load_noise(&options)) {
+        command_table_destroy(commands);
+        return 1;
+    }
+
+    struct clip *clips = NULL;
+    int clip_count = load_labels(options.clip_dir, &clips);
+    if (clip_count <= 0) {
+        fprintf(stderr, "garmin-eval: no clips to evaluate\n");
+        free(options.noise);
+        command_table_destroy(commands);
+        return 1;
+    }
+    if (options.threads > clip_count) {
+        options.threads = clip_count;
+    }
+
+    // Engines are created up front, so the model is loaded once and shared
+    struct eval_job job = {&options, clips, clip_count, 0};
+    struct eval_worker *workers = calloc((size_t)options.threads, sizeof(*workers));
+    int worker_count = 0;
+    for (int i = 0; workers && i < options.threads; i++) {
+        vosk_engine_t *engine = vosk_engine_create(options.model_path,
+                                                   command_table_grammar(commands));
+        if (!engine) {
+            break;
+        }
+        if (options.endpoint_mode != VOSK_ENDPOINT_DEFAULT &&
+            !vosk_engine_set_endpoint_mode(engine, (enum vosk_endpoint_mode)options.endpoint_mode)) {
+            fprintf(stderr, "garmin-eval: this Vosk build can't change endpointer timing\n");
+        }
+        workers[worker_count].job = &job;
+        workers[worker_count].engine = engine;
+        worker_count++;
+    }
+
+    int exit_code = 0;
+    if (!worker_count) {
+        fprintf(stderr, "garmin-eval: failed to load %s\n", options.model_path);
+        exit_code = 1;
+    } else if (options.kws_dir && !enroll_keywords(&options, commands, workers[0].engine)) {
+        exit_code = 1;
+    } else {
+        options.threads = worker_count;
+        fprintf(stderr, "garmin-eval: %d clips, %d thread%s\n", clip_count, worker_count,
+                worker_count == 1 ? "" : "s");
+
+        uint64_t start = os_gettime_ns();
+        int started = 0;
+        for (int i = 0; i < worker_count; i++) {
+            if (pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]) == 0) {
+                started++;
+            } else {
+                break;
+            }
+        }
+        if (!started) {
+            worker_thread(&workers[0]);
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        uint64_t wall_ns = os_gettime_ns() - start;
+
+        FILE *out = options.output_path ? os_fopen(options.output_path, "wb") : stdout;
+        if (out) {
+            write_report(out, &options, commands, clips, clip_count, wall_ns);
+            if (out != stdout) {
+                fclose(out);
+            }
+        } else {
+            fprintf(stderr, "garmin-eval: can't write %s\n", options.output_path);
+            exit_code = 1;
+        }
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        vosk_engine_destroy(workers[i].engine);
+    }
+    free(workers);
+    model_cache_shutdown();
+
+    free_clips(clips, clip_count);
+    keyword_spotter_destroy(options.kws);
+    free(options.noise);
+    command_table_destroy(commands);
+    base_set_log_handler(NULL, NULL);
+    return exit_code;
+}